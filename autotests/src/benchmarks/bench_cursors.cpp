@@ -0,0 +1,90 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+
+#include <katedocument.h>
+#include <kateglobal.h>
+#include <ktexteditor/movingcursor.h>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+/**
+ * Type into one line of a block while the block holds many cursors on its other lines,
+ * like bookmarks, search results or diagnostics would add.
+ */
+static void benchmark(int cursors, int keystrokes)
+{
+    KTextEditor::DocumentPrivate doc;
+    QStringList l;
+    for (int i = 0; i < 64; ++i) {
+        l.append(QStringLiteral("    if (value > 0) { result += compute(value, \"text\"); } // comment"));
+    }
+    doc.setText(l);
+
+    std::vector<std::unique_ptr<KTextEditor::MovingCursor>> movingCursors;
+    movingCursors.reserve(cursors);
+    for (int i = 0; i < cursors; ++i) {
+        // keep the typed into line free of cursors
+        movingCursors.emplace_back(doc.newMovingCursor(KTextEditor::Cursor(1 + i % 63, i % 60)));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < keystrokes; ++i) {
+        doc.insertText(KTextEditor::Cursor(0, 4), QStringLiteral("x"));
+    }
+    const qint64 typing = timer.nsecsElapsed();
+
+    timer.start();
+    for (int i = 0; i < keystrokes; ++i) {
+        doc.removeText(KTextEditor::Range(0, 4, 0, 5));
+    }
+    const qint64 deleting = timer.nsecsElapsed();
+
+    timer.start();
+    for (int i = 0; i < keystrokes; ++i) {
+        doc.insertText(KTextEditor::Cursor(0, 0), QStringLiteral("\n"));
+        doc.removeText(KTextEditor::Range(0, 0, 1, 0));
+    }
+    const qint64 wrapping = timer.nsecsElapsed();
+
+    printf("%d cursors, %d keystrokes: typing avg %.3f us, deleting avg %.3f us, wrap and unwrap avg %.3f us\n",
+           cursors,
+           keystrokes,
+           typing / double(keystrokes) / 1000.0,
+           deleting / double(keystrokes) / 1000.0,
+           wrapping / double(keystrokes) / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for editing a text block holding many moving cursors"));
+    p.addHelpOption();
+    QCommandLineOption iterOpt(QStringLiteral("i"), QStringLiteral("Number of keystrokes"), QStringLiteral("iters"), QStringLiteral("10000"));
+    p.addOption(iterOpt);
+    QCommandLineOption cursorsOpt(QStringLiteral("c"), QStringLiteral("Number of cursors"), QStringLiteral("cursors"), QStringLiteral("10000"));
+    p.addOption(cursorsOpt);
+
+    p.process(app);
+    bool ok = false;
+    int keystrokes = p.value(iterOpt).toInt(&ok);
+    if (!ok || keystrokes <= 0) {
+        keystrokes = 10000;
+    }
+    int cursors = p.value(cursorsOpt).toInt(&ok);
+    if (!ok || cursors <= 0) {
+        cursors = 10000;
+    }
+
+    benchmark(0, keystrokes);
+    benchmark(cursors, keystrokes);
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+
+#include <KMainWindow>
+#include <katedocument.h>
+#include <kateglobal.h>
+#include <kateundomanager.h>
+#include <kateview.h>
+
+#include <algorithm>
+#include <cstdio>
+
+/**
+ * Type with one cursor on each of the given number of lines, then undo and redo it all.
+ */
+static void benchmark(int cursors, int keystrokes)
+{
+    KMainWindow w;
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, &w);
+    w.setCentralWidget(view);
+    w.resize(1000, 800);
+    w.show();
+
+    QStringList l;
+    l.reserve(cursors);
+    for (int i = 0; i < cursors; ++i) {
+        l.append(QStringLiteral("    result += compute(value, \"text\"); // comment"));
+    }
+    doc.setText(l);
+    doc.undoManager()->undoSafePoint();
+
+    QList<KTextEditor::Cursor> positions;
+    positions.reserve(cursors);
+    for (int i = 0; i < cursors; ++i) {
+        positions.append(KTextEditor::Cursor(i, 4));
+    }
+    view->setCursors(positions);
+    QApplication::processEvents();
+
+    QElapsedTimer timer;
+    qint64 slowest = 0;
+    qint64 typing = 0;
+    for (int i = 0; i < keystrokes; ++i) {
+        timer.start();
+        doc.typeChars(view, QStringLiteral("x"));
+        const qint64 keystroke = timer.nsecsElapsed();
+        typing += keystroke;
+        slowest = std::max(slowest, keystroke);
+        QApplication::processEvents();
+    }
+
+    timer.start();
+    doc.undo();
+    const qint64 undo = timer.nsecsElapsed();
+    timer.start();
+    doc.redo();
+    const qint64 redo = timer.nsecsElapsed();
+
+    printf("%d cursors, %d keystrokes: keystroke avg %.3f ms, slowest %.3f ms, %u undo groups, undo %.3f ms, redo %.3f ms\n",
+           cursors,
+           keystrokes,
+           typing / double(keystrokes) / 1000000.0,
+           slowest / 1000000.0,
+           doc.undoManager()->undoCount(),
+           undo / 1000000.0,
+           redo / 1000000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for typing with multiple cursors"));
+    p.addHelpOption();
+    QCommandLineOption iterOpt(QStringLiteral("i"), QStringLiteral("Number of keystrokes"), QStringLiteral("iters"), QStringLiteral("50"));
+    p.addOption(iterOpt);
+    QCommandLineOption cursorsOpt(QStringLiteral("c"), QStringLiteral("Number of cursors"), QStringLiteral("cursors"), QStringLiteral("5000"));
+    p.addOption(cursorsOpt);
+
+    p.process(app);
+    bool ok = false;
+    int keystrokes = p.value(iterOpt).toInt(&ok);
+    if (!ok || keystrokes <= 0) {
+        keystrokes = 50;
+    }
+    int cursors = p.value(cursorsOpt).toInt(&ok);
+    if (!ok || cursors <= 0) {
+        cursors = 5000;
+    }
+
+    benchmark(1, keystrokes);
+    benchmark(cursors / 10, keystrokes);
+    benchmark(cursors, keystrokes);
+
+    return 0;
+}
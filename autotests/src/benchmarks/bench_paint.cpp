@@ -0,0 +1,100 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFontDatabase>
+
+#include <KMainWindow>
+#include <kateconfig.h>
+#include <katedocument.h>
+#include <katelayoutcache.h>
+#include <katerenderer.h>
+#include <kateview.h>
+#include <kateviewinternal.h>
+
+#include <cstdio>
+
+static constexpr int lines = 20000;
+
+/**
+ * Page through the document, once laying out and painting each page and once only painting it.
+ */
+static void benchmark(const char *name, const QString &extra, int frames)
+{
+    KMainWindow w;
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, &w);
+    w.setCentralWidget(view);
+    w.resize(1000, 800);
+    w.show();
+
+    view->renderer()->config()->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    KateLayoutCache *cache = view->getViewInternal()->cache();
+    cache->setPrefetchEnabled(false);
+
+    QStringList l;
+    l.reserve(lines);
+    for (int i = 0; i < lines; ++i) {
+        l.append(QStringLiteral("    if (value%1 > 0) { result += compute(value%1, \"text\"); } // comment%2").arg(i % 100).arg(extra));
+    }
+    doc.setText(l);
+    doc.setHighlightingMode(QStringLiteral("C++"));
+    QApplication::processEvents();
+
+    qint64 layoutAndPaint = 0;
+    qint64 paintOnly = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < frames; ++i) {
+        view->setScrollPosition(KTextEditor::Cursor((i * 40) % lines, 0));
+
+        const KTextEditor::Cursor start = cache->viewCacheStart();
+        const int viewLines = cache->viewCacheLineCount();
+        timer.start();
+        cache->clear();
+        cache->updateViewCache(start, viewLines);
+        view->getViewInternal()->repaint();
+        layoutAndPaint += timer.nsecsElapsed();
+
+        timer.start();
+        view->getViewInternal()->repaint();
+        paintOnly += timer.nsecsElapsed();
+
+        QApplication::processEvents();
+    }
+
+    const KateGlyphRunCache &glyphRunCache = view->renderer()->glyphRunCache();
+    printf("%s: %d frames, layout and paint avg %.3f ms, paint only avg %.3f ms, monospace line: %s, glyph run cache: %llu hits %llu misses\n",
+           name,
+           frames,
+           layoutAndPaint / double(frames) / 1000000.0,
+           paintOnly / double(frames) / 1000000.0,
+           cache->line(0)->monospaceAdvance > 0 ? "yes" : "no",
+           glyphRunCache.hits(),
+           glyphRunCache.misses());
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for laying out and painting lines in a monospace font"));
+    p.addHelpOption();
+    QCommandLineOption iterOpt(QStringLiteral("i"), QStringLiteral("Number of pages to paint"), QStringLiteral("iters"), QStringLiteral("500"));
+    p.addOption(iterOpt);
+
+    p.process(app);
+    bool ok = false;
+    int frames = p.value(iterOpt).toInt(&ok);
+    if (!ok || frames <= 0) {
+        frames = 500;
+    }
+
+    // pure ASCII takes the fast path with the glyph table, other left to right text with the glyph run cache,
+    // right to left text the QTextLayout one
+    benchmark("ascii", QString(), frames);
+    benchmark("non-ascii", QStringLiteral(" ä"), frames);
+    benchmark("fallback", QStringLiteral(" \u05e9\u05dc\u05d5\u05dd"), frames);
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+
+#include <kateconfig.h>
+#include <katedocument.h>
+#include <kateglobal.h>
+
+#include <cstdio>
+
+static constexpr int documentLines = 100000;
+
+static QStringList documentText()
+{
+    QStringList l;
+    l.reserve(documentLines);
+    for (int i = 0; i < documentLines; ++i) {
+        l.append(QStringLiteral("    if (value%1 > 0) { result += compute(value%1, \"text\"); } // comment").arg(i % 100));
+    }
+    return l;
+}
+
+/**
+ * Paste many lines at the start of a large document, once inserting them one line at a time
+ * like the paste did before, once with DocumentPrivate::insertText.
+ */
+static void benchmarkPaste(int pastedLines)
+{
+    QStringList pasted;
+    pasted.reserve(pastedLines);
+    for (int i = 0; i < pastedLines; ++i) {
+        pasted.append(QStringLiteral("pasted line %1 with some text").arg(i));
+    }
+    const QString text = pasted.join(QLatin1Char('\n'));
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(documentText());
+
+    QElapsedTimer timer;
+    timer.start();
+    doc.editStart();
+    for (int i = 0; i < pastedLines; ++i) {
+        doc.editInsertText(i, 0, pasted[i]);
+        if (i + 1 < pastedLines) {
+            doc.editWrapLine(i, pasted[i].size());
+        }
+    }
+    doc.editEnd();
+    const qint64 lineByLine = timer.nsecsElapsed();
+    const QString lineByLineText = doc.text();
+
+    doc.setText(documentText());
+    timer.start();
+    doc.insertText(KTextEditor::Cursor(0, 0), text);
+    const qint64 inOneGo = timer.nsecsElapsed();
+
+    printf("paste %d lines into %d lines: line by line %.3f ms, in one go %.3f ms%s\n",
+           pastedLines,
+           documentLines,
+           lineByLine / 1000000.0,
+           inOneGo / 1000000.0,
+           lineByLineText == doc.text() ? "" : ", TEXT DIFFERS");
+}
+
+/**
+ * Type into the middle of a single line of the given length.
+ */
+static void benchmarkLongLine(int length, int keystrokes, int chunkedLineLength)
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.config()->setChunkedLineLength(chunkedLineLength);
+    doc.setText(QString(length, QLatin1Char('x')));
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < keystrokes; ++i) {
+        doc.insertText(KTextEditor::Cursor(0, length / 2), QStringLiteral("y"));
+    }
+    const qint64 typing = timer.nsecsElapsed();
+
+    timer.start();
+    for (int i = 0; i < keystrokes; ++i) {
+        doc.removeText(KTextEditor::Range(0, length / 2, 0, length / 2 + 1));
+    }
+    const qint64 deleting = timer.nsecsElapsed();
+
+    printf("line of %d characters, %d keystrokes, chunked from %d: typing avg %.3f us, deleting avg %.3f us\n",
+           length,
+           keystrokes,
+           chunkedLineLength,
+           typing / double(keystrokes) / 1000.0,
+           deleting / double(keystrokes) / 1000.0);
+}
+
+/**
+ * Edit a single line of the given length at many places in one transaction,
+ * like typing with many cursors or replacing all matches does.
+ */
+static void benchmarkLongLineBatch(int length, int edits, int chunkedLineLength)
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.config()->setChunkedLineLength(chunkedLineLength);
+    doc.setText(QString(length, QLatin1Char('x')));
+
+    QElapsedTimer timer;
+    timer.start();
+    doc.editStart();
+    for (int i = 0; i < edits; ++i) {
+        const int column = int(qint64(length) * i / edits);
+        doc.editInsertText(0, column, QStringLiteral("yy"));
+        doc.editRemoveText(0, column + 2, 1);
+    }
+    doc.editEnd();
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    printf("line of %d characters, %d edits in one transaction, chunked from %d: %.3f ms, line length %d\n",
+           length,
+           edits,
+           chunkedLineLength,
+           elapsed / 1000000.0,
+           doc.lineLength(0));
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for pasting many lines and editing long lines, with and without chunked long lines"));
+    p.addHelpOption();
+    QCommandLineOption linesOpt(QStringLiteral("l"), QStringLiteral("Number of pasted lines"), QStringLiteral("lines"), QStringLiteral("100000"));
+    p.addOption(linesOpt);
+    QCommandLineOption iterOpt(QStringLiteral("i"), QStringLiteral("Number of keystrokes"), QStringLiteral("iters"), QStringLiteral("1000"));
+    p.addOption(iterOpt);
+
+    p.process(app);
+    bool ok = false;
+    int pastedLines = p.value(linesOpt).toInt(&ok);
+    if (!ok || pastedLines <= 0) {
+        pastedLines = 100000;
+    }
+    int keystrokes = p.value(iterOpt).toInt(&ok);
+    if (!ok || keystrokes <= 0) {
+        keystrokes = 1000;
+    }
+
+    benchmarkPaste(pastedLines / 10);
+    benchmarkPaste(pastedLines);
+
+    for (const int chunkedLineLength : {0, 65536}) {
+        benchmarkLongLine(80, keystrokes, chunkedLineLength);
+        benchmarkLongLine(1000000, keystrokes, chunkedLineLength);
+        benchmarkLongLine(10000000, keystrokes, chunkedLineLength);
+    }
+
+    for (const int chunkedLineLength : {0, 65536}) {
+        benchmarkLongLineBatch(1000000, keystrokes * 10, chunkedLineLength);
+        benchmarkLongLineBatch(10000000, keystrokes * 10, chunkedLineLength);
+    }
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFontDatabase>
+
+#include <KMainWindow>
+#include <kateconfig.h>
+#include <katedocument.h>
+#include <katelayoutcache.h>
+#include <katerenderer.h>
+#include <kateview.h>
+#include <kateviewinternal.h>
+#include <ktexteditor/attribute.h>
+#include <ktexteditor/movingrange.h>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+static constexpr int lines = 20000;
+
+/**
+ * Page through a document with many ranges with attributes, like diagnostics, spell check and
+ * search results would add, laying out and painting each page.
+ */
+static void benchmark(const char *name, int ranges, int multiLinePercent, int frames)
+{
+    KMainWindow w;
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, &w);
+    w.setCentralWidget(view);
+    w.resize(1000, 800);
+    w.show();
+
+    view->renderer()->config()->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    KateLayoutCache *cache = view->getViewInternal()->cache();
+    cache->setPrefetchEnabled(false);
+
+    QStringList l;
+    l.reserve(lines);
+    for (int i = 0; i < lines; ++i) {
+        l.append(QStringLiteral("    if (value%1 > 0) { result += compute(value%1, \"text\"); } // comment").arg(i % 100));
+    }
+    doc.setText(l);
+    doc.setHighlightingMode(QStringLiteral("C++"));
+
+    KTextEditor::Attribute::Ptr attribute(new KTextEditor::Attribute());
+    attribute->setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+    attribute->setUnderlineColor(Qt::red);
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::unique_ptr<KTextEditor::MovingRange>> movingRanges;
+    movingRanges.reserve(ranges);
+    for (int i = 0; i < ranges; ++i) {
+        const int line = (i * 7919) % lines;
+        const int column = (i * 13) % 60;
+        const bool multiLine = (i % 100) < multiLinePercent;
+        const KTextEditor::Range range(line, column, multiLine ? std::min(lines - 1, line + 1 + i % 20) : line, multiLine ? 10 : column + 5);
+        movingRanges.emplace_back(doc.newMovingRange(range));
+        movingRanges.back()->setAttribute(attribute);
+        movingRanges.back()->setZDepth(-(i % 3));
+    }
+    const qint64 setup = timer.nsecsElapsed();
+    QApplication::processEvents();
+
+    qint64 layoutAndPaint = 0;
+    for (int i = 0; i < frames; ++i) {
+        view->setScrollPosition(KTextEditor::Cursor((i * 40) % lines, 0));
+
+        const KTextEditor::Cursor start = cache->viewCacheStart();
+        const int viewLines = cache->viewCacheLineCount();
+        timer.start();
+        cache->clear();
+        cache->updateViewCache(start, viewLines);
+        view->getViewInternal()->repaint();
+        layoutAndPaint += timer.nsecsElapsed();
+
+        QApplication::processEvents();
+    }
+
+    printf("%s: %d ranges, %d%% multi-line, adding them %.3f ms, %d frames, layout and paint avg %.3f ms\n",
+           name,
+           ranges,
+           multiLinePercent,
+           setup / 1000000.0,
+           frames,
+           layoutAndPaint / double(frames) / 1000000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for painting lines with many moving ranges"));
+    p.addHelpOption();
+    QCommandLineOption iterOpt(QStringLiteral("i"), QStringLiteral("Number of pages to paint"), QStringLiteral("iters"), QStringLiteral("200"));
+    p.addOption(iterOpt);
+    QCommandLineOption rangesOpt(QStringLiteral("r"), QStringLiteral("Number of ranges"), QStringLiteral("ranges"), QStringLiteral("100000"));
+    p.addOption(rangesOpt);
+
+    p.process(app);
+    bool ok = false;
+    int frames = p.value(iterOpt).toInt(&ok);
+    if (!ok || frames <= 0) {
+        frames = 200;
+    }
+    int ranges = p.value(rangesOpt).toInt(&ok);
+    if (!ok || ranges <= 0) {
+        ranges = 100000;
+    }
+
+    benchmark("no ranges", 0, 0, frames);
+    benchmark("single-line", ranges, 0, frames);
+    benchmark("mixed", ranges, 20, frames);
+    benchmark("multi-line", ranges, 100, frames);
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+
+#include <KMainWindow>
+#include <kateconfig.h>
+#include <katedocument.h>
+#include <katesearchbar.h>
+#include <kateview.h>
+
+#include <cstdio>
+
+static constexpr int lines = 100000;
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for replace all"));
+    p.addHelpOption();
+    // number of lines, each line has 5 matches
+    QCommandLineOption iterOpt(QStringLiteral("i"),
+                               QStringLiteral("Number of lines of text in which replace will happen, each line has 5 matches"),
+                               QStringLiteral("iters"),
+                               QStringLiteral("0"));
+    p.addOption(iterOpt);
+
+    p.process(app);
+    bool ok = false;
+    int iters = p.value(iterOpt).toInt(&ok);
+
+    KMainWindow *w = new KMainWindow;
+    w->activateWindow();
+
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate view(&doc, nullptr);
+    KateViewConfig config(&view);
+    KateSearchBar bar(true, &view, &config);
+
+    int linesInText = ok ? (iters > 0 ? iters : lines) : lines;
+
+    QStringList l;
+    l.reserve(linesInText);
+    for (int i = 0; i < linesInText; ++i) {
+        l.append(QStringLiteral("This is a long long long long long sentence."));
+    }
+    doc.setText(l);
+
+    QElapsedTimer timer;
+    QObject::connect(&bar, &KateSearchBar::findOrReplaceAllFinished, [&]() {
+        printf("replaced %d matches in %lld ms\n", linesInText * 5, timer.elapsed());
+
+        timer.start();
+        doc.undo();
+        printf("undone in %lld ms\n", timer.elapsed());
+        timer.start();
+        doc.redo();
+        printf("redone in %lld ms\n", timer.elapsed());
+        w->close();
+    });
+
+    bar.setSearchMode(KateSearchBar::SearchMode::MODE_PLAIN_TEXT);
+    bar.setSearchPattern(QStringLiteral("long"));
+    bar.setReplacementPattern(QStringLiteral("short"));
+
+    timer.start();
+    bar.replaceAll();
+
+    return app.exec();
+}
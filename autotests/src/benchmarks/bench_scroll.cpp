@@ -0,0 +1,110 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+
+#include <KMainWindow>
+#include <kateconfig.h>
+#include <katedocument.h>
+#include <katelayoutcache.h>
+#include <kateview.h>
+#include <kateviewinternal.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+static constexpr int lines = 100000;
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for continuous scrolling through a dynamically wrapped document"));
+    p.addHelpOption();
+    QCommandLineOption iterOpt(QStringLiteral("i"), QStringLiteral("Number of frames to scroll"), QStringLiteral("iters"), QStringLiteral("2000"));
+    p.addOption(iterOpt);
+    QCommandLineOption noPrefetchOpt(QStringLiteral("no-prefetch"), QStringLiteral("Don't lay out lines around the view in idle time"));
+    p.addOption(noPrefetchOpt);
+    QCommandLineOption pageOpt(QStringLiteral("page"), QStringLiteral("Scroll page by page instead of three lines per frame"));
+    p.addOption(pageOpt);
+
+    p.process(app);
+    bool ok = false;
+    int frames = p.value(iterOpt).toInt(&ok);
+    if (!ok || frames <= 0) {
+        frames = 2000;
+    }
+
+    KMainWindow *w = new KMainWindow;
+
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, w);
+    w->setCentralWidget(view);
+    w->resize(800, 600);
+    w->show();
+    w->activateWindow();
+
+    view->config()->setDynWordWrap(true);
+    view->getViewInternal()->cache()->setPrefetchEnabled(!p.isSet(noPrefetchOpt));
+
+    // mix of short lines and long ones wrapping a few times
+    QStringList l;
+    l.reserve(lines);
+    for (int i = 0; i < lines; ++i) {
+        const int words = (i % 7 == 0) ? 60 : (i % 3 == 0 ? 15 : 4);
+        QString line;
+        for (int j = 0; j < words; ++j) {
+            line += QStringLiteral("word%1 ").arg((i + j) % 1000);
+        }
+        l.append(line);
+    }
+    doc.setText(l);
+    QApplication::processEvents();
+
+    std::vector<qint64> frameTimes;
+    frameTimes.reserve(frames);
+
+    QElapsedTimer total;
+    total.start();
+    QElapsedTimer timer;
+    for (int i = 0; i < frames; ++i) {
+        timer.start();
+        if (p.isSet(pageOpt)) {
+            view->pageDown();
+        } else {
+            view->scrollDown();
+            view->scrollDown();
+            view->scrollDown();
+        }
+        view->getViewInternal()->repaint();
+        frameTimes.push_back(timer.nsecsElapsed());
+
+        // idle time between two frames
+        QApplication::processEvents();
+    }
+    const qint64 totalMs = total.elapsed();
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    const auto percentile = [&frameTimes](int p) {
+        return frameTimes[std::min(frameTimes.size() - 1, frameTimes.size() * p / 100)] / 1000000.0;
+    };
+    qint64 sum = 0;
+    for (qint64 t : frameTimes) {
+        sum += t;
+    }
+
+    const KateLineLayoutCacheStatistics statistics = view->getViewInternal()->cache()->statistics();
+    printf("scrolled %d frames in %lld ms, last line %d\n", frames, totalMs, view->firstDisplayedLine());
+    printf("frame time ms: avg %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+           sum / double(frameTimes.size()) / 1000000.0,
+           percentile(50),
+           percentile(95),
+           percentile(99),
+           frameTimes.back() / 1000000.0);
+    printf("layout cache: %llu hits %llu misses %llu evictions %lld bytes\n", statistics.hits, statistics.misses, statistics.evictions, statistics.bytes);
+
+    delete w;
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <kateconfig.h>
+#include <katedocument.h>
+#include <kateglobal.h>
+
+#include <cstdio>
+
+/**
+ * Type into a document and replace in all of its lines at once, returns the time it took in ns.
+ */
+static qint64 edit(const QString &fileName, int keystrokes)
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.openUrl(QUrl::fromLocalFile(fileName));
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < keystrokes; ++i) {
+        doc.insertText(KTextEditor::Cursor(i % doc.lines(), 4), QStringLiteral("x"));
+    }
+
+    // like a replace all, many edits in one transaction
+    doc.editStart();
+    for (int line = 0; line < doc.lines(); ++line) {
+        doc.replaceText(KTextEditor::Range(line, 0, line, 4), QStringLiteral("\t"));
+    }
+    doc.editEnd();
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    // the swap file is gone with the document, don't keep its changes
+    doc.setModified(false);
+    return elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for the swap file overhead of editing"));
+    p.addHelpOption();
+    QCommandLineOption iterOpt(QStringLiteral("i"), QStringLiteral("Number of keystrokes"), QStringLiteral("iters"), QStringLiteral("20000"));
+    p.addOption(iterOpt);
+    QCommandLineOption linesOpt(QStringLiteral("l"), QStringLiteral("Number of lines"), QStringLiteral("lines"), QStringLiteral("100000"));
+    p.addOption(linesOpt);
+
+    p.process(app);
+    bool ok = false;
+    int keystrokes = p.value(iterOpt).toInt(&ok);
+    if (!ok || keystrokes <= 0) {
+        keystrokes = 20000;
+    }
+    int lines = p.value(linesOpt).toInt(&ok);
+    if (!ok || lines <= 0) {
+        lines = 100000;
+    }
+
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("bench.cpp"));
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return 1;
+    }
+    for (int i = 0; i < lines; ++i) {
+        file.write("    result += compute(value, \"text\"); // comment\n");
+    }
+    file.close();
+
+    // two edits for each line replaced
+    const int edits = keystrokes + 2 * lines;
+
+    KateDocumentConfig::global()->setSwapFileMode(KateDocumentConfig::DisableSwapFile);
+    const qint64 without = edit(fileName, keystrokes);
+    KateDocumentConfig::global()->setSwapFileMode(KateDocumentConfig::EnableSwapFile);
+    const qint64 with = edit(fileName, keystrokes);
+
+    printf("%d edits: without swap file %.3f ms, with swap file %.3f ms, overhead per edit %.3f us\n",
+           edits,
+           without / 1000000.0,
+           with / 1000000.0,
+           (with - without) / double(edits) / 1000.0);
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDataStream>
+#include <QElapsedTimer>
+
+#include <kateconfig.h>
+#include <katedocument.h>
+#include <kateglobal.h>
+#include <kateswapfile.h>
+#include <kateundomanager.h>
+
+#include <cstdio>
+
+static constexpr int lines = 10000;
+
+/**
+ * Type runs of characters into the lines, with backspaces and line breaks in between, as
+ * swap file records with one transaction for each keystroke. With a document given, the
+ * same is done to it the way the swap file recovery did it before, one transaction at a time.
+ */
+static QByteArray swapFile(int records, KTextEditor::DocumentPrivate *doc)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << QByteArray("Kate Swap File 2.0") << QByteArray();
+
+    int line = 0;
+    int column = 4;
+    for (int i = 0; i < records; ++i) {
+        stream << qint8('S');
+        if (i % 100 == 99) {
+            stream << qint8('W') << line << column;
+            if (doc) {
+                doc->editStart();
+                doc->editWrapLine(line, column, true);
+                doc->editEnd();
+            }
+            line = (line + 37) % lines;
+            column = 4;
+        } else if (i % 10 == 9) {
+            stream << qint8('R') << line << column - 1 << column;
+            if (doc) {
+                doc->editStart();
+                doc->removeText(KTextEditor::Range(line, column - 1, line, column));
+                doc->editEnd();
+            }
+            --column;
+        } else {
+            stream << qint8('I') << line << column << QByteArray("x");
+            if (doc) {
+                doc->editStart();
+                doc->insertText(KTextEditor::Cursor(line, column), QStringLiteral("x"));
+                doc->editEnd();
+            }
+            ++column;
+        }
+        stream << qint8('E');
+    }
+    return data;
+}
+
+static QStringList text()
+{
+    QStringList l;
+    l.reserve(lines);
+    for (int i = 0; i < lines; ++i) {
+        l.append(QStringLiteral("    result += compute(value, \"text\"); // comment"));
+    }
+    return l;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+    KateDocumentConfig::global()->setSwapFileMode(KateDocumentConfig::EnableSwapFile);
+
+    QCommandLineParser p;
+    p.setApplicationDescription(QStringLiteral("Performance benchmark for recovering from a swap file"));
+    p.addHelpOption();
+    QCommandLineOption iterOpt(QStringLiteral("i"), QStringLiteral("Number of records"), QStringLiteral("iters"), QStringLiteral("1000000"));
+    p.addOption(iterOpt);
+
+    p.process(app);
+    bool ok = false;
+    int records = p.value(iterOpt).toInt(&ok);
+    if (!ok || records <= 0) {
+        records = 1000000;
+    }
+
+    KTextEditor::DocumentPrivate sequential;
+    sequential.setText(text());
+    QElapsedTimer timer;
+    timer.start();
+    const QByteArray data = swapFile(records, &sequential);
+    const qint64 perTransaction = timer.nsecsElapsed();
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(text());
+    doc.undoManager()->clearUndo();
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_4_6);
+    timer.start();
+    doc.swapFile()->recover(stream, false);
+    const qint64 recovery = timer.nsecsElapsed();
+
+    printf("%d records, %lld bytes: one transaction each %.3f ms, recovery %.3f ms, %u undo groups, same text %s\n",
+           records,
+           qint64(data.size()),
+           perTransaction / 1000000.0,
+           recovery / 1000000.0,
+           doc.undoManager()->undoCount(),
+           doc.text() == sequential.text() ? "yes" : "no");
+
+    return 0;
+}
@@ -8,10 +8,19 @@
 
 #include "katetextbuffertest.h"
 #include "katebuffer.h"
+#include "kateconfig.h"
 #include "katedocument.h"
 #include "katetextfolding.h"
+#include "katetextrope.h"
 #include <kateglobal.h>
 #include <ktexteditor/movingcursor.h>
+#include <ktexteditor/movingrange.h>
+
+#include <QRandomGenerator>
+
+#include <atomic>
+#include <memory>
+#include <thread>
 
 QTEST_MAIN(KateTextBufferTest)
 
@@ -122,6 +131,78 @@ void KateTextBufferTest::insertRemoveTextTest()
     QVERIFY(buffer.text() == QLatin1String("testtext"));
 }
 
+void KateTextBufferTest::insertLinesTest()
+{
+    QStringList lines;
+    for (int i = 0; i < 300; ++i) {
+        lines << QStringLiteral("line %1").arg(i);
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(lines);
+    Kate::TextBuffer &buffer = doc.buffer();
+
+    std::unique_ptr<KTextEditor::MovingCursor> stays(doc.newMovingCursor(KTextEditor::Cursor(100, 0), KTextEditor::MovingCursor::StayOnInsert));
+    std::unique_ptr<KTextEditor::MovingCursor> moves(doc.newMovingCursor(KTextEditor::Cursor(100, 0), KTextEditor::MovingCursor::MoveOnInsert));
+    std::unique_ptr<KTextEditor::MovingCursor> behind(doc.newMovingCursor(KTextEditor::Cursor(250, 3)));
+    std::unique_ptr<KTextEditor::MovingRange> range(doc.newMovingRange(KTextEditor::Range(50, 2, 150, 4)));
+
+    // insert many more lines than fit into one block in front of line 100
+    QStringList inserted;
+    for (int i = 0; i < 1000; ++i) {
+        inserted << (i % 7 ? QStringLiteral("new %1").arg(i) : QString());
+    }
+    const qint64 revision = buffer.revision();
+    buffer.startEditing();
+    buffer.insertLines(100, inserted);
+    buffer.finishEditing();
+
+    QStringList expected = lines;
+    for (int i = 0; i < inserted.size(); ++i) {
+        expected.insert(100 + i, inserted[i]);
+    }
+    QCOMPARE(buffer.lines(), 1300);
+    QCOMPARE(buffer.text(), expected.join(QLatin1Char('\n')));
+    QCOMPARE(buffer.snapshot().text(), buffer.text());
+    QCOMPARE(buffer.line(1099).text(), QStringLiteral("new 999"));
+    QCOMPARE(buffer.line(1100).text(), QStringLiteral("line 100"));
+    QCOMPARE(buffer.line(1299).text(), QStringLiteral("line 299"));
+
+    // one revision per wrapped line and per inserted text, like wrapping and inserting one by one
+    QCOMPARE(buffer.revision(), revision + 1000 + inserted.size() - inserted.count(QString()));
+
+    QCOMPARE(stays->toCursor(), KTextEditor::Cursor(100, 0));
+    QCOMPARE(moves->toCursor(), KTextEditor::Cursor(1100, 0));
+    QCOMPARE(behind->toCursor(), KTextEditor::Cursor(1250, 3));
+    QCOMPARE(range->toRange(), KTextEditor::Range(50, 2, 1150, 4));
+
+    // the blocks split off are usable for further edits
+    doc.insertText(KTextEditor::Cursor(700, 0), QStringLiteral("x"));
+    doc.removeText(KTextEditor::Range(1200, 0, 1201, 0));
+    expected[700].prepend(QLatin1Char('x'));
+    expected.removeAt(1200);
+    QCOMPARE(doc.text(), expected.join(QLatin1Char('\n')));
+
+    // a multi-line paste ends up in the same text as before
+    doc.setText(lines);
+    const QString pasted = QStringLiteral("first\n%1\nlast").arg(inserted.join(QLatin1Char('\n')));
+    QVERIFY(doc.insertText(KTextEditor::Cursor(10, 2), pasted));
+    expected = lines;
+    const QStringList pastedLines = pasted.split(QLatin1Char('\n'));
+    expected[10] = QStringLiteral("li") + pastedLines.first();
+    for (int i = 1; i < pastedLines.size() - 1; ++i) {
+        expected.insert(10 + i, pastedLines[i]);
+    }
+    expected.insert(10 + pastedLines.size() - 1, pastedLines.last() + QStringLiteral("ne 10"));
+    QCOMPARE(doc.text(), expected.join(QLatin1Char('\n')));
+
+    // and is undone in one go
+    doc.undo();
+    QCOMPARE(doc.text(), lines.join(QLatin1Char('\n')));
+    doc.redo();
+    QCOMPARE(doc.text(), expected.join(QLatin1Char('\n')));
+}
+
 void KateTextBufferTest::cursorTest()
 {
     // last buffer content, for consistence checks
@@ -446,6 +527,279 @@ void KateTextBufferTest::saveFileInUnwritableFolder()
     QVERIFY(dir.remove());
 }
 
+void KateTextBufferTest::searchIndex()
+{
+    QStringList lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines << QStringLiteral("line %1 of some text").arg(i);
+    }
+    lines[700] = QStringLiteral("the Needle is here");
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(lines);
+    Kate::TextBuffer &buffer = doc.buffer();
+    buffer.setSearchIndexEnabled(true);
+    QTRY_VERIFY(buffer.searchIndexBuildTime() >= 0);
+    QVERIFY(buffer.searchIndexMemoryUsage() > 0);
+
+    // blocks far away from the needle are skipped, case insensitive
+    const auto needle = buffer.searchIndexTrigrams(u"needle");
+    QVERIFY(!needle.empty());
+    const int candidate = buffer.searchCandidateLine(0, needle, false);
+    QVERIFY(candidate > 0 && candidate <= 700);
+    QVERIFY(buffer.searchCandidateLine(999, needle, true) >= 700);
+    QCOMPARE(buffer.searchCandidateLine(900, needle, false), -1);
+    QCOMPARE(doc.searchText(doc.documentRange(), QStringLiteral("NEEDLE"), KTextEditor::CaseInsensitive).first(), KTextEditor::Range(700, 4, 700, 10));
+    QCOMPARE(doc.searchText(doc.documentRange(), QStringLiteral("\\bneedle\\b"), KTextEditor::Regex | KTextEditor::CaseInsensitive).first(),
+             KTextEditor::Range(700, 4, 700, 10));
+
+    // inserted and joined text is indexed right away
+    doc.insertText(KTextEditor::Cursor(100, 0), QStringLiteral("haystack"));
+    QCOMPARE(doc.searchText(doc.documentRange(), QStringLiteral("haystack"), KTextEditor::Default).first(), KTextEditor::Range(100, 0, 100, 8));
+    doc.removeText(KTextEditor::Range(300, 21, 301, 0));
+    QCOMPARE(doc.searchText(doc.documentRange(), QStringLiteral("textline 301"), KTextEditor::Default).first(), KTextEditor::Range(300, 17, 300, 29));
+
+    // disabling drops the index
+    buffer.setSearchIndexEnabled(false);
+    QCOMPARE(buffer.searchIndexMemoryUsage(), size_t(0));
+}
+
+void KateTextBufferTest::searchIndexSurrogates()
+{
+    // U+10400 and U+10428 are upper and lower case of the same letter outside of the BMP
+    const QString upper = QString::fromUcs4(U"\U00010400");
+    const QString lower = QString::fromUcs4(U"\U00010428");
+
+    QStringList lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines << QStringLiteral("line %1 of some text").arg(i);
+    }
+    lines[700] = QStringLiteral("word %1%1x here").arg(upper);
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(lines);
+    Kate::TextBuffer &buffer = doc.buffer();
+    buffer.setSearchIndexEnabled(true);
+    QTRY_VERIFY(buffer.searchIndexBuildTime() >= 0);
+
+    // the block with the match is a candidate for the other case, too
+    const QString needle = QStringLiteral("%1%1x").arg(lower);
+    QVERIFY(lines[700].indexOf(needle, 0, Qt::CaseInsensitive) >= 0);
+    const auto trigrams = buffer.searchIndexTrigrams(needle);
+    QVERIFY(!trigrams.empty());
+    const int candidate = buffer.searchCandidateLine(0, trigrams, false);
+    QVERIFY(candidate > 0 && candidate <= 700);
+    QCOMPARE(doc.searchText(doc.documentRange(), needle, KTextEditor::CaseInsensitive).first(), KTextEditor::Range(700, 5, 700, 10));
+
+    // text typed in between the units of a pair and removed again is found, too
+    doc.insertText(KTextEditor::Cursor(700, 6), QStringLiteral("y"));
+    doc.removeText(KTextEditor::Range(700, 6, 700, 7));
+    QCOMPARE(doc.searchText(doc.documentRange(), needle, KTextEditor::CaseInsensitive).first(), KTextEditor::Range(700, 5, 700, 10));
+}
+
+void KateTextBufferTest::snapshot()
+{
+    QStringList lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines << QStringLiteral("line %1 of some text").arg(i);
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(lines);
+    Kate::TextBuffer &buffer = doc.buffer();
+    const Kate::TextSnapshot snapshot = buffer.snapshot();
+    QCOMPARE(snapshot.revision(), buffer.revision());
+    QCOMPARE(snapshot.lines(), 1000);
+    QCOMPARE(snapshot.line(700).text(), lines[700]);
+    QCOMPARE(snapshot.lineLength(999), lines[999].size());
+    QCOMPARE(snapshot.text(), doc.text());
+
+    // read the snapshot on other threads while the buffer is changed
+    std::atomic<bool> done = false;
+    std::atomic<int> mismatches = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            do {
+                for (int line = 0; line < snapshot.lines(); ++line) {
+                    if (snapshot.line(line).text() != lines[line]) {
+                        ++mismatches;
+                    }
+                }
+            } while (!done);
+        });
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        const int line = (i * 37) % doc.lines();
+        doc.insertText(KTextEditor::Cursor(line, 4), QStringLiteral("x"));
+        if (i % 10 == 0) {
+            doc.insertText(KTextEditor::Cursor(line, 2), QStringLiteral("\n"));
+        }
+        if (i % 15 == 0 && line + 1 < doc.lines()) {
+            doc.removeText(KTextEditor::Range(line, 0, line + 1, 0));
+        }
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    // the snapshot still has the old lines, a new one the changed ones
+    QCOMPARE(mismatches.load(), 0);
+    QCOMPARE(snapshot.text(), lines.join(QLatin1Char('\n')));
+    QVERIFY(buffer.revision() > snapshot.revision());
+    const Kate::TextSnapshot changed = buffer.snapshot();
+    QCOMPARE(changed.lines(), doc.lines());
+    QCOMPARE(changed.text(), doc.text());
+
+    // clearing the buffer leaves the snapshot alone, too
+    doc.clear();
+    QCOMPARE(snapshot.text(), lines.join(QLatin1Char('\n')));
+    QCOMPARE(buffer.snapshot().text(), QString());
+}
+
+void KateTextBufferTest::textRope()
+{
+    QRandomGenerator random(42);
+    auto randomText = [&random](int length) {
+        QString text(length, Qt::Uninitialized);
+        for (QChar &c : text) {
+            c = QChar(u'a' + random.bounded(26));
+        }
+        return text;
+    };
+
+    QString reference = randomText(3 * Kate::TextRope::ChunkSize + 17);
+    Kate::TextRope rope(reference);
+    QCOMPARE(rope.length(), reference.size());
+    QCOMPARE(rope.chunks(), 4);
+    QCOMPARE(rope.toString(), reference);
+
+    // small and large edits anywhere, the chunks stay near their wanted size
+    for (int i = 0; i < 2000; ++i) {
+        const int column = random.bounded(reference.size() + 1);
+        if (random.bounded(2) == 0) {
+            const QString text = randomText(i % 100 == 0 ? random.bounded(3 * Kate::TextRope::ChunkSize) : random.bounded(1, 20));
+            reference.insert(column, text);
+            rope.insert(column, text);
+        } else {
+            const int length = random.bounded(std::min<int>(reference.size() - column, i % 100 == 0 ? 3 * Kate::TextRope::ChunkSize : 20) + 1);
+            reference.remove(column, length);
+            rope.remove(column, length);
+        }
+        QCOMPARE(rope.length(), reference.size());
+        const int start = random.bounded(reference.size() + 1);
+        QCOMPARE(rope.mid(start, 50), reference.mid(start, 50));
+    }
+    QCOMPARE(rope.toString(), reference);
+    QVERIFY(rope.chunks() <= reference.size() / (Kate::TextRope::ChunkSize / 2) + 1);
+
+    // removing everything leaves no chunks behind
+    rope.remove(0, rope.length());
+    QCOMPARE(rope.length(), 0);
+    QCOMPARE(rope.chunks(), 0);
+    QCOMPARE(rope.toString(), QString());
+    rope.insert(0, u"abc");
+    QCOMPARE(rope.toString(), QStringLiteral("abc"));
+}
+
+void KateTextBufferTest::chunkedLines()
+{
+    QStringList lines;
+    for (int i = 0; i < 200; ++i) {
+        lines << QStringLiteral("line %1 of some text").arg(i);
+    }
+    lines[100] = QString(5000, QLatin1Char('x'));
+
+    // the same edits with and without chunked lines
+    KTextEditor::DocumentPrivate chunkedDoc;
+    chunkedDoc.config()->setChunkedLineLength(1000);
+    QCOMPARE(chunkedDoc.buffer().chunkedLineLength(), 1000);
+    KTextEditor::DocumentPrivate plainDoc;
+    plainDoc.config()->setChunkedLineLength(0);
+    QCOMPARE(plainDoc.buffer().chunkedLineLength(), 0);
+
+    std::vector<std::unique_ptr<KTextEditor::MovingCursor>> cursors[2];
+    int docIndex = 0;
+    for (auto doc : {&chunkedDoc, &plainDoc}) {
+        doc->setText(lines);
+        doc->buffer().setSearchIndexEnabled(true);
+        QTRY_VERIFY(doc->buffer().searchIndexBuildTime() >= 0);
+        for (int column = 0; column < 5000; column += 250) {
+            cursors[docIndex].emplace_back(doc->newMovingCursor(KTextEditor::Cursor(100, column), KTextEditor::MovingCursor::MoveOnInsert));
+            cursors[docIndex].emplace_back(doc->newMovingCursor(KTextEditor::Cursor(100, column), KTextEditor::MovingCursor::StayOnInsert));
+        }
+        ++docIndex;
+    }
+
+    // many edits of the long line in one transaction, reading parts of it in between
+    QString reference = lines[100];
+    const Kate::TextSnapshot before = chunkedDoc.buffer().snapshot();
+    {
+        KTextEditor::Document::EditingTransaction chunkedTransaction(&chunkedDoc);
+        KTextEditor::Document::EditingTransaction plainTransaction(&plainDoc);
+        QRandomGenerator random(42);
+        for (int i = 0; i < 1000; ++i) {
+            const int column = random.bounded(reference.size() + 1);
+            if (random.bounded(3) > 0) {
+                const QString text = QString::number(i) + QLatin1Char('_');
+                reference.insert(column, text);
+                QVERIFY(chunkedDoc.insertText(KTextEditor::Cursor(100, column), text));
+                QVERIFY(plainDoc.insertText(KTextEditor::Cursor(100, column), text));
+            } else {
+                const int length = random.bounded(1, 10);
+                QCOMPARE(chunkedDoc.text(KTextEditor::Range(100, column, 100, column + length)), reference.mid(column, length));
+                reference.remove(column, length);
+                QVERIFY(chunkedDoc.removeText(KTextEditor::Range(100, column, 100, column + length)));
+                QVERIFY(plainDoc.removeText(KTextEditor::Range(100, column, 100, column + length)));
+            }
+            QCOMPARE(chunkedDoc.lineLength(100), reference.size());
+        }
+
+        // a snapshot taken while the line is chunked has the current text
+        QCOMPARE(chunkedDoc.buffer().snapshot().line(100).text(), reference);
+        chunkedDoc.insertText(KTextEditor::Cursor(100, 0), QStringLiteral("needle"));
+        plainDoc.insertText(KTextEditor::Cursor(100, 0), QStringLiteral("needle"));
+        reference.prepend(QStringLiteral("needle"));
+    }
+    QCOMPARE(chunkedDoc.line(100), reference);
+    QCOMPARE(chunkedDoc.text(), plainDoc.text());
+    QCOMPARE(before.line(100).text(), lines[100]);
+    for (size_t i = 0; i < cursors[0].size(); ++i) {
+        QCOMPARE(cursors[0][i]->toCursor(), cursors[1][i]->toCursor());
+    }
+
+    // the inserted text is in the search index
+    const auto trigrams = chunkedDoc.buffer().searchIndexTrigrams(u"needle");
+    QVERIFY(chunkedDoc.buffer().searchCandidateLine(0, trigrams, false) <= 100);
+    QCOMPARE(chunkedDoc.searchText(chunkedDoc.documentRange(), QStringLiteral("needle"), KTextEditor::Default).first(), KTextEditor::Range(100, 0, 100, 6));
+
+    // wrapping and joining the line again, with further edits in between
+    for (auto doc : {&chunkedDoc, &plainDoc}) {
+        KTextEditor::Document::EditingTransaction transaction(doc);
+        doc->insertText(KTextEditor::Cursor(100, 2000), QStringLiteral("\n"));
+        doc->insertText(KTextEditor::Cursor(101, 10), QStringLiteral("abc"));
+        doc->removeText(KTextEditor::Range(100, 1990, 101, 5));
+        doc->insertText(KTextEditor::Cursor(100, 1995), QStringLiteral("def"));
+    }
+    QCOMPARE(chunkedDoc.text(), plainDoc.text());
+    for (size_t i = 0; i < cursors[0].size(); ++i) {
+        QCOMPARE(cursors[0][i]->toCursor(), cursors[1][i]->toCursor());
+    }
+
+    // undo restores the original text
+    while (chunkedDoc.undoCount() > 0) {
+        chunkedDoc.undo();
+    }
+    QCOMPARE(chunkedDoc.text(), lines.join(QLatin1Char('\n')));
+
+    // disabling the chunks leaves the text alone
+    chunkedDoc.insertText(KTextEditor::Cursor(100, 10), QStringLiteral("yz"));
+    chunkedDoc.config()->setChunkedLineLength(0);
+    QCOMPARE(chunkedDoc.line(100), QString(10, QLatin1Char('x')) + QStringLiteral("yz") + QString(4990, QLatin1Char('x')));
+}
+
 void KateTextBufferTest::lineLengthLimit()
 {
     // create temp dir and get file name inside
@@ -26,11 +26,17 @@ private Q_SLOTS:
     void basicBufferTest();
     void wrapLineTest();
     void insertRemoveTextTest();
+    void insertLinesTest();
     void cursorTest();
     void foldingTest();
     void nestedFoldingTest();
     void saveFileInUnwritableFolder();
     void lineLengthLimit();
+    void searchIndex();
+    void searchIndexSurrogates();
+    void snapshot();
+    void textRope();
+    void chunkedLines();
 
 #if HAVE_KAUTH
     void saveFileWithElevatedPrivileges();
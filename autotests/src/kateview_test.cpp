@@ -12,15 +12,24 @@
 #include <kateconfig.h>
 #include <katedocument.h>
 #include <kateglobal.h>
+#include <katelayoutcache.h>
+#include <katerenderer.h>
+#include <katetextrange.h>
 #include <kateview.h>
+#include <kateviewhelpers.h>
 #include <kateviewinternal.h>
 #include <ktexteditor/message.h>
 #include <ktexteditor/movingcursor.h>
 
+#include <QFontDatabase>
+#include <QPainter>
 #include <QScrollBar>
 #include <QTemporaryFile>
+#include <QtMath>
 #include <QtTestWidgets>
 
+#include <algorithm>
+
 #define testNewRow() (QTest::newRow(QStringLiteral("line %1").arg(__LINE__).toLatin1().data()))
 
 using namespace KTextEditor;
@@ -95,6 +104,304 @@ void KateViewTest::testCursorToCoordinates()
     view->cursorToCoordinate(Cursor(-1, 0));
 }
 
+void KateViewTest::testMonospaceAsciiLayout()
+{
+    KTextEditor::DocumentPrivate doc(false, false);
+    doc.setText(QStringLiteral("int main() { return 0; }\nint \u05e9\u05dc\u05d5\u05dd() { return 0; }\n\tint a;\nint m\u00e4in() { m\u00e4in(); }"));
+
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, nullptr);
+    view->renderer()->config()->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    view->show();
+
+    KateRenderer *renderer = view->renderer();
+    KateLayoutCache *cache = view->getViewInternal()->cache();
+    KateLineLayout *ascii = cache->line(0);
+    if (ascii->monospaceAdvance == 0.0) {
+        QSKIP("No monospace font with all ASCII glyphs available");
+    }
+
+    // right to left text and tabs need the full layout
+    QCOMPARE(cache->line(1)->monospaceAdvance, 0.0);
+    QCOMPARE(cache->line(2)->monospaceAdvance, 0.0);
+
+    // the arithmetic positions match the ones of the layout
+    const KateTextLayout line = ascii->viewLine(0);
+    for (int column = 0; column <= line.length(); ++column) {
+        QCOMPARE(renderer->cursorToX(line, column), int(line.lineLayout().cursorToX(column)));
+    }
+    int pastLineX = int(line.lineLayout().cursorToX(line.length()));
+    pastLineX += 2 * renderer->spaceWidth();
+    QCOMPARE(renderer->cursorToX(line, line.length() + 2, true), pastLineX);
+
+    const qreal advance = ascii->monospaceAdvance;
+    for (int column = 0; column < line.length(); ++column) {
+        const int x = int(column * advance + advance / 4);
+        QCOMPARE(renderer->xToCursor(line, x).column(), line.lineLayout().xToCursor(x));
+    }
+    QCOMPARE(renderer->xToCursor(line, -10).column(), 0);
+    QCOMPARE(renderer->xToCursor(line, 10000).column(), line.length());
+
+    // other characters take the fast path if the font shapes them on the monospace grid, the repeated token is shaped once
+    KateLineLayout *latin = cache->line(3);
+    if (latin->monospaceAdvance == 0.0) {
+        QSKIP("The monospace font doesn't shape non ASCII characters on its grid");
+    }
+    QVERIFY(renderer->glyphRunCache().hits() > 0);
+    const KateTextLayout latinLine = latin->viewLine(0);
+    for (int column = 0; column <= latinLine.length(); ++column) {
+        QCOMPARE(renderer->cursorToX(latinLine, column), int(latinLine.lineLayout().cursorToX(column)));
+    }
+}
+
+void KateViewTest::testMonospaceHighlightedLine()
+{
+    KTextEditor::DocumentPrivate doc(false, false);
+    doc.setText(QStringLiteral("int main() { return 0; }"));
+
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, nullptr);
+    view->renderer()->config()->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    view->show();
+
+    KateRenderer *renderer = view->renderer();
+    KateLayoutCache *cache = view->getViewInternal()->cache();
+    if (cache->line(0)->monospaceAdvance == 0.0) {
+        QSKIP("No monospace font with all ASCII glyphs available");
+    }
+
+    doc.setHighlightingMode(QStringLiteral("C++"));
+    cache->relayoutLines(0, 0);
+    const auto decorations = renderer->decorationsForLine(doc.kateTextLine(0), 0);
+    if (std::none_of(decorations.begin(), decorations.end(), [](const QTextLayout::FormatRange &range) {
+            return range.format.fontWeight() == QFont::Bold;
+        })) {
+        QSKIP("The theme has no bold keywords");
+    }
+
+    // bold keywords keep the fast path
+    KateLineLayout *layout = cache->line(0);
+    QVERIFY(layout->monospaceAdvance > 0.0);
+
+    // selecting a part of the line leaves the highlighting of the rest alone
+    const auto paintLine = [&]() {
+        QImage image(int(layout->monospaceAdvance * doc.lineLength(0)) + 10, renderer->lineHeight(), QImage::Format_ARGB32);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        renderer->paintTextLine(painter, cache->line(0), 0, image.width(), QRectF(image.rect()));
+        return image;
+    };
+    const QImage unselected = paintLine();
+    view->setSelection(Range(0, 0, 0, 3));
+    const QImage selected = paintLine();
+
+    // "return" and everything behind it is not selected
+    const QRect unselectedRect(qCeil(13 * layout->monospaceAdvance), 0, unselected.width() - qCeil(13 * layout->monospaceAdvance), unselected.height());
+    QCOMPARE(selected.copy(unselectedRect), unselected.copy(unselectedRect));
+    QVERIFY(selected.copy(0, 0, qFloor(3 * layout->monospaceAdvance), selected.height()) != unselected.copy(0, 0, qFloor(3 * layout->monospaceAdvance), unselected.height()));
+}
+
+void KateViewTest::testPartialRepaint()
+{
+    KTextEditor::DocumentPrivate doc(false, false);
+    QStringList lines;
+    for (int i = 0; i < 50; ++i) {
+        lines.append(QStringLiteral("line %1 with some text").arg(i));
+    }
+    doc.setText(lines);
+
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, nullptr);
+    view->resize(400, 300);
+    view->show();
+    (void)QTest::qWaitForWindowExposed(view);
+
+    KateViewInternal *viewInternal = view->getViewInternal();
+    QTRY_VERIFY(viewInternal->paintStatistics().linesPainted > 1);
+
+    // a new selection on one line repaints just that line
+    viewInternal->resetPaintStatistics();
+    view->setSelection(Range(3, 0, 3, 4));
+    QTRY_VERIFY(viewInternal->paintStatistics().linesPainted > 0);
+    QCOMPARE(viewInternal->paintStatistics().linesPainted, quint64(1));
+
+    // so does the blinking caret
+    viewInternal->resetPaintStatistics();
+    viewInternal->updateCarets();
+    QTRY_VERIFY(viewInternal->paintStatistics().linesPainted > 0);
+    QCOMPARE(viewInternal->paintStatistics().linesPainted, quint64(1));
+}
+
+void KateViewTest::testSegmentedLongLine()
+{
+    KTextEditor::DocumentPrivate doc(false, false);
+    QString text;
+    for (int i = 0; i < 20000; ++i) {
+        text += QStringLiteral("word%1 ").arg(i % 10);
+    }
+    doc.setText(text);
+
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, nullptr);
+    view->config()->setDynWordWrap(true);
+    view->resize(400, 300);
+    view->show();
+    (void)QTest::qWaitForWindowExposed(view);
+
+    // the view lines of all segments cover the line without gaps
+    const auto checkViewLines = [&doc](KateLineLayout *lineLayout) {
+        int column = 0;
+        for (int i = 0; i < lineLayout->viewLineCount(); ++i) {
+            const KateTextLayout viewLine = lineLayout->viewLine(i);
+            QCOMPARE(viewLine.startCol(), column);
+            column = viewLine.endCol();
+        }
+        QCOMPARE(column, doc.lineLength(0));
+        QCOMPARE(lineLayout->viewLineForColumn(doc.lineLength(0)), lineLayout->viewLineCount() - 1);
+    };
+
+    KateLayoutCache *cache = view->getViewInternal()->cache();
+    KateLineLayout *lineLayout = cache->line(0);
+    QVERIFY(lineLayout->isSegmented());
+    const int segments = lineLayout->segmentCount();
+    QVERIFY(segments > 1);
+    checkViewLines(lineLayout);
+
+    // typing keeps the segmentation
+    doc.insertText(Cursor(0, 100), QStringLiteral("x"));
+    lineLayout = cache->line(0);
+    QVERIFY(lineLayout->isSegmented());
+    QCOMPARE(lineLayout->segmentCount(), segments);
+    checkViewLines(lineLayout);
+
+    // moving through the line crosses segments
+    view->setCursorPosition(Cursor(0, 16 * 1024));
+    for (int i = 0; i < 2000; ++i) {
+        view->cursorLeft();
+    }
+    QCOMPARE(view->cursorPosition(), Cursor(0, 16 * 1024 - 2000));
+}
+
+void KateViewTest::testViewLineCounts()
+{
+    KTextEditor::DocumentPrivate doc(false, false);
+    QStringList lines;
+    for (int i = 0; i < 3000; ++i) {
+        lines.append(QStringLiteral("word ").repeated(i % 7 == 0 ? 60 : 2));
+    }
+    doc.setText(lines);
+
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, nullptr);
+    view->config()->setDynWordWrap(true);
+    view->resize(400, 300);
+    view->show();
+    (void)QTest::qWaitForWindowExposed(view);
+
+    // all lines get counted in idle time
+    KateLayoutCache *cache = view->getViewInternal()->cache();
+    QTRY_COMPARE(cache->estimatedViewLineCounts(), 0);
+
+    qint64 viewLines = 0;
+    for (int line = 0; line < doc.lines(); ++line) {
+        QCOMPARE(cache->viewLinesBefore(line), viewLines);
+        QCOMPARE(cache->lineForViewLine(viewLines), std::make_pair(line, 0));
+        viewLines += cache->line(line)->viewLineCount();
+    }
+    QCOMPARE(cache->totalViewLines(), viewLines);
+    QVERIFY(viewLines > doc.lines());
+
+    // folded lines don't count
+    const qint64 hidden = cache->line(1)->viewLineCount() + cache->line(2)->viewLineCount();
+    view->textFolding().newFoldingRange(KTextEditor::Range(0, 0, 2, 0), Kate::TextFolding::Folded);
+    QCOMPARE(cache->totalViewLines(), viewLines - hidden);
+    QCOMPARE(cache->viewLinesBefore(1), cache->line(0)->viewLineCount());
+    QCOMPARE(cache->lineForViewLine(cache->line(0)->viewLineCount()), std::make_pair(1, 0));
+
+    // editing keeps the counts in sync, lines changed are counted again
+    const qint64 removed = cache->line(14)->viewLineCount();
+    doc.removeLine(14);
+    QTRY_COMPARE(cache->estimatedViewLineCounts(), 0);
+    QCOMPARE(cache->totalViewLines(), viewLines - hidden - removed);
+
+    // lines far away from the view are counted again, too
+    const qint64 total = cache->totalViewLines();
+    doc.insertText(KTextEditor::Cursor(2000, 0), QStringLiteral("word ").repeated(100));
+    QVERIFY(cache->estimatedViewLineCounts() > 0);
+    QTRY_COMPARE(cache->estimatedViewLineCounts(), 0);
+    const qint64 added = cache->line(2000)->viewLineCount() - 1;
+    QVERIFY(added > 0);
+    QCOMPARE(cache->totalViewLines(), total + added);
+
+    // like all lines once the cache is cleared
+    cache->clear();
+    QTRY_COMPARE(cache->estimatedViewLineCounts(), 0);
+    QCOMPARE(cache->totalViewLines(), total + added);
+}
+
+void KateViewTest::testMiniMapTiles()
+{
+    KTextEditor::DocumentPrivate doc(false, false);
+    QStringList lines;
+    for (int i = 0; i < 5000; ++i) {
+        lines.append(QStringLiteral("int value%1 = compute(%1);").arg(i));
+    }
+    doc.setText(lines);
+
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, nullptr);
+    view->config()->setValue(KateViewConfig::ShowScrollBarMiniMap, true);
+    view->resize(400, 300);
+    view->show();
+    (void)QTest::qWaitForWindowExposed(view);
+
+    KateScrollBar *scrollBar = view->findChild<KateScrollBar *>();
+    QVERIFY(scrollBar);
+    QVERIFY(scrollBar->showMiniMap());
+
+    // the first update draws all tiles on the worker thread
+    scrollBar->updatePixmap();
+    const KateMiniMapTiles &tiles = scrollBar->miniMapTiles();
+    QTRY_VERIFY(tiles.statistics().updates > 0);
+    QVERIFY(tiles.tileCount() > 1);
+    QVERIFY(tiles.statistics().tilesRendered >= quint64(tiles.tileCount()));
+    QVERIFY(!scrollBar->grab().isNull());
+
+    // typing inside of a line only draws its tile again
+    const quint64 rendered = tiles.statistics().tilesRendered;
+    const quint64 updates = tiles.statistics().updates;
+    doc.insertText(KTextEditor::Cursor(0, 0), QStringLiteral("x"));
+    QCOMPARE(tiles.dirtyTiles(), QList<int>{0});
+    scrollBar->updatePixmap();
+    QTRY_VERIFY(tiles.statistics().updates > updates);
+    QCOMPARE(tiles.statistics().tilesRendered, rendered + 1);
+}
+
+void KateViewTest::testMiniMapIdleHighlighting()
+{
+    KTextEditor::DocumentPrivate doc(false, false);
+    QStringList lines;
+    for (int i = 0; i < 5000; ++i) {
+        lines.append(QStringLiteral("int value%1 = compute(%1);").arg(i));
+    }
+    doc.setText(lines);
+    doc.setHighlightingMode(QStringLiteral("C++"));
+
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, nullptr);
+    view->config()->setValue(KateViewConfig::ShowScrollBarMiniMap, true);
+    view->resize(400, 300);
+    view->show();
+    (void)QTest::qWaitForWindowExposed(view);
+
+    KateScrollBar *scrollBar = view->findChild<KateScrollBar *>();
+    QVERIFY(scrollBar);
+    const KateMiniMapTiles &tiles = scrollBar->miniMapTiles();
+
+    // the minimap doesn't force highlighting, only the lines in view are highlighted at first
+    QVERIFY(doc.buffer().highlightedLines() < doc.lines());
+
+    // the rest is highlighted in idle time without scrolling, the minimap recolors on its own
+    scrollBar->updatePixmap();
+    QTRY_COMPARE(doc.buffer().highlightedLines(), doc.lines());
+    QCOMPARE(view->firstDisplayedLine(), 0);
+    QTRY_VERIFY(tiles.dirtyTiles().isEmpty());
+    QTRY_VERIFY(tiles.statistics().tilesRendered > quint64(tiles.tileCount()));
+}
+
 void KateViewTest::testReloadMultipleViews()
 {
     QTemporaryFile file(QStringLiteral("XXXXXX.cpp"));
@@ -402,6 +709,40 @@ void KateViewTest::testScrollPastEndOfDocument()
     QCOMPARE(view->firstDisplayedLineInternal(KTextEditor::View::RealLine), 3);
 }
 
+void KateViewTest::testLayoutCacheMemoryBudget()
+{
+    KTextEditor::DocumentPrivate doc;
+    QStringList lines;
+    for (int i = 0; i < 2000; ++i) {
+        lines.append(QString(300, QLatin1Char('a' + i % 26)));
+    }
+    doc.setText(lines);
+
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, nullptr);
+    view->config()->setDynWordWrap(true);
+    view->resize(400, 300);
+    view->show();
+
+    KateLayoutCache *cache = view->getViewInternal()->cache();
+    const qint64 budget = 512 * 1024;
+    cache->setMemoryBudget(budget);
+
+    // scroll through the whole document, without a budget every line layout would stay
+    for (int line = 0; line < doc.lines(); line += 10) {
+        view->setScrollPosition(KTextEditor::Cursor(line, 0));
+    }
+
+    const KateLineLayoutCacheStatistics statistics = cache->statistics();
+    QVERIFY(statistics.misses >= quint64(doc.lines() / 10));
+    QVERIFY(statistics.hits > 0);
+    QVERIFY(statistics.evictions > 0);
+    QVERIFY(statistics.bytes <= budget * 2);
+
+    // lines still in view are laid out
+    QVERIFY(cache->viewCacheLineCount() > 0);
+    QVERIFY(cache->viewLine(0).isValid());
+}
+
 void KateViewTest::testFoldFirstLine()
 {
     QTemporaryFile file(QStringLiteral("XXXXXX.cpp"));
@@ -600,6 +941,84 @@ void KateViewTest::testFindSelected()
     QCOMPARE(view->cursorPosition(), cursor3);
 }
 
+void KateViewTest::testSelectionHighlights()
+{
+    KTextEditor::DocumentPrivate doc(false, false);
+    QStringList lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines.append(QStringLiteral("line %1").arg(i));
+    }
+    lines[0] = QStringLiteral("foo");
+    lines[2] = QStringLiteral("foo and foo");
+    // a duplicated line shares its text with the original one
+    const QString duplicated = QStringLiteral("foo, foo, foo");
+    lines[4] = duplicated;
+    lines[5] = duplicated;
+    lines[6] = QString();
+    lines[7] = QStringLiteral("foobar foo");
+    doc.setText(lines);
+
+    KTextEditor::ViewPrivate *view = new KTextEditor::ViewPrivate(&doc, nullptr);
+    view->resize(400, 300);
+    view->show();
+    (void)QTest::qWaitForWindowExposed(view);
+
+    auto highlightsOn = [&doc, view](int line) {
+        int count = 0;
+        for (const Kate::TextRange *range : doc.buffer().rangesForLine(line, view, true)) {
+            count += range->toRange().onSingleLine() && range->toRange().start().line() == line;
+        }
+        return count;
+    };
+    auto updateHighlights = [view]() {
+        Q_EMIT view->displayRangeChanged(view);
+    };
+
+    // whole words only
+    view->setSelection(KTextEditor::Range(0, 0, 0, 3));
+    QCOMPARE(highlightsOn(2), 2);
+    QCOMPARE(highlightsOn(4), 3);
+    QCOMPARE(highlightsOn(5), 3);
+    QCOMPARE(highlightsOn(6), 0);
+    QCOMPARE(highlightsOn(7), 1);
+
+    // scrolling away drops the highlights, scrolling back creates them again
+    view->setScrollPosition(KTextEditor::Cursor(900, 0));
+    updateHighlights();
+    QCOMPARE(highlightsOn(2), 0);
+    view->setScrollPosition(KTextEditor::Cursor(0, 0));
+    updateHighlights();
+    QCOMPARE(highlightsOn(2), 2);
+    QCOMPARE(highlightsOn(4), 3);
+    QCOMPARE(highlightsOn(5), 3);
+
+    // editing a line rescans it
+    doc.insertText(KTextEditor::Cursor(2, 0), QStringLiteral("foo "));
+    updateHighlights();
+    QCOMPARE(highlightsOn(2), 3);
+
+    // deleting a line above moves the other lines up, highlights are neither doubled nor lost
+    doc.removeLine(3);
+    updateHighlights();
+    QCOMPARE(highlightsOn(2), 3);
+    QCOMPARE(highlightsOn(3), 3);
+    QCOMPARE(highlightsOn(4), 3);
+    QCOMPARE(highlightsOn(5), 0);
+    QCOMPARE(highlightsOn(6), 1);
+
+    // same for wrapping a line above the duplicated ones
+    doc.insertText(KTextEditor::Cursor(2, 3), QStringLiteral("\n"));
+    updateHighlights();
+    QCOMPARE(highlightsOn(2), 1);
+    QCOMPARE(highlightsOn(3), 2);
+    QCOMPARE(highlightsOn(4), 3);
+    QCOMPARE(highlightsOn(5), 3);
+    QCOMPARE(highlightsOn(6), 0);
+    QCOMPARE(highlightsOn(7), 1);
+
+    delete view;
+}
+
 void KateViewTest::testTransposeWord()
 {
     KTextEditor::DocumentPrivate doc(false, false);
@@ -24,16 +24,25 @@ private Q_SLOTS:
     void testLowerCaseBlockSelection();
     void testCoordinatesToCursor();
     void testCursorToCoordinates();
+    void testMonospaceAsciiLayout();
+    void testMonospaceHighlightedLine();
     void testSelection();
     void testDeselectByArrowKeys_data();
     void testDeselectByArrowKeys();
     void testKillline();
     void testKeyDeleteBlockSelection();
     void testScrollPastEndOfDocument();
+    void testLayoutCacheMemoryBudget();
+    void testPartialRepaint();
+    void testSegmentedLongLine();
+    void testViewLineCounts();
+    void testMiniMapTiles();
+    void testMiniMapIdleHighlighting();
     void testFoldFirstLine();
     void testDragAndDrop();
     void testGotoMatchingBracket();
     void testFindSelected();
+    void testSelectionHighlights();
     void testTransposeWord();
 
     void testFindMatchingFoldingMarker();
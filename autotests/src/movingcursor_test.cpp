@@ -14,6 +14,9 @@
 
 #include <QTest>
 
+#include <memory>
+#include <vector>
+
 using namespace KTextEditor;
 
 QTEST_MAIN(MovingCursorTest)
@@ -324,3 +327,92 @@ void MovingCursorTest::testInvalidMovingCursor()
     // if it crashes: c is still in KateBuffer::m_invalidCursors -> double deletion
     delete doc;
 }
+
+void MovingCursorTest::testCursorsOnEditedLines()
+{
+    // cursors are kept by line in the blocks, edits must move them between the lines
+    KTextEditor::DocumentPrivate doc;
+    QStringList lines;
+    for (int i = 0; i < 300; ++i) {
+        lines.append(QStringLiteral("0123456789"));
+    }
+    doc.setText(lines);
+
+    std::vector<std::unique_ptr<MovingCursor>> cursors;
+    std::vector<Cursor> expected;
+    for (int line = 0; line < 300; ++line) {
+        for (int column : {0, 5, 10}) {
+            cursors.emplace_back(doc.newMovingCursor(Cursor(line, column), MovingCursor::MoveOnInsert));
+            expected.push_back(Cursor(line, column));
+        }
+    }
+    auto verify = [&]() {
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            QCOMPARE(cursors[i]->toCursor(), expected[i]);
+        }
+    };
+
+    // text inserted into a line
+    doc.insertText(Cursor(100, 5), QStringLiteral("ab"));
+    for (Cursor &c : expected) {
+        if (c.line() == 100 && c.column() >= 5) {
+            c.setColumn(c.column() + 2);
+        }
+    }
+    verify();
+
+    // text removed from a line
+    doc.removeText(Range(20, 2, 20, 7));
+    for (Cursor &c : expected) {
+        if (c.line() == 20 && c.column() > 2) {
+            c.setColumn(c.column() <= 7 ? 2 : c.column() - 5);
+        }
+    }
+    verify();
+
+    // line wrapped
+    doc.insertText(Cursor(50, 5), QStringLiteral("\n"));
+    for (Cursor &c : expected) {
+        if (c.line() > 50) {
+            c.setLine(c.line() + 1);
+        } else if (c.line() == 50 && c.column() >= 5) {
+            c = Cursor(51, c.column() - 5);
+        }
+    }
+    verify();
+
+    // line unwrapped
+    doc.removeText(Range(10, 10, 11, 0));
+    for (Cursor &c : expected) {
+        if (c.line() == 11) {
+            c = Cursor(10, c.column() + 10);
+        } else if (c.line() > 11) {
+            c.setLine(c.line() - 1);
+        }
+    }
+    verify();
+
+    // cursors moved to other lines, inside of their block and into another one
+    cursors[600]->setPosition(Cursor(201, 3));
+    expected[600] = Cursor(201, 3);
+    cursors[601]->setPosition(Cursor(5, 3));
+    expected[601] = Cursor(5, 3);
+    doc.insertText(Cursor(201, 0), QStringLiteral("x"));
+    doc.insertText(Cursor(5, 0), QStringLiteral("x"));
+    for (Cursor &c : expected) {
+        if (c.line() == 201 || c.line() == 5) {
+            c.setColumn(c.column() + 1);
+        }
+    }
+    verify();
+
+    // cursors survive clearing the document
+    doc.clear();
+    for (const auto &cursor : cursors) {
+        QCOMPARE(cursor->toCursor(), Cursor(0, 0));
+    }
+    doc.insertText(Cursor(0, 0), QStringLiteral("abc"));
+    for (const auto &cursor : cursors) {
+        QCOMPARE(cursor->toCursor(), Cursor(0, 3));
+    }
+}
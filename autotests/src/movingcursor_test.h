@@ -23,6 +23,7 @@ private Q_SLOTS:
     void testConvenienceApi();
     void testOperators();
     void testInvalidMovingCursor();
+    void testCursorsOnEditedLines();
 };
 
 #endif // KATE_MOVINGCURSOR_TEST_H
@@ -17,6 +17,8 @@
 
 #include <QTest>
 
+#include <memory>
+
 using namespace KTextEditor;
 
 QTEST_MAIN(MovingRangeTest)
@@ -512,3 +514,43 @@ void MovingRangeTest::testMultiline()
     QVERIFY(doc.buffer().rangesForLine(1, nullptr, false).contains(range));
     QVERIFY(doc.buffer().rangesForLine(2, nullptr, false).contains(range));
 }
+
+void MovingRangeTest::testMultilineRangeIndex()
+{
+    KTextEditor::DocumentPrivate doc;
+    QStringList lines;
+    for (int i = 0; i < 500; ++i) {
+        lines.append(QStringLiteral("line %1").arg(i));
+    }
+    doc.setText(lines);
+
+    // ranges of all sizes, inside of one block and spanning several ones
+    std::vector<std::unique_ptr<KTextEditor::MovingRange>> ranges;
+    for (int i = 0; i < 400; ++i) {
+        const int start = (i * 37) % 480;
+        const int end = start + 1 + (i * 13) % (i % 5 == 0 ? 200 : 10);
+        ranges.emplace_back(doc.newMovingRange({start, 1, std::min(end, 499), 2}));
+    }
+
+    // the index must find exactly the ranges a full scan finds, also after edits moved them
+    const auto check = [&]() {
+        for (int line = 0; line < doc.lines(); ++line) {
+            const QList<Kate::TextRange *> found = doc.buffer().rangesForLine(line, nullptr, false);
+            int expected = 0;
+            for (const auto &range : ranges) {
+                expected += range->start().line() <= line && line <= range->end().line();
+            }
+            QCOMPARE(found.size(), expected);
+            for (Kate::TextRange *range : found) {
+                QVERIFY(range->start().line() <= line && line <= range->end().line());
+            }
+        }
+    };
+    check();
+
+    for (int i = 0; i < 50; ++i) {
+        doc.insertText(KTextEditor::Cursor((i * 71) % doc.lines(), 3), QStringLiteral("\nnew\n"));
+        doc.removeLine((i * 53) % doc.lines());
+    }
+    check();
+}
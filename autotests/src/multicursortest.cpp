@@ -333,6 +333,59 @@ void MulticursorTest::insertAutoBrackets()
     QCOMPARE(doc->text(), QStringLiteral("(hello\n(hello"));
 }
 
+void MulticursorTest::typeWithManyCursors()
+{
+    QStringList lines;
+    for (int i = 0; i < 200; ++i) {
+        lines.append(QStringLiteral("foo"));
+    }
+    auto [doc, view] = createDocAndView(lines.join(QLatin1Char('\n')), 0, 3);
+    QList<Cursor> cursors;
+    for (int i = 0; i < 200; ++i) {
+        cursors.append(Cursor(i, 3));
+    }
+    view->setCursors(cursors);
+    QCOMPARE(view->secondaryCursors().size(), 199);
+    doc->undoManager()->undoSafePoint();
+    const uint undoCount = doc->undoManager()->undoCount();
+
+    // the lines of all secondary cursors are changed in one go
+    QList<Range> inserted;
+    connect(doc, &DocumentPrivate::textInsertedRange, doc, [&inserted](Document *, Range range) {
+        inserted.append(range);
+    });
+    doc->typeChars(view, QStringLiteral("a"));
+    doc->typeChars(view, QStringLiteral("b"));
+    QCOMPARE(inserted.size(), 400);
+    QCOMPARE(inserted.at(0), Range(1, 3, 1, 4));
+
+    for (int i = 0; i < 200; ++i) {
+        QCOMPARE(doc->line(i), QStringLiteral("fooab"));
+    }
+    QCOMPARE(view->cursorPosition(), Cursor(0, 5));
+    for (const auto &c : view->secondaryCursors()) {
+        QCOMPARE(c.cursor().column(), 5);
+    }
+
+    // each cursor typed into one undo item
+    QCOMPARE(doc->undoManager()->undoCount(), undoCount + 1);
+    doc->undo();
+    QCOMPARE(doc->text(), lines.join(QLatin1Char('\n')));
+    doc->redo();
+    for (int i = 0; i < 200; ++i) {
+        QCOMPARE(doc->line(i), QStringLiteral("fooab"));
+    }
+
+    // several cursors in one line
+    doc->setText(QStringLiteral("abc"));
+    view->setCursors({Cursor(0, 0), Cursor(0, 1), Cursor(0, 2), Cursor(0, 3)});
+    doc->undoManager()->undoSafePoint();
+    doc->typeChars(view, QStringLiteral("x"));
+    QCOMPARE(doc->text(), QStringLiteral("xaxbxcx"));
+    doc->undo();
+    QCOMPARE(doc->text(), QStringLiteral("abc"));
+}
+
 void MulticursorTest::testCreateMultiCursor()
 {
     auto [doc, view] = createDocAndView(QStringLiteral("foo\nbar\nfoo\n"), 0, 0);
@@ -36,6 +36,7 @@ private Q_SLOTS:
     static void keyReturnIndentTest();
     static void wrapSelectionWithCharsTest();
     static void insertAutoBrackets();
+    static void typeWithManyCursors();
 
     // Movement
     static void moveCharTest();
@@ -27,6 +27,12 @@ QTEST_MAIN(SearchBarTest)
 
 using namespace KTextEditor;
 
+static QList<Range> searchHighlights(KTextEditor::ViewPrivate &view)
+{
+    const std::vector<Range> ranges = view.searchHighlights().ranges();
+    return QList<Range>(ranges.begin(), ranges.end());
+}
+
 SearchBarTest::SearchBarTest()
     : QObject()
 {
@@ -334,15 +340,15 @@ void SearchBarTest::testSetSearchPattern()
     bar.setSearchPattern(QStringLiteral("a"));
     bar.findAll();
 
-    QCOMPARE(bar.m_hlRanges.size(), 3);
+    QCOMPARE(searchHighlights(view).size(), 3);
 
     bar.setSearchPattern(QStringLiteral("a "));
 
-    QCOMPARE(bar.m_hlRanges.size(), numMatches2);
+    QCOMPARE(searchHighlights(view).size(), numMatches2);
 
     bar.findAll();
 
-    QCOMPARE(bar.m_hlRanges.size(), 2);
+    QCOMPARE(searchHighlights(view).size(), 2);
 }
 
 void SearchBarTest::testSetSelectionOnly()
@@ -360,11 +366,11 @@ void SearchBarTest::testSetSelectionOnly()
     bar.setSearchPattern(QStringLiteral("a"));
     bar.findAll();
 
-    QCOMPARE(bar.m_hlRanges.size(), 3);
+    QCOMPARE(searchHighlights(view).size(), 3);
 
     bar.setSelectionOnly(true);
 
-    QCOMPARE(bar.m_hlRanges.size(), 3);
+    QCOMPARE(searchHighlights(view).size(), 3);
 }
 
 void SearchBarTest::testFindAll_data()
@@ -395,26 +401,59 @@ void SearchBarTest::testFindAll()
     bar.setSearchPattern(QStringLiteral("a"));
     bar.findAll();
 
-    QCOMPARE(bar.m_hlRanges.size(), 3);
-    QCOMPARE(bar.m_hlRanges.at(0)->toRange(), Range(0, 0, 0, 1));
-    QCOMPARE(bar.m_hlRanges.at(1)->toRange(), Range(0, 2, 0, 3));
-    QCOMPARE(bar.m_hlRanges.at(2)->toRange(), Range(0, 4, 0, 5));
+    QCOMPARE(searchHighlights(view).size(), 3);
+    QCOMPARE(searchHighlights(view).at(0), Range(0, 0, 0, 1));
+    QCOMPARE(searchHighlights(view).at(1), Range(0, 2, 0, 3));
+    QCOMPARE(searchHighlights(view).at(2), Range(0, 4, 0, 5));
 
     bar.setSearchPattern(QStringLiteral("a "));
 
-    QCOMPARE(bar.m_hlRanges.size(), numMatches2);
+    QCOMPARE(searchHighlights(view).size(), numMatches2);
 
     bar.findAll();
 
-    QCOMPARE(bar.m_hlRanges.size(), 2);
+    QCOMPARE(searchHighlights(view).size(), 2);
 
     bar.setSearchPattern(QStringLiteral("a  "));
 
-    QCOMPARE(bar.m_hlRanges.size(), numMatches4);
+    QCOMPARE(searchHighlights(view).size(), numMatches4);
+
+    bar.findAll();
+
+    QCOMPARE(searchHighlights(view).size(), 0);
+}
+
+void SearchBarTest::testFindAllFollowsEdits()
+{
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate view(&doc, nullptr);
+    KateViewConfig config(&view);
+
+    doc.setText(QStringLiteral("a a a\nb a"));
+    KateSearchBar bar(true, &view, &config);
 
+    bar.setSearchPattern(QStringLiteral("a"));
     bar.findAll();
+    QCOMPARE(searchHighlights(view).size(), 4);
+
+    // lines in front of the matches move them
+    doc.insertText(Cursor(0, 0), QStringLiteral("x\n"));
+    QCOMPARE(searchHighlights(view).size(), 4);
+    QCOMPARE(searchHighlights(view).at(0), Range(1, 0, 1, 1));
+    QCOMPARE(searchHighlights(view).at(3), Range(2, 2, 2, 3));
+
+    // text inserted at the end of a match doesn't expand it
+    doc.insertText(Cursor(1, 1), QStringLiteral("yy"));
+    QCOMPARE(searchHighlights(view).at(0), Range(1, 0, 1, 1));
+    QCOMPARE(searchHighlights(view).at(1), Range(1, 4, 1, 5));
 
-    QCOMPARE(bar.m_hlRanges.size(), 0);
+    // wrapping in front of a match on the same line
+    doc.insertText(Cursor(2, 1), QStringLiteral("\n"));
+    QCOMPARE(searchHighlights(view).at(3), Range(3, 1, 3, 2));
+
+    // a new search clears them
+    QVERIFY(bar.clearHighlights());
+    QVERIFY(searchHighlights(view).isEmpty());
 }
 
 void SearchBarTest::testReplaceInSelectionOnly()
@@ -487,18 +526,85 @@ void SearchBarTest::testReplaceAll()
     bar.setReplacementPattern(QString());
     bar.replaceAll();
 
-    QCOMPARE(bar.m_hlRanges.size(), 3);
-    QCOMPARE(bar.m_hlRanges.at(0)->toRange(), Range(0, 0, 0, 0));
-    QCOMPARE(bar.m_hlRanges.at(1)->toRange(), Range(0, 1, 0, 1));
-    QCOMPARE(bar.m_hlRanges.at(2)->toRange(), Range(0, 2, 0, 2));
+    QCOMPARE(searchHighlights(view).size(), 3);
+    QCOMPARE(searchHighlights(view).at(0), Range(0, 0, 0, 0));
+    QCOMPARE(searchHighlights(view).at(1), Range(0, 1, 0, 1));
+    QCOMPARE(searchHighlights(view).at(2), Range(0, 2, 0, 2));
 
     bar.setSearchPattern(QStringLiteral(" "));
     bar.setReplacementPattern(QStringLiteral("b"));
     bar.replaceAll();
 
-    QCOMPARE(bar.m_hlRanges.size(), 2);
-    QCOMPARE(bar.m_hlRanges.at(0)->toRange(), Range(0, 0, 0, 1));
-    QCOMPARE(bar.m_hlRanges.at(1)->toRange(), Range(0, 1, 0, 2));
+    QCOMPARE(searchHighlights(view).size(), 2);
+    QCOMPARE(searchHighlights(view).at(0), Range(0, 0, 0, 1));
+    QCOMPARE(searchHighlights(view).at(1), Range(0, 1, 0, 2));
+}
+
+void SearchBarTest::testReplaceAllManyPerLine()
+{
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate view(&doc, nullptr);
+    KateViewConfig config(&view);
+
+    doc.setText(QStringLiteral("a-a-a\nxax\n\naa\na\nb"));
+    KateSearchBar bar(true, &view, &config);
+
+    // several matches on one line are applied with one edit per line
+    bar.setSearchPattern(QStringLiteral("a"));
+    bar.setReplacementPattern(QStringLiteral("bb"));
+    bar.replaceAll();
+
+    QCOMPARE(doc.text(), QStringLiteral("bb-bb-bb\nxbbx\n\nbbbb\nbb\nb"));
+    QCOMPARE(searchHighlights(view).size(), 7);
+    QCOMPARE(searchHighlights(view).at(0), Range(0, 0, 0, 2));
+    QCOMPARE(searchHighlights(view).at(1), Range(0, 3, 0, 5));
+    QCOMPARE(searchHighlights(view).at(2), Range(0, 6, 0, 8));
+    QCOMPARE(searchHighlights(view).at(3), Range(1, 1, 1, 3));
+    QCOMPARE(searchHighlights(view).at(4), Range(3, 0, 3, 2));
+    QCOMPARE(searchHighlights(view).at(5), Range(3, 2, 3, 4));
+    QCOMPARE(searchHighlights(view).at(6), Range(4, 0, 4, 2));
+
+    // the whole replace is one undo step
+    doc.undo();
+    QCOMPARE(doc.text(), QStringLiteral("a-a-a\nxax\n\naa\na\nb"));
+    doc.redo();
+    QCOMPARE(doc.text(), QStringLiteral("bb-bb-bb\nxbbx\n\nbbbb\nbb\nb"));
+
+    // mixing single line and multi-line matches on the same line
+    doc.setText(QStringLiteral("xa\nxa\nx"));
+    bar.setSearchMode(KateSearchBar::MODE_REGEX);
+    bar.setSearchPattern(QStringLiteral("x|a\\n"));
+    bar.setReplacementPattern(QStringLiteral("-"));
+    bar.replaceAll();
+
+    QCOMPARE(doc.text(), QStringLiteral("-----"));
+}
+
+void SearchBarTest::testIncrementalMatchCount()
+{
+    KTextEditor::DocumentPrivate doc;
+    KTextEditor::ViewPrivate view(&doc, nullptr);
+    KateViewConfig config(&view);
+
+    doc.setText(QStringLiteral("a b a\nb a\n\na"));
+    KateSearchBar bar(false, &view, &config);
+
+    // the total is counted in the background
+    bar.setSearchPattern(QStringLiteral("a"));
+    QCOMPARE(view.selectionRange(), Range(0, 0, 0, 1));
+    QTRY_COMPARE(bar.m_incUi->status->text(), QStringLiteral("Match 1 of 4"));
+
+    bar.findNext();
+    QCOMPARE(view.selectionRange(), Range(0, 4, 0, 5));
+    QCOMPARE(bar.m_incUi->status->text(), QStringLiteral("Match 2 of 4"));
+
+    // edits restart the count
+    doc.insertText(KTextEditor::Cursor(2, 0), QStringLiteral("a"));
+    QTRY_COMPARE(bar.m_incUi->status->text(), QStringLiteral("Match 2 of 5"));
+
+    // no count for a mismatch
+    bar.setSearchPattern(QStringLiteral("c"));
+    QCOMPARE(bar.m_incUi->status->text(), QStringLiteral("Not found"));
 }
 
 void SearchBarTest::testFindSelectionForward_data()
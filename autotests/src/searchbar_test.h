@@ -42,9 +42,12 @@ private Q_SLOTS:
 
     void testFindAll_data();
     void testFindAll();
+    void testFindAllFollowsEdits();
 
     void testReplaceInSelectionOnly();
     void testReplaceAll();
+    void testReplaceAllManyPerLine();
+    void testIncrementalMatchCount();
 
     void testFindSelectionForward_data();
     void testFindSelectionForward();
@@ -0,0 +1,153 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "swapfile_test.h"
+
+#include <kateconfig.h>
+#include <katedocument.h>
+#include <kateglobal.h>
+#include <kateswapfile.h>
+#include <kateundomanager.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <memory>
+
+QTEST_MAIN(SwapFileTest)
+
+using namespace KTextEditor;
+
+SwapFileTest::SwapFileTest()
+    : QObject()
+{
+    KTextEditor::EditorPrivate::enableUnitTestMode();
+}
+
+void SwapFileTest::initTestCase()
+{
+    KateDocumentConfig::global()->setSwapFileMode(KateDocumentConfig::EnableSwapFile);
+}
+
+void SwapFileTest::testCheckpoint()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("checkpoint.txt"));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    for (int i = 0; i < 100; ++i) {
+        file.write("line\n");
+    }
+    file.close();
+
+    auto doc = std::make_unique<DocumentPrivate>();
+    QVERIFY(doc->openUrl(QUrl::fromLocalFile(fileName)));
+
+    // enough edits for the log to be replaced by checkpoints
+    for (int i = 0; i < 12000; ++i) {
+        doc->insertText(Cursor(i % 100, i % 5), QString(QLatin1Char('a' + i % 26)));
+    }
+    doc->insertText(Cursor(0, 0), QStringLiteral("\n"));
+    doc->removeText(Range(50, 0, 51, 0));
+    const QString text = doc->text();
+
+    Kate::SwapFile *swapFile = doc->swapFile();
+    swapFile->flush();
+    const QString swapFileName = swapFile->fileName();
+    QFile swap(swapFileName);
+    QVERIFY(swap.open(QIODevice::ReadOnly));
+    const QByteArray data = swap.readAll();
+    swap.close();
+
+    // the swap file starts with the last checkpoint, the log before it is gone
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_4_6);
+    QByteArray header;
+    QByteArray checksum;
+    qint8 type = 0;
+    stream >> header >> checksum >> type;
+    QCOMPARE(checksum, doc->checksum());
+    QCOMPARE(type, qint8('C'));
+
+    // closing the unmodified document removes the swap file, put it back as a crash would leave it
+    doc->setModified(false);
+    doc.reset();
+    QVERIFY(!QFile::exists(swapFileName));
+    QVERIFY(swap.open(QIODevice::WriteOnly));
+    swap.write(data);
+    swap.close();
+
+    DocumentPrivate recovered;
+    QVERIFY(recovered.openUrl(QUrl::fromLocalFile(fileName)));
+    QVERIFY(recovered.isDataRecoveryAvailable());
+    recovered.recoverData();
+    QCOMPARE(recovered.text(), text);
+
+    recovered.setModified(false);
+}
+
+void SwapFileTest::testRecoverBatch()
+{
+    QStringList lines;
+    for (int i = 0; i < 100; ++i) {
+        lines.append(QStringLiteral("line %1").arg(i));
+    }
+
+    // the records of the swap file and the same changes done to a document
+    DocumentPrivate expected;
+    expected.setText(lines);
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << QByteArray("Kate Swap File 2.0") << QByteArray();
+    for (int i = 0; i < 2000; ++i) {
+        const int line = (i * 7) % 99;
+
+        // typing, then a backspace
+        stream << qint8('S') << qint8('I') << line << 4 << QByteArray("ab") << qint8('R') << line << 5 << 6 << qint8('E');
+        expected.insertText(Cursor(line, 4), QStringLiteral("ab"));
+        expected.removeText(Range(line, 5, line, 6));
+
+        // a line break and its removal
+        if (i % 50 == 0) {
+            stream << qint8('S') << qint8('W') << line << 2 << qint8('E') << qint8('S') << qint8('U') << line + 1 << qint8('E');
+            expected.insertText(Cursor(line, 2), QStringLiteral("\n"));
+            expected.removeText(Range(line, 2, line + 1, 0));
+        }
+
+        // a replace in all lines, in one transaction
+        if (i % 500 == 0) {
+            stream << qint8('S');
+            expected.editStart();
+            for (int l = 0; l < expected.lines(); ++l) {
+                stream << qint8('R') << l << 0 << 1 << qint8('I') << l << 0 << QByteArray("L");
+                expected.replaceText(Range(l, 0, l, 1), QStringLiteral("L"));
+            }
+            expected.editEnd();
+            stream << qint8('E');
+        }
+    }
+
+    DocumentPrivate doc;
+    doc.setText(lines);
+    doc.undoManager()->clearUndo();
+
+    QDataStream recoverStream(data);
+    recoverStream.setVersion(QDataStream::Qt_4_6);
+    QVERIFY(doc.swapFile()->recover(recoverStream, false));
+    QCOMPARE(doc.text(), expected.text());
+
+    // all of it is undone at once
+    QCOMPARE(doc.undoCount(), 1u);
+    doc.undo();
+    QCOMPARE(doc.textLines(doc.documentRange()), lines);
+    doc.redo();
+    QCOMPARE(doc.text(), expected.text());
+}
+
+#include "moc_swapfile_test.cpp"
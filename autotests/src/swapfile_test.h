@@ -0,0 +1,25 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_SWAPFILE_TEST_H
+#define KATE_SWAPFILE_TEST_H
+
+#include <QObject>
+
+class SwapFileTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    SwapFileTest();
+
+private Q_SLOTS:
+    void initTestCase();
+    void testCheckpoint();
+    void testRecoverBatch();
+};
+
+#endif
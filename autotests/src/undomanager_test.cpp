@@ -8,11 +8,16 @@
 
 #include "undomanager_test.h"
 
+#include <kateconfig.h>
 #include <katedocument.h>
 #include <kateglobal.h>
 #include <kateundomanager.h>
 #include <kateview.h>
+#include <ktexteditor/movingcursor.h>
 
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
 #include <QTest>
 
 QTEST_MAIN(UndoManagerTest)
@@ -278,4 +283,224 @@ void UndoManagerTest::testUndoAfterPastingWrappingLine()
     QCOMPARE(doc.text(), originalText);
 }
 
+void UndoManagerTest::testMemoryLimit()
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.config()->setUndoMemoryLimit(1);
+    KateUndoManager *undoManager = doc.undoManager();
+
+    // each step takes about 0.5 MiB
+    QStringList texts = {doc.text()};
+    for (int i = 0; i < 8; ++i) {
+        const QStringList lines(256, QString(1000, QLatin1Char('a' + i)));
+        doc.insertText(doc.documentEnd(), lines.join(QLatin1Char('\n')) + QLatin1Char('\n'));
+        undoManager->undoSafePoint();
+        texts.push_back(doc.text());
+    }
+    QCOMPARE(doc.undoCount(), 8u);
+
+    auto report = undoManager->memoryReport();
+    QCOMPARE(report.groups, 8);
+    QVERIFY(report.spilledGroups >= 6);
+    QVERIFY(report.memoryUsage <= 1024 * 1024);
+    QVERIFY(report.fileSize > 0);
+    QVERIFY(report.spilledBytes <= report.fileSize);
+    QCOMPARE(undoManager->memoryUsage(), report.memoryUsage);
+
+    // spilled steps are read back on undo and redo
+    for (int i = 7; i >= 0; --i) {
+        doc.undo();
+        QCOMPARE(doc.text(), texts[i]);
+    }
+    for (int i = 1; i <= 8; ++i) {
+        doc.redo();
+        QCOMPARE(doc.text(), texts[i]);
+    }
+    QVERIFY(undoManager->memoryReport().memoryUsage <= 1024 * 1024);
+    QCOMPARE(undoManager->memoryUsage(), undoManager->memoryReport().memoryUsage);
+
+    // editing after undo drops the spilled redo steps
+    doc.undo();
+    doc.undo();
+    doc.insertText(doc.documentEnd(), QStringLiteral("x"));
+    doc.undo();
+    QCOMPARE(doc.text(), texts[6]);
+    doc.undo();
+    QCOMPARE(doc.text(), texts[5]);
+    QCOMPARE(undoManager->memoryUsage(), undoManager->memoryReport().memoryUsage);
+
+    // the running total follows new and merged steps
+    for (int i = 0; i < 4; ++i) {
+        doc.insertText(doc.documentEnd(), QString(1000, QLatin1Char('x')));
+    }
+    QCOMPARE(undoManager->memoryUsage(), undoManager->memoryReport().memoryUsage);
+    QVERIFY(undoManager->memoryUsage() <= 1024 * 1024);
+
+    // the store is empty again without history
+    undoManager->clearUndo();
+    undoManager->clearRedo();
+    report = undoManager->memoryReport();
+    QCOMPARE(report.groups, 0);
+    QCOMPARE(report.fileSize, 0);
+    QCOMPARE(undoManager->memoryUsage(), 0);
+}
+
+void UndoManagerTest::testLostUndoStore()
+{
+    // keep the undo store in a directory of its own, to be able to break it
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    const bool hadTempDir = qEnvironmentVariableIsSet("TMPDIR");
+    const QByteArray oldTempDir = qgetenv("TMPDIR");
+    qputenv("TMPDIR", QFile::encodeName(tempDir.path()));
+
+    KTextEditor::DocumentPrivate doc;
+    doc.config()->setUndoMemoryLimit(1);
+    KateUndoManager *undoManager = doc.undoManager();
+
+    QStringList texts = {doc.text()};
+    for (int i = 0; i < 8; ++i) {
+        const QStringList lines(256, QString(1000, QLatin1Char('a' + i)));
+        doc.insertText(doc.documentEnd(), lines.join(QLatin1Char('\n')) + QLatin1Char('\n'));
+        undoManager->undoSafePoint();
+        texts.push_back(doc.text());
+    }
+    if (hadTempDir) {
+        qputenv("TMPDIR", oldTempDir);
+    } else {
+        qunsetenv("TMPDIR");
+    }
+    QVERIFY(undoManager->memoryReport().spilledGroups >= 6);
+
+    // the spilled groups can't be read back anymore
+    const QStringList storeFiles = QDir(tempDir.path()).entryList(QDir::Files);
+    QCOMPARE(storeFiles.size(), 1);
+    QFile store(tempDir.filePath(storeFiles.first()));
+    QVERIFY(store.resize(0));
+
+    // undo stops at the lost group, the older ones are dropped instead of applied to the wrong text
+    int current = 8;
+    while (doc.undoCount() > 0) {
+        const uint redoCount = doc.redoCount();
+        doc.undo();
+        if (doc.redoCount() > redoCount) {
+            --current;
+        }
+        QCOMPARE(doc.text(), texts[current]);
+    }
+    QVERIFY(current > 0);
+
+    // the groups undone before are still fine to redo
+    while (doc.redoCount() > 0) {
+        doc.redo();
+        ++current;
+        QCOMPARE(doc.text(), texts[current]);
+    }
+    QCOMPARE(current, 8);
+}
+
+void UndoManagerTest::testUndoText()
+{
+    UndoText text(QStringLiteral("abc"));
+    QVERIFY(text.isInline());
+    QCOMPARE(text.toString(), QStringLiteral("abc"));
+
+    text.prepend(u"12");
+    text.append(u"de");
+    QVERIFY(text.isInline());
+    QCOMPARE(text.toString(), QStringLiteral("12abcde"));
+
+    // grows out of the inline storage
+    text.append(u"fghijklmn");
+    QVERIFY(!text.isInline());
+    QCOMPARE(text.toString(), QStringLiteral("12abcdefghijklmn"));
+    text.prepend(u"0");
+    QCOMPARE(text.size(), qsizetype(17));
+    QCOMPARE(text.toString(), QStringLiteral("012abcdefghijklmn"));
+
+    // long text is shared, not copied
+    const QString line(1000, QLatin1Char('x'));
+    UndoText shared(line);
+    QVERIFY(!shared.isInline());
+    QVERIFY(shared.toString().isSharedWith(line));
+
+    UndoText copy = text;
+    text = QStringLiteral("x");
+    QVERIFY(text.isInline());
+    QCOMPARE(text.toString(), QStringLiteral("x"));
+    QCOMPARE(copy.toString(), QStringLiteral("012abcdefghijklmn"));
+}
+
+void UndoManagerTest::testDeleteForward()
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(QStringLiteral("0123456789"));
+    const qint64 before = doc.undoManager()->memoryReport().memoryUsage;
+
+    // like pressing the Delete key, all is folded into one item
+    for (int i = 0; i < 8; ++i) {
+        doc.removeText(KTextEditor::Range(0, 1, 0, 2));
+    }
+    QCOMPARE(doc.text(), QStringLiteral("09"));
+    QCOMPARE(doc.undoManager()->memoryReport().memoryUsage - before, qint64(sizeof(UndoItem)));
+
+    doc.undo();
+    QCOMPARE(doc.text(), QStringLiteral("0123456789"));
+    doc.redo();
+    QCOMPARE(doc.text(), QStringLiteral("09"));
+}
+
+void UndoManagerTest::testBulkUndo()
+{
+    KTextEditor::DocumentPrivate doc;
+    QStringList lines;
+    for (int i = 0; i < 100; ++i) {
+        lines.append(QStringLiteral("foo bar foo%1 foofoo").arg(i));
+    }
+    doc.setText(lines);
+    doc.undoManager()->undoSafePoint();
+    const QString original = doc.text();
+    std::unique_ptr<KTextEditor::MovingCursor> cursor(doc.newMovingCursor(KTextEditor::Cursor(50, 12)));
+
+    // replace all matches in one step, from the start to the end like the search bar does
+    doc.editStart();
+    for (int line = 0; line < doc.lines(); ++line) {
+        for (int column = doc.line(line).indexOf(QLatin1String("foo")); column != -1; column = doc.line(line).indexOf(QLatin1String("foo"), column + 1)) {
+            doc.replaceText(KTextEditor::Range(line, column, line, column + 3), QStringLiteral("x"));
+        }
+    }
+    doc.editEnd();
+    doc.undoManager()->undoSafePoint();
+    const QString replaced = doc.text();
+    QCOMPARE(doc.line(50), QStringLiteral("x bar x50 xx"));
+    QCOMPARE(cursor->toCursor(), KTextEditor::Cursor(50, 8));
+
+    // the bulk group is undone and redone in batches
+    doc.undo();
+    QCOMPARE(doc.text(), original);
+    QCOMPARE(cursor->toCursor(), KTextEditor::Cursor(50, 12));
+    doc.redo();
+    QCOMPARE(doc.text(), replaced);
+    QCOMPARE(cursor->toCursor(), KTextEditor::Cursor(50, 8));
+
+    // the same from the end to the start
+    doc.editStart();
+    for (int line = doc.lines() - 1; line >= 0; --line) {
+        for (int column = doc.line(line).lastIndexOf(QLatin1Char('x')); column != -1; column = column > 0 ? doc.line(line).lastIndexOf(QLatin1Char('x'), column - 1) : -1) {
+            doc.replaceText(KTextEditor::Range(line, column, line, column + 1), QStringLiteral("yy"));
+        }
+    }
+    doc.editEnd();
+    const QString replacedBackwards = doc.text();
+    QCOMPARE(doc.line(50), QStringLiteral("yy bar yy50 yyyy"));
+
+    doc.undo();
+    QCOMPARE(doc.text(), replaced);
+    doc.redo();
+    QCOMPARE(doc.text(), replacedBackwards);
+    doc.undo();
+    doc.undo();
+    QCOMPARE(doc.text(), original);
+}
+
 #include "moc_undomanager_test.cpp"
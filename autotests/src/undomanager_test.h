@@ -26,6 +26,11 @@ private Q_SLOTS:
     void testUndoWordWrapBug301367();
     void testUndoIndentBug373009();
     void testUndoAfterPastingWrappingLine();
+    void testMemoryLimit();
+    void testLostUndoStore();
+    void testUndoText();
+    void testDeleteForward();
+    void testBulkUndo();
 };
 
 #endif
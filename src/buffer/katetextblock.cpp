@@ -9,22 +9,67 @@
 #include "katetextcursor.h"
 #include "katetextrange.h"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
 namespace Kate
 {
+/**
+ * Size of the trigram search filter of one block in bits, must be a power of two.
+ * Each trigram sets two bits, for a full block of typical source or log lines
+ * this keeps the false candidate rate for short needles at a few percent.
+ */
+static constexpr quint32 SearchFilterBits = 16384;
+
+/**
+ * Case folded UTF-16 unit of the text at the given index. Surrogate pairs are folded as the code
+ * point they encode, like QString::indexOf() with Qt::CaseInsensitive does.
+ */
+static inline char16_t foldedUnit(QStringView text, qsizetype i)
+{
+    const QChar c = text[i];
+    if (c.isHighSurrogate() && i + 1 < text.size() && text[i + 1].isLowSurrogate()) {
+        const char32_t folded = QChar::toCaseFolded(QChar::surrogateToUcs4(c, text[i + 1]));
+        return QChar::requiresSurrogates(folded) ? QChar::highSurrogate(folded) : c.unicode();
+    }
+    if (c.isLowSurrogate() && i > 0 && text[i - 1].isHighSurrogate()) {
+        const char32_t folded = QChar::toCaseFolded(QChar::surrogateToUcs4(text[i - 1], c));
+        return QChar::requiresSurrogates(folded) ? QChar::lowSurrogate(folded) : c.unicode();
+    }
+    return c.toCaseFolded().unicode();
+}
+
+static inline quint32 trigramHash(QStringView text, qsizetype i)
+{
+    const quint64 key = (quint64(foldedUnit(text, i)) << 32) | (quint64(foldedUnit(text, i + 1)) << 16) | foldedUnit(text, i + 2);
+    return quint32((key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+static inline void setTrigramBits(std::vector<quint64> &filter, quint32 hash)
+{
+    const quint32 first = hash & (SearchFilterBits - 1);
+    const quint32 second = (hash >> 16) & (SearchFilterBits - 1);
+    filter[first / 64] |= quint64(1) << (first % 64);
+    filter[second / 64] |= quint64(1) << (second % 64);
+}
+
 TextBlock::TextBlock(TextBuffer *buffer, int startLine)
     : m_buffer(buffer)
     , m_startLine(startLine)
 {
     // reserve the block size
-    m_lines.reserve(BufferBlockSize);
+    auto lines = std::make_shared<std::vector<TextLine>>();
+    lines->reserve(BufferBlockSize);
+    m_lines = std::move(lines);
 }
 
 TextBlock::~TextBlock()
 {
     // blocks should be empty before they are deleted!
     Q_ASSERT(m_blockSize == 0);
-    Q_ASSERT(m_lines.empty());
-    Q_ASSERT(m_cursors.empty());
+    Q_ASSERT(m_lines->empty());
+    Q_ASSERT(m_cursorCount == 0);
 
     // it only is a hint for ranges for this block, not the storage of them
 }
@@ -43,8 +88,96 @@ TextLine TextBlock::line(int line) const
     // right input
     Q_ASSERT(line >= startLine());
 
+    // a chunked line needs its text first
+    if (!m_chunkedLines.empty()) {
+        if (ChunkedLine *chunked = chunkedLine(line - startLine())) {
+            joinChunkedLine(*chunked);
+        }
+    }
+
     // get text line, at will bail out on out-of-range
-    return m_lines.at(line - startLine());
+    return m_lines->at(line - startLine());
+}
+
+std::shared_ptr<const std::vector<TextLine>> TextBlock::sharedLines() const
+{
+    joinChunkedLines();
+    return m_lines;
+}
+
+TextLine TextBlock::lineMetaData(int line) const
+{
+    // right input
+    Q_ASSERT(line >= startLine());
+
+    TextLine textLine = m_lines->at(line - startLine());
+    textLine.text() = QString();
+    return textLine;
+}
+
+QString TextBlock::lineString(int line, int column, int length) const
+{
+    // right input
+    Q_ASSERT(line >= startLine());
+
+    if (const ChunkedLine *chunked = chunkedLine(line - startLine())) {
+        return chunked->text.mid(column, length);
+    }
+    return m_lines->at(line - startLine()).string(column, length);
+}
+
+std::vector<TextLine> &TextBlock::writableLines()
+{
+    // snapshots still read the lines, leave them the old ones
+    if (m_lines.use_count() > 1) {
+        m_lines = std::make_shared<std::vector<TextLine>>(*m_lines);
+    }
+
+    // a snapshot released on another thread is done reading the lines
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return const_cast<std::vector<TextLine> &>(*m_lines);
+}
+
+TextBlock::ChunkedLine *TextBlock::chunkedLineForEdit(int line)
+{
+    if (ChunkedLine *chunked = chunkedLine(line)) {
+        return chunked;
+    }
+
+    // only lines reaching the limit are worth to be split up
+    const int chunkedLineLength = m_buffer->chunkedLineLength();
+    const TextLine &textLine = m_lines->at(line);
+    if (chunkedLineLength <= 0 || textLine.length() < chunkedLineLength) {
+        return nullptr;
+    }
+
+    m_chunkedLines.push_back({line, TextRope(textLine.text())});
+    return &m_chunkedLines.back();
+}
+
+void TextBlock::joinChunkedLine(ChunkedLine &chunked) const
+{
+    if (!chunked.textStale) {
+        return;
+    }
+
+    // the lines got copied already when the text became stale, nothing shares them,
+    // this is only called on the GUI thread, other threads read snapshots
+    const_cast<TextBlock *>(this)->writableLines()[chunked.line].text() = chunked.text.toString();
+    chunked.textStale = false;
+}
+
+void TextBlock::joinChunkedLines() const
+{
+    for (ChunkedLine &chunked : m_chunkedLines) {
+        joinChunkedLine(chunked);
+    }
+}
+
+void TextBlock::flushChunkedLines()
+{
+    joinChunkedLines();
+    m_chunkedLines.clear();
 }
 
 void TextBlock::setLineMetaData(int line, const TextLine &textLine)
@@ -53,33 +186,104 @@ void TextBlock::setLineMetaData(int line, const TextLine &textLine)
     Q_ASSERT(line >= startLine());
 
     // set stuff, at will bail out on out-of-range
-    const QString originalText = m_lines.at(line - startLine()).text();
-    m_lines.at(line - startLine()) = textLine;
-    m_lines.at(line - startLine()).text() = originalText;
+    auto &textLines = writableLines();
+    const QString originalText = textLines.at(line - startLine()).text();
+    textLines.at(line - startLine()) = textLine;
+    textLines.at(line - startLine()).text() = originalText;
 }
 
 void TextBlock::appendLine(const QString &textOfLine)
 {
-    m_lines.emplace_back(textOfLine);
+    writableLines().emplace_back(textOfLine);
     m_blockSize += textOfLine.size();
+    addToSearchFilter(textOfLine, 0, textOfLine.size());
 }
 
 void TextBlock::clearLines()
 {
-    m_lines.clear();
+    m_chunkedLines.clear();
+
+    // no need to copy lines shared with snapshots just to clear them
+    if (m_lines.use_count() > 1) {
+        m_lines = std::make_shared<std::vector<TextLine>>();
+    } else {
+        writableLines().clear();
+    }
     m_blockSize = 0;
+    clearSearchFilter();
+}
+
+void TextBlock::searchTrigrams(QStringView text, std::vector<quint32> &hashes)
+{
+    for (qsizetype i = 0; i + 2 < text.size(); ++i) {
+        hashes.push_back(trigramHash(text, i));
+    }
+}
+
+void TextBlock::buildSearchFilter()
+{
+    joinChunkedLines();
+    m_searchFilter.assign(SearchFilterBits / 64, 0);
+    m_searchFilterStale = false;
+    for (const auto &line : *m_lines) {
+        addToSearchFilter(line.text(), 0, line.length());
+    }
+}
+
+bool TextBlock::mayContainTrigrams(const std::vector<quint32> &hashes) const
+{
+    if (m_searchFilter.empty()) {
+        return true;
+    }
+
+    for (const quint32 hash : hashes) {
+        const quint32 first = hash & (SearchFilterBits - 1);
+        const quint32 second = (hash >> 16) & (SearchFilterBits - 1);
+        if (!(m_searchFilter[first / 64] & (quint64(1) << (first % 64))) || !(m_searchFilter[second / 64] & (quint64(1) << (second % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TextBlock::addToSearchFilter(QStringView text, int startColumn, int endColumn)
+{
+    if (m_searchFilter.empty()) {
+        return;
+    }
+
+    // all trigrams overlapping [startColumn, endColumn) or spanning startColumn, one unit more
+    // on both sides, as surrogates next to the change might no longer belong to the same pair
+    const qsizetype end = std::min<qsizetype>(endColumn + 1, text.size() - 2);
+    for (qsizetype i = std::max(0, startColumn - 3); i < end; ++i) {
+        setTrigramBits(m_searchFilter, trigramHash(text, i));
+    }
+}
+
+void TextBlock::addToSearchFilter(const TextRope &text, int startColumn, int endColumn)
+{
+    if (m_searchFilter.empty()) {
+        return;
+    }
+
+    // the trigrams are within three units around the change, one more is needed to fold surrogates
+    const int windowStart = std::max(0, startColumn - 4);
+    const QString window = text.mid(windowStart, endColumn + 4 - windowStart);
+    addToSearchFilter(window, startColumn - windowStart, endColumn - windowStart);
 }
 
 void TextBlock::text(QString &text) const
 {
+    joinChunkedLines();
+
     // combine all lines
-    for (size_t i = 0; i < m_lines.size(); ++i) {
+    for (size_t i = 0; i < m_lines->size(); ++i) {
         // not first line, insert \n
         if (i > 0 || startLine() > 0) {
             text.append(QLatin1Char('\n'));
         }
 
-        text.append(m_lines.at(i).text());
+        text.append(m_lines->at(i).text());
     }
 }
 
@@ -87,37 +291,42 @@ void TextBlock::wrapLine(const KTextEditor::Cursor position, int fixStartLinesSt
 {
     // calc internal line
     int line = position.line() - startLine();
+    flushChunkedLines();
+    auto &textLines = writableLines();
 
     // get text, copy, we might invalidate the reference
-    const QString text = m_lines.at(line).text();
+    const QString text = textLines.at(line).text();
 
     // check if valid column
     Q_ASSERT(position.column() >= 0);
     Q_ASSERT(position.column() <= text.size());
 
     // create new line and insert it
-    m_lines.insert(m_lines.begin() + line + 1, TextLine());
+    textLines.insert(textLines.begin() + line + 1, TextLine());
 
     // cases for modification:
     // 1. line is wrapped in the middle
     // 2. if empty line is wrapped, mark new line as modified
     // 3. line-to-be-wrapped is already modified
-    if (position.column() > 0 || text.size() == 0 || m_lines.at(line).markedAsModified()) {
-        m_lines.at(line + 1).markAsModified(true);
-    } else if (m_lines.at(line).markedAsSavedOnDisk()) {
-        m_lines.at(line + 1).markAsSavedOnDisk(true);
+    if (position.column() > 0 || text.size() == 0 || textLines.at(line).markedAsModified()) {
+        textLines.at(line + 1).markAsModified(true);
+    } else if (textLines.at(line).markedAsSavedOnDisk()) {
+        textLines.at(line + 1).markAsSavedOnDisk(true);
     }
 
     // perhaps remove some text from previous line and append it
     if (position.column() < text.size()) {
         // text from old line moved first to new one
-        m_lines.at(line + 1).text() = text.right(text.size() - position.column());
+        textLines.at(line + 1).text() = text.right(text.size() - position.column());
 
         // now remove wrapped text from old line
-        m_lines.at(line).text().chop(text.size() - position.column());
+        textLines.at(line).text().chop(text.size() - position.column());
 
         // mark line as modified
-        m_lines.at(line).markAsModified(true);
+        textLines.at(line).markAsModified(true);
+
+        // trigrams spanning the wrap position are gone
+        m_searchFilterStale = hasSearchFilter();
     }
 
     // fix all start lines
@@ -132,44 +341,51 @@ void TextBlock::wrapLine(const KTextEditor::Cursor position, int fixStartLinesSt
 
     // no cursors will leave or join this block
 
-    // no cursors in this block, no work to do..
-    if (m_cursors.empty()) {
+    // no cursors on the wrapped line or behind it, no work to do..
+    if (m_cursors.size() <= size_t(line)) {
         return;
     }
 
-    // move all cursors on the line which has the text inserted
+    // the new line gets an empty bucket, the buckets behind move along with their cursors
+    m_cursors.insert(m_cursors.begin() + line + 1, std::vector<TextCursor *>());
+
     // remember all ranges modified, optimize for the standard case of a few ranges
     QVarLengthArray<TextRange *, 32> changedRanges;
-    for (TextCursor *cursor : m_cursors) {
-        // skip cursors on lines in front of the wrapped one!
-        if (cursor->lineInBlock() < line) {
-            continue;
-        }
-
-        // either this is simple, line behind the wrapped one
-        if (cursor->lineInBlock() > line) {
+    for (size_t i = line + 2; i < m_cursors.size(); ++i) {
+        for (TextCursor *cursor : m_cursors[i]) {
             // patch line of cursor
             cursor->m_line++;
-        }
 
-        // this is the wrapped line
-        else {
-            // skip cursors with too small column
-            if (cursor->column() <= position.column()) {
-                if (cursor->column() < position.column() || !cursor->m_moveOnInsert) {
-                    continue;
-                }
+            // remember range, if any, avoid double insert
+            auto range = cursor->kateRange();
+            if (range && !range->isValidityCheckRequired()) {
+                range->setValidityCheckRequired();
+                changedRanges.push_back(range);
             }
+        }
+    }
 
-            // move cursor
-
-            // patch line of cursor
-            cursor->m_line++;
+    // move the cursors of the wrapped line behind the wrap position to the new line
+    auto &wrappedCursors = m_cursors[line];
+    auto &newLineCursors = m_cursors[line + 1];
+    for (size_t i = 0; i < wrappedCursors.size();) {
+        TextCursor *cursor = wrappedCursors[i];
 
-            // patch column
-            cursor->m_column -= position.column();
+        // skip cursors with too small column
+        if (cursor->column() <= position.column()) {
+            if (cursor->column() < position.column() || !cursor->m_moveOnInsert) {
+                ++i;
+                continue;
+            }
         }
 
+        // patch line and column of cursor
+        cursor->m_line++;
+        cursor->m_column -= position.column();
+        newLineCursors.push_back(cursor);
+        wrappedCursors[i] = wrappedCursors.back();
+        wrappedCursors.pop_back();
+
         // remember range, if any, avoid double insert
         auto range = cursor->kateRange();
         if (range && !range->isValidityCheckRequired()) {
@@ -190,10 +406,90 @@ void TextBlock::wrapLine(const KTextEditor::Cursor position, int fixStartLinesSt
     }
 }
 
+void TextBlock::insertLines(int line, const QStringList &texts, int fixStartLinesStartIndex)
+{
+    // calc internal line
+    line = line - startLine();
+    flushChunkedLines();
+    auto &textLines = writableLines();
+    const int count = texts.size();
+
+    // create the new lines in one go, the line they are inserted in front of keeps its state
+    textLines.insert(textLines.begin() + line, count, TextLine());
+    for (int i = 0; i < count; ++i) {
+        TextLine &textLine = textLines[line + i];
+        textLine.text() = texts.at(i);
+        textLine.markAsModified(true);
+        m_blockSize += textLine.length();
+        addToSearchFilter(textLine.text(), 0, textLine.length());
+    }
+
+    // fix all start lines
+    // we need to do this NOW, else the range update will FAIL!
+    m_buffer->fixStartLines(fixStartLinesStartIndex);
+
+    // cursor and range handling below
+
+    // no cursors on the line or behind it, no work to do..
+    if (m_cursors.size() <= size_t(line)) {
+        return;
+    }
+
+    // the new lines get empty buckets, the buckets behind move along with their cursors
+    m_cursors.insert(m_cursors.begin() + line, count, std::vector<TextCursor *>());
+
+    // remember all ranges modified, optimize for the standard case of a few ranges
+    QVarLengthArray<TextRange *, 32> changedRanges;
+    for (size_t i = line + count; i < m_cursors.size(); ++i) {
+        for (TextCursor *cursor : m_cursors[i]) {
+            // patch line of cursor
+            cursor->m_line += count;
+
+            // remember range, if any, avoid double insert
+            auto range = cursor->kateRange();
+            if (range && !range->isValidityCheckRequired()) {
+                range->setValidityCheckRequired();
+                changedRanges.push_back(range);
+            }
+        }
+    }
+
+    // like for a wrap at the start of the line, cursors there not moving on insert stay in front
+    auto &movedCursors = m_cursors[line + count];
+    auto &firstLineCursors = m_cursors[line];
+    for (size_t i = 0; i < movedCursors.size();) {
+        TextCursor *cursor = movedCursors[i];
+        if (cursor->column() > 0 || cursor->m_moveOnInsert) {
+            ++i;
+            continue;
+        }
+
+        cursor->m_line -= count;
+        firstLineCursors.push_back(cursor);
+        movedCursors[i] = movedCursors.back();
+        movedCursors.pop_back();
+    }
+
+    // we might need to invalidate ranges or notify about their changes
+    // checkValidity might trigger delete of the range!
+    for (TextRange *range : std::as_const(changedRanges)) {
+        // we need to do updateRange to ALWAYS ensure the line => range and back cache is updated
+        updateRange(range);
+
+        // in addition: ensure that we really invalidate bad ranges!
+        range->checkValidity(range->toLineRange());
+    }
+}
+
 void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLinesStartIndex)
 {
     // calc internal line
     line = line - startLine();
+    flushChunkedLines();
+    if (previousBlock) {
+        previousBlock->flushChunkedLines();
+    }
+    auto &textLines = writableLines();
 
     // two possiblities: either first line of this block or later line
     if (line == 0) {
@@ -202,20 +498,25 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
         Q_ASSERT(previousBlock->lines() > 0);
 
         // move last line of previous block to this one, might result in empty block
-        const TextLine oldFirst = m_lines.at(0);
+        auto &previousLines = previousBlock->writableLines();
+        const TextLine oldFirst = textLines.at(0);
         int lastLineOfPreviousBlock = previousBlock->lines() - 1;
-        m_lines[0] = previousBlock->m_lines.back();
-        previousBlock->m_lines.erase(previousBlock->m_lines.begin() + (previousBlock->lines() - 1));
+        textLines[0] = previousLines.back();
+        previousLines.erase(previousLines.begin() + (previousBlock->lines() - 1));
 
-        const int oldSizeOfPreviousLine = m_lines[0].text().size();
+        const int oldSizeOfPreviousLine = textLines[0].text().size();
         if (oldFirst.length() > 0) {
             // append text
-            m_lines[0].text().append(oldFirst.text());
+            textLines[0].text().append(oldFirst.text());
 
             // mark line as modified, since text was appended
-            m_lines[0].markAsModified(true);
+            textLines[0].markAsModified(true);
         }
 
+        // the line moved over from the previous block is new for our search filter
+        addToSearchFilter(textLines[0].text(), 0, textLines[0].length());
+        previousBlock->m_searchFilterStale = previousBlock->hasSearchFilter();
+
         // patch startLine of this block
         --m_startLine;
 
@@ -229,17 +530,17 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
 
         // cursor and range handling below
 
-        // no cursors in this block and the previous one, no work to do..
-        if (m_cursors.empty() && previousBlock->m_cursors.empty()) {
+        // no cursors on the unwrapped line in this block and the previous one, no work to do..
+        const bool previousLineHasCursors = size_t(lastLineOfPreviousBlock) < previousBlock->m_cursors.size();
+        if (m_cursors.empty() && !previousLineHasCursors) {
             return;
         }
 
         // move all cursors because of the unwrapped line
         // remember all ranges modified, optimize for the standard case of a few ranges
         QVarLengthArray<TextRange *, 32> changedRanges;
-        for (TextCursor *cursor : m_cursors) {
-            // this is the unwrapped line
-            if (cursor->lineInBlock() == 0) {
+        if (!m_cursors.empty()) {
+            for (TextCursor *cursor : m_cursors[0]) {
                 // patch column
                 cursor->m_column += oldSizeOfPreviousLine;
 
@@ -253,12 +554,19 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
         }
 
         // move cursors of the moved line from previous block to this block now
-        for (auto it = previousBlock->m_cursors.begin(); it != previousBlock->m_cursors.end();) {
-            auto cursor = *it;
-            if (cursor->lineInBlock() == lastLineOfPreviousBlock) {
+        if (previousLineHasCursors) {
+            const std::vector<TextCursor *> movedCursors = std::move(previousBlock->m_cursors[lastLineOfPreviousBlock]);
+            previousBlock->m_cursors.erase(previousBlock->m_cursors.begin() + lastLineOfPreviousBlock);
+            previousBlock->m_cursorCount -= movedCursors.size();
+
+            if (m_cursors.empty()) {
+                m_cursors.resize(1);
+            }
+            m_cursorCount += movedCursors.size();
+            for (TextCursor *cursor : movedCursors) {
                 cursor->m_line = 0;
                 cursor->m_block = this;
-                m_cursors.insert(cursor);
+                m_cursors[0].push_back(cursor);
 
                 // remember range, if any, avoid double insert
                 auto range = cursor->kateRange();
@@ -266,12 +574,6 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
                     range->setValidityCheckRequired();
                     changedRanges.push_back(range);
                 }
-
-                // remove from previous block
-                it = previousBlock->m_cursors.erase(it);
-            } else {
-                // keep in previous block
-                ++it;
             }
         }
 
@@ -292,20 +594,23 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
     }
 
     // easy: just move text to previous line and remove current one
-    const int oldSizeOfPreviousLine = m_lines.at(line - 1).length();
-    const int sizeOfCurrentLine = m_lines.at(line).length();
+    const int oldSizeOfPreviousLine = textLines.at(line - 1).length();
+    const int sizeOfCurrentLine = textLines.at(line).length();
     if (sizeOfCurrentLine > 0) {
-        m_lines.at(line - 1).text().append(m_lines.at(line).text());
+        textLines.at(line - 1).text().append(textLines.at(line).text());
     }
 
-    const bool lineChanged = (oldSizeOfPreviousLine > 0 && m_lines.at(line - 1).markedAsModified())
-        || (sizeOfCurrentLine > 0 && (oldSizeOfPreviousLine > 0 || m_lines.at(line).markedAsModified()));
-    m_lines.at(line - 1).markAsModified(lineChanged);
-    if (oldSizeOfPreviousLine == 0 && m_lines.at(line).markedAsSavedOnDisk()) {
-        m_lines.at(line - 1).markAsSavedOnDisk(true);
+    const bool lineChanged = (oldSizeOfPreviousLine > 0 && textLines.at(line - 1).markedAsModified())
+        || (sizeOfCurrentLine > 0 && (oldSizeOfPreviousLine > 0 || textLines.at(line).markedAsModified()));
+    textLines.at(line - 1).markAsModified(lineChanged);
+    if (oldSizeOfPreviousLine == 0 && textLines.at(line).markedAsSavedOnDisk()) {
+        textLines.at(line - 1).markAsSavedOnDisk(true);
     }
 
-    m_lines.erase(m_lines.begin() + line);
+    textLines.erase(textLines.begin() + line);
+
+    // only the trigrams spanning the join are new
+    addToSearchFilter(textLines.at(line - 1).text(), oldSizeOfPreviousLine, oldSizeOfPreviousLine);
 
     // fix all start lines
     // we need to do this NOW, else the range update will FAIL!
@@ -317,37 +622,39 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
 
     // cursor and range handling below
 
-    // no cursors in this block, no work to do..
-    if (m_cursors.empty()) {
+    // no cursors on the unwrapped line or behind it, no work to do..
+    if (m_cursors.size() <= size_t(line)) {
         return;
     }
 
     // move all cursors because of the unwrapped line
     // remember all ranges modified, optimize for the standard case of a few ranges
     QVarLengthArray<TextRange *, 32> changedRanges;
-    for (TextCursor *cursor : m_cursors) {
-        // skip cursors in lines in front of removed one
-        if (cursor->lineInBlock() < line) {
-            continue;
-        }
-
-        // this is the unwrapped line
-        if (cursor->lineInBlock() == line) {
-            // patch column
-            cursor->m_column += oldSizeOfPreviousLine;
-        }
+    for (size_t i = line; i < m_cursors.size(); ++i) {
+        for (TextCursor *cursor : m_cursors[i]) {
+            // this is the unwrapped line
+            if (i == size_t(line)) {
+                // patch column
+                cursor->m_column += oldSizeOfPreviousLine;
+            }
 
-        // patch line of cursor
-        cursor->m_line--;
+            // patch line of cursor
+            cursor->m_line--;
 
-        // remember range, if any, avoid double insert
-        auto range = cursor->kateRange();
-        if (range && !range->isValidityCheckRequired()) {
-            range->setValidityCheckRequired();
-            changedRanges.push_back(range);
+            // remember range, if any, avoid double insert
+            auto range = cursor->kateRange();
+            if (range && !range->isValidityCheckRequired()) {
+                range->setValidityCheckRequired();
+                changedRanges.push_back(range);
+            }
         }
     }
 
+    // the cursors of the unwrapped line join the previous one, the buckets behind move along
+    auto &unwrappedCursors = m_cursors[line];
+    m_cursors[line - 1].insert(m_cursors[line - 1].end(), unwrappedCursors.begin(), unwrappedCursors.end());
+    m_cursors.erase(m_cursors.begin() + line);
+
     // we might need to invalidate ranges or notify about their changes
     // checkValidity might trigger delete of the range!
     for (TextRange *range : std::as_const(changedRanges)) {
@@ -362,20 +669,46 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
 
 void TextBlock::insertText(const KTextEditor::Cursor position, const QString &text)
 {
-    // calc internal line
-    int line = position.line() - startLine();
-
-    // get text
-    QString &textOfLine = m_lines.at(line).text();
-    int oldLength = textOfLine.size();
-    m_lines.at(line).markAsModified(true);
+    QVarLengthArray<TextRange *, 32> changedRanges;
+    insertText(position, text, changedRanges);
 
-    // check if valid column
-    Q_ASSERT(position.column() >= 0);
-    Q_ASSERT(position.column() <= textOfLine.size());
+    // we might need to invalidate ranges or notify about their changes
+    // checkValidity might trigger delete of the range!
+    for (TextRange *range : std::as_const(changedRanges)) {
+        range->checkValidity(range->toLineRange());
+    }
+}
 
-    // insert text
-    textOfLine.insert(position.column(), text);
+void TextBlock::insertText(const KTextEditor::Cursor position, const QString &text, QVarLengthArray<TextRange *, 32> &changedRanges)
+{
+    // calc internal line
+    int line = position.line() - startLine();
+    auto &textLines = writableLines();
+    textLines.at(line).markAsModified(true);
+
+    // insert text, very long lines are edited in chunks
+    int oldLength = 0;
+    int newLength = 0;
+    if (ChunkedLine *chunked = chunkedLineForEdit(line)) {
+        oldLength = chunked->text.length();
+        Q_ASSERT(position.column() >= 0);
+        Q_ASSERT(position.column() <= oldLength);
+
+        chunked->text.insert(position.column(), text);
+        chunked->textStale = true;
+        textLines.at(line).text() = QString();
+        newLength = chunked->text.length();
+        addToSearchFilter(chunked->text, position.column(), position.column() + text.size());
+    } else {
+        QString &textOfLine = textLines.at(line).text();
+        oldLength = textOfLine.size();
+        Q_ASSERT(position.column() >= 0);
+        Q_ASSERT(position.column() <= oldLength);
+
+        textOfLine.insert(position.column(), text);
+        newLength = textOfLine.size();
+        addToSearchFilter(textOfLine, position.column(), position.column() + text.size());
+    }
 
     // notify the text history
     m_buffer->history().insertText(position, text.size(), oldLength);
@@ -384,20 +717,13 @@ void TextBlock::insertText(const KTextEditor::Cursor position, const QString &te
 
     // cursor and range handling below
 
-    // no cursors in this block, no work to do..
-    if (m_cursors.empty()) {
+    // no cursors on this line, no work to do..
+    if (m_cursors.size() <= size_t(line)) {
         return;
     }
 
     // move all cursors on the line which has the text inserted
-    // remember all ranges modified, optimize for the standard case of a few ranges
-    QVarLengthArray<TextRange *, 32> changedRanges;
-    for (TextCursor *cursor : m_cursors) {
-        // skip cursors not on this line!
-        if (cursor->lineInBlock() != line) {
-            continue;
-        }
-
+    for (TextCursor *cursor : m_cursors[line]) {
         // skip cursors with too small column
         if (cursor->column() <= position.column()) {
             if (cursor->column() < position.column() || !cursor->m_moveOnInsert) {
@@ -411,8 +737,8 @@ void TextBlock::insertText(const KTextEditor::Cursor position, const QString &te
         }
 
         // special handling if cursor behind the real line, e.g. non-wrapping cursor in block selection mode
-        else if (cursor->m_column < textOfLine.size()) {
-            cursor->m_column = textOfLine.size();
+        else if (cursor->m_column < newLength) {
+            cursor->m_column = newLength;
         }
 
         // remember range, if any, avoid double insert
@@ -423,6 +749,12 @@ void TextBlock::insertText(const KTextEditor::Cursor position, const QString &te
             changedRanges.push_back(range);
         }
     }
+}
+
+void TextBlock::removeText(KTextEditor::Range range, QString &removedText)
+{
+    QVarLengthArray<TextRange *, 32> changedRanges;
+    removeText(range, removedText, changedRanges);
 
     // we might need to invalidate ranges or notify about their changes
     // checkValidity might trigger delete of the range!
@@ -431,27 +763,38 @@ void TextBlock::insertText(const KTextEditor::Cursor position, const QString &te
     }
 }
 
-void TextBlock::removeText(KTextEditor::Range range, QString &removedText)
+void TextBlock::removeText(KTextEditor::Range range, QString &removedText, QVarLengthArray<TextRange *, 32> &changedRanges)
 {
     // calc internal line
     int line = range.start().line() - startLine();
-
-    // get text
-    QString &textOfLine = m_lines.at(line).text();
-    int oldLength = textOfLine.size();
-
-    // check if valid column
-    Q_ASSERT(range.start().column() >= 0);
-    Q_ASSERT(range.start().column() <= textOfLine.size());
-    Q_ASSERT(range.end().column() >= 0);
-    Q_ASSERT(range.end().column() <= textOfLine.size());
-
-    // get text which will be removed
-    removedText = textOfLine.mid(range.start().column(), range.end().column() - range.start().column());
-
-    // remove text
-    textOfLine.remove(range.start().column(), range.end().column() - range.start().column());
-    m_lines.at(line).markAsModified(true);
+    auto &textLines = writableLines();
+    textLines.at(line).markAsModified(true);
+
+    // remove text, very long lines are edited in chunks
+    // removed trigrams stay in the search filter, only the ones spanning the gap are new
+    int oldLength = 0;
+    const int removedLength = range.end().column() - range.start().column();
+    if (ChunkedLine *chunked = chunkedLineForEdit(line)) {
+        oldLength = chunked->text.length();
+        Q_ASSERT(range.start().column() >= 0);
+        Q_ASSERT(range.end().column() <= oldLength);
+
+        removedText = chunked->text.mid(range.start().column(), removedLength);
+        chunked->text.remove(range.start().column(), removedLength);
+        chunked->textStale = true;
+        textLines.at(line).text() = QString();
+        addToSearchFilter(chunked->text, range.start().column(), range.start().column());
+    } else {
+        QString &textOfLine = textLines.at(line).text();
+        oldLength = textOfLine.size();
+        Q_ASSERT(range.start().column() >= 0);
+        Q_ASSERT(range.end().column() <= oldLength);
+
+        removedText = textOfLine.mid(range.start().column(), removedLength);
+        textOfLine.remove(range.start().column(), removedLength);
+        addToSearchFilter(textOfLine, range.start().column(), range.start().column());
+    }
+    m_searchFilterStale = hasSearchFilter();
 
     // notify the text history
     m_buffer->history().removeText(range, oldLength);
@@ -460,20 +803,13 @@ void TextBlock::removeText(KTextEditor::Range range, QString &removedText)
 
     // cursor and range handling below
 
-    // no cursors in this block, no work to do..
-    if (m_cursors.empty()) {
+    // no cursors on this line, no work to do..
+    if (m_cursors.size() <= size_t(line)) {
         return;
     }
 
     // move all cursors on the line which has the text removed
-    // remember all ranges modified, optimize for the standard case of a few ranges
-    QVarLengthArray<TextRange *, 32> changedRanges;
-    for (TextCursor *cursor : m_cursors) {
-        // skip cursors not on this line!
-        if (cursor->lineInBlock() != line) {
-            continue;
-        }
-
+    for (TextCursor *cursor : m_cursors[line]) {
         // skip cursors with too small column
         if (cursor->column() <= range.start().column()) {
             continue;
@@ -494,23 +830,19 @@ void TextBlock::removeText(KTextEditor::Range range, QString &removedText)
             changedRanges.push_back(range);
         }
     }
-
-    // we might need to invalidate ranges or notify about their changes
-    // checkValidity might trigger delete of the range!
-    for (TextRange *range : std::as_const(changedRanges)) {
-        range->checkValidity(range->toLineRange());
-    }
 }
 
 void TextBlock::debugPrint(int blockIndex) const
 {
+    joinChunkedLines();
+
     // print all blocks
-    for (size_t i = 0; i < m_lines.size(); ++i) {
+    for (size_t i = 0; i < m_lines->size(); ++i) {
         printf("%4d - %4llu : %4llu : '%s'\n",
                blockIndex,
                (unsigned long long)startLine() + i,
-               (unsigned long long)m_lines.at(i).text().size(),
-               qPrintable(m_lines.at(i).text()));
+               (unsigned long long)m_lines->at(i).text().size(),
+               qPrintable(m_lines->at(i).text()));
     }
 }
 
@@ -523,40 +855,50 @@ TextBlock *TextBlock::splitBlock(int fromLine)
     TextBlock *newBlock = new TextBlock(m_buffer, startLine() + fromLine);
 
     // move lines
-    newBlock->m_lines.reserve(linesOfNewBlock);
-    for (size_t i = fromLine; i < m_lines.size(); ++i) {
-        auto line = std::move(m_lines[i]);
+    flushChunkedLines();
+    auto &textLines = writableLines();
+    auto &newLines = newBlock->writableLines();
+    newLines.reserve(linesOfNewBlock);
+    for (size_t i = fromLine; i < textLines.size(); ++i) {
+        auto line = std::move(textLines[i]);
         m_blockSize -= line.length();
         newBlock->m_blockSize += line.length();
-        newBlock->m_lines.push_back(std::move(line));
+        newLines.push_back(std::move(line));
     }
 
-    m_lines.resize(fromLine);
+    textLines.resize(fromLine);
 
-    // move cursors
-    for (auto it = m_cursors.begin(); it != m_cursors.end();) {
-        auto cursor = *it;
-        if (cursor->lineInBlock() >= fromLine) {
+    // both halves keep a superset of their trigrams
+    if (hasSearchFilter()) {
+        newBlock->m_searchFilter = m_searchFilter;
+        newBlock->m_searchFilterStale = true;
+        m_searchFilterStale = true;
+    }
+
+    // move cursors, together with the buckets of their lines
+    for (size_t i = fromLine; i < m_cursors.size(); ++i) {
+        for (TextCursor *cursor : m_cursors[i]) {
             cursor->m_line = cursor->lineInBlock() - fromLine;
             cursor->m_block = newBlock;
-
-            // add to new, remove from current
-            newBlock->m_cursors.insert(cursor);
-            it = m_cursors.erase(it);
-        } else {
-            // keep in current
-            ++it;
         }
+        newBlock->m_cursorCount += m_cursors[i].size();
+        newBlock->m_cursors.push_back(std::move(m_cursors[i]));
+    }
+    if (m_cursors.size() > size_t(fromLine)) {
+        m_cursors.resize(fromLine);
+        m_cursorCount -= newBlock->m_cursorCount;
     }
 
     // fix ALL ranges!
-    // copy is necessary as update range may modify the uncached ranges
+    // copy is necessary as update range may modify the multi-line ranges
     std::vector<TextRange *> allRanges;
-    allRanges.reserve(m_uncachedRanges.size() + m_cachedLineForRanges.size());
+    allRanges.reserve(m_multiLineRanges.size() + m_cachedLineForRanges.size());
     std::for_each(m_cachedLineForRanges.keyBegin(), m_cachedLineForRanges.keyEnd(), [&allRanges](TextRange *range) {
         allRanges.push_back(range);
     });
-    allRanges.insert(allRanges.end(), m_uncachedRanges.begin(), m_uncachedRanges.end());
+    std::for_each(m_multiLineRanges.keyBegin(), m_multiLineRanges.keyEnd(), [&allRanges](TextRange *range) {
+        allRanges.push_back(range);
+    });
     for (TextRange *range : allRanges) {
         // update both blocks
         updateRange(range);
@@ -570,29 +912,51 @@ TextBlock *TextBlock::splitBlock(int fromLine)
 void TextBlock::mergeBlock(TextBlock *targetBlock)
 {
     // move cursors, do this first, now still lines() count is correct for target
-    for (TextCursor *cursor : m_cursors) {
-        cursor->m_line = cursor->lineInBlock() + targetBlock->lines();
-        cursor->m_block = targetBlock;
-        targetBlock->m_cursors.insert(cursor);
+    if (m_cursorCount > 0) {
+        targetBlock->m_cursors.resize(targetBlock->lines());
+        for (auto &cursors : m_cursors) {
+            for (TextCursor *cursor : cursors) {
+                cursor->m_line = cursor->lineInBlock() + targetBlock->lines();
+                cursor->m_block = targetBlock;
+            }
+            targetBlock->m_cursors.push_back(std::move(cursors));
+        }
+        targetBlock->m_cursorCount += m_cursorCount;
     }
     m_cursors.clear();
+    m_cursorCount = 0;
 
     // move lines
-    targetBlock->m_lines.reserve(targetBlock->lines() + lines());
-    for (size_t i = 0; i < m_lines.size(); ++i) {
-        targetBlock->m_lines.push_back(m_lines.at(i));
+    flushChunkedLines();
+    targetBlock->flushChunkedLines();
+    auto &targetLines = targetBlock->writableLines();
+    targetLines.reserve(targetBlock->lines() + lines());
+    for (size_t i = 0; i < m_lines->size(); ++i) {
+        targetLines.push_back(m_lines->at(i));
     }
     targetBlock->m_blockSize += m_blockSize;
+
+    // the united block has the union of both filters, if both exist
+    if (hasSearchFilter() && targetBlock->hasSearchFilter()) {
+        for (size_t i = 0; i < m_searchFilter.size(); ++i) {
+            targetBlock->m_searchFilter[i] |= m_searchFilter[i];
+        }
+        targetBlock->m_searchFilterStale = true;
+    } else {
+        targetBlock->clearSearchFilter();
+    }
     clearLines();
 
     // fix ALL ranges!
-    // copy is necessary as update range may modify the uncached ranges
+    // copy is necessary as update range may modify the multi-line ranges
     std::vector<TextRange *> allRanges;
-    allRanges.reserve(m_uncachedRanges.size() + m_cachedLineForRanges.size());
+    allRanges.reserve(m_multiLineRanges.size() + m_cachedLineForRanges.size());
     std::for_each(m_cachedLineForRanges.keyBegin(), m_cachedLineForRanges.keyEnd(), [&allRanges](TextRange *range) {
         allRanges.push_back(range);
     });
-    allRanges.insert(allRanges.end(), m_uncachedRanges.begin(), m_uncachedRanges.end());
+    std::for_each(m_multiLineRanges.keyBegin(), m_multiLineRanges.keyEnd(), [&allRanges](TextRange *range) {
+        allRanges.push_back(range);
+    });
     for (TextRange *range : allRanges) {
         // update both blocks
         updateRange(range);
@@ -605,18 +969,23 @@ void TextBlock::deleteBlockContent()
     // kill cursors, if not belonging to a range
     // we can do in-place editing of the current set of cursors as
     // we remove them before deleting
-    for (auto it = m_cursors.begin(); it != m_cursors.end();) {
-        auto cursor = *it;
-        if (!cursor->kateRange()) {
-            // remove it and advance to next element
-            it = m_cursors.erase(it);
-
-            // delete after cursor is gone from the set
-            // else the destructor will modify it!
-            delete cursor;
-        } else {
-            // keep this cursor
-            ++it;
+    for (auto &cursors : m_cursors) {
+        for (size_t i = 0; i < cursors.size();) {
+            auto cursor = cursors[i];
+            if (!cursor->kateRange()) {
+                // remove it, the next element takes its place
+                cursors[i] = cursors.back();
+                cursors.pop_back();
+                --m_cursorCount;
+
+                // delete after cursor is gone from the block
+                // else the destructor will modify it!
+                cursor->m_block = nullptr;
+                delete cursor;
+            } else {
+                // keep this cursor
+                ++i;
+            }
         }
     }
 
@@ -628,19 +997,23 @@ void TextBlock::clearBlockContent(TextBlock *targetBlock)
 {
     // move cursors, if not belonging to a range
     // we can do in-place editing of the current set of cursors
-    for (auto it = m_cursors.begin(); it != m_cursors.end();) {
-        auto cursor = *it;
-        if (!cursor->kateRange()) {
-            cursor->m_column = 0;
-            cursor->m_line = 0;
-            cursor->m_block = targetBlock;
-            targetBlock->m_cursors.insert(cursor);
-
-            // remove it and advance to next element
-            it = m_cursors.erase(it);
-        } else {
-            // keep this cursor
-            ++it;
+    for (auto &cursors : m_cursors) {
+        for (size_t i = 0; i < cursors.size();) {
+            auto cursor = cursors[i];
+            if (!cursor->kateRange()) {
+                cursor->m_column = 0;
+                cursor->m_line = 0;
+                cursor->m_block = targetBlock;
+                targetBlock->insertCursor(cursor);
+
+                // remove it, the next element takes its place
+                cursors[i] = cursors.back();
+                cursors.pop_back();
+                --m_cursorCount;
+            } else {
+                // keep this cursor
+                ++i;
+            }
         }
     }
 
@@ -652,7 +1025,7 @@ QList<TextRange *> TextBlock::rangesForLine(int line, KTextEditor::View *view, b
 {
     const auto cachedRanges = cachedRangesForLine(line);
     QList<TextRange *> ranges;
-    ranges.reserve(m_uncachedRanges.size() + (cachedRanges ? cachedRanges->size() : 0));
+    ranges.reserve(m_multiLineRanges.size() + (cachedRanges ? cachedRanges->size() : 0));
     rangesForLine(line, view, rangesWithAttributeOnly, ranges);
     return ranges;
 }
@@ -687,19 +1060,113 @@ void TextBlock::rangesForLine(int line, KTextEditor::View *view, bool rangesWith
     if (cachedRanges) {
         std::copy_if(cachedRanges->begin(), cachedRanges->end(), std::back_inserter(outRanges), predicate);
     }
-    std::copy_if(m_uncachedRanges.begin(), m_uncachedRanges.end(), std::back_inserter(outRanges), predicate);
+
+    if (m_multiLineRanges.isEmpty()) {
+        return;
+    }
+    if (m_rangeIndexDirty) {
+        buildRangeIndex();
+    }
+    multiLineRangesForLine(0, m_rangeIndex.size(), line - m_startLine, predicate, outRanges);
+}
+
+TextBlock::RangeSpan TextBlock::spanInBlock(const TextRange *range) const
+{
+    const int startLine = range->startInternal().lineInternal() - m_startLine;
+    const int endLine = range->endInternal().lineInternal() - m_startLine;
+    return {std::max(0, startLine), endLine >= lines() ? std::numeric_limits<int>::max() : endLine};
+}
+
+void TextBlock::buildRangeIndex() const
+{
+    m_rangeIndex.clear();
+    m_rangeIndex.reserve(m_multiLineRanges.size());
+    for (auto it = m_multiLineRanges.cbegin(); it != m_multiLineRanges.cend(); ++it) {
+        m_rangeIndex.push_back({it.value(), it.value().endLine, it.key()});
+    }
+    std::sort(m_rangeIndex.begin(), m_rangeIndex.end(), [](const IndexedRange &a, const IndexedRange &b) {
+        return a.span.startLine < b.span.startLine || (a.span.startLine == b.span.startLine && a.span.endLine < b.span.endLine);
+    });
+
+    // the root of the slice [begin, end) is its middle entry, compute the maximal end bottom up
+    const auto computeMaxEnd = [this](const auto &self, size_t begin, size_t end) -> int {
+        if (begin >= end) {
+            return -1;
+        }
+        const size_t middle = begin + (end - begin) / 2;
+        IndexedRange &root = m_rangeIndex[middle];
+        root.maxEndLine = std::max({root.span.endLine, self(self, begin, middle), self(self, middle + 1, end)});
+        return root.maxEndLine;
+    };
+    computeMaxEnd(computeMaxEnd, 0, m_rangeIndex.size());
+    m_rangeIndexDirty = false;
+}
+
+template<typename Predicate>
+void TextBlock::multiLineRangesForLine(size_t begin, size_t end, int line, const Predicate &predicate, QList<TextRange *> &outRanges) const
+{
+    while (begin < end) {
+        const size_t middle = begin + (end - begin) / 2;
+        const IndexedRange &root = m_rangeIndex[middle];
+
+        // nothing in this subtree reaches the line
+        if (root.maxEndLine < line) {
+            return;
+        }
+
+        multiLineRangesForLine(begin, middle, line, predicate, outRanges);
+
+        // the root and all behind it start after the line
+        if (root.span.startLine > line) {
+            return;
+        }
+        if (root.span.endLine >= line && predicate(root.range)) {
+            outRanges.push_back(root.range);
+        }
+
+        // continue with the right subtree
+        begin = middle + 1;
+    }
 }
 
 void TextBlock::markModifiedLinesAsSaved()
 {
     // mark all modified lines as saved
-    for (auto &textLine : m_lines) {
+    for (auto &textLine : writableLines()) {
         if (textLine.markedAsModified()) {
             textLine.markAsSavedOnDisk(true);
         }
     }
 }
 
+void TextBlock::insertCursor(TextCursor *cursor)
+{
+    const size_t line = cursor->lineInBlock();
+    Q_ASSERT(line < size_t(lines()));
+    if (line >= m_cursors.size()) {
+        m_cursors.resize(line + 1);
+    }
+    m_cursors[line].push_back(cursor);
+    ++m_cursorCount;
+}
+
+void TextBlock::removeCursor(TextCursor *cursor)
+{
+    auto &cursors = m_cursors[cursor->lineInBlock()];
+    const auto it = std::find(cursors.begin(), cursors.end(), cursor);
+    Q_ASSERT(it != cursors.end());
+    *it = cursors.back();
+    cursors.pop_back();
+    --m_cursorCount;
+}
+
+void TextBlock::moveCursorToLine(TextCursor *cursor, int line)
+{
+    removeCursor(cursor);
+    cursor->m_line = line;
+    insertCursor(cursor);
+}
+
 void TextBlock::updateRange(TextRange *range)
 {
     // get some simple facts about our nice range
@@ -721,9 +1188,17 @@ void TextBlock::updateRange(TextRange *range)
         }
     }
 
-    // The range is still a multi-line range, and is already in the correct set.
-    if (!isSingleLine && m_uncachedRanges.contains(range)) {
-        return;
+    // The range is still a multi-line range, update its span in the index if needed.
+    if (!isSingleLine) {
+        auto it = m_multiLineRanges.find(range);
+        if (it != m_multiLineRanges.end()) {
+            const RangeSpan span = spanInBlock(range);
+            if (!(it.value() == span)) {
+                it.value() = span;
+                m_rangeIndexDirty = true;
+            }
+            return;
+        }
     }
 
     // remove, if already there!
@@ -732,7 +1207,8 @@ void TextBlock::updateRange(TextRange *range)
     // simple case: multi-line range
     if (!isSingleLine) {
         // The range cannot be cached per line, as it spans multiple lines
-        m_uncachedRanges.append(range);
+        m_multiLineRanges.insert(range, spanInBlock(range));
+        m_rangeIndexDirty = true;
         return;
     }
 
@@ -753,11 +1229,10 @@ void TextBlock::updateRange(TextRange *range)
 
 void TextBlock::removeRange(TextRange *range)
 {
-    // uncached range? remove it and be done
-    int pos = m_uncachedRanges.indexOf(range);
-    if (pos != -1) {
-        m_uncachedRanges.remove(pos);
-        // must be only uncached!
+    // multi-line range? remove it and be done
+    if (m_multiLineRanges.remove(range)) {
+        m_rangeIndexDirty = true;
+        // must be only multi-line!
         Q_ASSERT(m_cachedLineForRanges.find(range) == m_cachedLineForRanges.end());
         return;
     }
@@ -765,9 +1240,6 @@ void TextBlock::removeRange(TextRange *range)
     // cached range?
     auto it = m_cachedLineForRanges.find(range);
     if (it != m_cachedLineForRanges.end()) {
-        // must be only cached!
-        Q_ASSERT(!m_uncachedRanges.contains(range));
-
         int line = it.value();
 
         // query the range from cache, must be there
@@ -8,14 +8,19 @@
 #define KATE_TEXTBLOCK_H
 
 #include "katetextline.h"
+#include "katetextrope.h"
 
+#include <QHash>
 #include <QList>
-#include <QSet>
+#include <QStringList>
 #include <QVarLengthArray>
 
 #include <ktexteditor/cursor.h>
 #include <ktexteditor_export.h>
 
+#include <memory>
+#include <vector>
+
 namespace KTextEditor
 {
 class View;
@@ -64,11 +69,38 @@ public:
 
     /**
      * Retrieve a text line.
+     * Joins the text of the line if it is chunked, like all const reads of the block
+     * this may only be used from the GUI thread, see TextBuffer::snapshot().
      * @param line wanted line number
      * @return text line
      */
     TextLine line(int line) const;
 
+    /**
+     * The lines of this block, to share them with a snapshot.
+     * They stay as they are, changes of the block are done on a copy.
+     * @return lines of this block
+     */
+    std::shared_ptr<const std::vector<TextLine>> sharedLines() const;
+
+    /**
+     * Retrieve the non text attributes of a text line, without its text.
+     * Unlike line() this doesn't need to join the chunks of a chunked line.
+     * @param line wanted line number
+     * @return text line with empty text
+     */
+    TextLine lineMetaData(int line) const;
+
+    /**
+     * Retrieve a part of the text of a line.
+     * Unlike line() this doesn't need to join the chunks of a chunked line.
+     * @param line wanted line number
+     * @param column first column of the part
+     * @param length length of the part
+     * @return text of the part
+     */
+    QString lineString(int line, int column, int length) const;
+
     /**
      * Transfer all non text attributes for the given line from the given text line to the one in the block.
      * @param line line number to set attributes
@@ -84,7 +116,10 @@ public:
     int lineLength(int line) const
     {
         Q_ASSERT(line >= startLine() && (line - startLine()) < lines());
-        return m_lines[line - startLine()].length();
+        if (const ChunkedLine *chunked = chunkedLine(line - startLine())) {
+            return chunked->text.length();
+        }
+        return (*m_lines)[line - startLine()].length();
     }
 
     /**
@@ -98,13 +133,19 @@ public:
      */
     void clearLines();
 
+    /**
+     * Join the text of all chunked lines and store them as plain lines again,
+     * see TextBuffer::setChunkedLineLength().
+     */
+    void flushChunkedLines();
+
     /**
      * Number of lines in this block.
      * @return number of lines
      */
     int lines() const
     {
-        return static_cast<int>(m_lines.size());
+        return static_cast<int>(m_lines->size());
     }
 
     /**
@@ -120,6 +161,16 @@ public:
      */
     void wrapLine(const KTextEditor::Cursor position, int fixStartLinesStartIndex);
 
+    /**
+     * Insert new lines in front of the given line, like wrapping it at its start once for each of them
+     * and inserting their text. Cursors at its start not moving on insert stay on the first new line.
+     * The caller notifies the text history and balances the block.
+     * @param line line in front of which the lines are inserted
+     * @param texts texts of the new lines
+     * @param fixStartLinesStartIndex start index to fix start lines, normally this is this block
+     */
+    void insertLines(int line, const QStringList &texts, int fixStartLinesStartIndex);
+
     /**
      * Unwrap given line.
      * @param line line to unwrap
@@ -135,6 +186,15 @@ public:
      */
     void insertText(const KTextEditor::Cursor position, const QString &text);
 
+    /**
+     * Insert text at given cursor position, but leave the validity check of the ranges
+     * of moved cursors to the caller, e.g. once a batch of edits is done.
+     * @param position position where to insert text
+     * @param text text to insert
+     * @param changedRanges ranges to check are appended here, they are flagged to avoid double insert
+     */
+    void insertText(const KTextEditor::Cursor position, const QString &text, QVarLengthArray<TextRange *, 32> &changedRanges);
+
     /**
      * Remove text at given range.
      * @param range range of text to remove, must be on one line only.
@@ -142,6 +202,14 @@ public:
      */
     void removeText(KTextEditor::Range range, QString &removedText);
 
+    /**
+     * Remove text at given range, but leave the validity check of the ranges of moved cursors to the caller.
+     * @param range range of text to remove, must be on one line only.
+     * @param removedText will be filled with removed text
+     * @param changedRanges ranges to check are appended here, they are flagged to avoid double insert
+     */
+    void removeText(KTextEditor::Range range, QString &removedText, QVarLengthArray<TextRange *, 32> &changedRanges);
+
     /**
      * Debug output, print whole block content with line numbers and line length
      * @param blockIndex index of this block in buffer
@@ -178,6 +246,7 @@ public:
 
     /**
      * Return all ranges in this block which might intersect the given line.
+     * The ranges on the line alone come first, then the ones spanning multiple lines ordered by their start.
      * @param line                          line to check intersection
      * @param view                          only return ranges associated with given view
      * @param rangesWithAttributeOnly       ranges with attributes only?
@@ -194,7 +263,7 @@ public:
      */
     bool containsRange(TextRange *range) const
     {
-        return m_cachedLineForRanges.find(range) != m_cachedLineForRanges.end() || m_uncachedRanges.contains(range);
+        return m_cachedLineForRanges.find(range) != m_cachedLineForRanges.end() || m_multiLineRanges.contains(range);
     }
 
     /**
@@ -203,22 +272,23 @@ public:
     void markModifiedLinesAsSaved();
 
     /**
-     * Insert cursor into this block.
+     * Insert cursor into this block, on the line it is on.
      * @param cursor cursor to insert
      */
-    void insertCursor(Kate::TextCursor *cursor)
-    {
-        m_cursors.insert(cursor);
-    }
+    void insertCursor(Kate::TextCursor *cursor);
 
     /**
      * Remove cursor from this block.
      * @param cursor cursor to remove
      */
-    void removeCursor(Kate::TextCursor *cursor)
-    {
-        m_cursors.remove(cursor);
-    }
+    void removeCursor(Kate::TextCursor *cursor);
+
+    /**
+     * Move a cursor of this block to another line of it.
+     * @param cursor cursor to move
+     * @param line line in this block
+     */
+    void moveCursorToLine(Kate::TextCursor *cursor, int line);
 
     /**
      * Update a range from this block.
@@ -239,10 +309,136 @@ public:
      */
     int blockSize() const
     {
-        return m_blockSize + m_lines.size();
+        return m_blockSize + m_lines->size();
+    }
+
+    /**
+     * Compute the hashes of all trigrams of the given text, case folded by code point.
+     * This is used to query the search filter, see mayContainTrigrams().
+     * @param text text to compute the trigrams for, texts shorter than three chars yield none
+     * @param hashes trigram hashes, will be appended to
+     */
+    static void searchTrigrams(QStringView text, std::vector<quint32> &hashes);
+
+    /**
+     * (Re)build the trigram search filter of this block from its current text.
+     */
+    void buildSearchFilter();
+
+    /**
+     * Drop the trigram search filter, the block is always a search candidate afterwards.
+     */
+    void clearSearchFilter()
+    {
+        m_searchFilter = std::vector<quint64>();
+        m_searchFilterStale = false;
+    }
+
+    /**
+     * Has this block a trigram search filter?
+     * @return search filter built?
+     */
+    bool hasSearchFilter() const
+    {
+        return !m_searchFilter.empty();
+    }
+
+    /**
+     * Is the search filter still exact or did removals leave stale trigrams behind?
+     * A stale filter is still correct, it just reports more false candidates.
+     * @return search filter should be rebuilt?
+     */
+    bool searchFilterIsStale() const
+    {
+        return m_searchFilterStale;
+    }
+
+    /**
+     * Might some line of this block contain all given trigrams?
+     * Blocks without search filter are always candidates.
+     * @param hashes trigram hashes, see searchTrigrams()
+     * @return false if the block can't contain the text the trigrams belong to
+     */
+    bool mayContainTrigrams(const std::vector<quint32> &hashes) const;
+
+    /**
+     * Memory used by the search filter of this block.
+     * @return used bytes
+     */
+    size_t searchFilterMemory() const
+    {
+        return m_searchFilter.size() * sizeof(quint64);
     }
 
 private:
+    /**
+     * The lines of this block to change them, copied first if they are shared with a snapshot.
+     * @return lines of this block
+     */
+    std::vector<TextLine> &writableLines();
+
+    /**
+     * A very long line whose text is kept in chunks while it is edited.
+     * The text of the line in m_lines is empty while it is stale, it is joined
+     * again on the first read. The chunks are kept until the lines of the block
+     * change, so typing into the line doesn't need to split it up again.
+     */
+    struct ChunkedLine {
+        int line;
+        TextRope text;
+        bool textStale = false;
+    };
+
+    /**
+     * Find the chunked line for the given line.
+     * @param line line in block
+     * @return chunked line, nullptr if the line isn't chunked
+     */
+    ChunkedLine *chunkedLine(int line) const
+    {
+        for (ChunkedLine &chunked : m_chunkedLines) {
+            if (chunked.line == line) {
+                return &chunked;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Chunked line to edit the given line with, the line is chunked if it is long enough.
+     * @param line line in block
+     * @return chunked line, nullptr if the line is edited as plain line
+     */
+    ChunkedLine *chunkedLineForEdit(int line);
+
+    /**
+     * Store the joined text of a stale chunked line in its text line.
+     * @param chunked chunked line
+     */
+    void joinChunkedLine(ChunkedLine &chunked) const;
+
+    /**
+     * Store the joined text of all stale chunked lines in their text lines.
+     */
+    void joinChunkedLines() const;
+
+    /**
+     * Add the trigrams touching the given column range of a chunked line to the search filter.
+     * @param text text of the line
+     * @param startColumn first changed column
+     * @param endColumn first column after the change
+     */
+    void addToSearchFilter(const TextRope &text, int startColumn, int endColumn);
+
+    /**
+     * Add all trigrams touching the given column range of the line to the search filter, if one is built.
+     * An empty column range adds the trigrams spanning that position, e.g. after lines got joined.
+     * @param text text of the line
+     * @param startColumn first changed column
+     * @param endColumn first column after the change
+     */
+    void addToSearchFilter(QStringView text, int startColumn, int endColumn);
+
     /**
      * Return all ranges in this block which might intersect the given line and only span one line.
      * For them an internal fast lookup cache is hold.
@@ -259,6 +455,37 @@ private:
         }
     }
 
+    /**
+     * Lines of a multi-line range inside of this block.
+     * Lines are relative to the block start, so they survive changes of it. A range starting
+     * in front of the block starts at 0, one ending behind it ends at INT_MAX, lines inserted
+     * into the block don't move these ends.
+     */
+    struct RangeSpan {
+        int startLine;
+        int endLine;
+
+        bool operator==(const RangeSpan &other) const = default;
+    };
+
+    /**
+     * Span of the range inside of this block.
+     */
+    RangeSpan spanInBlock(const TextRange *range) const;
+
+    /**
+     * Sort the multi-line ranges by their start and compute the maximal end of each subtree
+     * of the implicit search tree over them.
+     */
+    void buildRangeIndex() const;
+
+    /**
+     * Collect the multi-line ranges intersecting the line from the subtree of the index
+     * with the entries [begin, end), in order of their start.
+     */
+    template<typename Predicate>
+    void multiLineRangesForLine(size_t begin, size_t end, int line, const Predicate &predicate, QList<TextRange *> &outRanges) const;
+
 private:
     /**
      * parent text buffer
@@ -266,10 +493,16 @@ private:
     TextBuffer *m_buffer;
 
     /**
-     * Lines contained in this buffer.
-     * We need no sharing, use STL.
+     * Lines contained in this block.
+     * Shared with the snapshots taken since the last change, see writableLines().
      */
-    std::vector<Kate::TextLine> m_lines;
+    std::shared_ptr<const std::vector<Kate::TextLine>> m_lines;
+
+    /**
+     * Lines of this block kept in chunks, see TextBuffer::setChunkedLineLength().
+     * Only the few very long lines edited since the last change of the lines are in here.
+     */
+    mutable std::vector<ChunkedLine> m_chunkedLines;
 
     /**
      * Startline of this block
@@ -282,10 +515,27 @@ private:
     int m_blockSize = 0;
 
     /**
-     * Set of cursors for this block.
-     * using QSet is better than unordered_set for perf reasons
+     * Cursors of this block, by the line in the block they are on.
+     * Edits inside of a line only visit the cursors of that line.
+     * There is no bucket for the lines behind the last one with cursors.
+     */
+    std::vector<std::vector<TextCursor *>> m_cursors;
+
+    /**
+     * Number of cursors of this block.
      */
-    QSet<TextCursor *> m_cursors;
+    int m_cursorCount = 0;
+
+    /**
+     * Bloom filter over the case folded trigrams of all lines of this block.
+     * Empty if not built, see TextBuffer::setSearchIndexEnabled().
+     */
+    std::vector<quint64> m_searchFilter;
+
+    /**
+     * Text was removed since the search filter was built.
+     */
+    bool m_searchFilterStale = false;
 
     /**
      * Contains for each line-offset the ranges that were cached into it.
@@ -299,9 +549,24 @@ private:
     QHash<TextRange *, int> m_cachedLineForRanges;
 
     /**
-     * This contains all the ranges that are not cached.
+     * All ranges spanning multiple lines with their span inside of this block.
+     */
+    QHash<TextRange *, RangeSpan> m_multiLineRanges;
+
+    /**
+     * Interval index over the multi-line ranges: the ranges sorted by start, each entry
+     * being the root of the subtree of the entries around it (the middle one of a slice
+     * is its root) with the maximal end inside of that subtree. Finding the ranges of a
+     * line costs O(log n + k) instead of testing all of them.
+     * Rebuilt on the next lookup once ranges were added, moved or removed.
      */
-    QVarLengthArray<TextRange *, 1> m_uncachedRanges;
+    struct IndexedRange {
+        RangeSpan span;
+        int maxEndLine;
+        TextRange *range;
+    };
+    mutable std::vector<IndexedRange> m_rangeIndex;
+    mutable bool m_rangeIndexDirty = false;
 };
 
 }
@@ -8,6 +8,7 @@
 
 #include "katetextbuffer.h"
 #include "katetextloader.h"
+#include "katetextrange.h"
 
 #include "katedocument.h"
 
@@ -26,6 +27,7 @@
 
 #include <QBuffer>
 #include <QCryptographicHash>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QStringEncoder>
@@ -64,6 +66,10 @@ TextBuffer::TextBuffer(KTextEditor::DocumentPrivate *parent, bool alwaysUseKAuth
     , m_lineLengthLimit(4096)
     , m_alwaysUseKAuthForSave(alwaysUseKAuth)
 {
+    // search index is built in small slices in the event loop
+    m_searchIndexTimer.setSingleShot(true);
+    connect(&m_searchIndexTimer, &QTimer::timeout, this, &TextBuffer::buildSearchIndex);
+
     // create initial state
     clear();
 }
@@ -113,6 +119,9 @@ void TextBuffer::clear()
 
     invalidateRanges();
 
+    // drop the search index, the filters die with the blocks
+    setSearchIndexEnabled(false);
+
     // new block for empty buffer
     TextBlock *newBlock = new TextBlock(this, 0);
     newBlock->appendLine(QString());
@@ -166,6 +175,34 @@ void TextBuffer::setLineMetaData(int line, const TextLine &textLine)
     return m_blocks.at(blockIndex)->setLineMetaData(line, textLine);
 }
 
+TextLine TextBuffer::lineMetaData(int line) const
+{
+    // get block, this will assert on invalid line
+    int blockIndex = blockForLine(line);
+
+    return m_blocks.at(blockIndex)->lineMetaData(line);
+}
+
+QString TextBuffer::lineString(int line, int column, int length) const
+{
+    // get block, this will assert on invalid line
+    int blockIndex = blockForLine(line);
+
+    return m_blocks.at(blockIndex)->lineString(line, column, length);
+}
+
+void TextBuffer::setChunkedLineLength(int length)
+{
+    m_chunkedLineLength = std::max(0, length);
+
+    // lines already chunked keep their chunks until the lines of their block change
+    if (m_chunkedLineLength == 0) {
+        for (TextBlock *block : std::as_const(m_blocks)) {
+            block->flushChunkedLines();
+        }
+    }
+}
+
 int TextBuffer::cursorToOffset(KTextEditor::Cursor c) const
 {
     if (!c.isValid() || c > document()->documentEnd()) {
@@ -238,6 +275,20 @@ QString TextBuffer::text() const
     return text;
 }
 
+TextSnapshot TextBuffer::snapshot() const
+{
+    TextSnapshot snapshot;
+    snapshot.m_blocks.reserve(m_blocks.size());
+    for (const TextBlock *block : m_blocks) {
+        if (block->lines() > 0) {
+            snapshot.m_blocks.push_back({block->startLine(), block->sharedLines()});
+        }
+    }
+    snapshot.m_lines = lines();
+    snapshot.m_revision = revision();
+    return snapshot;
+}
+
 bool TextBuffer::startEditing()
 {
     // increment transaction counter
@@ -280,6 +331,11 @@ bool TextBuffer::finishEditing()
     Q_ASSERT(!editingChangedBuffer() || (m_editingMinimalLineChanged >= 0 && m_editingMinimalLineChanged < m_lines));
     Q_ASSERT(!editingChangedBuffer() || (m_editingMaximalLineChanged >= 0 && m_editingMaximalLineChanged < m_lines));
 
+    // refresh the search index for the changed blocks a bit later, edits tend to come in bursts
+    if (m_searchIndexEnabled && editingChangedBuffer() && !m_searchIndexTimer.isActive()) {
+        m_searchIndexTimer.start(500);
+    }
+
     // transaction has finished
     Q_EMIT m_document->KTextEditor::Document::editingFinished(m_document);
 
@@ -376,6 +432,71 @@ void TextBuffer::unwrapLine(int line)
     Q_EMIT m_document->KTextEditor::Document::lineUnwrapped(m_document, line);
 }
 
+void TextBuffer::insertLines(int line, const QStringList &texts)
+{
+    // debug output for REAL low-level debugging
+    BUFFER_DEBUG << "insertLines" << line << texts.size();
+
+    // only allowed if editing transaction running
+    Q_ASSERT(m_editingTransactions > 0);
+
+    // skip work, if no lines to insert
+    if (texts.isEmpty()) {
+        return;
+    }
+
+    // get block, this will assert on invalid line
+    const int blockIndex = blockForLine(line);
+
+    // let the block insert all lines, this call will trigger fixStartLines
+    const int count = texts.size();
+    m_lines += count; // first alter the line counter, as functions called will need the valid one
+    TextBlock *block = m_blocks.at(blockIndex);
+    block->insertLines(line, texts, blockIndex);
+
+    // notify the text history and remember changes, one revision for each primitive
+    for (int i = 0; i < count; ++i) {
+        m_history.wrapLine(KTextEditor::Cursor(line, 0));
+        ++m_revision;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (!texts.at(i).isEmpty()) {
+            m_history.insertText(KTextEditor::Cursor(line + i, 0), texts.at(i).size(), 0);
+            ++m_revision;
+        }
+    }
+
+    // update changed line interval
+    if (line < m_editingMinimalLineChanged || m_editingMinimalLineChanged == -1) {
+        m_editingMinimalLineChanged = line;
+    }
+
+    if (line <= m_editingMaximalLineChanged) {
+        m_editingMaximalLineChanged += count;
+    } else {
+        m_editingMaximalLineChanged = line + count;
+    }
+
+    // split the grown block into blocks of the usual size, from its end, the start lines stay valid
+    if (block->lines() >= 2 * BufferBlockSize) {
+        std::vector<TextBlock *> newBlocks;
+        while (block->lines() >= 2 * BufferBlockSize) {
+            newBlocks.push_back(block->splitBlock(block->lines() - BufferBlockSize));
+        }
+        m_blocks.insert(m_blocks.begin() + blockIndex + 1, newBlocks.rbegin(), newBlocks.rend());
+    }
+
+    // emit signals about done changes, in the order of the primitives
+    for (int i = 0; i < count; ++i) {
+        Q_EMIT m_document->KTextEditor::Document::lineWrapped(m_document, KTextEditor::Cursor(line, 0));
+    }
+    for (int i = 0; i < count; ++i) {
+        if (!texts.at(i).isEmpty()) {
+            Q_EMIT m_document->KTextEditor::Document::textInserted(m_document, KTextEditor::Cursor(line + i, 0), texts.at(i));
+        }
+    }
+}
+
 void TextBuffer::insertText(const KTextEditor::Cursor position, const QString &text)
 {
     // debug output for REAL low-level debugging
@@ -454,6 +575,61 @@ void TextBuffer::removeText(KTextEditor::Range range)
     Q_EMIT m_document->KTextEditor::Document::textRemoved(m_document, range, text);
 }
 
+void TextBuffer::editLines(const std::vector<LineEdit> &edits)
+{
+    // only allowed if editing transaction running
+    Q_ASSERT(m_editingTransactions > 0);
+
+    if (edits.empty()) {
+        return;
+    }
+
+    // from the last change to the first one, the positions of the changes not done yet stay valid
+    // remember all ranges modified, their validity is checked once all changes are done
+    QVarLengthArray<TextRange *, 32> changedRanges;
+    TextBlock *block = nullptr;
+    for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+        const KTextEditor::Cursor position = it->position;
+        Q_ASSERT(it == edits.rbegin() || position < std::prev(it)->position);
+
+        // the lines only get smaller, the last block stays valid until we are in front of it
+        if (!block || position.line() < block->startLine()) {
+            block = m_blocks.at(blockForLine(position.line()));
+        }
+
+        if (it->removedLength > 0) {
+            const KTextEditor::Range range(position, KTextEditor::Cursor(position.line(), position.column() + it->removedLength));
+            QString text;
+            block->removeText(range, text, changedRanges);
+            ++m_revision;
+            Q_EMIT m_document->KTextEditor::Document::textRemoved(m_document, range, text);
+        }
+
+        if (!it->insertedText.isEmpty()) {
+            block->insertText(position, it->insertedText, changedRanges);
+            ++m_revision;
+            Q_EMIT m_document->KTextEditor::Document::textInserted(m_document, position, it->insertedText);
+        }
+    }
+
+    // update changed line interval
+    const int firstLine = edits.front().position.line();
+    const int lastLine = edits.back().position.line();
+    if (firstLine < m_editingMinimalLineChanged || m_editingMinimalLineChanged == -1) {
+        m_editingMinimalLineChanged = firstLine;
+    }
+
+    if (lastLine > m_editingMaximalLineChanged) {
+        m_editingMaximalLineChanged = lastLine;
+    }
+
+    // we might need to invalidate ranges or notify about their changes
+    // checkValidity might trigger delete of the range!
+    for (TextRange *range : std::as_const(changedRanges)) {
+        range->checkValidity(range->toLineRange());
+    }
+}
+
 int TextBuffer::blockForLine(int line) const
 {
     // only allow valid lines
@@ -690,6 +866,103 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
     return true;
 }
 
+void TextBuffer::setSearchIndexEnabled(bool enabled)
+{
+    if (m_searchIndexEnabled == enabled) {
+        return;
+    }
+
+    m_searchIndexEnabled = enabled;
+    m_searchIndexPendingBuildTime = 0;
+    m_searchIndexBuildTime = -1;
+
+    if (enabled) {
+        m_searchIndexTimer.start(0);
+        return;
+    }
+
+    m_searchIndexTimer.stop();
+    for (TextBlock *block : std::as_const(m_blocks)) {
+        block->clearSearchFilter();
+    }
+}
+
+std::vector<quint32> TextBuffer::searchIndexTrigrams(QStringView needle) const
+{
+    std::vector<quint32> trigrams;
+    if (m_searchIndexEnabled) {
+        TextBlock::searchTrigrams(needle, trigrams);
+    }
+    return trigrams;
+}
+
+int TextBuffer::searchCandidateLine(int line, const std::vector<quint32> &trigrams, bool backwards) const
+{
+    if (!m_searchIndexEnabled || trigrams.empty()) {
+        return line;
+    }
+
+    const int inc = backwards ? -1 : 1;
+    for (int index = blockForLine(line); index >= 0 && index < int(m_blocks.size()); index += inc) {
+        const TextBlock *block = m_blocks.at(index);
+        if (block->lines() > 0 && block->mayContainTrigrams(trigrams)) {
+            return backwards ? std::min(line, block->startLine() + block->lines() - 1) : std::max(line, block->startLine());
+        }
+    }
+    return -1;
+}
+
+size_t TextBuffer::searchIndexMemoryUsage() const
+{
+    size_t memory = 0;
+    for (const TextBlock *block : m_blocks) {
+        memory += block->searchFilterMemory();
+    }
+    return memory;
+}
+
+void TextBuffer::buildSearchIndex()
+{
+    if (!m_searchIndexEnabled) {
+        return;
+    }
+
+    // never touch the blocks in the middle of an edit, e.g. if some nested event loop runs
+    if (m_editingTransactions > 0) {
+        m_searchIndexTimer.start(500);
+        return;
+    }
+
+    // build missing or stale filters, keep the event loop responsive
+    QElapsedTimer timer;
+    timer.start();
+    bool done = true;
+    for (TextBlock *block : std::as_const(m_blocks)) {
+        if (block->hasSearchFilter() && !block->searchFilterIsStale()) {
+            continue;
+        }
+        if (timer.elapsed() >= 10) {
+            done = false;
+            break;
+        }
+        block->buildSearchFilter();
+    }
+    m_searchIndexPendingBuildTime += timer.nsecsElapsed();
+
+    if (!done) {
+        m_searchIndexTimer.start(0);
+        return;
+    }
+
+    // first complete build? report the costs
+    if (m_searchIndexBuildTime < 0) {
+        m_searchIndexBuildTime = m_searchIndexPendingBuildTime / 1000000;
+        qCDebug(LOG_KTE) << "search index for" << m_lines << "lines built in" << m_searchIndexBuildTime << "ms using" << searchIndexMemoryUsage() / 1024
+                         << "KiB";
+    }
+    m_searchIndexPendingBuildTime = 0;
+}
+
 const QByteArray &TextBuffer::digest() const
 {
     return m_digest;
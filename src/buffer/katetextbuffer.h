@@ -10,9 +10,11 @@
 #include <QObject>
 #include <QSet>
 #include <QString>
+#include <QTimer>
 
 #include "katetextblock.h"
 #include "katetexthistory.h"
+#include "katetextsnapshot.h"
 #include <ktexteditor_export.h>
 
 // encoding prober
@@ -243,6 +245,42 @@ public:
         return m_blocks.at(blockIndex)->lineLength(line);
     }
 
+    /**
+     * Retrieve the non text attributes of a text line, without its text.
+     * Cheaper than line() for very long lines that are edited, see setChunkedLineLength().
+     * @param line wanted line number
+     * @return text line with empty text
+     */
+    TextLine lineMetaData(int line) const;
+
+    /**
+     * Retrieve a part of the text of a line.
+     * Cheaper than line() for very long lines that are edited, see setChunkedLineLength().
+     * @param line wanted line number
+     * @param column first column of the part
+     * @param length length of the part
+     * @return text of the part
+     */
+    QString lineString(int line, int column, int length) const;
+
+    /**
+     * Set the length from which on lines are kept in chunks while they are edited.
+     * Inserting or removing text in such a line then costs time depending on the size of
+     * the chunks instead of the length of the line, the chunks are joined again once the
+     * whole line is read, e.g. to highlight it after the editing transaction.
+     * @param length minimal length of chunked lines, 0 to never chunk lines
+     */
+    void setChunkedLineLength(int length);
+
+    /**
+     * Length from which on lines are kept in chunks while they are edited.
+     * @return minimal length of chunked lines, 0 if lines are never chunked
+     */
+    int chunkedLineLength() const
+    {
+        return m_chunkedLineLength;
+    }
+
     /**
      * Retrieve offset in text for the given cursor position
      */
@@ -259,6 +297,18 @@ public:
      */
     QString text() const;
 
+    /**
+     * Take a read only snapshot of the lines, to read them from other threads.
+     * This is cheap, the lines are shared with the snapshot until they are changed.
+     *
+     * All other accessors, const ones like line(), lineLength() or text() included,
+     * may only be used from the thread owning the buffer, the GUI thread. Reading a
+     * line kept in chunks while edited joins its text, see setChunkedLineLength(),
+     * so even const reads of the live buffer change it.
+     * @return snapshot of the current revision
+     */
+    TextSnapshot snapshot() const;
+
     /**
      * Start an editing transaction, the wrapLine/unwrapLine/insertText and removeText functions
      * are only allowed to be called inside a editing transaction.
@@ -354,6 +404,16 @@ public:
      */
     virtual void unwrapLine(int line);
 
+    /**
+     * Insert new lines in front of the given line, e.g. the lines in the middle of a large paste.
+     * Behaves like wrapLine() at the start of the line and insertText() into the new line for
+     * each of them, but the blocks are fixed up once for all of them.
+     * @param line existing line in front of which the lines are inserted
+     * @param texts texts of the new lines, without newlines
+     * Virtual, can be overwritten.
+     */
+    virtual void insertLines(int line, const QStringList &texts);
+
     /**
      * Insert text at given cursor position. Does nothing if text is empty, beside some consistency checks.
      * @param position position where to insert text
@@ -369,6 +429,28 @@ public:
      */
     virtual void removeText(KTextEditor::Range range);
 
+    /**
+     * Change of the text inside of one line, see editLines().
+     */
+    struct LineEdit {
+        // start of the change
+        KTextEditor::Cursor position;
+        // number of characters removed behind position
+        int removedLength = 0;
+        // text inserted at position, once they are gone
+        QString insertedText;
+    };
+
+    /**
+     * Apply many changes inside of lines at once, e.g. typing with multiple cursors.
+     * Behaves like removeText() and insertText() for each change, starting with the last one,
+     * but looks up the block of the lines once and checks the validity of the ranges touched
+     * only after all changes are done.
+     * @param edits changes sorted by position, not overlapping, with positions and lengths valid
+     *        for the text before any of them is done
+     */
+    void editLines(const std::vector<LineEdit> &edits);
+
     /**
      * TextHistory of this buffer
      * @return text history for this buffer
@@ -516,6 +598,68 @@ public:
      */
     void invalidateRanges();
 
+    //
+    // search index handling
+    //
+public:
+    /**
+     * Enable or disable the trigram search index.
+     * If enabled, each block gets a small filter of the trigrams of its text, built
+     * in time slices in the event loop and kept up-to-date by the edit primitives.
+     * Searches can use searchCandidateLine() to skip blocks that can't contain the needle.
+     * The index is disabled again by clear() and load().
+     * @param enabled enable index?
+     */
+    void setSearchIndexEnabled(bool enabled);
+
+    /**
+     * Is the trigram search index enabled?
+     * @return index enabled?
+     */
+    bool searchIndexEnabled() const
+    {
+        return m_searchIndexEnabled;
+    }
+
+    /**
+     * Compute the trigrams of a single-line needle for searchCandidateLine().
+     * @param needle text to search for
+     * @return trigram hashes, empty if the index is disabled or the needle is too short to use it
+     */
+    std::vector<quint32> searchIndexTrigrams(QStringView needle) const;
+
+    /**
+     * Find the first line starting at the given one in search direction that might contain the
+     * text the trigrams belong to. Only whole blocks are skipped.
+     * @param line line to start with, must be valid
+     * @param trigrams trigram hashes of the needle, see searchIndexTrigrams()
+     * @param backwards search direction
+     * @return candidate line or -1 if no later line can contain the text
+     */
+    int searchCandidateLine(int line, const std::vector<quint32> &trigrams, bool backwards) const;
+
+    /**
+     * Memory used by the search index.
+     * @return used bytes
+     */
+    size_t searchIndexMemoryUsage() const;
+
+    /**
+     * Time needed for the last complete build of the search index.
+     * @return build time in milliseconds, -1 if the index was not completely built yet
+     */
+    qint64 searchIndexBuildTime() const
+    {
+        return m_searchIndexBuildTime;
+    }
+
+private:
+    /**
+     * Build or refresh search filters of blocks for a few milliseconds, reschedules itself until done.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void buildSearchIndex();
+
     //
     // checksum handling
     //
@@ -599,6 +743,31 @@ private:
      */
     QSet<TextRange *> m_ranges;
 
+    /**
+     * Minimal length of lines kept in chunks while they are edited, 0 to never chunk lines.
+     */
+    int m_chunkedLineLength = 65536;
+
+    /**
+     * Search index enabled?
+     */
+    bool m_searchIndexEnabled = false;
+
+    /**
+     * Timer driving the time sliced build of the search index.
+     */
+    QTimer m_searchIndexTimer;
+
+    /**
+     * Time spent in the current search index build in nanoseconds.
+     */
+    qint64 m_searchIndexPendingBuildTime = 0;
+
+    /**
+     * Time needed for the last complete search index build in milliseconds.
+     */
+    qint64 m_searchIndexBuildTime = -1;
+
     /**
      * Encoding prober type to use
      */
@@ -47,7 +47,16 @@ TextCursor::~TextCursor()
 
 void TextCursor::setPosition(const TextCursor &position)
 {
-    if (m_block && m_block != position.m_block) {
+    // same block: only the line inside of it might change
+    if (m_block && m_block == position.m_block) {
+        if (m_line != position.m_line) {
+            m_block->moveCursorToLine(this, position.m_line);
+        }
+        m_column = position.m_column;
+        return;
+    }
+
+    if (m_block) {
         m_block->removeCursor(this);
     }
 
@@ -100,8 +109,13 @@ void TextCursor::setPosition(KTextEditor::Cursor position, bool init)
         }
         m_block = m_buffer.m_blocks[m_buffer.blockForLine(position.line())];
         Q_ASSERT(m_block);
-        m_block->insertCursor(this);
         startLine = m_block->startLine();
+
+        // the block keeps its cursors by line, set it first
+        m_line = position.line() - startLine;
+        m_block->insertCursor(this);
+    } else if (position.line() - startLine != m_line) {
+        m_block->moveCursorToLine(this, position.line() - startLine);
     }
 
     // if cursor was invalid before, remove it from invalid cursor list
@@ -278,6 +278,19 @@ int TextFolding::visibleLines() const
     return visibleLines;
 }
 
+std::vector<std::pair<int, int>> TextFolding::hiddenLineRanges() const
+{
+    std::vector<std::pair<int, int>> ranges;
+    ranges.reserve(m_foldedFoldingRanges.size());
+    for (FoldingRange *range : m_foldedFoldingRanges) {
+        // the start line of a folded range stays visible
+        if (range->end->line() > range->start->line()) {
+            ranges.emplace_back(range->start->line() + 1, range->end->line());
+        }
+    }
+    return ranges;
+}
+
 int TextFolding::lineToVisibleLine(int line) const
 {
     // valid input needed!
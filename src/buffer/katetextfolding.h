@@ -17,6 +17,8 @@
 #include <QObject>
 
 #include <functional>
+#include <utility>
+#include <vector>
 
 namespace Kate
 {
@@ -120,6 +122,12 @@ public:
      */
     int visibleLines() const;
 
+    /**
+     * Lines hidden by folded ranges, as first and last hidden line, sorted and disjoint.
+     * O(n) for n == number of folded ranges
+     */
+    std::vector<std::pair<int, int>> hiddenLineRanges() const;
+
     /**
      * Convert a text buffer line to a visible line number.
      * Very fast, if nothing is folded, else walks over all folded regions
@@ -0,0 +1,216 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "katetexthighlightstore.h"
+#include "katetextbuffer.h"
+
+#include <algorithm>
+
+namespace Kate
+{
+/**
+ * Number of ranges a bucket is filled with, buckets never span a line with others.
+ */
+static constexpr size_t BucketSize = 256;
+
+TextHighlightStore::TextHighlightStore(TextBuffer &buffer)
+    : m_buffer(buffer)
+{
+    // the history is cleared, too, nothing left to transform our ranges with
+    connect(&m_buffer, &TextBuffer::cleared, this, &TextHighlightStore::reset);
+}
+
+TextHighlightStore::~TextHighlightStore()
+{
+    clear();
+}
+
+void TextHighlightStore::setRanges(const std::vector<KTextEditor::Range> &ranges, KTextEditor::Attribute::Ptr attribute, qreal zDepth)
+{
+    clear();
+    if (ranges.empty()) {
+        return;
+    }
+
+    m_attribute = std::move(attribute);
+    m_zDepth = zDepth;
+    m_size = ranges.size();
+    m_revision = m_buffer.history().revision();
+    m_buffer.history().lockRevision(m_revision);
+
+    for (const KTextEditor::Range &range : ranges) {
+        if (!range.onSingleLine()) {
+            m_multiLineRanges.push_back(range);
+            continue;
+        }
+
+        // start a new bucket if the last one is full, but never in the middle of a line
+        const int line = range.start().line();
+        if (m_buckets.empty() || (m_buckets.back().items.size() >= BucketSize && m_buckets.back().startLine + m_buckets.back().lastLine != line)) {
+            m_buckets.push_back({line, 0, {}});
+            m_buckets.back().items.reserve(BucketSize);
+        }
+
+        Bucket &bucket = m_buckets.back();
+        bucket.lastLine = line - bucket.startLine;
+        bucket.items.push_back({bucket.lastLine, range.start().column(), range.end().column()});
+    }
+}
+
+void TextHighlightStore::clear()
+{
+    if (m_revision != -1) {
+        m_buffer.history().unlockRevision(m_revision);
+    }
+    reset();
+}
+
+void TextHighlightStore::reset()
+{
+    m_buckets.clear();
+    m_multiLineRanges.clear();
+    m_attribute.reset();
+    m_size = 0;
+    m_revision = -1;
+}
+
+void TextHighlightStore::rangesForLine(int line, QList<KTextEditor::Range> &outRanges)
+{
+    if (isEmpty()) {
+        return;
+    }
+
+    update();
+
+    // last bucket starting in front of the line, after unwraps the line might continue in buckets before
+    auto it = std::upper_bound(m_buckets.begin(), m_buckets.end(), line, [](int line, const Bucket &bucket) {
+        return line < bucket.startLine;
+    });
+    while (it != m_buckets.begin()) {
+        --it;
+        const int relativeLine = line - it->startLine;
+        if (relativeLine > it->lastLine) {
+            break;
+        }
+
+        auto item = std::lower_bound(it->items.begin(), it->items.end(), relativeLine, [](const Item &item, int line) {
+            return item.line < line;
+        });
+        for (; item != it->items.end() && item->line == relativeLine; ++item) {
+            outRanges.push_back(KTextEditor::Range(line, item->startColumn, line, item->endColumn));
+        }
+    }
+
+    for (const KTextEditor::Range &range : std::as_const(m_multiLineRanges)) {
+        if (range.start().line() <= line && line <= range.end().line()) {
+            outRanges.push_back(range);
+        }
+    }
+}
+
+std::vector<KTextEditor::Range> TextHighlightStore::ranges()
+{
+    update();
+
+    std::vector<KTextEditor::Range> ranges;
+    ranges.reserve(m_size);
+    for (const Bucket &bucket : m_buckets) {
+        for (const Item &item : bucket.items) {
+            const int line = bucket.startLine + item.line;
+            ranges.push_back(KTextEditor::Range(line, item.startColumn, line, item.endColumn));
+        }
+    }
+    ranges.insert(ranges.end(), m_multiLineRanges.begin(), m_multiLineRanges.end());
+    std::stable_sort(ranges.begin(), ranges.end(), [](const KTextEditor::Range &a, const KTextEditor::Range &b) {
+        return a.start() < b.start();
+    });
+    return ranges;
+}
+
+void TextHighlightStore::update()
+{
+    TextHistory &history = m_buffer.history();
+    const qint64 revision = history.revision();
+    if (m_revision == -1 || m_revision == revision) {
+        return;
+    }
+
+    // apply edit by edit, each one can only change ranges at or behind its line
+    std::vector<Item> transformed;
+    for (qint64 rev = m_revision + 1; rev <= revision; ++rev) {
+        const TextHistory::Entry &entry = history.m_historyEntries.at(rev - history.m_firstHistoryEntryRevision);
+        const int lineDelta = entry.type == TextHistory::Entry::WrapLine ? 1 : entry.type == TextHistory::Entry::UnwrapLine ? -1 : 0;
+
+        // multi-line ranges first, ranges moved over from the buckets below are already transformed
+        for (KTextEditor::Range &range : m_multiLineRanges) {
+            int startLine = range.start().line();
+            int startColumn = range.start().column();
+            int endLine = range.end().line();
+            int endColumn = range.end().column();
+            entry.transformCursor(startLine, startColumn, true);
+            entry.transformCursor(endLine, endColumn, false);
+            if (endLine < startLine || (endLine == startLine && endColumn < startColumn)) {
+                endLine = startLine;
+                endColumn = startColumn;
+            }
+            range = KTextEditor::Range(startLine, startColumn, endLine, endColumn);
+        }
+
+        for (auto it = m_buckets.begin(); it != m_buckets.end();) {
+            Bucket &bucket = *it;
+
+            // in front of the edit
+            if (bucket.startLine + bucket.lastLine < entry.line) {
+                ++it;
+                continue;
+            }
+
+            // completely behind the edit, only moves
+            if (bucket.startLine > entry.line) {
+                bucket.startLine += lineDelta;
+                ++it;
+                continue;
+            }
+
+            // transform range by range, wrapping inside of a range makes it a multi-line one
+            transformed.clear();
+            for (const Item &item : std::as_const(bucket.items)) {
+                int startLine = bucket.startLine + item.line;
+                int startColumn = item.startColumn;
+                int endLine = startLine;
+                int endColumn = item.endColumn;
+                entry.transformCursor(startLine, startColumn, true);
+                entry.transformCursor(endLine, endColumn, false);
+                if (startLine != endLine) {
+                    m_multiLineRanges.push_back(KTextEditor::Range(startLine, startColumn, endLine, endColumn));
+                    continue;
+                }
+                transformed.push_back({startLine, startColumn, std::max(startColumn, endColumn)});
+            }
+
+            if (transformed.empty()) {
+                it = m_buckets.erase(it);
+                continue;
+            }
+
+            bucket.startLine = transformed.front().line;
+            bucket.lastLine = transformed.back().line - bucket.startLine;
+            bucket.items.clear();
+            for (const Item &item : std::as_const(transformed)) {
+                bucket.items.push_back({item.line - bucket.startLine, item.startColumn, item.endColumn});
+            }
+            ++it;
+        }
+    }
+
+    history.lockRevision(revision);
+    history.unlockRevision(m_revision);
+    m_revision = revision;
+}
+
+}
+
+#include "moc_katetexthighlightstore.cpp"
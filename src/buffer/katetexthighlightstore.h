@@ -0,0 +1,152 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_TEXTHIGHLIGHTSTORE_H
+#define KATE_TEXTHIGHLIGHTSTORE_H
+
+#include <QList>
+#include <QObject>
+
+#include <ktexteditor/attribute.h>
+#include <ktexteditor/range.h>
+#include <ktexteditor_export.h>
+
+#include <vector>
+
+namespace Kate
+{
+class TextBuffer;
+
+/**
+ * Compact store for many ranges painted with the same attribute, e.g. all matches of a find all.
+ *
+ * Unlike TextRange, the stored ranges are not touched on each edit. The store remembers the
+ * revision its ranges belong to and transforms them with the TextHistory once they are queried.
+ * The ranges are kept in buckets of consecutive lines, edits in front of a bucket only move the
+ * bucket, so only the few ranges near the edit get transformed one by one.
+ * The ranges behave like TextRange::DoNotExpand with TextRange::AllowEmpty.
+ */
+class KTEXTEDITOR_EXPORT TextHighlightStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Construct an empty store.
+     * @param buffer buffer the ranges belong to
+     */
+    explicit TextHighlightStore(TextBuffer &buffer);
+
+    /**
+     * Destruct the store, releases the revision of the ranges.
+     */
+    ~TextHighlightStore() override;
+
+    /**
+     * Replace the content of the store.
+     * @param ranges ranges in the current revision, sorted by start
+     * @param attribute attribute to paint the ranges with
+     * @param zDepth z depth of the ranges, like TextRange::zDepth()
+     */
+    void setRanges(const std::vector<KTextEditor::Range> &ranges, KTextEditor::Attribute::Ptr attribute, qreal zDepth);
+
+    /**
+     * Remove all ranges.
+     */
+    void clear();
+
+    /**
+     * Are there any ranges?
+     * @return store is empty
+     */
+    bool isEmpty() const
+    {
+        return m_size == 0;
+    }
+
+    /**
+     * Attribute all ranges are painted with.
+     * @return attribute
+     */
+    const KTextEditor::Attribute::Ptr &attribute() const
+    {
+        return m_attribute;
+    }
+
+    /**
+     * Z depth of all ranges.
+     * @return z depth
+     */
+    qreal zDepth() const
+    {
+        return m_zDepth;
+    }
+
+    /**
+     * Append the ranges intersecting the given line to @p outRanges.
+     * @param line line to look at
+     * @param outRanges ranges in current revision, unsorted
+     */
+    void rangesForLine(int line, QList<KTextEditor::Range> &outRanges);
+
+    /**
+     * All ranges.
+     * @return ranges in current revision, sorted by start
+     */
+    std::vector<KTextEditor::Range> ranges();
+
+private:
+    /**
+     * Transform all ranges to the current revision of the buffer.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void update();
+
+    /**
+     * Forget everything without releasing the revision, the history is gone on buffer clear.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void reset();
+
+    /**
+     * Single line range, line relative to the start line of its bucket.
+     */
+    struct Item {
+        int line;
+        int startColumn;
+        int endColumn;
+    };
+
+    /**
+     * Ranges on some consecutive lines.
+     */
+    struct Bucket {
+        int startLine;
+        int lastLine; // relative to startLine
+        std::vector<Item> items;
+    };
+
+    TextBuffer &m_buffer;
+    std::vector<Bucket> m_buckets;
+
+    /**
+     * The few ranges spanning lines are kept apart, they are transformed one by one.
+     */
+    std::vector<KTextEditor::Range> m_multiLineRanges;
+
+    KTextEditor::Attribute::Ptr m_attribute;
+    qreal m_zDepth = 0.0;
+    size_t m_size = 0;
+
+    /**
+     * Revision the ranges belong to, locked in the history, -1 if empty.
+     */
+    qint64 m_revision = -1;
+};
+
+}
+
+#endif
@@ -24,6 +24,7 @@ class TextHistory
 {
     friend class TextBuffer;
     friend class TextBlock;
+    friend class TextHighlightStore;
 
 public:
     /**
@@ -0,0 +1,164 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "katetextrope.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace Kate
+{
+TextRope::TextRope(QStringView text)
+    : m_length(text.size())
+{
+    m_chunks.reserve(text.size() / ChunkSize + 1);
+    for (qsizetype i = 0; i < text.size(); i += ChunkSize) {
+        m_chunks.push_back(text.mid(i, ChunkSize).toString());
+    }
+}
+
+std::pair<size_t, int> TextRope::locate(int column) const
+{
+    Q_ASSERT(column >= 0 && column <= m_length);
+
+    // the lines this is used for have a few thousand chunks at most, a linear scan is fast enough
+    for (size_t i = 0; i + 1 < m_chunks.size(); ++i) {
+        if (column < m_chunks[i].size()) {
+            return {i, column};
+        }
+        column -= int(m_chunks[i].size());
+    }
+    return {m_chunks.empty() ? 0 : m_chunks.size() - 1, column};
+}
+
+void TextRope::mergeSmallChunk(size_t index)
+{
+    if (index >= m_chunks.size() || m_chunks[index].size() >= ChunkSize / 2) {
+        return;
+    }
+
+    if (m_chunks[index].isEmpty()) {
+        m_chunks.erase(m_chunks.begin() + index);
+    } else if (index > 0 && m_chunks[index - 1].size() + m_chunks[index].size() <= 2 * ChunkSize) {
+        m_chunks[index - 1].append(m_chunks[index]);
+        m_chunks.erase(m_chunks.begin() + index);
+    } else if (index + 1 < m_chunks.size() && m_chunks[index].size() + m_chunks[index + 1].size() <= 2 * ChunkSize) {
+        m_chunks[index].append(m_chunks[index + 1]);
+        m_chunks.erase(m_chunks.begin() + index + 1);
+    }
+}
+
+void TextRope::insert(int column, QStringView text)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+
+    if (m_chunks.empty()) {
+        m_chunks.emplace_back();
+    }
+
+    const auto [index, offset] = locate(column);
+    m_length += text.size();
+
+    // small texts go into the chunk, it is split in halves once too large
+    if (text.size() <= ChunkSize) {
+        QString &chunk = m_chunks[index];
+        chunk.insert(offset, text);
+        if (chunk.size() > 2 * ChunkSize) {
+            QString second = chunk.mid(chunk.size() / 2);
+            chunk.truncate(chunk.size() / 2);
+            m_chunks.insert(m_chunks.begin() + index + 1, std::move(second));
+        }
+        return;
+    }
+
+    // large texts split the chunk and get chunks of their own in between
+    std::vector<QString> pieces;
+    pieces.reserve(text.size() / ChunkSize + 2);
+    for (qsizetype i = 0; i < text.size(); i += ChunkSize) {
+        pieces.push_back(text.mid(i, ChunkSize).toString());
+    }
+    pieces.push_back(m_chunks[index].mid(offset));
+    m_chunks[index].truncate(offset);
+    const size_t tail = index + pieces.size();
+    m_chunks.insert(m_chunks.begin() + index + 1, std::make_move_iterator(pieces.begin()), std::make_move_iterator(pieces.end()));
+
+    // the parts of the split chunk and the last piece might be small now, merging them
+    // from the back keeps the indices in front valid
+    mergeSmallChunk(tail);
+    mergeSmallChunk(tail - 1);
+    mergeSmallChunk(index);
+}
+
+void TextRope::remove(int column, int length)
+{
+    if (length <= 0) {
+        return;
+    }
+
+    Q_ASSERT(column >= 0 && column + length <= m_length);
+
+    const auto [index, offset] = locate(column);
+    m_length -= length;
+
+    // the part in the first chunk
+    const int removedInFirst = std::min<int>(length, m_chunks[index].size() - offset);
+    m_chunks[index].remove(offset, removedInFirst);
+    length -= removedInFirst;
+
+    // whole chunks in between
+    const size_t next = index + 1;
+    size_t last = next;
+    while (length > 0 && m_chunks[last].size() <= length) {
+        length -= int(m_chunks[last].size());
+        ++last;
+    }
+    m_chunks.erase(m_chunks.begin() + next, m_chunks.begin() + last);
+
+    // the part in the last chunk
+    if (length > 0) {
+        m_chunks[next].remove(0, length);
+    }
+
+    mergeSmallChunk(next);
+    mergeSmallChunk(index);
+}
+
+QString TextRope::mid(int column, int length) const
+{
+    column = std::clamp(column, 0, m_length);
+    length = std::clamp(length, 0, m_length - column);
+
+    QString text;
+    text.reserve(length);
+    if (length == 0) {
+        return text;
+    }
+
+    auto [index, offset] = locate(column);
+    while (length > 0) {
+        const QString &chunk = m_chunks[index];
+        const int count = std::min<int>(length, chunk.size() - offset);
+        text.append(QStringView(chunk).mid(offset, count));
+        length -= count;
+        offset = 0;
+        ++index;
+    }
+    return text;
+}
+
+QString TextRope::toString() const
+{
+    QString text;
+    text.reserve(m_length);
+    for (const QString &chunk : m_chunks) {
+        text.append(chunk);
+    }
+    return text;
+}
+
+}
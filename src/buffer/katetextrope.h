@@ -0,0 +1,107 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_TEXTROPE_H
+#define KATE_TEXTROPE_H
+
+#include <QString>
+#include <QStringView>
+
+#include <ktexteditor_export.h>
+
+#include <utility>
+#include <vector>
+
+namespace Kate
+{
+/**
+ * Text of one very long line, kept in chunks of a few thousand chars.
+ *
+ * Inserting or removing text only moves the chars of the chunk the edit is in,
+ * instead of all chars behind the edit like for a single QString. This is used
+ * by TextBlock for lines longer than TextBuffer::chunkedLineLength().
+ */
+class KTEXTEDITOR_EXPORT TextRope
+{
+public:
+    /**
+     * Wanted size of the chunks, chunks grow to at most twice that size before they are split.
+     */
+    static constexpr int ChunkSize = 4096;
+
+    /**
+     * Construct a rope with the given text.
+     * @param text text of the rope
+     */
+    explicit TextRope(QStringView text = {});
+
+    /**
+     * Length of the text.
+     * @return number of chars
+     */
+    int length() const
+    {
+        return m_length;
+    }
+
+    /**
+     * Insert text at the given column.
+     * @param column column to insert at, must be in [0, length()]
+     * @param text text to insert
+     */
+    void insert(int column, QStringView text);
+
+    /**
+     * Remove text.
+     * @param column first column to remove, must be in [0, length()]
+     * @param length number of chars to remove, must not reach behind the text
+     */
+    void remove(int column, int length);
+
+    /**
+     * Retrieve a part of the text.
+     * @param column first column, is clamped to [0, length()]
+     * @param length number of chars, the part ends at the end of the text at the latest
+     * @return text of the part
+     */
+    QString mid(int column, int length) const;
+
+    /**
+     * Retrieve the whole text.
+     * @return text
+     */
+    QString toString() const;
+
+    /**
+     * Number of chunks, for the tests.
+     * @return number of chunks
+     */
+    int chunks() const
+    {
+        return static_cast<int>(m_chunks.size());
+    }
+
+private:
+    /**
+     * Find the chunk containing the column, the last chunk for the end of the text.
+     * @param column column to find, must be in [0, length()]
+     * @return index of the chunk and column inside of it
+     */
+    std::pair<size_t, int> locate(int column) const;
+
+    /**
+     * Merge a small chunk with a neighbour, if the result isn't too large.
+     * @param index index of the chunk
+     */
+    void mergeSmallChunk(size_t index);
+
+    std::vector<QString> m_chunks;
+    int m_length = 0;
+};
+
+}
+
+#endif
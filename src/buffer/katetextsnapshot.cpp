@@ -0,0 +1,57 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "katetextsnapshot.h"
+
+#include <algorithm>
+
+namespace Kate
+{
+const TextSnapshot::Block &TextSnapshot::blockForLine(int line) const
+{
+    // only allow valid lines
+    if (line < 0 || line >= m_lines) {
+        qFatal("out of range line requested in text snapshot (%d out of [0, %d])", line, m_lines);
+    }
+
+    // the last block starting in front of or at the line
+    auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), line, [](int line, const Block &block) {
+        return line < block.startLine;
+    });
+    return *(it - 1);
+}
+
+TextLine TextSnapshot::line(int line) const
+{
+    const Block &block = blockForLine(line);
+    return block.lines->at(line - block.startLine);
+}
+
+int TextSnapshot::lineLength(int line) const
+{
+    const Block &block = blockForLine(line);
+    return block.lines->at(line - block.startLine).length();
+}
+
+QString TextSnapshot::text() const
+{
+    QString text;
+    bool firstLine = true;
+    for (const Block &block : m_blocks) {
+        for (const TextLine &line : *block.lines) {
+            // not first line, insert \n
+            if (!firstLine) {
+                text.append(QLatin1Char('\n'));
+            }
+            firstLine = false;
+
+            text.append(line.text());
+        }
+    }
+    return text;
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_TEXTSNAPSHOT_H
+#define KATE_TEXTSNAPSHOT_H
+
+#include "katetextline.h"
+
+#include <ktexteditor_export.h>
+
+#include <memory>
+#include <vector>
+
+namespace Kate
+{
+class TextBuffer;
+
+/**
+ * Read only copy of the lines of a TextBuffer at one revision, see TextBuffer::snapshot().
+ *
+ * Taking a snapshot only shares the lines of the blocks of the buffer, a block copies its
+ * lines on its next change. A snapshot never changes, it can be read from any thread and
+ * by many threads at once while the buffer is edited further.
+ *
+ * Positions found in a snapshot can be transformed to the current text with the
+ * TextHistory, lock its revision() first if the buffer might change in between.
+ */
+class KTEXTEDITOR_EXPORT TextSnapshot
+{
+    friend class TextBuffer;
+
+public:
+    /**
+     * Construct an empty snapshot without lines.
+     */
+    TextSnapshot() = default;
+
+    /**
+     * Revision of the buffer the snapshot was taken at.
+     * @return buffer revision, -1 for an empty snapshot
+     */
+    qint64 revision() const
+    {
+        return m_revision;
+    }
+
+    /**
+     * Lines in this snapshot.
+     * @return number of lines
+     */
+    int lines() const
+    {
+        return m_lines;
+    }
+
+    /**
+     * Retrieve a text line.
+     * @param line wanted line number, must be valid
+     * @return text line
+     */
+    TextLine line(int line) const;
+
+    /**
+     * Retrieve length of a line.
+     * @param line wanted line number, must be valid
+     * @return length of the line
+     */
+    int lineLength(int line) const;
+
+    /**
+     * Retrieve text of the whole snapshot.
+     * @return text, lines separated by '\n'
+     */
+    QString text() const;
+
+private:
+    /**
+     * Lines of one block of the buffer.
+     */
+    struct Block {
+        int startLine;
+        std::shared_ptr<const std::vector<TextLine>> lines;
+    };
+
+    /**
+     * Find the block containing the line.
+     * @param line wanted line number, must be valid
+     * @return block of the line
+     */
+    const Block &blockForLine(int line) const;
+
+    std::vector<Block> m_blocks;
+    int m_lines = 0;
+    qint64 m_revision = -1;
+};
+
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include <KLocalizedString>
 
 #include <QDate>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QStringEncoder>
@@ -38,6 +39,9 @@ KateBuffer::KateBuffer(KTextEditor::DocumentPrivate *doc)
     , m_tabWidth(8)
     , m_lineHighlighted(0)
 {
+    m_idleHighlightTimer.setSingleShot(true);
+    m_idleHighlightTimer.setInterval(0);
+    connect(&m_idleHighlightTimer, &QTimer::timeout, this, &KateBuffer::highlightIdleSlice);
 }
 
 /**
@@ -168,10 +172,19 @@ bool KateBuffer::openFile(const QString &m_file, bool enforceTextCodec)
         m_doc->config()->setBom(true);
     }
 
+    // large documents get a search index
+    updateSearchIndex();
+
     // okay, loading did work
     return true;
 }
 
+void KateBuffer::updateSearchIndex()
+{
+    const int threshold = m_doc->config()->searchIndexLineThreshold();
+    setSearchIndexEnabled(threshold > 0 && lines() >= threshold);
+}
+
 bool KateBuffer::canEncode()
 {
     // hardcode some Unicode encodings which can encode all chars
@@ -256,6 +269,33 @@ void KateBuffer::ensureHighlighted(int line, int lookAhead)
     doHighlight(m_lineHighlighted, end, false);
 }
 
+int KateBuffer::highlightedLines() const
+{
+    if (!m_highlight || m_highlight->noHighlighting()) {
+        return lines();
+    }
+    return qMin(m_lineHighlighted, lines());
+}
+
+void KateBuffer::highlightInIdleTime()
+{
+    if (highlightedLines() < lines() && !m_idleHighlightTimer.isActive()) {
+        m_idleHighlightTimer.start();
+    }
+}
+
+void KateBuffer::highlightIdleSlice()
+{
+    // stay responsive, each slice only takes a few milliseconds, the event loop runs in between
+    QElapsedTimer timer;
+    timer.start();
+    while (highlightedLines() < lines() && timer.elapsed() < 5) {
+        doHighlight(m_lineHighlighted, m_lineHighlighted + 63, false);
+    }
+
+    highlightInIdleTime();
+}
+
 void KateBuffer::wrapLine(const KTextEditor::Cursor position)
 {
     // call original
@@ -266,6 +306,16 @@ void KateBuffer::wrapLine(const KTextEditor::Cursor position)
     }
 }
 
+void KateBuffer::insertLines(int line, const QStringList &texts)
+{
+    // call original
+    Kate::TextBuffer::insertLines(line, texts);
+
+    if (m_lineHighlighted > line + 1) {
+        m_lineHighlighted += texts.size();
+    }
+}
+
 void KateBuffer::unwrapLine(int line)
 {
     // reimplemented, so first call original
@@ -382,6 +432,11 @@ void KateBuffer::doHighlight(int startLine, int endLine, bool invalidate)
         m_lineHighlighted = current_line;
     }
 
+    // lines seen the first time, views with an overview of the whole document want to know
+    if (m_lineHighlighted > oldHighlighted) {
+        Q_EMIT highlightingAdvanced({oldHighlighted, m_lineHighlighted - 1});
+    }
+
     // tag the changed lines !
     if (invalidate) {
 #ifdef BUFFER_DEBUGGING
@@ -14,6 +14,7 @@
 #include <ktexteditor_export.h>
 
 #include <QObject>
+#include <QTimer>
 
 class KateLineInfo;
 namespace KTextEditor
@@ -134,6 +135,12 @@ public:
         return m_longestLineLoaded;
     }
 
+    /**
+     * Enable or disable the search index depending on the document size,
+     * see KateDocumentConfig::searchIndexLineThreshold().
+     */
+    void updateSearchIndex();
+
     /**
      * Can the current codec handle all chars
      * @return chars can be encoded
@@ -182,6 +189,19 @@ public:
      */
     void ensureHighlighted(int line, int lookAhead = 64);
 
+    /**
+     * Number of lines from the start of the document with up to date highlighting,
+     * all lines if there is no highlighting. Lines behind might carry outdated attributes.
+     */
+    int highlightedLines() const;
+
+    /**
+     * Highlight the lines behind highlightedLines() in idle time, a few lines at once.
+     * Used by views with an overview of the whole document, they get highlightingAdvanced
+     * for each slice.
+     */
+    void highlightInIdleTime();
+
     /**
      * Unwrap given line.
      * @param line line to unwrap
@@ -194,6 +214,13 @@ public:
      */
     void wrapLine(const KTextEditor::Cursor position) override;
 
+    /**
+     * Insert new lines in front of the given line.
+     * @param line existing line in front of which the lines are inserted
+     * @param texts texts of the new lines
+     */
+    void insertLines(int line, const QStringList &texts) override;
+
 public:
     inline int tabWidth() const
     {
@@ -254,6 +281,12 @@ private:
     KTEXTEDITOR_NO_EXPORT
     void doHighlight(int from, int to, bool invalidate);
 
+    /**
+     * Highlight the next lines for highlightInIdleTime(), for a few milliseconds at most.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void highlightIdleSlice();
+
 Q_SIGNALS:
     /**
      * Emitted when the highlighting of a certain range has
@@ -262,6 +295,12 @@ Q_SIGNALS:
     void tagLines(KTextEditor::LineRange lineRange);
     void respellCheckBlock(int start, int end);
 
+    /**
+     * Emitted when lines got highlighted for the first time, e.g. by ensureHighlighted.
+     * @param lineRange lines that were not highlighted before
+     */
+    void highlightingAdvanced(KTextEditor::LineRange lineRange);
+
 private:
     /**
      * document we belong to
@@ -295,6 +334,11 @@ private:
      * last line with valid highlighting
      */
     int m_lineHighlighted;
+
+    /**
+     * drives highlightIdleSlice()
+     */
+    QTimer m_idleHighlightTimer;
 };
 
 #endif
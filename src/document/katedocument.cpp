@@ -726,10 +726,18 @@ bool KTextEditor::DocumentPrivate::insertText(const KTextEditor::Cursor position
 
     int endCol = 0;
     int pos = 0;
+    QStringList newLines;
     for (; pos < totalLength; pos++) {
         const QChar &ch = text.at(pos);
 
         if (ch == QLatin1Char('\n')) {
+            // once the first line is wrapped, all complete lines go in front of its rest, insert them in one go below
+            if (!block && currentLine > position.line()) {
+                newLines.append(text.mid(currentLineStart, pos - currentLineStart));
+                currentLineStart = pos + 1;
+                continue;
+            }
+
             // Only perform the text insert if there is text to insert
             if (currentLineStart < pos) {
                 editInsertText(currentLine, insertColumn, text.mid(currentLineStart, pos - currentLineStart), notify);
@@ -768,6 +776,12 @@ bool KTextEditor::DocumentPrivate::insertText(const KTextEditor::Cursor position
         }
     }
 
+    // insert the complete lines of a multi-line paste, the buffer fixes up its blocks once for all of them
+    if (!newLines.isEmpty()) {
+        editInsertLines(currentLine, newLines, notify);
+        currentLine += newLines.size();
+    }
+
     // Only perform the text insert if there is text to insert
     if (currentLineStart < pos) {
         editInsertText(currentLine, insertColumn, text.mid(currentLineStart, pos - currentLineStart), notify);
@@ -1271,8 +1285,8 @@ bool KTextEditor::DocumentPrivate::editInsertText(int line, int col, const QStri
         return false;
     }
 
-    auto l = plainKateTextLine(line);
-    int length = l.length();
+    // only look at the length and flags of the line, very long lines are kept in chunks while edited
+    int length = m_buffer->lineLength(line);
     if (length < 0) {
         return false;
     }
@@ -1286,7 +1300,7 @@ bool KTextEditor::DocumentPrivate::editInsertText(int line, int col, const QStri
         col2 = length;
     }
 
-    m_undoManager->slotTextInserted(line, col2, s2, l);
+    m_undoManager->slotTextInserted(line, col2, s2, m_buffer->lineMetaData(line));
 
     // remember last change cursor
     m_editLastChangeStartCursor = KTextEditor::Cursor(line, col2);
@@ -1315,26 +1329,27 @@ bool KTextEditor::DocumentPrivate::editRemoveText(int line, int col, int len)
         return false;
     }
 
-    Kate::TextLine l = plainKateTextLine(line);
-
     // nothing to do, do nothing!
     if (len == 0) {
         return true;
     }
 
+    // only look at the length and flags of the line, very long lines are kept in chunks while edited
+    const int length = m_buffer->lineLength(line);
+
     // wrong column
-    if (col >= l.text().size()) {
+    if (col >= length) {
         return false;
     }
 
     // don't try to remove what's not there
-    len = qMin(len, l.text().size() - col);
+    len = qMin(len, length - col);
 
     editStart();
 
-    QString oldText = l.string(col, len);
+    QString oldText = m_buffer->lineString(line, col, len);
 
-    m_undoManager->slotTextRemoved(line, col, oldText, l);
+    m_undoManager->slotTextRemoved(line, col, oldText, m_buffer->lineMetaData(line));
 
     // remember last change cursor
     m_editLastChangeStartCursor = KTextEditor::Cursor(line, col);
@@ -1349,6 +1364,152 @@ bool KTextEditor::DocumentPrivate::editRemoveText(int line, int col, int len)
     return true;
 }
 
+QList<KTextEditor::Range>
+KTextEditor::DocumentPrivate::replaceTextOnLine(int line, const QList<KTextEditor::Range> &ranges, const QStringList &replacements)
+{
+    // verbose debug
+    EDIT_DEBUG << "replaceTextOnLine" << line << ranges.size();
+
+    Q_ASSERT(ranges.size() == replacements.size());
+
+    QList<KTextEditor::Range> replacedRanges;
+    if (ranges.isEmpty() || line < 0 || line >= lines()) {
+        return replacedRanges;
+    }
+
+    if (!isReadWrite()) {
+        return replacedRanges;
+    }
+
+    // copy, the buffer will change below
+    const QString oldText = m_buffer->plainLine(line).text();
+    const int spanStart = ranges.first().start().column();
+    const int spanEnd = ranges.last().end().column();
+    if (spanStart < 0 || spanEnd > oldText.size()) {
+        return replacedRanges;
+    }
+
+    // rebuild the affected span, unchanged text between the ranges is kept as is
+    QString spanText;
+    spanText.reserve(spanEnd - spanStart);
+    replacedRanges.reserve(ranges.size());
+    int oldColumn = spanStart;
+    for (qsizetype i = 0; i < ranges.size(); ++i) {
+        const KTextEditor::Range range = ranges.at(i);
+        Q_ASSERT(range.onSingleLine() && range.start().line() == line);
+        Q_ASSERT(range.start().column() >= oldColumn);
+        Q_ASSERT(!replacements.at(i).contains(QLatin1Char('\n')));
+
+        spanText.append(QStringView(oldText).mid(oldColumn, range.start().column() - oldColumn));
+        const int replacedStart = spanStart + spanText.size();
+        spanText.append(replacements.at(i));
+        replacedRanges.append(KTextEditor::Range(line, replacedStart, line, spanStart + spanText.size()));
+        oldColumn = range.end().column();
+    }
+
+    editStart();
+
+    if (spanEnd > spanStart) {
+        Q_EMIT aboutToRemoveText(KTextEditor::Range(line, spanStart, line, spanEnd));
+        editRemoveText(line, spanStart, spanEnd - spanStart);
+    }
+    editInsertText(line, spanStart, spanText);
+
+    editEnd();
+    return replacedRanges;
+}
+
+QList<KTextEditor::Range> KTextEditor::DocumentPrivate::replaceTextInLines(const QList<KTextEditor::Range> &ranges, const QStringList &replacements)
+{
+    // verbose debug
+    EDIT_DEBUG << "replaceTextInLines" << ranges.size();
+
+    Q_ASSERT(ranges.size() == replacements.size());
+
+    QList<KTextEditor::Range> replacedRanges;
+    if (ranges.isEmpty() || !isReadWrite()) {
+        return replacedRanges;
+    }
+
+    // check all ranges first, either all or nothing is changed
+    std::vector<Kate::TextBuffer::LineEdit> edits;
+    edits.reserve(ranges.size());
+    KTextEditor::Cursor previousEnd = KTextEditor::Cursor::invalid();
+    for (qsizetype i = 0; i < ranges.size(); ++i) {
+        const KTextEditor::Range range = ranges.at(i);
+        const int line = range.start().line();
+        if (!range.onSingleLine() || line < 0 || line >= lines() || range.start().column() < 0 || range.end().column() > lineLength(line)) {
+            return replacedRanges;
+        }
+
+        // two insertions at one position would be ambiguous, too
+        if (previousEnd.isValid() && (range.start() < previousEnd || range.start() == edits.back().position)) {
+            return replacedRanges;
+        }
+
+        Q_ASSERT(!replacements.at(i).contains(QLatin1Char('\n')));
+        edits.push_back({range.start(), range.columnWidth(), replacements.at(i)});
+        previousEnd = range.end();
+    }
+
+    editStart();
+
+    // undo items in the order the buffer does the changes, from the last one to the first one
+    std::vector<QString> removedTexts(edits.size());
+    Kate::TextLine textLine;
+    int textLineNumber = -1;
+    for (size_t i = edits.size(); i-- > 0;) {
+        const auto &edit = edits[i];
+        const int line = edit.position.line();
+        const int column = edit.position.column();
+        if (line != textLineNumber) {
+            textLine = plainKateTextLine(line);
+            textLineNumber = line;
+        }
+
+        // the text in front of a change stays as is while the changes behind it are done
+        if (edit.removedLength > 0) {
+            removedTexts[i] = textLine.string(column, edit.removedLength);
+            m_undoManager->slotTextRemoved(line, column, removedTexts[i], textLine);
+            textLine.markAsModified(true);
+        }
+        if (!edit.insertedText.isEmpty()) {
+            m_undoManager->slotTextInserted(line, column, edit.insertedText, textLine);
+            textLine.markAsModified(true);
+        }
+    }
+
+    // remember last change cursor
+    m_editLastChangeStartCursor = edits.front().position;
+
+    m_buffer->editLines(edits);
+
+    // notify with the positions in the changed text
+    replacedRanges.reserve(edits.size());
+    int shift = 0;
+    for (size_t i = 0; i < edits.size(); ++i) {
+        const auto &edit = edits[i];
+        if (i > 0 && edit.position.line() != edits[i - 1].position.line()) {
+            shift = 0;
+        }
+
+        const KTextEditor::Cursor start(edit.position.line(), edit.position.column() + shift);
+        if (edit.removedLength > 0) {
+            Q_EMIT textRemoved(this, KTextEditor::Range(start, edit.removedLength), removedTexts[i]);
+        }
+
+        const KTextEditor::Range replacedRange(start, edit.insertedText.size());
+        if (!edit.insertedText.isEmpty()) {
+            Q_EMIT textInsertedRange(this, replacedRange);
+        }
+        replacedRanges.append(replacedRange);
+        shift += edit.insertedText.size() - edit.removedLength;
+    }
+
+    editEnd();
+    return replacedRanges;
+}
+
 bool KTextEditor::DocumentPrivate::editMarkLineAutoWrapped(int line, bool autowrapped)
 {
     // verbose debug
@@ -1586,6 +1747,66 @@ bool KTextEditor::DocumentPrivate::editInsertLine(int line, const QString &s, bo
     return true;
 }
 
+bool KTextEditor::DocumentPrivate::editInsertLines(int line, const QStringList &texts, bool notify)
+{
+    // verbose debug
+    EDIT_DEBUG << "editInsertLines" << line << texts.size();
+
+    if (line < 0 || line >= lines()) {
+        return false;
+    }
+
+    if (!isReadWrite()) {
+        return false;
+    }
+
+    if (texts.isEmpty()) {
+        return true;
+    }
+
+    editStart();
+
+    // same undo items as inserting the lines one by one
+    for (int i = 0; i < texts.size(); ++i) {
+        m_undoManager->slotLineInserted(line + i, texts.at(i));
+    }
+
+    m_buffer->insertLines(line, texts);
+
+    QVarLengthArray<KTextEditor::Mark *, 8> list;
+    for (const auto &mark : std::as_const(m_marks)) {
+        if (mark->line >= line) {
+            list.push_back(mark);
+        }
+    }
+
+    for (const auto &mark : list) {
+        m_marks.take(mark->line);
+    }
+
+    for (const auto &mark : list) {
+        mark->line += texts.size();
+        m_marks.insert(mark->line, mark);
+    }
+
+    if (!list.isEmpty()) {
+        Q_EMIT marksChanged(this);
+    }
+
+    KTextEditor::Range rangeInserted(line, 0, line + texts.size(), 0);
+
+    // remember last change cursor
+    m_editLastChangeStartCursor = rangeInserted.start();
+
+    if (notify) {
+        Q_EMIT textInsertedRange(this, rangeInserted);
+    }
+
+    editEnd();
+
+    return true;
+}
+
 bool KTextEditor::DocumentPrivate::editRemoveLine(int line)
 {
     return editRemoveLines(line, line);
@@ -3194,13 +3415,32 @@ void KTextEditor::DocumentPrivate::typeChars(KTextEditor::ViewPrivate *view, QSt
         const auto &sc = view->secondaryCursors();
         const bool hasClosingBracket = !closingBracket.isNull();
         const QString closingChar = closingBracket;
-        for (const auto &c : sc) {
-            insertText(c.cursor(), chars);
-            const auto pos = c.cursor();
-            const auto nextChar = view->document()->text({pos, pos + Cursor{0, 1}}).trimmed();
-            if (hasClosingBracket && !skipAutoBrace(closingBracket, pos) && (nextChar.isEmpty() || !nextChar.at(0).isLetterOrNumber())) {
-                insertText(c.cursor(), closingChar);
-                c.pos->setPosition(pos);
+
+        // plain typing: change the lines of all secondary cursors in one go
+        bool typedInOneGo = false;
+        if (!hasClosingBracket && !sc.empty() && !chars.contains(QLatin1Char('\n'))) {
+            QList<KTextEditor::Range> ranges;
+            ranges.reserve(sc.size());
+            for (const auto &c : sc) {
+                ranges.append(KTextEditor::Range(c.cursor(), c.cursor()));
+            }
+            std::sort(ranges.begin(), ranges.end(), [](const KTextEditor::Range &l, const KTextEditor::Range &r) {
+                return l.start() < r.start();
+            });
+
+            // fails e.g. for cursors behind the end of their line, these need the padding of insertText()
+            typedInOneGo = !replaceTextInLines(ranges, QStringList(ranges.size(), chars)).isEmpty();
+        }
+
+        if (!typedInOneGo) {
+            for (const auto &c : sc) {
+                insertText(c.cursor(), chars);
+                const auto pos = c.cursor();
+                const auto nextChar = view->document()->text({pos, pos + Cursor{0, 1}}).trimmed();
+                if (hasClosingBracket && !skipAutoBrace(closingBracket, pos) && (nextChar.isEmpty() || !nextChar.at(0).isLetterOrNumber())) {
+                    insertText(c.cursor(), closingChar);
+                    c.pos->setPosition(pos);
+                }
             }
         }
         view->completionWidget()->setIgnoreBufferSignals(false);
@@ -5024,6 +5264,12 @@ void KTextEditor::DocumentPrivate::updateConfig()
     // set tab width there, too
     m_buffer->setTabWidth(config()->tabWidth());
 
+    // the search index threshold might have changed
+    m_buffer->updateSearchIndex();
+
+    // very long lines are edited in chunks
+    m_buffer->setChunkedLineLength(config()->chunkedLineLength());
+
     // update all views, does tagAll and updateView...
     for (auto view : std::as_const(m_views)) {
         static_cast<ViewPrivate *>(view)->updateDocumentConfig();
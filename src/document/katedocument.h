@@ -244,6 +244,29 @@ public:
      */
     bool editRemoveText(int line, int col, int len);
 
+    /**
+     * Replace several ranges on one line in one go.
+     * The line is rewritten once: the span from the first to the last range
+     * is removed and the rebuilt text is inserted, so the whole line costs one
+     * undo item pair, one history/swap record pair and one moving range update
+     * instead of one round per range.
+     * @param line line number
+     * @param ranges ranges on @p line to replace, sorted and non-overlapping
+     * @param replacements replacement text for each range, must not contain newlines
+     * @return ranges the replacements occupy after the edit, empty on failure
+     */
+    QList<KTextEditor::Range> replaceTextOnLine(int line, const QList<KTextEditor::Range> &ranges, const QStringList &replacements);
+
+    /**
+     * Replace ranges on many lines in one go, e.g. text typed with multiple cursors.
+     * The buffer does all changes in one pass, see Kate::TextBuffer::editLines(), each of them
+     * still gets its own undo items and signals, like editRemoveText() and editInsertText() do.
+     * @param ranges ranges to replace, each on one line, sorted and non-overlapping, empty ranges insert
+     * @param replacements replacement text for each range, must not contain newlines
+     * @return ranges the replacements occupy after the edit, empty on failure, then nothing is changed
+     */
+    QList<KTextEditor::Range> replaceTextInLines(const QList<KTextEditor::Range> &ranges, const QStringList &replacements);
+
     /**
      * Mark @p line as @p autowrapped. This is necessary if static word warp is
      * enabled, because we have to know whether to insert a new line or add the
@@ -283,6 +306,14 @@ public:
      */
     bool editInsertLine(int line, const QString &s, bool notify = true);
 
+    /**
+     * Insert new lines in front of an existing line, in one go for the buffer.
+     * @param line line number, must be an existing line
+     * @param texts strings to insert, one per line
+     * @return true on success
+     */
+    bool editInsertLines(int line, const QStringList &texts, bool notify = true);
+
     /**
      * Remove a line
      * @param line line number
@@ -1088,6 +1119,11 @@ public:
         return *m_buffer;
     }
 
+    const KateBuffer &buffer() const
+    {
+        return *m_buffer;
+    }
+
     /**
      * set indentation mode by user
      * this will remember that a user did set it and will avoid reset on save
@@ -0,0 +1,94 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "katetextchangebatch.h"
+#include "katedocument.h"
+
+bool KateTextChangeBatch::add(int line, int column, int removedLength, const QString &insertedText)
+{
+    const int delta = insertedText.size() - removedLength;
+    if (m_edits.empty()) {
+        m_edits.push_back({KTextEditor::Range(line, column, line, column + removedLength), insertedText});
+        m_steps.push_back({line, column, removedLength, insertedText});
+        m_shift = delta;
+        return true;
+    }
+
+    Edit &last = m_edits.back();
+    const int lastLine = last.range.start().line();
+
+    // in front of all changes collected so far, its column isn't changed by them
+    if (m_direction != Forward && (line < lastLine || (line == lastLine && column + removedLength <= last.range.start().column()))) {
+        if (line == lastLine && column + removedLength == last.range.start().column()) {
+            // adjacent, e.g. the old text inserted where the new one was removed
+            last.range.setStart(KTextEditor::Cursor(line, column));
+            last.text.prepend(insertedText);
+        } else {
+            m_edits.push_back({KTextEditor::Range(line, column, line, column + removedLength), insertedText});
+            m_direction = Backward;
+        }
+        m_shift = line == lastLine ? m_shift + delta : delta;
+        m_steps.push_back({line, column, removedLength, insertedText});
+        return true;
+    }
+
+    // behind all changes collected so far, on their line they moved the column by m_shift
+    if (m_direction != Backward && (line > lastLine || (line == lastLine && column - m_shift >= last.range.end().column()))) {
+        const int originalColumn = line == lastLine ? column - m_shift : column;
+        if (line == lastLine && originalColumn == last.range.end().column()) {
+            last.range.setEnd(KTextEditor::Cursor(line, originalColumn + removedLength));
+            last.text.append(insertedText);
+        } else {
+            m_edits.push_back({KTextEditor::Range(line, originalColumn, line, originalColumn + removedLength), insertedText});
+            m_direction = Forward;
+        }
+        m_shift = line == lastLine ? m_shift + delta : delta;
+        m_steps.push_back({line, column, removedLength, insertedText});
+        return true;
+    }
+
+    return false;
+}
+
+void KateTextChangeBatch::apply()
+{
+    if (m_edits.empty()) {
+        return;
+    }
+
+    QList<KTextEditor::Range> ranges;
+    QStringList texts;
+    ranges.reserve(m_edits.size());
+    texts.reserve(m_edits.size());
+    if (m_direction == Backward) {
+        for (auto it = m_edits.rbegin(); it != m_edits.rend(); ++it) {
+            ranges.push_back(it->range);
+            texts.push_back(it->text);
+        }
+    } else {
+        for (const auto &edit : m_edits) {
+            ranges.push_back(edit.range);
+            texts.push_back(edit.text);
+        }
+    }
+
+    // if the document refuses the batch, do the changes one after another
+    if (m_doc->replaceTextInLines(ranges, texts).isEmpty()) {
+        for (const auto &step : m_steps) {
+            if (step.removedLength > 0) {
+                m_doc->editRemoveText(step.line, step.column, step.removedLength);
+            }
+            if (!step.insertedText.isEmpty()) {
+                m_doc->editInsertText(step.line, step.column, step.insertedText);
+            }
+        }
+    }
+
+    m_edits.clear();
+    m_steps.clear();
+    m_direction = Unknown;
+    m_shift = 0;
+}
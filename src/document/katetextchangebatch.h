@@ -0,0 +1,80 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_TEXTCHANGEBATCH_H
+#define KATE_TEXTCHANGEBATCH_H
+
+#include <ktexteditor/range.h>
+
+#include <QString>
+
+#include <vector>
+
+namespace KTextEditor
+{
+class DocumentPrivate;
+}
+
+/**
+ * Text changes of single lines, done one after another, collected into one change of the whole
+ * batch with DocumentPrivate::replaceTextInLines(). This works as long as the changes are done
+ * from the end of the document to its start or the other way around, like a replace all does,
+ * or are adjacent to each other, like typing does.
+ *
+ * Used to undo and redo large undo groups and to replay the swap file.
+ */
+class KateTextChangeBatch
+{
+public:
+    explicit KateTextChangeBatch(KTextEditor::DocumentPrivate *doc)
+        : m_doc(doc)
+    {
+    }
+
+    /**
+     * Add a change of a line, the column is the one at the time the change is done.
+     * @return false if the change doesn't fit into the batch, apply() it first
+     */
+    bool add(int line, int column, int removedLength, const QString &insertedText);
+
+    /**
+     * Do all changes added so far, the batch is empty afterwards.
+     */
+    void apply();
+
+    /**
+     * Number of changes added since the last apply().
+     */
+    size_t size() const
+    {
+        return m_steps.size();
+    }
+
+private:
+    struct Edit {
+        KTextEditor::Range range;
+        QString text;
+    };
+
+    struct Step {
+        int line;
+        int column;
+        int removedLength;
+        QString insertedText;
+    };
+
+    KTextEditor::DocumentPrivate *const m_doc;
+
+    // changes in the columns before the batch, in the order they were added
+    std::vector<Edit> m_edits;
+    // the changes as added, in case the batch fails
+    std::vector<Step> m_steps;
+    enum { Unknown, Backward, Forward } m_direction = Unknown;
+    // change of the length of the last line by the batch
+    int m_shift = 0;
+};
+
+#endif
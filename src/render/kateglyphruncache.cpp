@@ -0,0 +1,79 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kateglyphruncache.h"
+
+#include <QGlyphRun>
+#include <QTextLayout>
+
+KateGlyphRunCache::KateGlyphRunCache(qsizetype maxGlyphs)
+    : m_cache(maxGlyphs)
+{
+}
+
+void KateGlyphRunCache::clear()
+{
+    m_cache.clear();
+}
+
+/**
+ * Is the glyph run from the given font, not from some fallback font?
+ */
+static bool isFromFont(const QGlyphRun &run, const QRawFont &rawFont)
+{
+    const QRawFont runFont = run.rawFont();
+    return runFont == rawFont
+        || (runFont.familyName() == rawFont.familyName() && runFont.styleName() == rawFont.styleName() && qFuzzyCompare(runFont.pixelSize(), rawFont.pixelSize()));
+}
+
+const QList<quint32> *KateGlyphRunCache::glyphs(QStringView token, int style, const QFont &font, const QRawFont &rawFont, qreal advance)
+{
+    QString key;
+    key.reserve(token.size() + 1);
+    key.append(QChar(u'0' + style));
+    key.append(token);
+
+    if (const Entry *entry = m_cache.object(key)) {
+        ++m_hits;
+        return entry->monospace ? &entry->glyphs : nullptr;
+    }
+    ++m_misses;
+
+    // shape the token on its own, left to right, like it would be shaped inside of a line without formats
+    QTextLayout layout(token.toString(), font);
+    QTextOption option;
+    option.setFlags(QTextOption::IncludeTrailingSpaces);
+    option.setTextDirection(Qt::LeftToRight);
+    layout.setTextOption(option);
+    layout.beginLayout();
+    QTextLine line = layout.createLine();
+    line.setLineWidth(INT_MAX);
+    layout.endLayout();
+
+    auto entry = new Entry;
+    const QList<QGlyphRun> runs = layout.glyphRuns();
+    if (runs.size() == 1 && isFromFont(runs.front(), rawFont)) {
+        const QList<quint32> glyphs = runs.front().glyphIndexes();
+        const QList<QPointF> positions = runs.front().positions();
+
+        // one glyph per character on the monospace grid, no ligatures, no combining marks, no wide characters
+        entry->monospace = glyphs.size() == token.size() && !glyphs.contains(0);
+        for (qsizetype i = 0; entry->monospace && i < positions.size(); ++i) {
+            entry->monospace = qAbs(positions[i].x() - positions.front().x() - i * advance) < 0.01;
+        }
+        entry->monospace = entry->monospace && qAbs(line.naturalTextWidth() - token.size() * advance) < 0.01;
+        if (entry->monospace) {
+            entry->glyphs = glyphs;
+        }
+    }
+
+    // tokens larger than the whole cache are deleted right away
+    const bool monospace = entry->monospace;
+    if (!m_cache.insert(key, entry, std::max<qsizetype>(1, token.size())) || !monospace) {
+        return nullptr;
+    }
+    return &entry->glyphs;
+}
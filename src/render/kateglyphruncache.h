@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATEGLYPHRUNCACHE_H
+#define KATEGLYPHRUNCACHE_H
+
+#include <QCache>
+#include <QFont>
+#include <QList>
+#include <QRawFont>
+#include <QString>
+
+/**
+ * Cache of shaped tokens for the monospace fast path of KateRenderer.
+ *
+ * Source code repeats the same identifiers, keywords and strings over and over. A token,
+ * i.e. a piece of a line with one format, is shaped once per font style and the glyphs are
+ * reused wherever the token shows up again. Only tokens that end up with one glyph per
+ * character at the monospace advance, taken from the font itself, can be painted by the
+ * fast path; for others the negative result is cached.
+ *
+ * Colors don't change glyphs, therefore the key is just the token text and the style
+ * (bold, italic) of its attribute. The cache must be cleared on font changes.
+ */
+class KateGlyphRunCache
+{
+public:
+    /**
+     * Construct an empty cache.
+     * @param maxGlyphs number of glyphs to keep at most
+     */
+    explicit KateGlyphRunCache(qsizetype maxGlyphs = 64 * 1024);
+
+    /**
+     * Drop all tokens, e.g. after the font changed.
+     */
+    void clear();
+
+    /**
+     * Glyphs for the token.
+     * @param token text of the token
+     * @param style style index of the token, 1 = bold, 2 = italic
+     * @param font font of that style
+     * @param rawFont raw font of that style, the glyphs must come from it
+     * @param advance advance each glyph must have
+     * @return one glyph per character or nullptr if the token can't be painted glyph by glyph,
+     *         only valid until the next call
+     */
+    const QList<quint32> *glyphs(QStringView token, int style, const QFont &font, const QRawFont &rawFont, qreal advance);
+
+    quint64 hits() const
+    {
+        return m_hits;
+    }
+
+    quint64 misses() const
+    {
+        return m_misses;
+    }
+
+private:
+    struct Entry {
+        // empty if the token doesn't fit the monospace grid
+        QList<quint32> glyphs;
+        bool monospace = false;
+    };
+
+    QCache<QString, Entry> m_cache;
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+};
+
+#endif
@@ -10,15 +10,40 @@
 #include "katedocument.h"
 #include "katepartdebug.h"
 #include "katerenderer.h"
+#include "katetextfolding.h"
 #include "kateview.h"
 
+#include <QElapsedTimer>
+#include <QTextLayout>
+#include <QtMath>
+
+#include <algorithm>
+
 namespace
 {
 bool enableLayoutCache = false;
 
-bool lessThan(const KateLineLayoutMap::LineLayoutPair &lhs, const KateLineLayoutMap::LineLayoutPair &rhs)
+bool lessThan(const KateLineLayoutMap::LineLayoutEntry &lhs, int rhs)
+{
+    return lhs.line < rhs;
+}
+
+bool greaterThan(int lhs, const KateLineLayoutMap::LineLayoutEntry &rhs)
 {
-    return lhs.first < rhs.first;
+    return lhs < rhs.line;
+}
+
+/**
+ * Rough guess of the memory a line layout occupies: the QTextLayout keeps some glyph data
+ * per character and some more per wrapped line, on top of the objects themselves.
+ */
+qint64 estimatedMemoryUsage(const KateLineLayout &lineLayout)
+{
+    qint64 bytes = sizeof(KateLineLayout);
+    for (const QTextLayout *layout : lineLayout.segmentLayouts()) {
+        bytes += sizeof(QTextLayout) + 256 + qint64(layout->text().size()) * 40 + qint64(layout->lineCount()) * 128;
+    }
+    return bytes;
 }
 
 }
@@ -32,41 +57,44 @@ void KateLineLayoutMap::clear()
 
 void KateLineLayoutMap::insert(int realLine, std::unique_ptr<KateLineLayout> lineLayoutPtr)
 {
-    auto it = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), LineLayoutPair(realLine, nullptr), lessThan);
-    if (it != m_lineLayouts.end() && (*it) == LineLayoutPair(realLine, nullptr)) {
-        (*it).second = std::move(lineLayoutPtr);
+    // only layouts that were not found get inserted
+    ++m_misses;
+
+    auto it = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), realLine, lessThan);
+    if (it != m_lineLayouts.end() && it->line == realLine) {
+        it->layout = std::move(lineLayoutPtr);
+        it->lastUse = m_useCount;
     } else {
-        it = std::upper_bound(m_lineLayouts.begin(), m_lineLayouts.end(), LineLayoutPair(realLine, nullptr), lessThan);
-        m_lineLayouts.insert(it, LineLayoutPair(realLine, std::move(lineLayoutPtr)));
+        m_lineLayouts.insert(it, LineLayoutEntry{realLine, std::move(lineLayoutPtr), m_useCount});
     }
 }
 
 void KateLineLayoutMap::relayoutLines(int startRealLine, int endRealLine)
 {
-    auto start = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), LineLayoutPair(startRealLine, nullptr), lessThan);
-    auto end = std::upper_bound(start, m_lineLayouts.end(), LineLayoutPair(endRealLine, nullptr), lessThan);
+    auto start = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), startRealLine, lessThan);
+    auto end = std::upper_bound(start, m_lineLayouts.end(), endRealLine, greaterThan);
 
     while (start != end) {
-        (*start).second->layoutDirty = true;
+        start->layout->layoutDirty = true;
         ++start;
     }
 }
 
 void KateLineLayoutMap::slotEditDone(int fromLine, int toLine, int shiftAmount, std::vector<KateTextLayout> &textLayouts)
 {
-    auto start = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), LineLayoutPair(fromLine, nullptr), lessThan);
-    auto end = std::upper_bound(start, m_lineLayouts.end(), LineLayoutPair(toLine, nullptr), lessThan);
+    auto start = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), fromLine, lessThan);
+    auto end = std::upper_bound(start, m_lineLayouts.end(), toLine, greaterThan);
 
     if (shiftAmount != 0) {
         for (auto it = end; it != m_lineLayouts.end(); ++it) {
-            (*it).first += shiftAmount;
-            (*it).second->setLine((*it).second->line() + shiftAmount);
+            it->line += shiftAmount;
+            it->layout->setLine(it->layout->line() + shiftAmount);
         }
 
         for (auto it = start; it != end; ++it) {
-            (*it).second->clear();
+            it->layout->clear();
             for (auto &tl : textLayouts) {
-                if (tl.kateLineLayout() == it->second.get()) {
+                if (tl.kateLineLayout() == it->layout.get()) {
                     // Invalidate the layout, this will mark it as dirty
                     tl = KateTextLayout::invalid();
                 }
@@ -76,19 +104,97 @@ void KateLineLayoutMap::slotEditDone(int fromLine, int toLine, int shiftAmount,
         m_lineLayouts.erase(start, end);
     } else {
         for (auto it = start; it != end; ++it) {
-            (*it).second->layoutDirty = true;
+            it->layout->layoutDirty = true;
         }
     }
 }
 
 KateLineLayout *KateLineLayoutMap::find(int i)
 {
-    const auto it = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), LineLayoutPair(i, nullptr), lessThan);
-    if (it != m_lineLayouts.end() && it->first == i) {
-        return it->second.get();
+    const auto it = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), i, lessThan);
+    if (it != m_lineLayouts.end() && it->line == i) {
+        ++m_hits;
+        it->lastUse = m_useCount;
+        return it->layout.get();
     }
     return nullptr;
 }
+
+void KateLineLayoutMap::evict(int startRealLine, int endRealLine, const std::vector<KateTextLayout> &textLayouts)
+{
+    // all lookups until the next eviction count as one use, layouts looked up since the last
+    // eviction might still be referenced by the caller and are kept
+    const quint64 currentUse = m_useCount++;
+
+    qint64 bytes = memoryUsage();
+    if (bytes <= m_memoryBudget) {
+        return;
+    }
+
+    // the view still points to its layouts
+    std::vector<const KateLineLayout *> inUse;
+    inUse.reserve(textLayouts.size());
+    for (const KateTextLayout &textLayout : textLayouts) {
+        inUse.push_back(textLayout.kateLineLayout());
+    }
+    std::sort(inUse.begin(), inUse.end());
+
+    const auto distance = [startRealLine, endRealLine](int line) {
+        return line < startRealLine ? startRealLine - line : std::max(0, line - endRealLine);
+    };
+
+    std::vector<LineLayoutEntry *> candidates;
+    candidates.reserve(m_lineLayouts.size());
+    for (LineLayoutEntry &entry : m_lineLayouts) {
+        if (entry.lastUse != currentUse && (entry.line < startRealLine || entry.line > endRealLine)
+            && !std::binary_search(inUse.begin(), inUse.end(), entry.layout.get())) {
+            candidates.push_back(&entry);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&distance](const LineLayoutEntry *lhs, const LineLayoutEntry *rhs) {
+        if (lhs->lastUse != rhs->lastUse) {
+            return lhs->lastUse < rhs->lastUse;
+        }
+        return distance(lhs->line) > distance(rhs->line);
+    });
+
+    // evict a bit more than needed, to not evict again on the next scroll step
+    const qint64 target = m_memoryBudget - m_memoryBudget / 4;
+    for (LineLayoutEntry *entry : candidates) {
+        if (bytes <= target) {
+            break;
+        }
+        bytes -= estimatedMemoryUsage(*entry->layout);
+        entry->layout.reset();
+        ++m_evictions;
+    }
+
+    m_lineLayouts.erase(std::remove_if(m_lineLayouts.begin(),
+                                       m_lineLayouts.end(),
+                                       [](const LineLayoutEntry &entry) {
+                                           return !entry.layout;
+                                       }),
+                        m_lineLayouts.end());
+}
+
+qint64 KateLineLayoutMap::memoryUsage() const
+{
+    qint64 bytes = m_lineLayouts.capacity() * sizeof(LineLayoutEntry);
+    for (const LineLayoutEntry &entry : m_lineLayouts) {
+        bytes += estimatedMemoryUsage(*entry.layout);
+    }
+    return bytes;
+}
+
+KateLineLayoutCacheStatistics KateLineLayoutMap::statistics() const
+{
+    KateLineLayoutCacheStatistics statistics;
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.evictions = m_evictions;
+    statistics.bytes = memoryUsage();
+    return statistics;
+}
 // END KateLineLayoutMap
 
 KateLayoutCache::KateLayoutCache(KateRenderer *renderer, QObject *parent)
@@ -102,6 +208,12 @@ KateLayoutCache::KateLayoutCache(KateRenderer *renderer, QObject *parent)
     connect(m_renderer->doc(), &KTextEditor::Document::lineUnwrapped, this, &KateLayoutCache::unwrapLine);
     connect(m_renderer->doc(), &KTextEditor::Document::textInserted, this, &KateLayoutCache::insertText);
     connect(m_renderer->doc(), &KTextEditor::Document::textRemoved, this, &KateLayoutCache::removeText);
+
+    m_prefetchTimer.setSingleShot(true);
+    connect(&m_prefetchTimer, &QTimer::timeout, this, &KateLayoutCache::prefetchLines);
+
+    m_countViewLinesTimer.setSingleShot(true);
+    connect(&m_countViewLinesTimer, &QTimer::timeout, this, &KateLayoutCache::countViewLines);
 }
 
 void KateLayoutCache::updateViewCache(const KTextEditor::Cursor startPos, int newViewLineCount, int viewLinesScrolled)
@@ -140,6 +252,9 @@ void KateLayoutCache::updateViewCache(const KTextEditor::Cursor startPos, int ne
         }
     }
 
+    if (m_startPos.isValid() && startPos.line() != m_startPos.line()) {
+        m_scrollDirection = startPos.line() > m_startPos.line() ? 1 : -1;
+    }
     m_startPos = startPos;
 
     // Move the text layouts if we've just scrolled...
@@ -210,6 +325,68 @@ void KateLayoutCache::updateViewCache(const KTextEditor::Cursor startPos, int ne
     }
 
     enableLayoutCache = false;
+
+    // very long lines keep only the layouts of the segments around the view
+    for (size_t i = 0; i < m_textLayouts.size();) {
+        KateLineLayout *lineLayout = m_textLayouts[i].kateLineLayout();
+        size_t j = i + 1;
+        while (j < m_textLayouts.size() && m_textLayouts[j].kateLineLayout() == lineLayout) {
+            ++j;
+        }
+        if (lineLayout && lineLayout->isSegmented()) {
+            lineLayout->trimSegments(m_textLayouts[i].viewLine(), m_textLayouts[j - 1].viewLine());
+        }
+        i = j;
+    }
+
+    // keep the layouts of lines scrolled away from growing without bounds
+    if (!m_textLayouts.empty() && m_textLayouts.front().isValid()) {
+        const int lastLine = m_textLayouts.back().isValid() ? m_textLayouts.back().line() : m_renderer->doc()->lines() - 1;
+        m_lineLayouts.evict(m_textLayouts.front().line(), lastLine, m_textLayouts);
+    }
+
+    // prepare the lines the next scroll step will need once we are idle
+    if (m_prefetchEnabled) {
+        m_prefetchedAhead = 0;
+        m_prefetchedBehind = 0;
+        m_prefetchTimer.start(0);
+    }
+}
+
+void KateLayoutCache::prefetchLines()
+{
+    if (m_textLayouts.empty() || !m_startPos.isValid() || !m_renderer->view() || !m_renderer->view()->isVisible()) {
+        return;
+    }
+
+    // a page ahead in scroll direction, that is where page down will go, too
+    // wrapped lines take more than one view line, so that is an upper bound
+    const int page = m_textLayouts.size();
+    const int behind = page / 4 + 1;
+    const int firstVisibleLine = m_startPos.line();
+    const int lastVisibleLine = firstVisibleLine + page - 1;
+    const int visibleLines = m_renderer->folding().visibleLines();
+
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < 5) {
+        int visibleLine;
+        if (m_prefetchedAhead < page) {
+            visibleLine = m_scrollDirection > 0 ? lastVisibleLine + 1 + m_prefetchedAhead : firstVisibleLine - 1 - m_prefetchedAhead;
+            ++m_prefetchedAhead;
+        } else if (m_prefetchedBehind < behind) {
+            visibleLine = m_scrollDirection > 0 ? firstVisibleLine - 1 - m_prefetchedBehind : lastVisibleLine + 1 + m_prefetchedBehind;
+            ++m_prefetchedBehind;
+        } else {
+            return;
+        }
+
+        if (visibleLine >= 0 && visibleLine < visibleLines) {
+            line(m_renderer->folding().visibleLineToLine(visibleLine), visibleLine);
+        }
+    }
+
+    m_prefetchTimer.start(0);
 }
 
 KateLineLayout *KateLayoutCache::line(int realLine, int virtualLine)
@@ -227,11 +404,13 @@ KateLineLayout *KateLayoutCache::line(int realLine, int virtualLine)
             l->usePlainTextLine = acceptDirtyLayouts();
             l->textLine(!acceptDirtyLayouts());
             m_renderer->layoutLine(l, wrap() ? m_viewWidth : -1, enableLayoutCache);
+            recordViewLineCount(l);
         } else if (l->layoutDirty && !acceptDirtyLayouts()) {
             // reset textline
             l->usePlainTextLine = false;
             l->textLine(true);
             m_renderer->layoutLine(l, wrap() ? m_viewWidth : -1, enableLayoutCache);
+            recordViewLineCount(l);
         }
 
         Q_ASSERT(l->layout() && (!l->layoutDirty || acceptDirtyLayouts()));
@@ -254,6 +433,7 @@ KateLineLayout *KateLayoutCache::line(int realLine, int virtualLine)
 
     m_renderer->layoutLine(l, wrap() ? m_viewWidth : -1, enableLayoutCache);
     Q_ASSERT(l->isValid());
+    recordViewLineCount(l);
 
     if (acceptDirtyLayouts()) {
         l->layoutDirty = true;
@@ -437,36 +617,69 @@ void KateLayoutCache::viewCacheDebugOutput() const
 void KateLayoutCache::wrapLine(KTextEditor::Document *, const KTextEditor::Cursor position)
 {
     m_lineLayouts.slotEditDone(position.line(), position.line() + 1, 1, m_textLayouts);
+
+    if (m_viewLineCountsValid) {
+        m_viewLineCounts.insertLines(position.line() + 1, 1, [this](int line) {
+            return estimateViewLineCount(line);
+        });
+        m_viewLineCounts.setCount(position.line(), estimateViewLineCount(position.line()), false);
+        scheduleViewLineCounting();
+    }
 }
 
 void KateLayoutCache::unwrapLine(KTextEditor::Document *, int line)
 {
     m_lineLayouts.slotEditDone(line - 1, line, -1, m_textLayouts);
+
+    if (m_viewLineCountsValid) {
+        m_viewLineCounts.removeLines(line, 1);
+        m_viewLineCounts.setCount(line - 1, estimateViewLineCount(line - 1), false);
+        scheduleViewLineCounting();
+    }
 }
 
 void KateLayoutCache::insertText(KTextEditor::Document *, const KTextEditor::Cursor position, const QString &)
 {
     m_lineLayouts.slotEditDone(position.line(), position.line(), 0, m_textLayouts);
+
+    if (m_viewLineCountsValid) {
+        m_viewLineCounts.setCount(position.line(), estimateViewLineCount(position.line()), false);
+        scheduleViewLineCounting();
+    }
 }
 
 void KateLayoutCache::removeText(KTextEditor::Document *, KTextEditor::Range range, const QString &)
 {
     m_lineLayouts.slotEditDone(range.start().line(), range.start().line(), 0, m_textLayouts);
+
+    if (m_viewLineCountsValid) {
+        m_viewLineCounts.setCount(range.start().line(), estimateViewLineCount(range.start().line()), false);
+        scheduleViewLineCounting();
+    }
 }
 
 void KateLayoutCache::clear()
 {
+    m_prefetchTimer.stop();
     m_textLayouts.clear();
     m_lineLayouts.clear();
     m_startPos = KTextEditor::Cursor(-1, -1);
+
+    // e.g. the font changed, the counts are still the best estimates we have
+    m_viewLineCounts.markAllEstimated();
+    scheduleViewLineCounting();
 }
 
 void KateLayoutCache::setViewWidth(int width)
 {
+    m_prefetchTimer.stop();
     m_viewWidth = width;
     m_lineLayouts.clear();
     m_textLayouts.clear();
     m_startPos = KTextEditor::Cursor(-1, -1);
+
+    m_countViewLinesTimer.stop();
+    m_viewLineCountsValid = false;
 }
 
 bool KateLayoutCache::wrap() const
@@ -478,6 +691,9 @@ void KateLayoutCache::setWrap(bool wrap)
 {
     m_wrap = wrap;
     clear();
+
+    m_countViewLinesTimer.stop();
+    m_viewLineCountsValid = false;
 }
 
 void KateLayoutCache::relayoutLines(int startRealLine, int endRealLine)
@@ -498,3 +714,209 @@ void KateLayoutCache::setAcceptDirtyLayouts(bool accept)
 {
     m_acceptDirtyLayouts = accept;
 }
+
+qint64 KateLayoutCache::memoryBudget() const
+{
+    return m_lineLayouts.memoryBudget();
+}
+
+void KateLayoutCache::setMemoryBudget(qint64 bytes)
+{
+    m_lineLayouts.setMemoryBudget(bytes);
+}
+
+KateLineLayoutCacheStatistics KateLayoutCache::statistics() const
+{
+    return m_lineLayouts.statistics();
+}
+
+bool KateLayoutCache::prefetchEnabled() const
+{
+    return m_prefetchEnabled;
+}
+
+void KateLayoutCache::setPrefetchEnabled(bool enabled)
+{
+    m_prefetchEnabled = enabled;
+    if (!enabled) {
+        m_prefetchTimer.stop();
+        m_countViewLinesTimer.stop();
+    } else {
+        scheduleViewLineCounting();
+    }
+}
+
+void KateLayoutCache::updateViewLineCounts()
+{
+    if (m_viewLineCountsValid && m_viewLineCounts.lines() == m_renderer->doc()->lines()) {
+        return;
+    }
+
+    m_viewLineCounts.reset(m_renderer->doc()->lines(), [this](int line) {
+        return estimateViewLineCount(line);
+    });
+    m_viewLineCountsValid = true;
+
+    // count the lines from the view on, that is where scrolling most likely goes
+    m_nextCountedLine = m_startPos.isValid() ? m_startPos.line() : 0;
+    if (m_prefetchEnabled) {
+        m_countViewLinesTimer.start(0);
+    }
+}
+
+int KateLayoutCache::estimateViewLineCount(int realLine) const
+{
+    // tabs and wide characters are not taken into account, the line is counted exactly in idle time
+    const qreal advance = m_renderer->spaceWidth();
+    const int length = m_renderer->doc()->lineLength(realLine);
+    return std::max(1, qCeil(length * advance / std::max(1, m_viewWidth)));
+}
+
+void KateLayoutCache::recordViewLineCount(const KateLineLayout *lineLayout)
+{
+    if (m_wrap && m_viewLineCountsValid && lineLayout->line() < m_viewLineCounts.lines()) {
+        m_viewLineCounts.setCount(lineLayout->line(), lineLayout->viewLineCount(), true);
+    }
+}
+
+void KateLayoutCache::countViewLines()
+{
+    if (!m_wrap || !m_viewLineCountsValid || m_viewLineCounts.lines() != m_renderer->doc()->lines() || !m_renderer->view()
+        || !m_renderer->view()->isVisible()) {
+        return;
+    }
+
+    // ASCII lines narrower than the view even with the widest character of the font take one view line
+    const qreal maxAdvance = m_renderer->currentFontMetrics().maxWidth();
+    const int tabWidth = m_renderer->doc()->config()->tabWidth();
+    const auto fitsIntoView = [&](const QString &text) {
+        int columns = 0;
+        for (QChar c : text) {
+            if (c == QLatin1Char('\t')) {
+                columns += tabWidth;
+            } else if (c.unicode() >= 0x20 && c.unicode() < 0x7f) {
+                ++columns;
+            } else {
+                return false;
+            }
+        }
+        return columns * maxAdvance < m_viewWidth;
+    };
+
+    // lines are laid out on their own, without highlighting and without polluting the cache
+    KateLineLayout lineLayout(*m_renderer);
+    lineLayout.usePlainTextLine = true;
+
+    bool changed = false;
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < 5) {
+        int line = m_viewLineCounts.nextEstimatedLine(m_nextCountedLine);
+        if (line == -1) {
+            line = m_viewLineCounts.nextEstimatedLine(0);
+        }
+        if (line == -1) {
+            break;
+        }
+
+        int count = 1;
+        if (!fitsIntoView(m_renderer->doc()->line(line))) {
+            lineLayout.setLine(line);
+            m_renderer->layoutLine(&lineLayout, m_viewWidth, false);
+            count = lineLayout.viewLineCount();
+        }
+
+        changed = changed || count != m_viewLineCounts.count(line);
+        m_viewLineCounts.setCount(line, count, true);
+        m_nextCountedLine = line + 1;
+    }
+
+    if (changed) {
+        Q_EMIT viewLineCountsChanged();
+    }
+    if (m_viewLineCounts.estimatedLines() > 0) {
+        // leave most of the idle time to others
+        m_countViewLinesTimer.start(20);
+    }
+}
+
+void KateLayoutCache::scheduleViewLineCounting()
+{
+    // a running count picks up the new estimates, too
+    if (m_prefetchEnabled && m_viewLineCountsValid && !m_countViewLinesTimer.isActive()) {
+        m_countViewLinesTimer.start(20);
+    }
+}
+
+qint64 KateLayoutCache::viewLinesBefore(int virtualLine)
+{
+    const Kate::TextFolding &folding = m_renderer->folding();
+    if (!m_wrap) {
+        return std::clamp(virtualLine, 0, folding.visibleLines());
+    }
+    if (virtualLine <= 0) {
+        return 0;
+    }
+    if (virtualLine >= folding.visibleLines()) {
+        return totalViewLines();
+    }
+
+    updateViewLineCounts();
+    const int realLine = folding.visibleLineToLine(virtualLine);
+    qint64 viewLines = m_viewLineCounts.viewLinesBefore(realLine);
+    for (const auto &[first, last] : folding.hiddenLineRanges()) {
+        if (first >= realLine) {
+            break;
+        }
+        viewLines -= m_viewLineCounts.viewLinesBefore(last + 1) - m_viewLineCounts.viewLinesBefore(first);
+    }
+    return viewLines;
+}
+
+qint64 KateLayoutCache::totalViewLines()
+{
+    const Kate::TextFolding &folding = m_renderer->folding();
+    if (!m_wrap) {
+        return folding.visibleLines();
+    }
+
+    updateViewLineCounts();
+    qint64 viewLines = m_viewLineCounts.viewLines();
+    for (const auto &[first, last] : folding.hiddenLineRanges()) {
+        viewLines -= m_viewLineCounts.viewLinesBefore(last + 1) - m_viewLineCounts.viewLinesBefore(first);
+    }
+    return viewLines;
+}
+
+std::pair<int, int> KateLayoutCache::lineForViewLine(qint64 viewLine)
+{
+    const Kate::TextFolding &folding = m_renderer->folding();
+    if (!m_wrap) {
+        return {int(std::clamp<qint64>(viewLine, 0, folding.visibleLines() - 1)), 0};
+    }
+
+    // skip the view lines of hidden lines in front of the view line
+    updateViewLineCounts();
+    qint64 hiddenViewLines = 0;
+    for (const auto &[first, last] : folding.hiddenLineRanges()) {
+        const qint64 hiddenStart = m_viewLineCounts.viewLinesBefore(first);
+        if (viewLine + hiddenViewLines < hiddenStart) {
+            break;
+        }
+        hiddenViewLines += m_viewLineCounts.viewLinesBefore(last + 1) - hiddenStart;
+    }
+
+    const auto [realLine, viewLineInLine] = m_viewLineCounts.lineForViewLine(viewLine + hiddenViewLines);
+    return {folding.lineToVisibleLine(realLine), viewLineInLine};
+}
+
+int KateLayoutCache::estimatedViewLineCounts()
+{
+    if (!m_wrap) {
+        return 0;
+    }
+    updateViewLineCounts();
+    return m_viewLineCounts.estimatedLines();
+}
+
+#include "moc_katelayoutcache.cpp"
@@ -9,13 +9,27 @@
 #define KATELAYOUTCACHE_H
 
 #include <QPair>
+#include <QTimer>
 
 #include <ktexteditor/range.h>
 
 #include "katetextlayout.h"
+#include "kateviewlinecounts.h"
+
+#include <utility>
 
 class KateRenderer;
 
+/**
+ * Counters of a KateLineLayoutMap, see KateLineLayoutMap::statistics().
+ */
+struct KateLineLayoutCacheStatistics {
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 evictions = 0;
+    qint64 bytes = 0;
+};
+
 class KateLineLayoutMap
 {
 public:
@@ -29,11 +43,59 @@ public:
 
     KateLineLayout *find(int i);
 
-    typedef std::pair<int, std::unique_ptr<KateLineLayout>> LineLayoutPair;
+    /**
+     * Memory the layouts may use before evict() drops some, in bytes.
+     */
+    qint64 memoryBudget() const
+    {
+        return m_memoryBudget;
+    }
+    void setMemoryBudget(qint64 bytes)
+    {
+        m_memoryBudget = bytes;
+    }
+
+    /**
+     * Drop layouts until the memory budget is met again.
+     * Layouts not used for the longest time go first, if used equally long ago the ones
+     * farthest from the given lines. Layouts referenced by @p textLayouts are kept.
+     * @param startRealLine first line of the viewport
+     * @param endRealLine last line of the viewport
+     * @param textLayouts layouts in use by the view
+     */
+    void evict(int startRealLine, int endRealLine, const std::vector<KateTextLayout> &textLayouts);
+
+    /**
+     * Estimated memory used by all layouts, in bytes.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * Counters since construction, bytes is the current memoryUsage().
+     */
+    KateLineLayoutCacheStatistics statistics() const;
+
+    struct LineLayoutEntry {
+        int line;
+        std::unique_ptr<KateLineLayout> layout;
+        // value of m_useCount when last looked up
+        quint64 lastUse;
+    };
 
 private:
-    typedef std::vector<LineLayoutPair> LineLayoutMap;
+    typedef std::vector<LineLayoutEntry> LineLayoutMap;
     LineLayoutMap m_lineLayouts;
+
+    qint64 m_memoryBudget = 32 * 1024 * 1024;
+
+    /**
+     * Bumped by each evict(), layouts looked up in between count as used at the same time.
+     */
+    quint64 m_useCount = 0;
+
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+    quint64 m_evictions = 0;
 };
 
 /**
@@ -53,6 +115,8 @@ private:
 
 class KateLayoutCache : public QObject
 {
+    Q_OBJECT
+
 public:
     explicit KateLayoutCache(KateRenderer *renderer, QObject *parent);
 
@@ -128,7 +192,86 @@ public:
     void viewCacheDebugOutput() const;
     // END
 
+    /**
+     * Memory the cached line layouts may use, in bytes.
+     * Layouts outside of the view are evicted once it is exceeded.
+     */
+    qint64 memoryBudget() const;
+    void setMemoryBudget(qint64 bytes);
+
+    /// Hits, misses and evictions of the line layout cache and its estimated memory usage.
+    KateLineLayoutCacheStatistics statistics() const;
+
+    /**
+     * Lay out the lines around the view in idle time, enabled by default.
+     * A page in scroll direction and a bit in the other one are prepared, scrolling
+     * or paging then finds the layouts in the cache.
+     */
+    bool prefetchEnabled() const;
+    void setPrefetchEnabled(bool enabled);
+
+    // BEGIN scroll geometry under dynamic word wrap
+    /**
+     * View lines of all visible lines in front of the given visible line.
+     * Lines laid out at least once count exactly, others by an estimate from their length
+     * until they get counted in idle time, like prefetching lines that is only done if enabled.
+     */
+    qint64 viewLinesBefore(int virtualLine);
+
+    /**
+     * View lines of all visible lines.
+     */
+    qint64 totalViewLines();
+
+    /**
+     * Visible line containing the given view line and the view line inside of it.
+     * @param viewLine view line counted from the start of the document, hidden lines excluded
+     */
+    std::pair<int, int> lineForViewLine(qint64 viewLine);
+
+    /**
+     * Number of lines whose view line count is estimated only.
+     */
+    int estimatedViewLineCounts();
+    // END
+
+Q_SIGNALS:
+    /**
+     * Counts of view lines changed in idle time, the scroll geometry should be updated.
+     */
+    void viewLineCountsChanged();
+
 private:
+    /**
+     * Create the view line counts if needed, after the width changed or the cache was cleared.
+     */
+    void updateViewLineCounts();
+
+    /**
+     * Estimated view line count of a line that was not laid out.
+     */
+    int estimateViewLineCount(int realLine) const;
+
+    /**
+     * Remember the view line count of a line just laid out.
+     */
+    void recordViewLineCount(const KateLineLayout *lineLayout);
+
+    /**
+     * Count the view lines of some lines with an estimate only, reschedules itself until all are done.
+     */
+    void countViewLines();
+
+    /**
+     * Start counting the view lines in idle time, after estimates were written.
+     */
+    void scheduleViewLineCounting();
+
+    /**
+     * Lay out some lines next to the view cache, reschedules itself until enough are done.
+     */
+    void prefetchLines();
+
     void wrapLine(KTextEditor::Document *, const KTextEditor::Cursor position);
     void unwrapLine(KTextEditor::Document *, int line);
     void insertText(KTextEditor::Document *, const KTextEditor::Cursor position, const QString &text);
@@ -153,6 +296,22 @@ private:
     int m_viewWidth = 0;
     bool m_wrap = false;
     bool m_acceptDirtyLayouts = false;
+
+    QTimer m_prefetchTimer;
+    bool m_prefetchEnabled = true;
+    // 1 if the view did last scroll down, -1 if up
+    int m_scrollDirection = 1;
+    // lines prefetched since the last view cache update, ahead of and behind the view
+    int m_prefetchedAhead = 0;
+    int m_prefetchedBehind = 0;
+
+    // view line counts of all lines, only used under dynamic word wrap
+    KateViewLineCounts m_viewLineCounts;
+    // reset lazily after the width changed
+    bool m_viewLineCountsValid = false;
+    QTimer m_countViewLinesTimer;
+    // line the next idle count continues at
+    int m_nextCountedLine = 0;
 };
 
 #endif
@@ -9,8 +9,11 @@
 #include "katetextfolding.h"
 #include "katetextlayout.h"
 
+#include <QTextLayout>
 #include <QTextLine>
 
+#include <algorithm>
+
 #include "katepartdebug.h"
 
 #include "katedocument.h"
@@ -32,6 +35,9 @@ void KateLineLayout::clear()
     shiftX = 0;
     // not touching dirty
     m_layout.reset();
+    m_segments.clear();
+    m_segmentText.clear();
+    m_segmentWidth = -1;
     // not touching layout dirty
 }
 
@@ -92,7 +98,7 @@ bool KateLineLayout::isValid() const
 
 QTextLayout *KateLineLayout::layout() const
 {
-    return m_layout.get();
+    return m_segments.empty() ? m_layout.get() : m_segments.front().layout.get();
 }
 
 void KateLineLayout::setLayout(QTextLayout *layout)
@@ -100,14 +106,144 @@ void KateLineLayout::setLayout(QTextLayout *layout)
     if (m_layout.get() != layout) {
         m_layout.reset(layout);
     }
+    m_segments.clear();
+    m_segmentText.clear();
+    m_segmentWidth = -1;
 
     layoutDirty = !m_layout;
     m_dirtyList.clear();
     if (m_layout) {
-        for (int i = 0; i < qMax(1, m_layout->lineCount()); ++i) {
-            m_dirtyList.append(true);
+        m_dirtyList.fill(true, qMax(1, m_layout->lineCount()));
+    }
+}
+
+void KateLineLayout::setSegments(std::vector<Segment> segments, const QString &text, int maxwidth)
+{
+    Q_ASSERT(!segments.empty() && segments.front().layout);
+
+    m_layout.reset();
+    m_segments = std::move(segments);
+    m_segmentText = text;
+    m_segmentWidth = maxwidth;
+
+    layoutDirty = false;
+    m_dirtyList.clear();
+    m_dirtyList.fill(true, qMax(1, viewLineCount()));
+}
+
+std::vector<KateLineLayout::Segment> KateLineLayout::takeSegments(QString &text, int &maxwidth)
+{
+    std::vector<Segment> segments;
+    segments.swap(m_segments);
+    text.swap(m_segmentText);
+    m_segmentText.clear();
+    maxwidth = m_segmentWidth;
+    m_segmentWidth = -1;
+    return segments;
+}
+
+int KateLineLayout::segmentCount() const
+{
+    return m_segments.empty() ? 1 : int(m_segments.size());
+}
+
+size_t KateLineLayout::segmentForViewLine(int viewLine) const
+{
+    // last segment starting at or before the view line
+    auto it = std::upper_bound(m_segments.begin(), m_segments.end(), viewLine, [](int value, const Segment &segment) {
+        return value < segment.firstViewLine;
+    });
+    return it == m_segments.begin() ? 0 : std::distance(m_segments.begin(), it) - 1;
+}
+
+size_t KateLineLayout::segmentForColumn(int column) const
+{
+    // last segment starting at or before the column
+    auto it = std::upper_bound(m_segments.begin(), m_segments.end(), column, [](int value, const Segment &segment) {
+        return value < segment.start;
+    });
+    return it == m_segments.begin() ? 0 : std::distance(m_segments.begin(), it) - 1;
+}
+
+QTextLayout *KateLineLayout::segmentLayout(size_t index, int *columnOffset, int *firstViewLine) const
+{
+    if (m_segments.empty()) {
+        *columnOffset = 0;
+        if (firstViewLine) {
+            *firstViewLine = 0;
+        }
+        return m_layout.get();
+    }
+
+    Segment &segment = m_segments[index];
+    if (!segment.layout) {
+        m_renderer.layoutSegment(this, segment);
+    }
+
+    *columnOffset = segment.start;
+    if (firstViewLine) {
+        *firstViewLine = segment.firstViewLine;
+    }
+    return segment.layout.get();
+}
+
+QTextLayout *KateLineLayout::segmentLayoutForViewLine(int viewLine, int *columnOffset, int *firstViewLine) const
+{
+    return segmentLayout(m_segments.empty() ? 0 : segmentForViewLine(viewLine), columnOffset, firstViewLine);
+}
+
+QTextLayout *KateLineLayout::segmentLayoutForColumn(int column, int *columnOffset, int *firstViewLine) const
+{
+    return segmentLayout(m_segments.empty() ? 0 : segmentForColumn(column), columnOffset, firstViewLine);
+}
+
+std::vector<const QTextLayout *> KateLineLayout::segmentLayouts() const
+{
+    std::vector<const QTextLayout *> layouts;
+    if (m_segments.empty()) {
+        if (m_layout) {
+            layouts.push_back(m_layout.get());
         }
+        return layouts;
     }
+
+    for (const Segment &segment : m_segments) {
+        if (segment.layout) {
+            layouts.push_back(segment.layout.get());
+        }
+    }
+    return layouts;
+}
+
+void KateLineLayout::trimSegments(int firstViewLine, int lastViewLine)
+{
+    if (m_segments.empty()) {
+        return;
+    }
+
+    // keep one more segment on each side, scrolling a bit won't need a new layout
+    const size_t first = segmentForViewLine(firstViewLine);
+    const size_t last = segmentForViewLine(lastViewLine);
+    for (size_t i = 1; i < m_segments.size(); ++i) {
+        if (i + 1 < first || i > last + 1) {
+            m_segments[i].layout.reset();
+        }
+    }
+}
+
+int KateLineLayout::nextCursorPosition(int column) const
+{
+    int columnOffset = 0;
+    const QTextLayout *layout = segmentLayoutForColumn(column, &columnOffset);
+    return columnOffset + layout->nextCursorPosition(column - columnOffset);
+}
+
+int KateLineLayout::previousCursorPosition(int column) const
+{
+    // the start of a segment belongs to the segment in front of it here
+    int columnOffset = 0;
+    const QTextLayout *layout = segmentLayoutForColumn(qMax(0, column - 1), &columnOffset);
+    return columnOffset + layout->previousCursorPosition(column - columnOffset);
 }
 
 void KateLineLayout::invalidateLayout()
@@ -140,6 +276,9 @@ int KateLineLayout::length() const
 
 int KateLineLayout::viewLineCount() const
 {
+    if (!m_segments.empty()) {
+        return m_segments.back().firstViewLine + m_segments.back().viewLineCount;
+    }
     return m_layout->lineCount();
 }
 
@@ -157,8 +296,11 @@ int KateLineLayout::width() const
 {
     int width = 0;
 
-    for (int i = 0; i < m_layout->lineCount(); ++i) {
-        width = qMax((int)m_layout->lineAt(i).naturalTextWidth(), width);
+    // segmented lines are wrapped, the segments laid out right now are good enough
+    for (const QTextLayout *layout : segmentLayouts()) {
+        for (int i = 0; i < layout->lineCount(); ++i) {
+            width = qMax((int)layout->lineAt(i).naturalTextWidth(), width);
+        }
     }
 
     return width;
@@ -183,15 +325,20 @@ void KateLineLayout::debugOutput() const
 
 int KateLineLayout::viewLineForColumn(int column) const
 {
-    int len = 0;
+    // for segmented lines only the view lines of the segment need to be searched
+    int columnOffset = 0;
+    int firstViewLine = 0;
+    const QTextLayout *layout = segmentLayoutForColumn(column, &columnOffset, &firstViewLine);
+
+    int len = columnOffset;
     int i = 0;
-    for (; i < m_layout->lineCount() - 1; ++i) {
-        len += m_layout->lineAt(i).textLength();
+    for (; i < layout->lineCount() - 1; ++i) {
+        len += layout->lineAt(i).textLength();
         if (column < len) {
-            return i;
+            return firstViewLine + i;
         }
     }
-    return i;
+    return firstViewLine + i;
 }
 
 bool KateLineLayout::isRightToLeft() const
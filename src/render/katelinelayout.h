@@ -11,13 +11,16 @@
 #include <QExplicitlySharedDataPointer>
 #include <QSharedData>
 
+#include <memory>
 #include <optional>
+#include <vector>
 
 #include "katetextline.h"
 
 #include <ktexteditor/cursor.h>
 
 class QTextLayout;
+class QTextLine;
 namespace KTextEditor
 {
 class DocumentPrivate;
@@ -70,10 +73,94 @@ public:
 
     bool startsInvisibleBlock() const;
 
+    /**
+     * The layout of the line, for a line split into segments the one of the first segment.
+     */
     QTextLayout *layout() const;
     void setLayout(QTextLayout *layout);
     void invalidateLayout();
 
+    /**
+     * A piece of a very long line with a layout of its own, see KateRenderer::layoutLine.
+     * Only the view line count is kept for segments far away from the view, their layout is
+     * created again on demand.
+     */
+    struct Segment {
+        // columns of the line covered by the segment
+        int start = 0;
+        int length = 0;
+        // view lines of the line covered by the segment
+        int firstViewLine = 0;
+        int viewLineCount = 0;
+        std::unique_ptr<QTextLayout> layout;
+    };
+
+    /**
+     * Split the line into segments, replaces any layout.
+     * @param segments segments covering the whole line, the first one laid out
+     * @param text text the segments were made for, to keep unchanged segments on the next layout
+     * @param maxwidth width the segments are laid out for
+     */
+    void setSegments(std::vector<Segment> segments, const QString &text, int maxwidth);
+
+    /**
+     * Take the segments of the last layout, to reuse the unchanged ones.
+     * @param text filled with the text the segments were made for
+     * @param maxwidth filled with the width the segments were laid out for
+     */
+    std::vector<Segment> takeSegments(QString &text, int &maxwidth);
+
+    bool isSegmented() const
+    {
+        return !m_segments.empty();
+    }
+
+    /**
+     * Number of segments, 1 for a line that is not split.
+     */
+    int segmentCount() const;
+
+    /**
+     * Segment containing the view line, laid out if needed.
+     * @param viewLine view line of the line
+     * @param columnOffset set to the column the layout of the segment starts at
+     * @param firstViewLine set to the first view line of the segment
+     */
+    QTextLayout *segmentLayoutForViewLine(int viewLine, int *columnOffset, int *firstViewLine = nullptr) const;
+
+    /**
+     * Segment containing the column, laid out if needed.
+     * @param column column of the line, the end of the line belongs to the last segment
+     * @param columnOffset set to the column the layout of the segment starts at
+     * @param firstViewLine set to the first view line of the segment
+     */
+    QTextLayout *segmentLayoutForColumn(int column, int *columnOffset, int *firstViewLine = nullptr) const;
+
+    /**
+     * Layouts of all segments that are laid out right now.
+     */
+    std::vector<const QTextLayout *> segmentLayouts() const;
+
+    /**
+     * Drop the layouts of segments outside of the given view lines, keeping their view line counts.
+     * Only the first segment and the segments next to the given view lines stay laid out.
+     */
+    void trimSegments(int firstViewLine, int lastViewLine);
+
+    /**
+     * Next and previous cursor positions like QTextLayout has them, across segments.
+     */
+    int nextCursorPosition(int column) const;
+    int previousCursorPosition(int column) const;
+
+    /**
+     * Width the segments are laid out for, -1 if the line is not split.
+     */
+    int segmentWidth() const
+    {
+        return m_segmentWidth;
+    }
+
     bool layoutDirty = true;
     bool usePlainTextLine = false;
 
@@ -86,10 +173,19 @@ public:
     // this is used to provide a dynamic-wrapping-retains-indent feature.
     int shiftX = 0;
 
+    // Advance of each character if the line was laid out by the monospace fast path
+    // of KateRenderer::layoutLine, 0 otherwise. Such layouts carry no formats, the renderer
+    // computes positions itself and paints the glyphs directly.
+    qreal monospaceAdvance = 0.0;
+
 private:
     // Disable copy
     KateLineLayout(const KateLineLayout &copy);
 
+    size_t segmentForViewLine(int viewLine) const;
+    size_t segmentForColumn(int column) const;
+    QTextLayout *segmentLayout(size_t index, int *columnOffset, int *firstViewLine) const;
+
     KateRenderer &m_renderer;
     mutable std::optional<Kate::TextLine> m_textLine;
     int m_line;
@@ -97,6 +193,12 @@ private:
 
     std::unique_ptr<QTextLayout> m_layout;
     QList<bool> m_dirtyList;
+
+    // very long lines: the segments, the text they were made for and the width they are laid out for,
+    // segments far away from the view are laid out again on demand, even for const access
+    mutable std::vector<Segment> m_segments;
+    QString m_segmentText;
+    int m_segmentWidth = -1;
 };
 
 #endif
@@ -28,6 +28,7 @@
 #include "katepartdebug.h"
 
 #include <QBrush>
+#include <QGlyphRun>
 #include <QPaintEngine>
 #include <QPainter>
 #include <QPainterPath>
@@ -35,10 +36,69 @@
 #include <QStack>
 #include <QtMath> // qCeil
 
+#include <algorithm>
+
 static const QChar tabChar(QLatin1Char('\t'));
 static const QChar spaceChar(QLatin1Char(' '));
 static const QChar nbSpaceChar(0xa0); // non-breaking space
 
+/**
+ * Lines longer than this are split into segments with layouts of their own under dynamic word wrap,
+ * laying out and painting a view of such a line then only costs its visible segments.
+ */
+static constexpr int SegmentThreshold = 64 * 1024;
+
+/**
+ * Length segments are aimed at.
+ */
+static constexpr int SegmentLength = 16 * 1024;
+
+/**
+ * End of the segment starting at start.
+ * Prefers one of the given ends, i.e. the shifted boundaries of unchanged segments of the last layout,
+ * then the start of a word, then any position not inside a surrogate pair or in front of a mark.
+ */
+static int segmentEnd(const QString &text, int start, const std::vector<int> &preferredEnds)
+{
+    const int length = text.size();
+    if (length - start <= SegmentLength + SegmentLength / 2) {
+        return length;
+    }
+
+    auto it = std::lower_bound(preferredEnds.begin(), preferredEnds.end(), start + SegmentLength / 2);
+    if (it != preferredEnds.end() && *it <= start + SegmentLength + SegmentLength / 2) {
+        return *it;
+    }
+
+    for (int end = start + SegmentLength; end > start + SegmentLength * 3 / 4; --end) {
+        if (text[end - 1].isSpace() && !text[end].isSpace()) {
+            return end;
+        }
+    }
+
+    int end = start + SegmentLength;
+    while (end > start + 1 && (text[end].isLowSurrogate() || text[end].isMark())) {
+        --end;
+    }
+    return end;
+}
+
+/**
+ * Formats clipped to the given columns, relative to their start.
+ */
+static QList<QTextLayout::FormatRange> formatsForSegment(const QList<QTextLayout::FormatRange> &formats, int start, int length)
+{
+    QList<QTextLayout::FormatRange> segmentFormats;
+    for (const QTextLayout::FormatRange &range : formats) {
+        const int rangeStart = std::max(range.start, start);
+        const int rangeEnd = std::min(range.start + range.length, start + length);
+        if (rangeStart < rangeEnd) {
+            segmentFormats.append(QTextLayout::FormatRange{rangeStart - start, rangeEnd - rangeStart, range.format});
+        }
+    }
+    return segmentFormats;
+}
+
 KateRenderer::KateRenderer(KTextEditor::DocumentPrivate *doc, Kate::TextFolding &folding, KTextEditor::ViewPrivate *view)
     : m_doc(doc)
     , m_folding(folding)
@@ -442,9 +502,18 @@ QList<QTextLayout::FormatRange> KateRenderer::decorationsForLine(const Kate::Tex
         rangesWithAttributes.clear();
     }
 
+    // find all results of the view are kept apart from the moving ranges
+    QList<KTextEditor::Range> searchHighlights;
+    if (m_view && !m_printerFriendly) {
+        m_view->searchHighlights().rangesForLine(line, searchHighlights);
+        if (searchHighlights.size() > limitOfRanges) {
+            searchHighlights.clear();
+        }
+    }
+
     // Don't compute the highlighting if there isn't going to be any highlighting
     const auto &al = textLine.attributesList();
-    if (!(selectionsOnly || !al.empty() || !rangesWithAttributes.empty())) {
+    if (!(selectionsOnly || !al.empty() || !rangesWithAttributes.empty() || !searchHighlights.empty())) {
         return QList<QTextLayout::FormatRange>();
     }
 
@@ -468,11 +537,22 @@ QList<QTextLayout::FormatRange> KateRenderer::decorationsForLine(const Kate::Tex
     // rangs behavior ;)
     std::sort(rangesWithAttributes.begin(), rangesWithAttributes.end(), rangeLessThanForRenderer);
 
-    renderRanges.reserve(rangesWithAttributes.size());
+    // the search highlights are painted like moving ranges of their z depth would be
+    const auto pushSearchHighlights = [&]() {
+        for (const KTextEditor::Range &range : std::as_const(searchHighlights)) {
+            renderRanges.pushNewRange().addRange(range, m_view->searchHighlights().attribute());
+        }
+        searchHighlights.clear();
+    };
+
+    renderRanges.reserve(rangesWithAttributes.size() + searchHighlights.size());
     // loop over all ranges
     for (int i = 0; i < rangesWithAttributes.size(); ++i) {
         // real range
         Kate::TextRange *kateRange = rangesWithAttributes[i];
+        if (!searchHighlights.empty() && kateRange->zDepth() < m_view->searchHighlights().zDepth()) {
+            pushSearchHighlights();
+        }
 
         // calculate attribute, default: normal attribute
         KTextEditor::Attribute::Ptr attribute = kateRange->attribute();
@@ -495,6 +575,7 @@ QList<QTextLayout::FormatRange> KateRenderer::decorationsForLine(const Kate::Tex
         // span range
         renderRanges.pushNewRange().addRange(*kateRange, std::move(attribute));
     }
+    pushSearchHighlights();
 
     // Add selection highlighting if we're creating the selection decorations
     if ((m_view && selectionsOnly && showSelections() && m_view->selection()) || (m_view && m_view->blockSelection())) {
@@ -660,16 +741,16 @@ void KateRenderer::paintTextBackground(QPainter &paint,
                     if (rtl) {
                         // For rtl, Rect starts at 0 and ends at selection start
                         sx = 0;
-                        width = kateLayout.lineLayout().cursorToX(s);
+                        width = kateLayout.cursorToX(s);
                     } else {
-                        sx = kateLayout.lineLayout().cursorToX(s);
+                        sx = kateLayout.cursorToX(s);
                     }
                 } else if (l == endViewLine) {
                     if (rtl) {
                         // Drawing will start at selection end, and end at the view border
-                        sx = kateLayout.lineLayout().cursorToX(e);
+                        sx = kateLayout.cursorToX(e);
                     } else {
-                        width = kateLayout.lineLayout().cursorToX(e);
+                        width = kateLayout.cursorToX(e);
                     }
                 }
 
@@ -682,6 +763,19 @@ void KateRenderer::paintTextBackground(QPainter &paint,
     }
 }
 
+std::pair<int, int> KateRenderer::visibleViewLines(const KateLineLayout *range, const QRectF &textClipRect) const
+{
+    const int lastViewLine = range->viewLineCount() - 1;
+    if (!range->isSegmented() || textClipRect.isEmpty()) {
+        return {0, lastViewLine};
+    }
+
+    const int height = std::max(1, lineHeight());
+    const int first = std::clamp(int(textClipRect.top()) / height, 0, lastViewLine);
+    const int last = std::clamp(qCeil(textClipRect.bottom()) / height, first, lastViewLine);
+    return {first, last};
+}
+
 void KateRenderer::paintTextLine(QPainter &paint,
                                  KateLineLayout *range,
                                  int xStart,
@@ -716,6 +810,7 @@ void KateRenderer::paintTextLine(QPainter &paint,
     }
 
     if (range->layout()) {
+        const auto [firstVisibleViewLine, lastVisibleViewLine] = visibleViewLines(range, textClipRect);
         bool drawSelection =
             m_view && m_view->selection() && showSelections() && m_view->selectionRange().overlapsLine(range->line()) && !flags.testFlag(SkipDrawLineSelection);
         // Draw selection in block selection mode. We need 2 kinds of selections that QTextLayout::draw can't render:
@@ -771,6 +866,24 @@ void KateRenderer::paintTextLine(QPainter &paint,
                 if (hasCustomLineHeight()) {
                     paintTextBackground(paint, range, additionalFormats, config()->selectionColor(), xStart);
                 }
+            }
+
+            if (range->monospaceAdvance > 0) {
+                // the layout has no formats, see layoutLine, we need all of them with the selection on top
+                QList<QTextLayout::FormatRange> formats = decorationsForLine(range->textLine(), range->line());
+                formats.append(additionalFormats);
+                paintMonospaceLine(paint, range, formats, xStart, xEnd);
+            } else if (range->isSegmented()) {
+                // only the segments inside the clip rect, their layouts have no selection formats either
+                const QList<QTextLayout::FormatRange> &formats = drawSelection ? additionalFormats : QList<QTextLayout::FormatRange>{};
+                for (int viewLine = firstVisibleViewLine; viewLine <= lastVisibleViewLine;) {
+                    int columnOffset = 0;
+                    int firstViewLine = 0;
+                    const QTextLayout *layout = range->segmentLayoutForViewLine(viewLine, &columnOffset, &firstViewLine);
+                    layout->draw(&paint, QPoint(-xStart, 0), formatsForSegment(formats, columnOffset, layout->text().size()), drawSelection ? QRectF{} : textClipRect);
+                    viewLine = std::max(viewLine + 1, firstViewLine + layout->lineCount());
+                }
+            } else if (drawSelection) {
                 // DONT apply clipping, it breaks rendering when there are selections
                 range->layout()->draw(&paint, QPoint(-xStart, 0), additionalFormats);
 
@@ -791,7 +904,7 @@ void KateRenderer::paintTextLine(QPainter &paint,
         }
 
         // Loop each individual line for additional text decoration etc.
-        for (int i = 0; i < range->viewLineCount(); ++i) {
+        for (int i = firstVisibleViewLine; i <= lastVisibleViewLine; ++i) {
             KateTextLayout line = range->viewLine(i);
 
             // Draw indent lines
@@ -809,10 +922,10 @@ void KateRenderer::paintTextLine(QPainter &paint,
             // draw an open box to mark non-breaking spaces
             const QString &text = range->textLine().text();
             int y = lineHeight() * i + m_fontAscent - fm.strikeOutPos();
-            int nbSpaceIndex = text.indexOf(nbSpaceChar, line.lineLayout().xToCursor(xStart));
+            int nbSpaceIndex = text.indexOf(nbSpaceChar, line.xToCursor(xStart));
 
             while (nbSpaceIndex != -1 && nbSpaceIndex < line.endCol()) {
-                int x = line.lineLayout().cursorToX(nbSpaceIndex);
+                int x = line.cursorToX(nbSpaceIndex);
                 if (x > xEnd) {
                     break;
                 }
@@ -822,9 +935,9 @@ void KateRenderer::paintTextLine(QPainter &paint,
 
             // draw tab stop indicators
             if (showTabs()) {
-                int tabIndex = text.indexOf(tabChar, line.lineLayout().xToCursor(xStart));
+                int tabIndex = text.indexOf(tabChar, line.xToCursor(xStart));
                 while (tabIndex != -1 && tabIndex < line.endCol()) {
-                    int x = line.lineLayout().cursorToX(tabIndex);
+                    int x = line.cursorToX(tabIndex);
                     if (x > xEnd) {
                         break;
                     }
@@ -846,8 +959,8 @@ void KateRenderer::paintTextLine(QPainter &paint,
                     int start = isRTL ? xEnd : xStart;
                     int end = isRTL ? xStart : xEnd;
 
-                    spaceIndex = std::min(line.lineLayout().xToCursor(end), spaceIndex);
-                    int visibleStart = line.lineLayout().xToCursor(start);
+                    spaceIndex = std::min(line.xToCursor(end), spaceIndex);
+                    int visibleStart = line.xToCursor(start);
 
                     for (; spaceIndex >= line.startCol(); --spaceIndex) {
                         if (!text.at(spaceIndex).isSpace()) {
@@ -872,7 +985,7 @@ void KateRenderer::paintTextLine(QPainter &paint,
                     // reverse because we want to look at the spaces at the beginning of line first
                     for (auto rit = spacePositions.rbegin(); rit != spacePositions.rend(); ++rit) {
                         const int spaceIdx = *rit;
-                        qreal x = line.lineLayout().cursorToX(spaceIdx) - xStart;
+                        qreal x = line.cursorToX(spaceIdx) - xStart;
                         int dir = 1; // 1 == ltr, -1 == rtl
                         if (range->layout()->textOption().alignment() == Qt::AlignRight) {
                             dir = -1;
@@ -913,12 +1026,12 @@ void KateRenderer::paintTextLine(QPainter &paint,
 
                 static const QRegularExpression nonPrintableSpacesRegExp(
                     QStringLiteral("[\\x{2000}-\\x{200F}\\x{2028}-\\x{202F}\\x{205F}-\\x{2064}\\x{206A}-\\x{206F}]"));
-                QRegularExpressionMatchIterator i = nonPrintableSpacesRegExp.globalMatch(text, line.lineLayout().xToCursor(xStart));
+                QRegularExpressionMatchIterator i = nonPrintableSpacesRegExp.globalMatch(text, line.xToCursor(xStart));
 
                 while (i.hasNext()) {
                     const int charIndex = i.next().capturedStart();
 
-                    const int x = line.lineLayout().cursorToX(charIndex);
+                    const int x = line.cursorToX(charIndex);
                     if (x > xEnd) {
                         break;
                     }
@@ -987,11 +1100,11 @@ void KateRenderer::paintTextLine(QPainter &paint,
             // If the text is ltr or rtl + dyn wrap, get the X from column
             qreal x;
             if (dir == Qt::LeftToRight || (dir == Qt::RightToLeft && m_view->dynWordWrap())) {
-                x = range->viewLine(viewLine).lineLayout().cursorToX(column) - xStart;
+                x = range->viewLine(viewLine).cursorToX(column) - xStart;
             } else /* rtl + dynWordWrap == false */ {
                 // if text is rtl and dynamic wrap is false, the x offsets are in the opposite
                 // direction i.e., [0] == biggest offset, [1] = next
-                x = range->viewLine(viewLine).lineLayout().cursorToX(range->length() - column) - xStart;
+                x = range->viewLine(viewLine).cursorToX(range->length() - column) - xStart;
             }
             int textLength = range->length();
             if (column == 0 || column < textLength) {
@@ -1017,7 +1130,7 @@ void KateRenderer::paintTextLine(QPainter &paint,
     }
 }
 
-static void drawCursor(const QTextLayout &layout, QPainter *p, const QPointF &pos, int cursorPosition, int width, const int height)
+static void drawCursor(const QTextLayout &layout, QPainter *p, const QPointF &pos, int cursorPosition, int width, const int height, int firstViewLine = 0)
 {
     cursorPosition = qBound(0, cursorPosition, layout.text().length());
     const QTextLine l = layout.lineForTextPosition(cursorPosition);
@@ -1032,7 +1145,7 @@ static void drawCursor(const QTextLayout &layout, QPainter *p, const QPointF &po
 
     const QPointF position = pos + layout.position();
     const qreal x = position.x() + l.cursorToX(cursorPosition);
-    const qreal y = l.lineNumber() * height;
+    const qreal y = (firstViewLine + l.lineNumber()) * height;
     p->fillRect(QRectF(x, y, (qreal)width, (qreal)height), p->pen().brush());
     p->setCompositionMode(origCompositionMode);
 }
@@ -1043,7 +1156,12 @@ void KateRenderer::paintCaret(KTextEditor::Cursor cursor, KateLineLayout *range,
         int caretWidth;
         int lineWidth = 2;
         QColor color;
-        QTextLine line = range->layout()->lineForTextPosition(qMin(cursor.column(), range->length()));
+        // for segmented lines the layout of the segment with the cursor, columns relative to it
+        int columnOffset = 0;
+        int firstViewLine = 0;
+        const QTextLayout *layout = range->segmentLayoutForColumn(cursor.column(), &columnOffset, &firstViewLine);
+        const int column = cursor.column() - columnOffset;
+        QTextLine line = layout->lineForTextPosition(qMin(column, int(layout->text().size())));
 
         // Determine the caret's style
         KTextEditor::caretStyles style = caretStyle();
@@ -1052,7 +1170,7 @@ void KateRenderer::paintCaret(KTextEditor::Cursor cursor, KateLineLayout *range,
         if (style == KTextEditor::caretStyles::Line) {
             caretWidth = lineWidth;
         } else if (line.isValid() && cursor.column() < range->length()) {
-            caretWidth = int(line.cursorToX(cursor.column() + 1) - line.cursorToX(cursor.column()));
+            caretWidth = int(line.cursorToX(column + 1) - line.cursorToX(column));
             if (caretWidth < 0) {
                 caretWidth = -caretWidth;
             }
@@ -1067,7 +1185,7 @@ void KateRenderer::paintCaret(KTextEditor::Cursor cursor, KateLineLayout *range,
             color = m_caretOverrideColor;
         } else {
             // search for the FormatRange that includes the cursor
-            const auto formatRanges = range->layout()->formats();
+            const auto formatRanges = (range->monospaceAdvance > 0 || range->isSegmented()) ? decorationsForLine(range->textLine(), range->line()) : range->layout()->formats();
             for (const QTextLayout::FormatRange &r : formatRanges) {
                 if ((r.start <= cursor.column()) && ((r.start + r.length) > cursor.column())) {
                     // check for Qt::NoBrush, as the returned color is black() and no invalid QColor
@@ -1115,7 +1233,7 @@ void KateRenderer::paintCaret(KTextEditor::Cursor cursor, KateLineLayout *range,
                     width = inlineNote.width() + (caretStyle() == KTextEditor::caretStyles::Line ? 2.0 : 0.0);
                 }
             }
-            drawCursor(*range->layout(), &paint, QPoint(-xStart - width, 0), cursor.column(), caretWidth, lineHeight());
+            drawCursor(*layout, &paint, QPoint(-xStart - width, 0), column, caretWidth, lineHeight(), firstViewLine);
         } else {
             // Off the end of the line... must be block mode. Draw the caret ourselves.
             const KateTextLayout &lastLine = range->viewLine(range->viewLineCount() - 1);
@@ -1229,6 +1347,324 @@ void KateRenderer::updateFontHeight()
         qreal diff = std::abs(oldFontHeight - newFontHeight);
         m_fontAscent += (diff / 2);
     }
+
+    updateMonospaceGlyphs();
+}
+
+void KateRenderer::updateMonospaceGlyphs()
+{
+    m_monospaceAdvance = 0.0;
+    m_glyphRunCache.clear();
+
+    // the regular style must be one of the styles we have glyphs for
+    if (m_font.weight() != QFont::Normal && m_font.weight() != QFont::Bold) {
+        return;
+    }
+
+    QString ascii;
+    for (char16_t c = 0x20; c < 0x7f; ++c) {
+        ascii.append(QChar(c));
+    }
+
+    qreal advance = 0.0;
+    for (int style = 0; style < 4; ++style) {
+        QFont font = m_font;
+        font.setWeight((style & 1) ? QFont::Bold : QFont::Normal);
+        font.setItalic(style & 2);
+
+        const QFontMetricsF metrics(font);
+        for (const QChar c : std::as_const(ascii)) {
+            const qreal charAdvance = metrics.horizontalAdvance(c);
+            if (advance == 0.0) {
+                advance = charAdvance;
+            }
+            if (charAdvance <= 0.0 || !qFuzzyCompare(charAdvance, advance)) {
+                return;
+            }
+        }
+
+        // all glyphs must be in the font itself, no fallback fonts
+        const QRawFont rawFont = QRawFont::fromFont(font);
+        const QList<quint32> glyphs = rawFont.isValid() ? rawFont.glyphIndexesForString(ascii) : QList<quint32>();
+        if (glyphs.size() != ascii.size() || glyphs.contains(0)) {
+            return;
+        }
+
+        m_styleFonts[style] = font;
+        m_asciiRawFonts[style] = rawFont;
+        std::copy(glyphs.begin(), glyphs.end(), m_asciiGlyphs[style].begin());
+    }
+
+    m_monospaceAdvance = advance;
+}
+
+/**
+ * Does the format leave the advance of monospace text untouched and can we paint it ourselves?
+ */
+static bool keepsMonospaceAdvance(const QTextCharFormat &format)
+{
+    const auto properties = format.properties();
+    for (auto it = properties.cbegin(); it != properties.cend(); ++it) {
+        switch (it.key()) {
+        case QTextFormat::ForegroundBrush:
+        case QTextFormat::BackgroundBrush:
+        case QTextFormat::FontItalic:
+        case QTextFormat::FontUnderline:
+        case QTextFormat::TextUnderlineStyle:
+        case QTextFormat::TextUnderlineColor:
+        case QTextFormat::FontStrikeOut:
+        case QTextFormat::FontOverline:
+            break;
+        case QTextFormat::FontWeight:
+            if (format.fontWeight() != QFont::Normal && format.fontWeight() != QFont::Bold) {
+                return false;
+            }
+            break;
+        case QTextFormat::FontStyleName:
+            // cleared for bold and italic text by decorationsForLine, that keeps the font of the style
+            if (!it.value().toString().isEmpty()) {
+                return false;
+            }
+            break;
+        default:
+            // our custom properties are ignored by QTextLayout, too
+            if (it.key() < QTextFormat::UserProperty) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Split [firstColumn, endColumn) where formats start or end, each piece gets the merge of the formats covering it.
+ */
+static void splitAtFormats(const QList<QTextLayout::FormatRange> &formats,
+                           int firstColumn,
+                           int endColumn,
+                           QVarLengthArray<int, 64> &boundaries,
+                           QVarLengthArray<QTextCharFormat, 64> &pieceFormats)
+{
+    boundaries = {firstColumn, endColumn};
+    for (const auto &fr : formats) {
+        for (const int column : {fr.start, fr.start + fr.length}) {
+            if (column > firstColumn && column < endColumn) {
+                boundaries.append(column);
+            }
+        }
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    pieceFormats.clear();
+    for (int i = 0; i + 1 < boundaries.size(); ++i) {
+        QTextCharFormat format;
+        for (const auto &fr : formats) {
+            if (fr.start <= boundaries[i] && boundaries[i] < fr.start + fr.length) {
+                format.merge(fr.format);
+            }
+        }
+        pieceFormats.append(format);
+    }
+}
+
+/**
+ * Index of the glyph tables to use for the format: 1 = bold, 2 = italic.
+ */
+static int monospaceStyle(const QTextCharFormat &format, const QFont &font)
+{
+    const bool bold = format.hasProperty(QTextFormat::FontWeight) ? format.fontWeight() == QFont::Bold : font.weight() == QFont::Bold;
+    const bool italic = format.hasProperty(QTextFormat::FontItalic) ? format.fontItalic() : font.italic();
+    return (bold ? 1 : 0) | (italic ? 2 : 0);
+}
+
+static bool isAscii(QStringView text)
+{
+    return std::all_of(text.begin(), text.end(), [](QChar c) {
+        return c.unicode() < 0x7f;
+    });
+}
+
+bool KateRenderer::isMonospaceLine(QStringView text, const QList<QTextLayout::FormatRange> &decorations) const
+{
+    if (m_monospaceAdvance <= 0.0 || m_printerFriendly) {
+        return false;
+    }
+
+    bool ascii = true;
+    for (const QChar c : text) {
+        if (c.unicode() < 0x20) {
+            return false;
+        }
+        if (c.unicode() >= 0x7f) {
+            ascii = false;
+
+            // nothing that changes the direction or combines with other characters
+            switch (c.direction()) {
+            case QChar::DirL:
+            case QChar::DirEN:
+            case QChar::DirES:
+            case QChar::DirET:
+            case QChar::DirCS:
+            case QChar::DirWS:
+            case QChar::DirON:
+                break;
+            default:
+                return false;
+            }
+            if (c.isSurrogate() || c.isMark() || c.category() == QChar::Other_Format) {
+                return false;
+            }
+        }
+    }
+
+    if (!std::all_of(decorations.begin(), decorations.end(), [](const QTextLayout::FormatRange &range) {
+            return keepsMonospaceAdvance(range.format);
+        })) {
+        return false;
+    }
+
+    if (ascii) {
+        return true;
+    }
+
+    // other characters need to be checked token by token, the shaped tokens are cached
+    QVarLengthArray<int, 64> boundaries;
+    QVarLengthArray<QTextCharFormat, 64> pieceFormats;
+    splitAtFormats(decorations, 0, text.size(), boundaries, pieceFormats);
+    for (int i = 0; i < pieceFormats.size(); ++i) {
+        const QStringView token = text.mid(boundaries[i], boundaries[i + 1] - boundaries[i]);
+        if (isAscii(token)) {
+            continue;
+        }
+        const int style = monospaceStyle(pieceFormats[i], m_font);
+        if (!m_glyphRunCache.glyphs(token, style, m_styleFonts[style], m_asciiRawFonts[style], m_monospaceAdvance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void KateRenderer::paintMonospaceLine(QPainter &paint, KateLineLayout *range, const QList<QTextLayout::FormatRange> &formats, int xStart, int xEnd) const
+{
+    const QString &text = range->layout()->text();
+    const QTextLine line = range->layout()->lineAt(0);
+    const qreal advance = range->monospaceAdvance;
+    const qreal baseline = line.y() + line.ascent();
+
+    // visible columns only, one more on each side for italic overhang
+    const int firstColumn = std::clamp(qFloor(xStart / advance) - 1, 0, int(text.size()));
+    const int endColumn = std::clamp(qCeil(xEnd / advance) + 1, firstColumn, int(text.size()));
+    if (firstColumn == endColumn) {
+        return;
+    }
+
+    // split the visible text where formats start or end, each piece has one merged format
+    QVarLengthArray<int, 64> boundaries;
+    QVarLengthArray<QTextCharFormat, 64> pieceFormats;
+    splitAtFormats(formats, firstColumn, endColumn, boundaries, pieceFormats);
+
+    // backgrounds first, like QTextLine::draw, then the text on top
+    for (int i = 0; i < pieceFormats.size(); ++i) {
+        if (pieceFormats[i].hasProperty(QTextFormat::BackgroundBrush)) {
+            const QRectF rect(boundaries[i] * advance - xStart, line.y(), (boundaries[i + 1] - boundaries[i]) * advance, line.height());
+            paint.fillRect(rect, pieceFormats[i].background());
+        }
+    }
+
+    const QPen defaultPen = paint.pen();
+    QVarLengthArray<quint32, 256> glyphs;
+    QVarLengthArray<QPointF, 256> positions;
+    for (int i = 0; i < pieceFormats.size(); ++i) {
+        const QTextCharFormat &format = pieceFormats[i];
+        const int style = monospaceStyle(format, m_font);
+        const QStringView token = QStringView(text).mid(boundaries[i], boundaries[i + 1] - boundaries[i]);
+
+        const QPen pen = format.hasProperty(QTextFormat::ForegroundBrush) ? QPen(format.foreground(), 0) : defaultPen;
+        paint.setPen(pen);
+
+        // ASCII from the glyph table, anything else from the shaped tokens
+        glyphs.clear();
+        positions.clear();
+        if (isAscii(token)) {
+            for (const QChar c : token) {
+                glyphs.append(m_asciiGlyphs[style][c.unicode() - 0x20]);
+            }
+        } else if (const QList<quint32> *tokenGlyphs = m_glyphRunCache.glyphs(token, style, m_styleFonts[style], m_asciiRawFonts[style], advance)) {
+            glyphs.append(tokenGlyphs->constData(), tokenGlyphs->size());
+        }
+
+        if (glyphs.size() == token.size()) {
+            for (int column = boundaries[i]; column < boundaries[i + 1]; ++column) {
+                positions.append(QPointF(column * advance, 0));
+            }
+            QGlyphRun run;
+            run.setRawFont(m_asciiRawFonts[style]);
+            run.setRawData(glyphs.constData(), positions.constData(), glyphs.size());
+            paint.drawGlyphRun(QPointF(-xStart, baseline), run);
+        } else {
+            // a part of a token, e.g. cut by the selection, might shape differently than the whole
+            paint.save();
+            paint.setFont(m_styleFonts[style]);
+            paint.drawText(QPointF(boundaries[i] * advance - xStart, baseline), token.toString());
+            paint.restore();
+        }
+
+        // decorations, QGlyphRun only knows plain lines
+        const qreal x1 = boundaries[i] * advance - xStart;
+        const qreal x2 = boundaries[i + 1] * advance - xStart;
+        const QRawFont &rawFont = m_asciiRawFonts[style];
+        const qreal lineWidth = std::max<qreal>(1.0, rawFont.lineThickness());
+        const QTextCharFormat::UnderlineStyle underline = format.underlineStyle();
+        if (underline != QTextCharFormat::NoUnderline) {
+            QPen underlinePen(format.underlineColor().isValid() ? QBrush(format.underlineColor()) : pen.brush(), lineWidth);
+            const qreal y = baseline + rawFont.underlinePosition();
+            if (underline == QTextCharFormat::WaveUnderline || underline == QTextCharFormat::SpellCheckUnderline) {
+                const qreal radius = std::max<qreal>(1.0, lineWidth);
+                QPainterPath wave(QPointF(x1, y));
+                for (qreal x = x1; x < x2; x += 2 * radius) {
+                    wave.quadTo(QPointF(x + radius / 2, y - radius), QPointF(x + radius, y));
+                    wave.quadTo(QPointF(x + radius * 1.5, y + radius), QPointF(x + 2 * radius, y));
+                }
+                paint.save();
+                paint.setClipRect(QRectF(x1, y - 2 * radius, x2 - x1, 4 * radius), Qt::IntersectClip);
+                paint.setPen(underlinePen);
+                paint.drawPath(wave);
+                paint.restore();
+            } else {
+                switch (underline) {
+                case QTextCharFormat::DashUnderline:
+                    underlinePen.setStyle(Qt::DashLine);
+                    break;
+                case QTextCharFormat::DotLine:
+                    underlinePen.setStyle(Qt::DotLine);
+                    break;
+                case QTextCharFormat::DashDotLine:
+                    underlinePen.setStyle(Qt::DashDotLine);
+                    break;
+                case QTextCharFormat::DashDotDotLine:
+                    underlinePen.setStyle(Qt::DashDotDotLine);
+                    break;
+                default:
+                    break;
+                }
+                paint.setPen(underlinePen);
+                paint.drawLine(QLineF(x1, y, x2, y));
+            }
+        }
+        if (format.fontStrikeOut()) {
+            paint.setPen(QPen(pen.brush(), lineWidth));
+            const qreal y = baseline - rawFont.ascent() / 3;
+            paint.drawLine(QLineF(x1, y, x2, y));
+        }
+        if (format.fontOverline()) {
+            paint.setPen(QPen(pen.brush(), lineWidth));
+            const qreal y = baseline - rawFont.ascent() + lineWidth / 2;
+            paint.drawLine(QLineF(x1, y, x2, y));
+        }
+    }
+
+    paint.setPen(defaultPen);
 }
 
 void KateRenderer::updateMarkerSize()
@@ -1244,13 +1680,200 @@ qreal KateRenderer::spaceWidth() const
     return m_fontMetrics.horizontalAdvance(spaceChar);
 }
 
+QTextLayout *KateRenderer::createSegmentLayout(const QString &text,
+                                               const QList<QTextLayout::FormatRange> &formats,
+                                               const KateLineLayout::Segment &segment,
+                                               int maxwidth,
+                                               int &shiftX) const
+{
+    auto *l = new QTextLayout(text.mid(segment.start, segment.length), m_font);
+    l->setCacheEnabled(false);
+
+    // like layoutLine, segmented lines are always left to right
+    QTextOption opt;
+    opt.setFlags(QTextOption::IncludeTrailingSpaces);
+    opt.setTabStopDistance(m_tabWidth * m_fontMetrics.horizontalAdvance(spaceChar));
+    opt.setWrapMode(m_view->config()->dynWrapAnywhere() ? QTextOption::WrapAnywhere : QTextOption::WrapAtWordBoundaryOrAnywhere);
+    opt.setAlignment(Qt::AlignLeft);
+    opt.setTextDirection(Qt::LeftToRight);
+    l->setTextOption(opt);
+    l->setFormats(formats);
+
+    l->beginLayout();
+
+    // only the first view line of the whole line starts at x = 0, the others are indented by shiftX
+    const bool firstSegment = segment.start == 0;
+    bool needShiftX = firstSegment && m_view->config()->dynWordWrapAlignIndent() > 0;
+    if (firstSegment) {
+        shiftX = 0;
+    }
+    int lineWidth = firstSegment ? maxwidth : maxwidth - shiftX;
+    int viewLine = segment.firstViewLine;
+
+    while (true) {
+        QTextLine line = l->createLine();
+        if (!line.isValid()) {
+            break;
+        }
+
+        line.setLineWidth(lineWidth);
+        line.setLeadingIncluded(true);
+        line.setPosition(QPoint((firstSegment && line.lineNumber() == 0) ? 0 : shiftX, viewLine * lineHeight() - line.ascent() + m_fontAscent));
+
+        if (needShiftX) {
+            needShiftX = false;
+            int pos = 0;
+            while (pos < text.size() && text[pos].isSpace()) {
+                ++pos;
+            }
+            if (pos > 0 && pos < text.size()) {
+                shiftX = (int)line.cursorToX(pos);
+            }
+            if (shiftX > ((double)maxwidth / 100 * m_view->config()->dynWordWrapAlignIndent())) {
+                shiftX = 0;
+            }
+            lineWidth = maxwidth - shiftX;
+        }
+
+        ++viewLine;
+    }
+
+    l->endLayout();
+    return l;
+}
+
+void KateRenderer::layoutSegment(const KateLineLayout *lineLayout, KateLineLayout::Segment &segment) const
+{
+    const Kate::TextLine textLine = lineLayout->textLine();
+    const QList<QTextLayout::FormatRange> formats = formatsForSegment(decorationsForLine(textLine, lineLayout->line()), segment.start, segment.length);
+    int shiftX = lineLayout->shiftX;
+    segment.layout.reset(createSegmentLayout(textLine.text(), formats, segment, lineLayout->segmentWidth(), shiftX));
+}
+
+void KateRenderer::layoutSegmentedLine(KateLineLayout *lineLayout, int maxwidth) const
+{
+    const Kate::TextLine textLine = lineLayout->textLine();
+    const QString &text = textLine.text();
+    const int length = text.size();
+
+    // segments of the last layout, the unchanged ones keep their view line count,
+    // an edit usually changes one segment of the line only
+    QString oldText;
+    int oldWidth = -1;
+    std::vector<KateLineLayout::Segment> oldSegments = lineLayout->takeSegments(oldText, oldWidth);
+    if (oldWidth != maxwidth) {
+        oldSegments.clear();
+    }
+
+    int prefix = 0;
+    int suffix = 0;
+    if (!oldSegments.empty()) {
+        const int minLength = std::min<int>(length, oldText.size());
+        prefix = std::mismatch(text.begin(), text.begin() + minLength, oldText.begin()).first - text.begin();
+        suffix = std::mismatch(text.rbegin(), text.rbegin() + (minLength - prefix), oldText.rbegin()).first - text.rbegin();
+    }
+    const int delta = length - int(oldText.size());
+    const int oldSuffixStart = int(oldText.size()) - suffix;
+
+    // old segment at the given position of the new text, if its text didn't change
+    const auto unchangedSegment = [&](int pos) -> const KateLineLayout::Segment * {
+        for (int oldPos : {pos, pos - delta}) {
+            auto it = std::lower_bound(oldSegments.begin(), oldSegments.end(), oldPos, [](const KateLineLayout::Segment &segment, int pos) {
+                return segment.start < pos;
+            });
+            if (it == oldSegments.end() || it->start != oldPos) {
+                continue;
+            }
+            if (oldPos == pos && it->start + it->length <= prefix) {
+                return &*it;
+            }
+            if (oldPos == pos - delta && it->start >= oldSuffixStart && (pos == 0) == (it->start == 0)) {
+                return &*it;
+            }
+        }
+        return nullptr;
+    };
+
+    std::vector<int> preferredEnds;
+    for (const KateLineLayout::Segment &segment : oldSegments) {
+        if (segment.start >= oldSuffixStart && segment.start + delta > 0) {
+            preferredEnds.push_back(segment.start + delta);
+        }
+    }
+
+    // split the line, view line counts of changed segments are unknown yet
+    std::vector<KateLineLayout::Segment> segments;
+    for (int pos = 0; pos < length;) {
+        KateLineLayout::Segment segment;
+        segment.start = pos;
+        if (const KateLineLayout::Segment *old = unchangedSegment(pos)) {
+            segment.length = old->length;
+            segment.viewLineCount = old->viewLineCount;
+        } else {
+            segment.length = segmentEnd(text, pos, preferredEnds) - pos;
+            segment.viewLineCount = -1;
+        }
+        pos += segment.length;
+        segments.push_back(std::move(segment));
+    }
+
+    // formats of all segments in one go, a format can span several segments
+    QList<QTextLayout::FormatRange> decorations = decorationsForLine(textLine, lineLayout->line());
+    std::vector<QList<QTextLayout::FormatRange>> segmentFormats(segments.size());
+    for (const QTextLayout::FormatRange &range : std::as_const(decorations)) {
+        auto it = std::upper_bound(segments.begin(), segments.end(), range.start, [](int pos, const KateLineLayout::Segment &segment) {
+            return pos < segment.start;
+        });
+        if (it != segments.begin()) {
+            --it;
+        }
+        for (; it != segments.end() && it->start < range.start + range.length; ++it) {
+            const int rangeStart = std::max(range.start, it->start);
+            const int rangeEnd = std::min(range.start + range.length, it->start + it->length);
+            if (rangeStart < rangeEnd) {
+                segmentFormats[it - segments.begin()].append(QTextLayout::FormatRange{rangeStart - it->start, rangeEnd - rangeStart, range.format});
+            }
+        }
+    }
+
+    // the first segment stays laid out, it determines the indentation of all others;
+    // the others are laid out just to count their view lines, once that changed all counts are stale
+    int shiftX = 0;
+    segments.front().layout.reset(createSegmentLayout(text, segmentFormats.front(), segments.front(), maxwidth, shiftX));
+    segments.front().viewLineCount = segments.front().layout->lineCount();
+    const bool shiftChanged = shiftX != lineLayout->shiftX;
+    lineLayout->shiftX = shiftX;
+
+    int firstViewLine = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        KateLineLayout::Segment &segment = segments[i];
+        segment.firstViewLine = firstViewLine;
+        if (i > 0 && (segment.viewLineCount < 0 || shiftChanged)) {
+            std::unique_ptr<QTextLayout> layout(createSegmentLayout(text, segmentFormats[i], segment, maxwidth, shiftX));
+            segment.viewLineCount = layout->lineCount();
+        }
+        firstViewLine += segment.viewLineCount;
+    }
+
+    lineLayout->monospaceAdvance = 0.0;
+    lineLayout->setSegments(std::move(segments), text, maxwidth);
+}
+
 void KateRenderer::layoutLine(KateLineLayout *lineLayout, int maxwidth, bool cacheLayout) const
 {
     // if maxwidth == -1 we have no wrap
 
     Kate::TextLine textLine = lineLayout->textLine();
 
-    QTextLayout *l = lineLayout->layout();
+    // very long left to right lines without inline notes are split into segments under dynamic word wrap
+    if (maxwidth > 0 && m_view && !isPrinterFriendly() && textLine.length() > SegmentThreshold && !view()->forceRTLDirection()
+        && m_view->inlineNotes(lineLayout->line()).isEmpty() && !isLineRightToLeft(textLine.text())) {
+        layoutSegmentedLine(lineLayout, maxwidth);
+        return;
+    }
+
+    // the layout of the first segment of a formerly segmented line belongs to the segment
+    QTextLayout *l = lineLayout->isSegmented() ? nullptr : lineLayout->layout();
     if (!l) {
         l = new QTextLayout(textLine.text(), m_font);
     } else {
@@ -1260,6 +1883,20 @@ void KateRenderer::layoutLine(KateLineLayout *lineLayout, int maxwidth, bool cac
 
     l->setCacheEnabled(cacheLayout);
 
+    // Syntax highlighting, inbuilt and arbitrary
+    QList<QTextLayout::FormatRange> decorations = decorationsForLine(textLine, lineLayout->line());
+
+    QVarLengthArray<KateInlineNoteData, 8> inlineNotes;
+    if (!isPrinterFriendly() && m_view) {
+        inlineNotes = m_view->inlineNotes(lineLayout->line());
+    }
+
+    // Left to right text in a monospace font that fits into one line: positions are just multiples of the
+    // advance, so the layout needs no formats and no bidi detection, we paint the formats ourselves.
+    const bool monospace = inlineNotes.isEmpty() && !(view()->dynWordWrap() && view()->forceRTLDirection())
+        && (maxwidth <= 0 || textLine.length() * m_monospaceAdvance <= maxwidth) && isMonospaceLine(textLine.text(), decorations);
+    lineLayout->monospaceAdvance = monospace ? m_monospaceAdvance : 0.0;
+
     // Initial setup of the QTextLayout.
 
     // Tab width
@@ -1283,7 +1920,7 @@ void KateRenderer::layoutLine(KateLineLayout *lineLayout, int maxwidth, bool cac
     // Only force RTL direction if dynWordWrap is on. Otherwise the view has infinite width
     // and the lines will never be forced RTL no matter what direction we set. The layout
     // can't force a line to the right if it doesn't know where the "right" is
-    if (isLineRightToLeft(textLine.text()) || (view()->dynWordWrap() && view()->forceRTLDirection())) {
+    if (!monospace && (isLineRightToLeft(textLine.text()) || (view()->dynWordWrap() && view()->forceRTLDirection()))) {
         opt.setAlignment(Qt::AlignRight);
         opt.setTextDirection(Qt::RightToLeft);
         // Must turn off this flag otherwise cursor placement
@@ -1300,9 +1937,6 @@ void KateRenderer::layoutLine(KateLineLayout *lineLayout, int maxwidth, bool cac
 
     l->setTextOption(opt);
 
-    // Syntax highlighting, inbuilt and arbitrary
-    QList<QTextLayout::FormatRange> decorations = decorationsForLine(textLine, lineLayout->line());
-
     // Qt works badly if you have RTL text and formats set on that text.
     // It will shape the text according to the given format ranges which
     // produces incorrect results as a letter in RTL can have a different
@@ -1329,8 +1963,11 @@ void KateRenderer::layoutLine(KateLineLayout *lineLayout, int maxwidth, bool cac
 
     int firstLineOffset = 0;
 
+    if (monospace) {
+        decorations.clear();
+    }
+
     if (!isPrinterFriendly() && m_view) {
-        const auto inlineNotes = m_view->inlineNotes(lineLayout->line());
         for (const KateInlineNoteData &noteData : inlineNotes) {
             const KTextEditor::InlineNote inlineNote(noteData);
             const int column = inlineNote.position().column();
@@ -1453,8 +2090,11 @@ int KateRenderer::cursorToX(const KateTextLayout &range, const KTextEditor::Curs
     Q_ASSERT(range.isValid());
 
     int x;
-    if (range.lineLayout().width() > 0) {
-        x = (int)range.lineLayout().cursorToX(pos.column());
+    if (const qreal advance = range.kateLineLayout()->monospaceAdvance; advance > 0) {
+        // monospace lines have one view line at x = 0
+        x = (int)(std::clamp(pos.column(), 0, range.length()) * advance);
+    } else if (range.lineLayout().width() > 0) {
+        x = (int)range.cursorToX(pos.column());
     } else {
         x = 0;
     }
@@ -1470,7 +2110,13 @@ int KateRenderer::cursorToX(const KateTextLayout &range, const KTextEditor::Curs
 KTextEditor::Cursor KateRenderer::xToCursor(const KateTextLayout &range, int x, bool returnPastLine) const
 {
     Q_ASSERT(range.isValid());
-    KTextEditor::Cursor ret(range.line(), range.lineLayout().xToCursor(x));
+    KTextEditor::Cursor ret(range.line(), 0);
+    if (const qreal advance = range.kateLineLayout()->monospaceAdvance; advance > 0) {
+        // nearest boundary between two characters, like QTextLine::CursorBetweenCharacters
+        ret.setColumn(std::clamp(qFloor(x / advance + 0.5), 0, range.length()));
+    } else {
+        ret.setColumn(range.xToCursor(x));
+    }
 
     // Do not wrap to the next line. (bug #423253)
     if (range.wrap() && ret.column() >= range.endCol() && range.length() > 0) {
@@ -13,13 +13,18 @@
 #define KATE_RENDERER_H
 
 #include "kateconfig.h"
+#include "kateglyphruncache.h"
+#include "katelinelayout.h"
 #include "ktexteditor/range.h"
 
 #include <QFlags>
 #include <QFont>
 #include <QFontMetricsF>
+#include <QRawFont>
 #include <QTextLine>
 
+#include <array>
+
 namespace KTextEditor
 {
 class DocumentPrivate;
@@ -34,7 +39,6 @@ class TextLine;
 }
 
 class KateTextLayout;
-class KateLineLayout;
 typedef QExplicitlySharedDataPointer<KTextEditor::Attribute> AttributePtr;
 
 namespace KTextEditor
@@ -261,6 +265,15 @@ public:
         return m_fontMetrics;
     }
 
+    /**
+     * Access the cache of shaped tokens of the monospace fast path.
+     * @return glyph run cache
+     */
+    const KateGlyphRunCache &glyphRunCache() const
+    {
+        return m_glyphRunCache;
+    }
+
     /**
      * @return whether the renderer is configured to paint in a
      * printer-friendly fashion.
@@ -279,6 +292,11 @@ public:
      */
     void layoutLine(KateLineLayout *line, int maxwidth = -1, bool cacheLayout = false) const;
 
+    /**
+     * Lay out one segment of a line split by layoutLine again, after its layout was dropped.
+     */
+    void layoutSegment(const KateLineLayout *lineLayout, KateLineLayout::Segment &segment) const;
+
     /**
      * This is a smaller QString::isRightToLeft(). It's also marked as internal to kate
      * instead of internal to Qt, so we can modify. This method searches for the first
@@ -435,9 +453,47 @@ private:
 
     void paintCaret(KTextEditor::Cursor cursor, KateLineLayout *range, QPainter &paint, int xStart, int xEnd);
 
+    /**
+     * Can the line take the monospace fast path of layoutLine?
+     * That needs a font with one advance for all printable ASCII characters, a line of left to right
+     * characters that are shaped to one glyph each at that advance and formats that don't change it.
+     */
+    bool isMonospaceLine(QStringView text, const QList<QTextLayout::FormatRange> &decorations) const;
+
+    /**
+     * Paint the text of a line laid out by the monospace fast path, like QTextLayout::draw would.
+     * ASCII glyphs are looked up in the table of printable ASCII glyphs, other tokens in the glyph run cache.
+     */
+    void paintMonospaceLine(QPainter &paint, KateLineLayout *range, const QList<QTextLayout::FormatRange> &formats, int xStart, int xEnd) const;
+
+    /**
+     * Lay out a very long line in segments of their own, see layoutLine.
+     */
+    void layoutSegmentedLine(KateLineLayout *lineLayout, int maxwidth) const;
+
+    /**
+     * Create the layout of one segment of a line.
+     * @param formats formats of the segment, relative to its start
+     * @param shiftX indentation of the view lines after the first one, computed for the first segment
+     */
+    QTextLayout *createSegmentLayout(const QString &text,
+                                     const QList<QTextLayout::FormatRange> &formats,
+                                     const KateLineLayout::Segment &segment,
+                                     int maxwidth,
+                                     int &shiftX) const;
+
+    /**
+     * View lines of the line inside the clip rect, all of them if the clip rect is empty
+     * or the line is not split into segments.
+     */
+    std::pair<int, int> visibleViewLines(const KateLineLayout *range, const QRectF &textClipRect) const;
+
     // update font height
     void updateFontHeight();
 
+    // check whether the font allows the monospace fast path and fill the glyph tables
+    void updateMonospaceGlyphs();
+
     bool hasCustomLineHeight() const;
 
     KTextEditor::DocumentPrivate *const m_doc;
@@ -492,6 +548,23 @@ private:
      * cached font metrics
      */
     QFontMetricsF m_fontMetrics;
+
+    /**
+     * Advance of all printable ASCII characters in all font styles, 0 if they differ.
+     */
+    qreal m_monospaceAdvance = 0.0;
+
+    /**
+     * Fonts and glyphs of the printable ASCII characters, for regular, bold, italic and bold italic.
+     */
+    std::array<QFont, 4> m_styleFonts;
+    std::array<QRawFont, 4> m_asciiRawFonts;
+    std::array<std::array<quint32, 0x7f - 0x20>, 4> m_asciiGlyphs;
+
+    /**
+     * Glyphs of other tokens, shaped on first use.
+     */
+    mutable KateGlyphRunCache m_glyphRunCache;
 };
 
 #endif
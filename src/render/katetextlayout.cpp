@@ -9,16 +9,31 @@
 
 #include "katepartdebug.h"
 
+#include <QTextLayout>
+
 KateTextLayout::KateTextLayout(KateLineLayout *line, int viewLine)
     : m_lineLayout(line)
     , m_viewLine(viewLine)
     , m_startX(m_viewLine ? -1 : 0)
 {
     if (isValid()) {
-        m_textLayout = m_lineLayout->layout()->lineAt(m_viewLine);
+        // very long lines are split into segments with layouts of their own
+        int firstViewLine = 0;
+        const QTextLayout *layout = m_lineLayout->segmentLayoutForViewLine(m_viewLine, &m_columnOffset, &firstViewLine);
+        m_textLayout = layout->lineAt(qMin(m_viewLine - firstViewLine, layout->lineCount() - 1));
     }
 }
 
+qreal KateTextLayout::cursorToX(int column) const
+{
+    return m_textLayout.cursorToX(column - m_columnOffset);
+}
+
+int KateTextLayout::xToCursor(qreal x, QTextLine::CursorPosition cpos) const
+{
+    return m_columnOffset + m_textLayout.xToCursor(x, cpos);
+}
+
 bool KateTextLayout::isDirty() const
 {
     if (!isValid()) {
@@ -125,7 +140,7 @@ int KateTextLayout::startCol() const
         return 0;
     }
 
-    return lineLayout().textStart();
+    return m_columnOffset + lineLayout().textStart();
 }
 
 KTextEditor::Cursor KateTextLayout::start() const
@@ -188,8 +203,12 @@ int KateTextLayout::startX() const
 
     if (m_startX == -1) {
         // viewLine is already > 0, from the constructor
-        for (int i = 0; i < viewLine(); ++i) {
-            m_startX += (int)m_lineLayout->layout()->lineAt(i).naturalTextWidth();
+        // for segmented lines, only the view lines of the segment count
+        int columnOffset = 0;
+        int firstViewLine = 0;
+        const QTextLayout *layout = m_lineLayout->segmentLayoutForViewLine(viewLine(), &columnOffset, &firstViewLine);
+        for (int i = firstViewLine; i < viewLine(); ++i) {
+            m_startX += (int)layout->lineAt(i - firstViewLine).naturalTextWidth();
         }
     }
 
@@ -32,9 +32,19 @@ public:
         (KateLineLayout).  */
     int viewLine() const;
 
+    /**
+     * The line of the layout, its text positions are relative to startCol() - lineLayout().textStart()
+     * for lines split into segments. Prefer cursorToX() and xToCursor() with columns of the line.
+     */
     const QTextLine &lineLayout() const;
     KateLineLayout *kateLineLayout() const;
 
+    /**
+     * Like QTextLine::cursorToX and QTextLine::xToCursor, but with columns of the document line.
+     */
+    qreal cursorToX(int column) const;
+    int xToCursor(qreal x, QTextLine::CursorPosition cpos = QTextLine::CursorBetweenCharacters) const;
+
     int startCol() const;
     KTextEditor::Cursor start() const;
 
@@ -86,6 +96,8 @@ private:
     QTextLine m_textLayout;
 
     int m_viewLine;
+    // column the layout of the segment of this view line starts at
+    int m_columnOffset = 0;
     mutable int m_startX;
     bool m_invalidDirty = true;
 };
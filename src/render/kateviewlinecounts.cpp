@@ -0,0 +1,318 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kateviewlinecounts.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * Number of lines a block is filled with, blocks are split once they hold twice as many.
+ */
+static constexpr int BlockSize = 1024;
+
+template<typename T>
+static void treeAdd(std::vector<T> &tree, size_t index, T delta)
+{
+    for (size_t i = index + 1; i < tree.size(); i += i & (~i + 1)) {
+        tree[i] += delta;
+    }
+}
+
+/**
+ * Sum of the first count entries.
+ */
+template<typename T>
+static T treePrefix(const std::vector<T> &tree, size_t count)
+{
+    T sum = 0;
+    for (size_t i = count; i > 0; i -= i & (~i + 1)) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+/**
+ * Entry containing the value, i.e. the largest index with a prefix sum not larger than the value.
+ * @param value filled with the remainder of the value inside of the entry
+ */
+template<typename T>
+static size_t treeFind(const std::vector<T> &tree, T &value)
+{
+    const size_t size = tree.size() - 1;
+    size_t step = 1;
+    while (step * 2 <= size) {
+        step *= 2;
+    }
+
+    size_t index = 0;
+    for (; step > 0; step /= 2) {
+        if (index + step <= size && tree[index + step] <= value) {
+            index += step;
+            value -= tree[index];
+        }
+    }
+    return index;
+}
+
+void KateViewLineCounts::reset(int lines, const Estimate &estimate)
+{
+    m_blocks.clear();
+    m_lines = lines;
+    m_estimatedLines = lines;
+
+    for (int line = 0; line < lines; line += BlockSize) {
+        Block block;
+        const int end = std::min(lines, line + BlockSize);
+        block.counts.reserve(end - line);
+        for (int i = line; i < end; ++i) {
+            const int count = std::max(1, estimate(i));
+            block.counts.push_back(-count);
+            block.viewLines += count;
+        }
+        block.estimatedLines = end - line;
+        m_blocks.push_back(std::move(block));
+    }
+
+    rebalance();
+}
+
+void KateViewLineCounts::markAllEstimated()
+{
+    for (Block &block : m_blocks) {
+        for (int &count : block.counts) {
+            count = -std::abs(count);
+        }
+        block.estimatedLines = block.counts.size();
+    }
+    m_estimatedLines = m_lines;
+}
+
+qint64 KateViewLineCounts::viewLines() const
+{
+    return treePrefix(m_viewLineTree, m_blocks.size());
+}
+
+std::pair<size_t, int> KateViewLineCounts::blockForLine(int line) const
+{
+    if (line >= m_lines) {
+        return {m_blocks.size() - 1, int(m_blocks.back().counts.size())};
+    }
+
+    int index = line;
+    const size_t block = treeFind(m_lineTree, index);
+    return {block, index};
+}
+
+void KateViewLineCounts::insertLines(int line, int count, const Estimate &estimate)
+{
+    if (count <= 0) {
+        return;
+    }
+    if (m_blocks.empty()) {
+        m_blocks.emplace_back();
+        rebalance();
+    }
+
+    const auto [blockIndex, index] = blockForLine(line);
+    Block &block = m_blocks[blockIndex];
+
+    std::vector<int> counts;
+    counts.reserve(count);
+    qint64 addedViewLines = 0;
+    for (int i = 0; i < count; ++i) {
+        const int lineCount = std::max(1, estimate(line + i));
+        counts.push_back(-lineCount);
+        addedViewLines += lineCount;
+    }
+    block.counts.insert(block.counts.begin() + index, counts.begin(), counts.end());
+    block.viewLines += addedViewLines;
+    block.estimatedLines += count;
+    m_lines += count;
+    m_estimatedLines += count;
+
+    if (block.counts.size() > 2 * BlockSize) {
+        rebalance();
+    } else {
+        treeAdd(m_lineTree, blockIndex, count);
+        treeAdd(m_viewLineTree, blockIndex, addedViewLines);
+    }
+}
+
+void KateViewLineCounts::removeLines(int line, int count)
+{
+    count = std::min(count, m_lines - line);
+    bool emptied = false;
+
+    while (count > 0) {
+        const auto [blockIndex, index] = blockForLine(line);
+        Block &block = m_blocks[blockIndex];
+
+        const int removed = std::min<int>(count, block.counts.size() - index);
+        qint64 removedViewLines = 0;
+        int estimatedLines = 0;
+        for (int i = index; i < index + removed; ++i) {
+            removedViewLines += std::abs(block.counts[i]);
+            estimatedLines += block.counts[i] < 0;
+        }
+        block.counts.erase(block.counts.begin() + index, block.counts.begin() + index + removed);
+        block.viewLines -= removedViewLines;
+        block.estimatedLines -= estimatedLines;
+        m_lines -= removed;
+        m_estimatedLines -= estimatedLines;
+        count -= removed;
+
+        treeAdd(m_lineTree, blockIndex, -removed);
+        treeAdd(m_viewLineTree, blockIndex, -removedViewLines);
+        emptied = emptied || block.counts.empty();
+    }
+
+    if (emptied) {
+        rebalance();
+    }
+}
+
+void KateViewLineCounts::setCount(int line, int count, bool exact)
+{
+    if (line < 0 || line >= m_lines) {
+        return;
+    }
+
+    const auto [blockIndex, index] = blockForLine(line);
+    Block &block = m_blocks[blockIndex];
+    int &value = block.counts[index];
+
+    count = std::max(1, count);
+    const qint64 delta = count - std::abs(value);
+    const int estimatedDelta = (exact ? 0 : 1) - (value < 0 ? 1 : 0);
+    value = exact ? count : -count;
+
+    block.estimatedLines += estimatedDelta;
+    m_estimatedLines += estimatedDelta;
+    if (delta != 0) {
+        block.viewLines += delta;
+        treeAdd(m_viewLineTree, blockIndex, delta);
+    }
+}
+
+int KateViewLineCounts::count(int line) const
+{
+    const auto [blockIndex, index] = blockForLine(line);
+    return std::abs(m_blocks[blockIndex].counts[index]);
+}
+
+bool KateViewLineCounts::isExact(int line) const
+{
+    const auto [blockIndex, index] = blockForLine(line);
+    return m_blocks[blockIndex].counts[index] > 0;
+}
+
+int KateViewLineCounts::nextEstimatedLine(int line) const
+{
+    if (m_estimatedLines == 0 || line >= m_lines) {
+        return -1;
+    }
+
+    auto [blockIndex, index] = blockForLine(std::max(0, line));
+    int firstLine = std::max(0, line) - index;
+    for (; blockIndex < m_blocks.size(); ++blockIndex, index = 0) {
+        const Block &block = m_blocks[blockIndex];
+        if (block.estimatedLines > 0) {
+            for (size_t i = index; i < block.counts.size(); ++i) {
+                if (block.counts[i] < 0) {
+                    return firstLine + int(i);
+                }
+            }
+        }
+        firstLine += block.counts.size();
+    }
+    return -1;
+}
+
+qint64 KateViewLineCounts::viewLinesBefore(int line) const
+{
+    if (line <= 0 || m_lines == 0) {
+        return 0;
+    }
+    if (line >= m_lines) {
+        return viewLines();
+    }
+
+    const auto [blockIndex, index] = blockForLine(line);
+    qint64 sum = treePrefix(m_viewLineTree, blockIndex);
+    const Block &block = m_blocks[blockIndex];
+    for (int i = 0; i < index; ++i) {
+        sum += std::abs(block.counts[i]);
+    }
+    return sum;
+}
+
+std::pair<int, int> KateViewLineCounts::lineForViewLine(qint64 viewLine) const
+{
+    if (m_lines == 0 || viewLine <= 0) {
+        return {0, 0};
+    }
+    if (viewLine >= viewLines()) {
+        return {m_lines - 1, count(m_lines - 1) - 1};
+    }
+
+    const size_t blockIndex = treeFind(m_viewLineTree, viewLine);
+    int line = treePrefix(m_lineTree, blockIndex);
+    for (int count : m_blocks[blockIndex].counts) {
+        count = std::abs(count);
+        if (viewLine < count) {
+            break;
+        }
+        viewLine -= count;
+        ++line;
+    }
+    return {line, int(viewLine)};
+}
+
+void KateViewLineCounts::rebalance()
+{
+    std::vector<Block> blocks;
+    blocks.reserve(m_blocks.size() + 1);
+    for (Block &block : m_blocks) {
+        if (block.counts.empty()) {
+            continue;
+        }
+        if (block.counts.size() <= 2 * BlockSize) {
+            blocks.push_back(std::move(block));
+            continue;
+        }
+
+        for (size_t start = 0; start < block.counts.size(); start += BlockSize) {
+            Block part;
+            const size_t end = std::min(block.counts.size(), start + BlockSize);
+            part.counts.assign(block.counts.begin() + start, block.counts.begin() + end);
+            for (int count : part.counts) {
+                part.viewLines += std::abs(count);
+                part.estimatedLines += count < 0;
+            }
+            blocks.push_back(std::move(part));
+        }
+    }
+
+    // an empty document still has one block to insert into
+    if (blocks.empty()) {
+        blocks.emplace_back();
+    }
+    m_blocks = std::move(blocks);
+
+    // build the trees in linear time, each node adds itself to its parent
+    m_lineTree.assign(m_blocks.size() + 1, 0);
+    m_viewLineTree.assign(m_blocks.size() + 1, 0);
+    for (size_t i = 1; i <= m_blocks.size(); ++i) {
+        m_lineTree[i] += m_blocks[i - 1].counts.size();
+        m_viewLineTree[i] += m_blocks[i - 1].viewLines;
+        const size_t parent = i + (i & (~i + 1));
+        if (parent <= m_blocks.size()) {
+            m_lineTree[parent] += m_lineTree[i];
+            m_viewLineTree[parent] += m_viewLineTree[i];
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATEVIEWLINECOUNTS_H
+#define KATEVIEWLINECOUNTS_H
+
+#include <QtGlobal>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * Number of view lines of each line of a document under dynamic word wrap, with prefix sums.
+ *
+ * The exact count of a line is known once the line was laid out, until then an estimate
+ * is used. Lines are kept in blocks and the sums of the blocks in Fenwick trees, mapping
+ * between lines and view lines costs a tree lookup and a scan of one block, inserting or
+ * removing lines only touches one block.
+ */
+class KateViewLineCounts
+{
+public:
+    /**
+     * Estimated view line count of a line, at least 1.
+     */
+    using Estimate = std::function<int(int line)>;
+
+    /**
+     * Start over with estimates for all lines.
+     */
+    void reset(int lines, const Estimate &estimate);
+
+    /**
+     * Keep all counts, but as estimates only, e.g. after the font changed.
+     */
+    void markAllEstimated();
+
+    int lines() const
+    {
+        return m_lines;
+    }
+
+    /**
+     * View lines of all lines.
+     */
+    qint64 viewLines() const;
+
+    /**
+     * Insert lines with estimated counts in front of the given line.
+     */
+    void insertLines(int line, int count, const Estimate &estimate);
+
+    void removeLines(int line, int count);
+
+    /**
+     * Set the count of the line.
+     * @param exact true if the count comes from a layout of the line
+     */
+    void setCount(int line, int count, bool exact);
+
+    int count(int line) const;
+    bool isExact(int line) const;
+
+    /**
+     * Number of lines with an estimated count only.
+     */
+    int estimatedLines() const
+    {
+        return m_estimatedLines;
+    }
+
+    /**
+     * First line at or behind the given one with an estimated count only, -1 if there is none.
+     */
+    int nextEstimatedLine(int line) const;
+
+    /**
+     * View lines of all lines in front of the given one.
+     */
+    qint64 viewLinesBefore(int line) const;
+
+    /**
+     * Line containing the given view line.
+     * @param viewLine view line counted from the start of the document
+     * @return the line and the view line inside of it, clamped to the document
+     */
+    std::pair<int, int> lineForViewLine(qint64 viewLine) const;
+
+private:
+    struct Block {
+        // view line counts, negated for estimates
+        std::vector<int> counts;
+        qint64 viewLines = 0;
+        int estimatedLines = 0;
+    };
+
+    /**
+     * Block containing the line and the index of the line inside of it.
+     * The end of the document belongs to the last block.
+     */
+    std::pair<size_t, int> blockForLine(int line) const;
+
+    /**
+     * Split blocks grown too large and drop empty ones, then rebuild the trees.
+     */
+    void rebalance();
+
+    std::vector<Block> m_blocks;
+
+    // Fenwick trees over the line and view line counts of the blocks
+    std::vector<int> m_lineTree;
+    std::vector<qint64> m_viewLineTree;
+
+    int m_lines = 0;
+    int m_estimatedLines = 0;
+};
+
+#endif
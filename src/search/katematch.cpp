@@ -24,14 +24,19 @@ KTextEditor::Range KateMatch::searchText(KTextEditor::Range range, const QString
     return m_resultRanges[0];
 }
 
-KTextEditor::Range KateMatch::replace(const QString &replacement, bool blockMode, int replacementCounter)
+QString KateMatch::replacementText(const QString &replacement, bool blockMode, int replacementCounter) const
 {
     // Placeholders depending on search mode
     // skip place-holder stuff if we have no \ at all inside the replacement, the buildReplacement is expensive
     const bool usePlaceholders =
         (m_options.testFlag(KTextEditor::Regex) || m_options.testFlag(KTextEditor::EscapeSequences)) && replacement.contains(QLatin1Char('\\'));
 
-    const QString finalReplacement = usePlaceholders ? buildReplacement(replacement, blockMode, replacementCounter) : replacement;
+    return usePlaceholders ? buildReplacement(replacement, blockMode, replacementCounter) : replacement;
+}
+
+KTextEditor::Range KateMatch::replace(const QString &replacement, bool blockMode, int replacementCounter)
+{
+    const QString finalReplacement = replacementText(replacement, blockMode, replacementCounter);
 
     // Track replacement operation, reuse range if already there
     if (m_afterReplaceRange) {
@@ -24,6 +24,13 @@ public:
     KateMatch(KTextEditor::DocumentPrivate *document, KTextEditor::SearchOptions options);
     KTextEditor::Range searchText(KTextEditor::Range range, const QString &pattern);
     KTextEditor::Range replace(const QString &replacement, bool blockMode, int replacementCounter = 1);
+
+    /**
+     * The text replace() would put in place of the current match,
+     * with references and escape sequences resolved.
+     */
+    QString replacementText(const QString &replacement, bool blockMode, int replacementCounter = 1) const;
+
     bool isValid() const;
     bool isEmpty() const;
     KTextEditor::Range range() const;
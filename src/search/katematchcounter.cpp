@@ -0,0 +1,173 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "katematchcounter.h"
+
+#include "katedocument.h"
+#include "katematch.h"
+
+#include <KTextEditor/DocumentCursor>
+
+#include <QElapsedTimer>
+
+/**
+ * Lines counted in one go, a count is remembered per chunk of that many lines.
+ */
+static constexpr int ChunkLines = 1024;
+
+/**
+ * Lines searched behind a chunk, for matches starting in the chunk but spanning some lines.
+ */
+static constexpr int LookaheadLines = 64;
+
+KateMatchCounter::KateMatchCounter(KTextEditor::DocumentPrivate *document, QObject *parent)
+    : QObject(parent)
+    , m_document(document)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &KateMatchCounter::countNextChunks);
+    connect(m_document, &KTextEditor::Document::textChanged, this, &KateMatchCounter::restart);
+}
+
+void KateMatchCounter::start(const QString &pattern, KTextEditor::SearchOptions options)
+{
+    options.setFlag(KTextEditor::Backwards, false);
+    if (pattern == m_pattern && options == m_options) {
+        return;
+    }
+
+    cancel();
+    if (pattern.isEmpty()) {
+        return;
+    }
+
+    m_pattern = pattern;
+    m_options = options;
+    m_next = KTextEditor::Cursor(0, 0);
+    m_timer.start(0);
+}
+
+void KateMatchCounter::cancel()
+{
+    m_timer.stop();
+    m_pattern.clear();
+    m_chunks.clear();
+    m_next = KTextEditor::Cursor::invalid();
+    m_count = 0;
+    m_finished = false;
+    Q_EMIT countChanged();
+}
+
+void KateMatchCounter::restart()
+{
+    if (m_pattern.isEmpty()) {
+        return;
+    }
+
+    // edits tend to come in bursts, don't count after each keystroke
+    m_chunks.clear();
+    m_next = KTextEditor::Cursor(0, 0);
+    m_count = 0;
+    m_finished = false;
+    m_timer.start(250);
+    Q_EMIT countChanged();
+}
+
+int KateMatchCounter::indexOf(KTextEditor::Range match) const
+{
+    if (!match.isValid() || m_pattern.isEmpty()) {
+        return 0;
+    }
+
+    const size_t chunk = match.start().line() / ChunkLines;
+    if (chunk >= m_chunks.size()) {
+        return 0;
+    }
+
+    int before = 0;
+    for (size_t i = 0; i < chunk; ++i) {
+        before += m_chunks[i].count;
+    }
+
+    // count the chunk again up to the match, it must be the next match then
+    const int lastLine = std::min(int(chunk + 1) * ChunkLines, m_document->lines()) - 1;
+    KTextEditor::Cursor next;
+    bool atMatch = false;
+    const int inFront = countMatches(m_chunks[chunk].start, lastLine, match.start(), next, &atMatch);
+    return atMatch ? before + inFront + 1 : 0;
+}
+
+void KateMatchCounter::countNextChunks()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const int lines = m_document->lines();
+    while (m_next.isValid() && timer.elapsed() < 10) {
+        // a match spanning the chunk border lets us start in the middle of the next chunk
+        const int chunk = m_next.line() / ChunkLines;
+        while (int(m_chunks.size()) < chunk) {
+            m_chunks.push_back({m_next, 0});
+        }
+
+        const int lastLine = std::min((chunk + 1) * ChunkLines, lines) - 1;
+        KTextEditor::Cursor next;
+        const int count = countMatches(m_next, lastLine, KTextEditor::Cursor(lines, 0), next);
+        m_chunks.push_back({m_next, count});
+        m_count += count;
+        m_next = next;
+    }
+
+    m_finished = !m_next.isValid();
+    if (!m_finished) {
+        m_timer.start(0);
+    }
+
+    Q_EMIT countChanged();
+}
+
+int KateMatchCounter::countMatches(KTextEditor::Cursor from, int lastLine, KTextEditor::Cursor stopAt, KTextEditor::Cursor &next, bool *atStop) const
+{
+    const int searchEndLine = std::min(lastLine + LookaheadLines, m_document->lines() - 1);
+    const KTextEditor::Cursor searchEnd(searchEndLine, m_document->lineLength(searchEndLine));
+
+    KateMatch match(m_document, m_options);
+    KTextEditor::Cursor pos = from;
+    int count = 0;
+    while (pos < searchEnd) {
+        const KTextEditor::Range found = match.searchText(KTextEditor::Range(pos, searchEnd), m_pattern);
+        if (!found.isValid() || found.start().line() > lastLine) {
+            break;
+        }
+        if (found.start() >= stopAt) {
+            if (atStop) {
+                *atStop = found.start() == stopAt;
+            }
+            break;
+        }
+
+        ++count;
+
+        // continue behind the match like find all does, zero-length matches like ^ or $ need one step more
+        KTextEditor::DocumentCursor behind(m_document, found.end());
+        if (found.isEmpty()) {
+            behind.move(1);
+        }
+        if (behind.atEndOfDocument()) {
+            next = KTextEditor::Cursor::invalid();
+            return count;
+        }
+        pos = behind.toCursor();
+    }
+
+    next = std::max(pos, KTextEditor::Cursor(lastLine + 1, 0));
+    if (next.line() >= m_document->lines()) {
+        next = KTextEditor::Cursor::invalid();
+    }
+    return count;
+}
+
+#include "moc_katematchcounter.cpp"
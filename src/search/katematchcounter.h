@@ -0,0 +1,128 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_MATCHCOUNTER_H
+#define KATE_MATCHCOUNTER_H
+
+#include <QObject>
+#include <QTimer>
+
+#include <ktexteditor/document.h>
+
+#include <vector>
+
+namespace KTextEditor
+{
+class DocumentPrivate;
+}
+
+/**
+ * Counts all matches of a search pattern in a document in the background.
+ *
+ * The document is scanned in chunks of lines, a few milliseconds at a time
+ * from the event loop, so that even huge documents don't block the editor.
+ * Per chunk the number of matches is remembered, this allows to tell the
+ * index of a given match without scanning the document again.
+ * Edits of the document restart the count.
+ */
+class KateMatchCounter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit KateMatchCounter(KTextEditor::DocumentPrivate *document, QObject *parent = nullptr);
+
+    /**
+     * Start counting the matches of the given pattern, a running count is cancelled.
+     * Does nothing if the same pattern with the same options is already counted.
+     * @param pattern search pattern
+     * @param options search options, the direction is ignored
+     */
+    void start(const QString &pattern, KTextEditor::SearchOptions options);
+
+    /**
+     * Stop counting and forget all results.
+     */
+    void cancel();
+
+    /**
+     * Has the whole document been counted?
+     * @return count is complete
+     */
+    bool isFinished() const
+    {
+        return m_finished;
+    }
+
+    /**
+     * Matches counted so far.
+     * @return number of matches
+     */
+    int count() const
+    {
+        return m_count;
+    }
+
+    /**
+     * Tell the position of a match in the document.
+     * @param match range of a match of the counted pattern
+     * @return 1-based index of the match, 0 if the match wasn't counted yet
+     */
+    int indexOf(KTextEditor::Range match) const;
+
+Q_SIGNALS:
+    /**
+     * Emitted whenever count() grew or the count was finished or restarted.
+     */
+    void countChanged();
+
+private:
+    /**
+     * Count the next chunks for a few milliseconds, reschedules itself until done.
+     */
+    void countNextChunks();
+
+    /**
+     * Count the matches starting in [from, end of lastLine] and in front of stopAt.
+     * @param from position to start counting at
+     * @param lastLine last line a counted match may start in
+     * @param stopAt no matches starting at or behind this position are counted
+     * @param next position to continue counting at behind lastLine
+     * @param atStop set to whether counting stopped at a match starting exactly at stopAt
+     * @return number of matches
+     */
+    int countMatches(KTextEditor::Cursor from, int lastLine, KTextEditor::Cursor stopAt, KTextEditor::Cursor &next, bool *atStop = nullptr) const;
+
+    /**
+     * Restart the count after the document changed.
+     */
+    void restart();
+
+private:
+    KTextEditor::DocumentPrivate *const m_document;
+    QString m_pattern;
+    KTextEditor::SearchOptions m_options;
+
+    /**
+     * Where counting did start in each counted chunk and how many matches were found there.
+     */
+    struct Chunk {
+        KTextEditor::Cursor start;
+        int count;
+    };
+    std::vector<Chunk> m_chunks;
+
+    /**
+     * Position to continue counting at.
+     */
+    KTextEditor::Cursor m_next = KTextEditor::Cursor::invalid();
+
+    int m_count = 0;
+    bool m_finished = false;
+    QTimer m_timer;
+};
+
+#endif // KATE_MATCHCOUNTER_H
@@ -8,6 +8,8 @@
 // BEGIN includes
 #include "kateplaintextsearch.h"
 
+#include "katebuffer.h"
+#include "katedocument.h"
 #include "katepartdebug.h"
 #include "kateregexpsearch.h"
 #include <ktexteditor/document.h>
@@ -103,12 +105,23 @@ KTextEditor::Range KatePlainTextSearch::search(const QString &text, KTextEditor:
         const int endLine = inputRange.end().line();
         const int forInc = backwards ? -1 : +1;
 
+        // use the search index of large documents to skip blocks without the needle
+        const auto doc = qobject_cast<const KTextEditor::DocumentPrivate *>(m_document);
+        const std::vector<quint32> trigrams = doc ? doc->buffer().searchIndexTrigrams(text) : std::vector<quint32>();
+
         for (int line = backwards ? endLine : startLine; (startLine <= line) && (line <= endLine); line += forInc) {
             if ((line < 0) || (m_document->lines() <= line)) {
                 qCWarning(LOG_KTE) << "line " << line << " is not within interval [0.." << m_document->lines() << ") ... returning invalid range";
                 return KTextEditor::Range::invalid();
             }
 
+            if (!trigrams.empty()) {
+                line = doc->buffer().searchCandidateLine(line, trigrams, backwards);
+                if ((line < startLine) || (line > endLine)) {
+                    break;
+                }
+            }
+
             const QString textLine = m_document->line(line);
 
             const int offset = (line == startLine) ? startCol : 0;
@@ -8,6 +8,9 @@
 // BEGIN includes
 #include "kateregexpsearch.h"
 
+#include "katebuffer.h"
+#include "katedocument.h"
+
 #include <ktexteditor/document.h>
 // END  includes
 
@@ -163,6 +166,44 @@ struct IndexPair {
     int closeIndex;
 };
 
+/**
+ * Text every match of a simple single-line pattern contains.
+ * Simple patterns consist only of plain or escaped chars and word boundaries,
+ * like the ones whole word plain text search creates.
+ * @return the literal text or a null string for all other patterns
+ */
+static QString literalOfSimplePattern(const QString &pattern, QRegularExpression::PatternOptions options)
+{
+    if (options & QRegularExpression::ExtendedPatternSyntaxOption) {
+        return QString();
+    }
+
+    static const QString metaChars = QStringLiteral("^$.|?*+()[]{}");
+    QString literal;
+    literal.reserve(pattern.size());
+    for (qsizetype i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('\\')) {
+            if (++i == pattern.size()) {
+                return QString();
+            }
+            const QChar escaped = pattern.at(i);
+            if (escaped == QLatin1Char('b')) {
+                continue;
+            }
+            if (escaped.isLetterOrNumber()) {
+                return QString();
+            }
+            literal.append(escaped);
+        } else if (metaChars.contains(c)) {
+            return QString();
+        } else {
+            literal.append(c);
+        }
+    }
+    return literal;
+}
+
 QList<KTextEditor::Range>
 KateRegExpSearch::search(const QString &pattern, KTextEditor::Range inputRange, bool backwards, QRegularExpression::PatternOptions options)
 {
@@ -420,12 +461,24 @@ KateRegExpSearch::search(const QString &pattern, KTextEditor::Range inputRange,
 
         FAST_DEBUG("single line " << (backwards ? rangeEndLine : rangeStartLine) << ".." << (backwards ? rangeStartLine : rangeEndLine));
 
+        // use the search index of large documents to skip blocks without the literal of simple patterns
+        const auto doc = qobject_cast<const KTextEditor::DocumentPrivate *>(m_document);
+        const QString literal = doc && doc->buffer().searchIndexEnabled() ? literalOfSimplePattern(repairedPattern, options) : QString();
+        const std::vector<quint32> trigrams = literal.isEmpty() ? std::vector<quint32>() : doc->buffer().searchIndexTrigrams(literal);
+
         for (int j = forInit; (rangeStartLine <= j) && (j <= rangeEndLine); j += forInc) {
             if (j < 0 || m_document->lines() <= j) {
                 FAST_DEBUG("searchText | line " << j << ": no");
                 return noResult;
             }
 
+            if (!trigrams.empty()) {
+                j = doc->buffer().searchCandidateLine(j, trigrams, backwards);
+                if (j < rangeStartLine || j > rangeEndLine) {
+                    break;
+                }
+            }
+
             const QString textLine = m_document->line(j);
 
             const int offset = (j == rangeStartLine) ? rangeStartCol : 0;
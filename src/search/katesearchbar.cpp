@@ -13,6 +13,7 @@
 #include "katedocument.h"
 #include "kateglobal.h"
 #include "katematch.h"
+#include "katematchcounter.h"
 #include "kateundomanager.h"
 #include "kateview.h"
 
@@ -39,6 +40,7 @@
 #include <QStringListModel>
 #include <QVBoxLayout>
 
+#include <algorithm>
 #include <vector>
 
 // Turn debug messages on/off here
@@ -137,6 +139,7 @@ KateSearchBar::KateSearchBar(bool initAsPower, KTextEditor::ViewPrivate *view, K
     , m_incUi(nullptr)
     , m_incInitCursor(view->cursorPosition())
     , m_powerUi(nullptr)
+    , m_matchCountJob(new KateMatchCounter(view->doc(), this))
     , highlightMatchAttribute(new Attribute())
     , highlightReplacementAttribute(new Attribute())
     , m_incHighlightAll(false)
@@ -150,6 +153,7 @@ KateSearchBar::KateSearchBar(bool initAsPower, KTextEditor::ViewPrivate *view, K
     connect(view, &KTextEditor::View::cursorPositionChanged, this, &KateSearchBar::updateIncInitCursor);
     connect(view, &KTextEditor::View::selectionChanged, this, &KateSearchBar::updateSelectionOnly);
     connect(this, &KateSearchBar::findOrReplaceAllFinished, this, &KateSearchBar::endFindOrReplaceAll);
+    connect(m_matchCountJob, &KateMatchCounter::countChanged, this, &KateSearchBar::updateMatchCountStatus);
 
     auto setSelectionChangedByUndoRedo = [this]() {
         m_selectionChangedByUndoRedo = true;
@@ -240,6 +244,7 @@ void KateSearchBar::closed()
     clearHighlights();
     m_replacement.clear();
     m_unfinishedSearchText.clear();
+    m_matchCountJob->cancel();
 }
 
 void KateSearchBar::setReplacementPattern(const QString &replacementPattern)
@@ -312,17 +317,6 @@ void KateSearchBar::showResultMessage()
     }
 }
 
-void KateSearchBar::highlightMatch(Range range)
-{
-    KTextEditor::MovingRange *const highlight = m_view->doc()->newMovingRange(range, Kate::TextRange::DoNotExpand);
-    highlight->setView(m_view); // show only in this view
-    highlight->setAttributeOnlyForViews(true);
-    // use z depth defined in moving ranges interface
-    highlight->setZDepth(-10000.0);
-    highlight->setAttribute(highlightMatchAttribute);
-    m_hlRanges.append(highlight);
-}
-
 void KateSearchBar::highlightReplacement(Range range)
 {
     KTextEditor::MovingRange *const highlight = m_view->doc()->newMovingRange(range, Kate::TextRange::DoNotExpand);
@@ -339,6 +333,9 @@ void KateSearchBar::indicateMatch(MatchResult matchResult)
     QLineEdit *const lineEdit = isPower() ? m_powerUi->pattern->lineEdit() : m_incUi->pattern->lineEdit();
     QPalette background(lineEdit->palette());
 
+    // wrap and mismatch hints take precedence over the match count
+    m_showMatchCount = (matchResult == MatchFound);
+
     switch (matchResult) {
     case MatchFound: // FALLTHROUGH
     case MatchWrappedForward:
@@ -386,11 +383,32 @@ void KateSearchBar::indicateMatch(MatchResult matchResult)
             break;
         }
         m_incUi->status->setPalette(foreground);
+        updateMatchCountStatus();
     }
 
     lineEdit->setPalette(background);
 }
 
+void KateSearchBar::updateMatchCountStatus()
+{
+    if (!m_incUi || !m_showMatchCount) {
+        return;
+    }
+
+    const int index = m_view->selection() ? m_matchCountJob->indexOf(m_view->selectionRange()) : 0;
+    const int count = m_matchCountJob->count();
+
+    QString text;
+    if (m_matchCountJob->isFinished()) {
+        text = index > 0 ? i18nc("short translation", "Match %1 of %2", index, count) : i18ncp("short translation", "1 match", "%1 matches", count);
+    } else if (count > 0) {
+        // still counting
+        text = index > 0 ? i18nc("short translation, more matches might follow", "Match %1 of %2+", index, count)
+                         : i18nc("short translation, more matches might follow", "%1+ matches", count);
+    }
+    m_incUi->status->setText(text);
+}
+
 /*static*/ void KateSearchBar::selectRange(KTextEditor::ViewPrivate *view, KTextEditor::Range range)
 {
     view->setCursorPositionInternal(range.end());
@@ -441,6 +459,9 @@ void KateSearchBar::onIncPatternChanged(const QString &pattern)
     selectRange2(selectionRange);
     connect(m_view, &KTextEditor::View::cursorPositionChanged, this, &KateSearchBar::updateIncInitCursor);
 
+    // count all matches in the background, restarts for a changed pattern
+    m_matchCountJob->start(pattern, searchOptions());
+
     indicateMatch(matchResult);
 }
 
@@ -640,6 +661,9 @@ bool KateSearchBar::findOrReplace(SearchDirection searchDirection, const QString
         : !wrap                                      ? MatchFound
         : searchDirection == SearchForward           ? MatchWrappedForward
                                                      : MatchWrappedBackward;
+    if (m_incUi) {
+        m_matchCountJob->start(searchPattern(), enabledOptions);
+    }
     indicateMatch(matchResult);
 
     // highlight replacements if applicable
@@ -802,10 +826,6 @@ void KateSearchBar::findOrReplaceAll()
 {
     const SearchOptions enabledOptions = searchOptions(SearchForward);
 
-    // we highlight all ranges of a replace, up to some hard limit
-    // e.g. if you replace 100000 things, rendering will break down otherwise ;=)
-    const int maxHighlightings = 65536;
-
     // reuse match object to avoid massive moving range creation
     KateMatch match(m_view->doc(), enabledOptions);
 
@@ -822,6 +842,38 @@ void KateSearchBar::findOrReplaceAll()
     int numLinesSearched = 0;
     // Use a simple range in the loop to avoid needless work
     KTextEditor::Range workingRangeCopy = m_workingRange->toRange();
+
+    // Single line replacements are not applied match by match, we collect them per line
+    // and let the document rewrite the line once, see DocumentPrivate::replaceTextOnLine.
+    // Until flushed, all ranges below are in coordinates of the unmodified line.
+    QList<Range> pendingRanges;
+    QStringList pendingReplacements;
+    auto rememberRange = [this](Range range) {
+        // we highlight all ranges, the view stores them compactly, see Kate::TextHighlightStore
+        m_highlightRanges.push_back(range);
+    };
+    auto flushPendingReplacements = [&]() {
+        if (pendingRanges.isEmpty()) {
+            return;
+        }
+
+        const int pendingLine = pendingRanges.first().start().line();
+        const QList<Range> replacedRanges = m_view->doc()->replaceTextOnLine(pendingLine, pendingRanges, pendingReplacements);
+        for (const Range &r : replacedRanges) {
+            rememberRange(r);
+        }
+        const int delta = replacedRanges.isEmpty() ? 0 : replacedRanges.last().end().column() - pendingRanges.last().end().column();
+
+        // working range borders behind the last match move with the text
+        auto shifted = [pendingLine, delta](Cursor c) {
+            return c.line() == pendingLine ? Cursor(c.line(), c.column() + delta) : c;
+        };
+        workingRangeCopy.setRange(shifted(workingRangeCopy.start()), shifted(workingRangeCopy.end()));
+
+        pendingRanges.clear();
+        pendingReplacements.clear();
+    };
+
     do {
         if (block) {
             delete m_workingRange; // Never forget that!
@@ -845,21 +897,39 @@ void KateSearchBar::findOrReplaceAll()
                     static_cast<KTextEditor::DocumentPrivate *>(m_view->document())->editStart();
                 }
 
-                // Replace
-                lastRange = match.replace(m_replacement, false, ++m_matchCounter);
-                // update working range as text must have changed now
-                workingRangeCopy = m_workingRange->toRange();
+                // matches on an other line: apply what we collected so far, this doesn't change line numbers
+                if (!pendingRanges.isEmpty() && pendingRanges.first().start().line() != match.range().start().line()) {
+                    flushPendingReplacements();
+                }
+
+                const QString replacement = match.replacementText(m_replacement, false, ++m_matchCounter);
+                if (match.range().onSingleLine() && !replacement.contains(QLatin1Char('\n'))) {
+                    // Defer the replacement, continue searching in the unmodified text
+                    lastRange = match.range();
+                    pendingRanges.push_back(lastRange);
+                    pendingReplacements.push_back(replacement);
+                } else {
+                    // Multi-line match or replacement, the line structure changes, replace right now.
+                    // Pending replacements in front of the match shift its columns, search it again afterwards.
+                    if (!pendingRanges.isEmpty()) {
+                        flushPendingReplacements();
+                        match.searchText(workingRangeCopy, searchPattern());
+                        if (!match.isValid()) {
+                            done = true;
+                            break;
+                        }
+                    }
+
+                    lastRange = match.replace(m_replacement, false, m_matchCounter);
+                    rememberRange(lastRange);
+
+                    // update working range as text must have changed now
+                    workingRangeCopy = m_workingRange->toRange();
+                }
             } else {
                 lastRange = match.range();
                 ++m_matchCounter;
-            }
-
-            // remember ranges if limit not reached
-            if (m_matchCounter < maxHighlightings) {
-                m_highlightRanges.push_back(lastRange);
-            } else {
-                m_highlightRanges.clear();
-                // TODO Info user that highlighting is disabled
+                rememberRange(lastRange);
             }
 
             // Continue after match
@@ -890,6 +960,9 @@ void KateSearchBar::findOrReplaceAll()
 
         } while (!m_cancelFindOrReplace && !timeOut);
 
+        // apply collected replacements before we leave this line or give control back to the event loop
+        flushPendingReplacements();
+
     } while (!m_cancelFindOrReplace && !timeOut && block && ++line <= m_inputRange.end().line());
 
     // update m_workingRange
@@ -925,20 +998,19 @@ void KateSearchBar::endFindOrReplaceAll()
         }
     }
 
-    // Add highlights
+    // Add highlights, no moving range per match, there might be millions of them
+    std::stable_sort(m_highlightRanges.begin(), m_highlightRanges.end(), [](const Range &a, const Range &b) {
+        return a.start() < b.start();
+    });
+    m_view->searchHighlights().setRanges(m_highlightRanges, m_replaceMode ? highlightReplacementAttribute : highlightMatchAttribute, -10000.0);
+    if (!m_highlightRanges.empty()) {
+        m_view->notifyAboutRangeChange(KTextEditor::LineRange(m_highlightRanges.front().start().line(), m_highlightRanges.back().end().line()), true);
+    }
     if (m_replaceMode) {
-        for (const Range &r : std::as_const(m_highlightRanges)) {
-            highlightReplacement(r);
-        }
         // Never merge replace actions with other replace actions/user actions
         m_view->doc()->undoManager()->undoSafePoint();
-
-    } else {
-        for (const Range &r : std::as_const(m_highlightRanges)) {
-            highlightMatch(r);
-        }
-        //         indicateMatch(m_matchCounter > 0 ? MatchFound : MatchMismatch); TODO
     }
+    //         indicateMatch(m_matchCounter > 0 ? MatchFound : MatchMismatch); TODO
 
     // Clean-Up the still hold MovingRange
     delete m_workingRange;
@@ -1319,6 +1391,9 @@ void KateSearchBar::nextMatchForSelection(KTextEditor::ViewPrivate *view, Search
 
 void KateSearchBar::enterPowerMode()
 {
+    // only the incremental bar shows the match count
+    m_matchCountJob->cancel();
+
     QString initialPattern;
     bool selectionOnly = false;
 
@@ -1631,9 +1706,13 @@ bool KateSearchBar::clearHighlights()
         delete m_infoMessage;
     }
 
-    if (m_hlRanges.isEmpty()) {
+    if (!m_view->searchHighlights().isEmpty()) {
+        m_view->searchHighlights().clear();
+        m_view->notifyAboutRangeChange(KTextEditor::LineRange(0, m_view->document()->lines() - 1), true);
+    } else if (m_hlRanges.isEmpty()) {
         return false;
     }
+
     qDeleteAll(m_hlRanges);
     m_hlRanges.clear();
     return true;
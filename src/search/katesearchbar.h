@@ -19,6 +19,7 @@ namespace KTextEditor
 class ViewPrivate;
 }
 class KateViewConfig;
+class KateMatchCounter;
 class QVBoxLayout;
 class QComboBox;
 
@@ -127,6 +128,11 @@ private Q_SLOTS:
     void onPowerReplacmentContextMenuRequest(const QPoint &);
     void onPowerCancelFindOrReplace();
 
+    /**
+     * Show the progress of the background match count in the status of the incremental bar.
+     */
+    void updateMatchCountStatus();
+
     /**
      * This function do the hard search & replace work in time slice steps.
      * When all is done @ref m_matchCounter is set and the signal
@@ -173,8 +179,6 @@ private:
     KTEXTEDITOR_NO_EXPORT
     KTextEditor::SearchOptions searchOptions(SearchDirection searchDirection = SearchForward) const;
 
-    KTEXTEDITOR_NO_EXPORT
-    void highlightMatch(KTextEditor::Range range);
     KTEXTEDITOR_NO_EXPORT
     void highlightReplacement(KTextEditor::Range range);
     KTEXTEDITOR_NO_EXPORT
@@ -227,6 +231,10 @@ private:
     bool m_selectionChangedByUndoRedo = false;
     std::vector<KTextEditor::Range> m_highlightRanges;
 
+    // total match count of the incremental search, computed in the background
+    KateMatchCounter *const m_matchCountJob;
+    bool m_showMatchCount = false;
+
     // attribute to highlight matches with
     KTextEditor::Attribute::Ptr highlightMatchAttribute;
     KTextEditor::Attribute::Ptr highlightReplacementAttribute;
@@ -14,6 +14,7 @@
 #include "kateswapdiffcreator.h"
 #include "kateswapfile.h"
 #include "katetextbuffer.h"
+#include "katetextchangebatch.h"
 #include "kateundomanager.h"
 #include "ktexteditor/message.h"
 #include <ktexteditor/view.h>
@@ -25,6 +26,10 @@
 #include <QCryptographicHash>
 #include <QDir>
 #include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <iterator>
 
 #ifndef Q_OS_WIN
 #include <unistd.h>
@@ -40,6 +45,13 @@ const static qint8 EA_WrapLine = 'W';
 const static qint8 EA_UnwrapLine = 'U';
 const static qint8 EA_InsertText = 'I';
 const static qint8 EA_RemoveText = 'R';
+const static qint8 EA_Checkpoint = 'C';
+
+// actions after which the log is replaced by a snapshot of the text, at least one for each line
+const static int CheckpointActions = 10000;
+
+// changes of lines replayed at once when recovering
+const static size_t RecoverBatchSize = 4096;
 
 namespace Kate
 {
@@ -55,6 +67,8 @@ SwapFile::SwapFile(KTextEditor::DocumentPrivate *document)
     // fixed version of serialisation
     m_stream.setVersion(QDataStream::Qt_4_6);
 
+    m_writer.setMaxThreadCount(1);
+
     // connect the timer
     connect(syncTimer(), &QTimer::timeout, this, &Kate::SwapFile::writeFileToDisk, Qt::DirectConnection);
 
@@ -69,6 +83,9 @@ SwapFile::SwapFile(KTextEditor::DocumentPrivate *document)
 
 SwapFile::~SwapFile()
 {
+    // whatever was handed over is written
+    m_writer.waitForDone();
+
     // only remove swap file after data recovery (bug #304576)
     if (!shouldRecover()) {
         removeSwapFile();
@@ -121,6 +138,11 @@ void SwapFile::fileClosed()
     updateFileName();
 }
 
+void SwapFile::flush()
+{
+    m_writer.waitForDone();
+}
+
 KTextEditor::DocumentPrivate *SwapFile::document()
 {
     return m_document;
@@ -202,7 +224,7 @@ void SwapFile::recover()
     // Example: The document was falsely marked as writable and the user changed
     // text even though the recover bar was visible. In this case, a replay of
     // the swap file across wrong document content would happen -> certainly wrong
-    if (m_swapfile.isOpen()) {
+    if (m_journalOpen) {
         qCWarning(LOG_KTE) << "Attempt to recover an already modified document. Aborting";
         removeSwapFile();
         return;
@@ -247,10 +269,26 @@ bool SwapFile::recover(QDataStream &stream, bool checkDigest)
     // disconnect current signals
     setTrackingEnabled(false);
 
-    // needed to set undo/redo cursors in a sane way
-    bool firstEditInGroup = false;
+    // replay all transactions as one, this is a single undo group and views and highlighting
+    // are updated once, the changes of lines are done in batches
+    m_document->editStart();
+    KateTextChangeBatch batch(m_document);
+    auto addToBatch = [&batch](int line, int column, int removedLength, const QString &text) {
+        if (batch.size() >= RecoverBatchSize || !batch.add(line, column, removedLength, text)) {
+            batch.apply();
+            batch.add(line, column, removedLength, text);
+        }
+    };
+
+    // the undo cursor of the first change and the redo cursor of the last one
     KTextEditor::Cursor undoCursor = KTextEditor::Cursor::invalid();
     KTextEditor::Cursor redoCursor = KTextEditor::Cursor::invalid();
+    auto trackCursors = [&undoCursor, &redoCursor](const KTextEditor::Cursor undo, const KTextEditor::Cursor redo) {
+        if (!undoCursor.isValid()) {
+            undoCursor = undo;
+        }
+        redoCursor = redo;
+    };
 
     // replay swapfile
     bool editRunning = false;
@@ -264,23 +302,10 @@ bool SwapFile::recover(QDataStream &stream, bool checkDigest)
         stream >> type;
         switch (type) {
         case EA_StartEditing: {
-            m_document->editStart();
             editRunning = true;
-            firstEditInGroup = true;
-            undoCursor = KTextEditor::Cursor::invalid();
-            redoCursor = KTextEditor::Cursor::invalid();
             break;
         }
         case EA_FinishEditing: {
-            m_document->editEnd();
-
-            // empty editStart() / editEnd() groups exist: only set cursor if required
-            if (!firstEditInGroup) {
-                // set undo/redo cursor of last KateUndoGroup of the undo manager
-                m_document->undoManager()->setUndoRedoCursorsOfLastGroup(undoCursor, redoCursor);
-                m_document->undoManager()->undoSafePoint();
-            }
-            firstEditInGroup = false;
             editRunning = false;
             break;
         }
@@ -295,14 +320,9 @@ bool SwapFile::recover(QDataStream &stream, bool checkDigest)
             stream >> line >> column;
 
             // emulate buffer unwrapLine with document
+            batch.apply();
             m_document->editWrapLine(line, column, true);
-
-            // track undo/redo cursor
-            if (firstEditInGroup) {
-                firstEditInGroup = false;
-                undoCursor = KTextEditor::Cursor(line, column);
-            }
-            redoCursor = KTextEditor::Cursor(line + 1, 0);
+            trackCursors(KTextEditor::Cursor(line, column), KTextEditor::Cursor(line + 1, 0));
 
             break;
         }
@@ -318,17 +338,12 @@ bool SwapFile::recover(QDataStream &stream, bool checkDigest)
             // assert valid line
             Q_ASSERT(line > 0);
 
+            batch.apply();
             const int undoColumn = m_document->lineLength(line - 1);
 
             // emulate buffer unwrapLine with document
             m_document->editUnWrapLine(line - 1, true, 0);
-
-            // track undo/redo cursor
-            if (firstEditInGroup) {
-                firstEditInGroup = false;
-                undoCursor = KTextEditor::Cursor(line, 0);
-            }
-            redoCursor = KTextEditor::Cursor(line - 1, undoColumn);
+            trackCursors(KTextEditor::Cursor(line, 0), KTextEditor::Cursor(line - 1, undoColumn));
 
             break;
         }
@@ -342,15 +357,24 @@ bool SwapFile::recover(QDataStream &stream, bool checkDigest)
             int column;
             QByteArray text;
             stream >> line >> column >> text;
-            m_document->insertText(KTextEditor::Cursor(line, column), QString::fromUtf8(text.data(), text.size()));
+            const QString insertedText = QString::fromUtf8(text.data(), text.size());
+            addToBatch(line, column, 0, insertedText);
+            trackCursors(KTextEditor::Cursor(line, column), KTextEditor::Cursor(line, column + insertedText.size()));
 
-            // track undo/redo cursor
-            if (firstEditInGroup) {
-                firstEditInGroup = false;
-                undoCursor = KTextEditor::Cursor(line, column);
+            break;
+        }
+        case EA_Checkpoint: {
+            if (editRunning) {
+                brokenSwapFile = true;
+                break;
             }
-            redoCursor = KTextEditor::Cursor(line, column + text.size());
 
+            // the text when the checkpoint was taken, the log before it is gone
+            QByteArray text;
+            stream >> text;
+            batch.apply();
+            m_document->setText(QString::fromUtf8(qUncompress(text)));
+            trackCursors(KTextEditor::Cursor::start(), m_document->documentEnd());
             break;
         }
         case EA_RemoveText: {
@@ -363,14 +387,8 @@ bool SwapFile::recover(QDataStream &stream, bool checkDigest)
             int startColumn;
             int endColumn;
             stream >> line >> startColumn >> endColumn;
-            m_document->removeText(KTextEditor::Range(KTextEditor::Cursor(line, startColumn), KTextEditor::Cursor(line, endColumn)));
-
-            // track undo/redo cursor
-            if (firstEditInGroup) {
-                firstEditInGroup = false;
-                undoCursor = KTextEditor::Cursor(line, endColumn);
-            }
-            redoCursor = KTextEditor::Cursor(line, startColumn);
+            addToBatch(line, startColumn, endColumn - startColumn, QString());
+            trackCursors(KTextEditor::Cursor(line, endColumn), KTextEditor::Cursor(line, startColumn));
 
             break;
         }
@@ -380,10 +398,19 @@ bool SwapFile::recover(QDataStream &stream, bool checkDigest)
         }
     }
 
+    batch.apply();
+    m_document->editEnd();
+
+    // empty editStart() / editEnd() groups exist: only set cursor if required
+    if (undoCursor.isValid()) {
+        // set undo/redo cursor of last KateUndoGroup of the undo manager
+        m_document->undoManager()->setUndoRedoCursorsOfLastGroup(undoCursor, redoCursor);
+        m_document->undoManager()->undoSafePoint();
+    }
+
     // balanced editStart and editEnd?
     if (editRunning) {
         brokenSwapFile = true;
-        m_document->editEnd();
     }
 
     // warn the user if the swap file is not complete
@@ -425,36 +452,41 @@ void SwapFile::startEditing()
     // if swap file doesn't exists, open it in WriteOnly mode
     // if it does, append the data to the existing swap file,
     // in case you recover and start editing again
-    if (!m_swapfile.exists()) {
+    if (!m_journalOpen && !m_swapfile.exists()) {
         // create path if not there
         if (KateDocumentConfig::global()->swapFileMode() == KateDocumentConfig::SwapFilePresetDirectory
             && !QDir(KateDocumentConfig::global()->swapDirectory()).exists()) {
             QDir().mkpath(KateDocumentConfig::global()->swapDirectory());
         }
 
-        m_swapfile.open(QIODevice::WriteOnly);
+        m_journalOpen = m_swapfile.open(QIODevice::WriteOnly);
         m_swapfile.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
         m_stream.setDevice(&m_swapfile);
-
-        // write file header
-        m_stream << QByteArray(swapFileVersionString);
-
-        // write checksum
-        m_stream << m_document->checksum();
+        m_checksum = m_document->checksum();
+        m_actionsSinceCheckpoint = 0;
+
+        // write file header and checksum, before anything else the writer gets
+        m_writer.start([this]() {
+            m_stream << QByteArray(swapFileVersionString);
+            m_stream << m_checksum;
+        });
     } else if (m_stream.device() == nullptr) {
-        m_swapfile.open(QIODevice::Append);
+        m_journalOpen = m_swapfile.open(QIODevice::Append);
         m_swapfile.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
         m_stream.setDevice(&m_swapfile);
+        m_checksum = m_document->checksum();
     }
 
     // format: qint8
-    m_stream << EA_StartEditing;
+    if (m_journalOpen) {
+        m_actions.push_back({EA_StartEditing});
+    }
 }
 
 void SwapFile::finishEditing()
 {
     // skip if not open
-    if (!m_swapfile.isOpen()) {
+    if (!m_journalOpen) {
         return;
     }
 
@@ -466,19 +498,138 @@ void SwapFile::finishEditing()
     }
 
     // format: qint8
-    m_stream << EA_FinishEditing;
+    m_actions.push_back({EA_FinishEditing});
+
+    // bound the time to recover, once replaying the log takes longer than loading the text
+    m_actionsSinceCheckpoint += m_actions.size();
+    if (m_actionsSinceCheckpoint >= std::max(CheckpointActions, m_document->lines())) {
+        takeCheckpoint();
+    }
+
+    queueActions();
+}
+
+void SwapFile::takeCheckpoint()
+{
+    // the lines are shared, the writer converts and compresses them
+    QStringList lines;
+    lines.reserve(m_document->lines());
+    for (int line = 0; line < m_document->lines(); ++line) {
+        lines.push_back(m_document->line(line));
+    }
+
+    m_actions.push_back({EA_Checkpoint});
+    m_checkpoints.push_back(std::move(lines));
+    m_actionsSinceCheckpoint = 0;
+}
+
+bool SwapFile::writeCheckpoint(const QStringList &lines)
+{
+    // write a new swap file and replace the old one once complete, after a crash one of them is there
+    QSaveFile file(m_swapfile.fileName());
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    // format: header, checksum, qint8, bytearray
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << QByteArray(swapFileVersionString) << m_checksum;
+    stream << EA_Checkpoint << qCompress(lines.join(QLatin1Char('\n')).toUtf8());
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        qCWarning(LOG_KTE) << "Can't write swap file checkpoint:" << file.errorString();
+        return false;
+    }
+
+    // continue the log in the new file
+    m_swapfile.close();
+    if (!m_swapfile.open(QIODevice::Append)) {
+        qCWarning(LOG_KTE) << "Can't open swap file after checkpoint:" << m_swapfile.errorString();
+    }
+    return true;
+}
+
+void SwapFile::queueActions()
+{
+    QMutexLocker lock(&m_pendingMutex);
+    if (m_pendingActions.empty()) {
+        m_pendingActions.swap(m_actions);
+    } else {
+        std::move(m_actions.begin(), m_actions.end(), std::back_inserter(m_pendingActions));
+        m_actions.clear();
+    }
+    std::move(m_checkpoints.begin(), m_checkpoints.end(), std::back_inserter(m_pendingCheckpoints));
+    m_checkpoints.clear();
+
+    // a writer not started yet takes these, too
+    if (!m_writeQueued) {
+        m_writeQueued = true;
+        m_writer.start([this]() {
+            writeActions();
+        });
+    }
+}
+
+void SwapFile::writeActions()
+{
+    std::vector<EditAction> actions;
+    std::vector<QStringList> checkpoints;
+    {
+        QMutexLocker lock(&m_pendingMutex);
+        actions.swap(m_pendingActions);
+        checkpoints.swap(m_pendingCheckpoints);
+        m_writeQueued = false;
+    }
+
+    // all actions in front of the last checkpoint are part of its snapshot
+    auto first = actions.begin();
+    if (!checkpoints.empty() && writeCheckpoint(checkpoints.back())) {
+        first = std::find_if(actions.rbegin(), actions.rend(), [](const EditAction &action) {
+                    return action.type == EA_Checkpoint;
+                }).base();
+    }
+
+    for (auto it = first; it != actions.end(); ++it) {
+        const EditAction &action = *it;
+        if (action.type == EA_Checkpoint) {
+            continue;
+        }
+
+        m_stream << action.type;
+        switch (action.type) {
+        case EA_WrapLine:
+            // format: qint8, int, int
+            m_stream << action.line << action.column;
+            break;
+        case EA_UnwrapLine:
+            // format: qint8, int
+            m_stream << action.line;
+            break;
+        case EA_InsertText:
+            // format: qint8, int, int, bytearray
+            m_stream << action.line << action.column << action.text.toUtf8();
+            break;
+        case EA_RemoveText:
+            // format: qint8, int, int, int
+            m_stream << action.line << action.column << action.endColumn;
+            break;
+        default:
+            // format: qint8
+            break;
+        }
+    }
     m_swapfile.flush();
 }
 
 void SwapFile::wrapLine(KTextEditor::Document *, const KTextEditor::Cursor position)
 {
     // skip if not open
-    if (!m_swapfile.isOpen()) {
+    if (!m_journalOpen) {
         return;
     }
 
-    // format: qint8, int, int
-    m_stream << EA_WrapLine << position.line() << position.column();
+    m_actions.push_back({EA_WrapLine, position.line(), position.column()});
 
     m_needSync = true;
 }
@@ -486,12 +637,11 @@ void SwapFile::wrapLine(KTextEditor::Document *, const KTextEditor::Cursor posit
 void SwapFile::unwrapLine(KTextEditor::Document *, int line)
 {
     // skip if not open
-    if (!m_swapfile.isOpen()) {
+    if (!m_journalOpen) {
         return;
     }
 
-    // format: qint8, int
-    m_stream << EA_UnwrapLine << line;
+    m_actions.push_back({EA_UnwrapLine, line});
 
     m_needSync = true;
 }
@@ -499,12 +649,11 @@ void SwapFile::unwrapLine(KTextEditor::Document *, int line)
 void SwapFile::insertText(KTextEditor::Document *, const KTextEditor::Cursor position, const QString &text)
 {
     // skip if not open
-    if (!m_swapfile.isOpen()) {
+    if (!m_journalOpen) {
         return;
     }
 
-    // format: qint8, int, int, bytearray
-    m_stream << EA_InsertText << position.line() << position.column() << text.toUtf8();
+    m_actions.push_back({EA_InsertText, position.line(), position.column(), 0, text});
 
     m_needSync = true;
 }
@@ -512,13 +661,12 @@ void SwapFile::insertText(KTextEditor::Document *, const KTextEditor::Cursor pos
 void SwapFile::removeText(KTextEditor::Document *, KTextEditor::Range range, const QString &)
 {
     // skip if not open
-    if (!m_swapfile.isOpen()) {
+    if (!m_journalOpen) {
         return;
     }
 
-    // format: qint8, int, int, int
     Q_ASSERT(range.start().line() == range.end().line());
-    m_stream << EA_RemoveText << range.start().line() << range.start().column() << range.end().column();
+    m_actions.push_back({EA_RemoveText, range.start().line(), range.start().column(), range.end().column()});
 
     m_needSync = true;
 }
@@ -530,7 +678,13 @@ bool SwapFile::shouldRecover() const
         return false;
     }
 
-    return !m_swapfile.fileName().isEmpty() && m_swapfile.exists() && m_stream.device() == nullptr;
+    // nothing to recover while we write the journal ourselves, check this first:
+    // while the journal is open, the writer thread uses m_swapfile, don't touch it here
+    if (m_stream.device() != nullptr) {
+        return false;
+    }
+
+    return !m_swapfile.fileName().isEmpty() && m_swapfile.exists();
 }
 
 void SwapFile::discard()
@@ -547,6 +701,15 @@ void SwapFile::discard()
 
 void SwapFile::removeSwapFile()
 {
+    // let the writer finish before the file is gone
+    m_writer.waitForDone();
+    m_actions.clear();
+    m_pendingActions.clear();
+    m_checkpoints.clear();
+    m_pendingCheckpoints.clear();
+    m_journalOpen = false;
+    m_needSync = false;
+
     if (!m_swapfile.fileName().isEmpty() && m_swapfile.exists()) {
         m_stream.setDevice(nullptr);
         m_swapfile.close();
@@ -610,16 +773,19 @@ QTimer *SwapFile::syncTimer()
 
 void SwapFile::writeFileToDisk()
 {
-    if (m_needSync) {
+    // the shared timer might fire after the swap file was removed or closed, nothing to sync then
+    if (m_needSync && m_journalOpen) {
         m_needSync = false;
 
 #ifndef Q_OS_WIN
-        // ensure that the file is written to disk
+        // ensure that the file is written to disk, after all handed to the writer so far
+        m_writer.start([this]() {
 #if HAVE_FDATASYNC
-        fdatasync(m_swapfile.handle());
+            fdatasync(m_swapfile.handle());
 #else
-        fsync(m_swapfile.handle());
+            fsync(m_swapfile.handle());
 #endif
+        });
 #endif
     }
 }
@@ -10,8 +10,14 @@
 
 #include <QDataStream>
 #include <QFile>
+#include <QMutex>
 #include <QObject>
 #include <QPointer>
+#include <QThreadPool>
+
+#include <ktexteditor_export.h>
+
+#include <vector>
 
 class QTimer;
 namespace KTextEditor
@@ -30,6 +36,14 @@ namespace Kate
  * Class for tracking editing actions.
  * In case Kate crashes, this can be used to replay all edit actions to
  * recover the lost data.
+ *
+ * The actions of an editing transaction are collected in memory and handed
+ * to a writer thread once it is finished. The writer appends all transactions
+ * handed over since its last run at once and syncs the file to the disk in the
+ * configured interval, so a slow disk doesn't stall editing.
+ *
+ * Once replaying the log would take longer than loading the text, the log is
+ * replaced by a checkpoint, a compressed snapshot of the text.
  */
 class SwapFile : public QObject
 {
@@ -39,7 +53,12 @@ public:
     bool shouldRecover() const;
 
     void fileClosed();
-    QString fileName();
+    KTEXTEDITOR_EXPORT QString fileName();
+
+    /**
+     * Wait until the writer thread wrote all finished transactions.
+     */
+    KTEXTEDITOR_EXPORT void flush();
 
     KTextEditor::DocumentPrivate *document();
 
@@ -69,16 +88,64 @@ protected:
 public:
     void discard();
     void recover();
-    bool recover(QDataStream &, bool checkDigest = true);
+    KTEXTEDITOR_EXPORT bool recover(QDataStream &, bool checkDigest = true);
     void configChanged();
 
 private:
+    /**
+     * One editing action, the text is converted on the writer thread.
+     */
+    struct EditAction {
+        qint8 type;
+        int line = 0;
+        int column = 0;
+        int endColumn = 0;
+        QString text;
+    };
+
+    /**
+     * Hand the actions of the finished transaction to the writer thread.
+     */
+    void queueActions();
+
+    /**
+     * Append all actions handed over so far to the file, runs on the writer thread.
+     */
+    void writeActions();
+
+    /**
+     * Snapshot the text after the running transaction for a checkpoint.
+     */
+    void takeCheckpoint();
+
+    /**
+     * Replace the swap file by one starting with the checkpoint, runs on the writer thread.
+     * @return success, the old file is kept otherwise
+     */
+    bool writeCheckpoint(const QStringList &lines);
+
+    // used by the writer thread while tracking
     QDataStream m_stream;
     QFile m_swapfile;
     bool m_recovered;
     bool m_needSync;
     static QTimer *s_timer;
 
+    // actions of the running transaction
+    std::vector<EditAction> m_actions;
+    std::vector<QStringList> m_checkpoints;
+    // the swap file is open and actions are tracked
+    bool m_journalOpen = false;
+    // checksum of the header, for checkpoints
+    QByteArray m_checksum;
+    int m_actionsSinceCheckpoint = 0;
+
+    // actions handed to the writer thread and not written yet
+    QMutex m_pendingMutex;
+    std::vector<EditAction> m_pendingActions;
+    std::vector<QStringList> m_pendingCheckpoints;
+    bool m_writeQueued = false;
+
 protected:
     void writeFileToDisk();
 
@@ -91,6 +158,9 @@ public:
 
 private:
     QPointer<KTextEditor::Message> m_swapMessage;
+
+    // one writer, the file is written in order, last member, gone before the file
+    QThreadPool m_writer;
 };
 }
 
@@ -13,12 +13,18 @@
 
 #include "katebuffer.h"
 #include "katedocument.h"
+#include "katepartdebug.h"
+#include "katetextchangebatch.h"
 #include "kateundomanager.h"
 #include "kateview.h"
 
 #include <ktexteditor/cursor.h>
 #include <ktexteditor/view.h>
 
+#include <QDataStream>
+
+#include <algorithm>
+
 KateUndoGroup::KateUndoGroup(const KTextEditor::Cursor cursorPosition,
                              KTextEditor::Range selection,
                              const QList<KTextEditor::ViewPrivate::PlainSecondaryCursor> &secondary)
@@ -30,6 +36,9 @@ KateUndoGroup::KateUndoGroup(const KTextEditor::Cursor cursorPosition,
 {
 }
 
+// groups with that many items, e.g. of a replace all or a reindent, change the text in batches
+static constexpr size_t BulkItems = 64;
+
 void KateUndoGroup::undo(KateUndoManager *manager, KTextEditor::ViewPrivate *view)
 {
     if (m_items.empty()) {
@@ -46,15 +55,39 @@ void KateUndoGroup::undo(KateUndoManager *manager, KTextEditor::ViewPrivate *vie
         doc->buffer().setLineMetaData(item.line, tl);
     };
 
+    // batch the text changes of bulk groups, the lines are flagged once it is done
+    const bool bulk = m_items.size() >= BulkItems;
+    KateTextChangeBatch batch(doc);
+    std::vector<const UndoItem *> batchedItems;
+    auto applyBatch = [&]() {
+        batch.apply();
+        for (const UndoItem *item : batchedItems) {
+            updateDocLine(*item);
+        }
+        batchedItems.clear();
+    };
+
     for (auto rit = m_items.rbegin(); rit != m_items.rend(); ++rit) {
         auto &item = *rit;
+        if (bulk && (item.type == UndoItem::editInsertText || item.type == UndoItem::editRemoveText)) {
+            const int removedLength = item.type == UndoItem::editInsertText ? item.text.size() : 0;
+            const QString insertedText = item.type == UndoItem::editRemoveText ? item.text.toString() : QString();
+            if (!batch.add(item.line, item.col, removedLength, insertedText)) {
+                applyBatch();
+                batch.add(item.line, item.col, removedLength, insertedText);
+            }
+            batchedItems.push_back(&item);
+            continue;
+        }
+        applyBatch();
+
         switch (item.type) {
         case UndoItem::editInsertText:
             doc->editRemoveText(item.line, item.col, item.text.size());
             updateDocLine(item);
             break;
         case UndoItem::editRemoveText:
-            doc->editInsertText(item.line, item.col, item.text);
+            doc->editInsertText(item.line, item.col, item.text.toString());
             updateDocLine(item);
             break;
         case UndoItem::editWrapLine:
@@ -74,7 +107,7 @@ void KateUndoGroup::undo(KateUndoManager *manager, KTextEditor::ViewPrivate *vie
             doc->editRemoveLine(item.line);
             break;
         case UndoItem::editRemoveLine:
-            doc->editInsertLine(item.line, item.text);
+            doc->editInsertLine(item.line, item.text.toString());
             updateDocLine(item);
             break;
         case UndoItem::editMarkLineAutoWrapped:
@@ -84,6 +117,7 @@ void KateUndoGroup::undo(KateUndoManager *manager, KTextEditor::ViewPrivate *vie
             break;
         }
     }
+    applyBatch();
 
     if (view != nullptr) {
         if (m_undoSelection.isValid()) {
@@ -118,10 +152,34 @@ void KateUndoGroup::redo(KateUndoManager *manager, KTextEditor::ViewPrivate *vie
         doc->buffer().setLineMetaData(item.line, tl);
     };
 
+    // batch the text changes of bulk groups, the lines are flagged once it is done
+    const bool bulk = m_items.size() >= BulkItems;
+    KateTextChangeBatch batch(doc);
+    std::vector<const UndoItem *> batchedItems;
+    auto applyBatch = [&]() {
+        batch.apply();
+        for (const UndoItem *item : batchedItems) {
+            updateDocLine(*item);
+        }
+        batchedItems.clear();
+    };
+
     for (auto &item : m_items) {
+        if (bulk && (item.type == UndoItem::editInsertText || item.type == UndoItem::editRemoveText)) {
+            const int removedLength = item.type == UndoItem::editRemoveText ? item.text.size() : 0;
+            const QString insertedText = item.type == UndoItem::editInsertText ? item.text.toString() : QString();
+            if (!batch.add(item.line, item.col, removedLength, insertedText)) {
+                applyBatch();
+                batch.add(item.line, item.col, removedLength, insertedText);
+            }
+            batchedItems.push_back(&item);
+            continue;
+        }
+        applyBatch();
+
         switch (item.type) {
         case UndoItem::editInsertText:
-            doc->editInsertText(item.line, item.col, item.text);
+            doc->editInsertText(item.line, item.col, item.text.toString());
             updateDocLine(item);
             break;
         case UndoItem::editRemoveText:
@@ -142,7 +200,7 @@ void KateUndoGroup::redo(KateUndoManager *manager, KTextEditor::ViewPrivate *vie
             updateDocLine(item);
             break;
         case UndoItem::editInsertLine:
-            doc->editInsertLine(item.line, item.text);
+            doc->editInsertLine(item.line, item.text.toString());
             updateDocLine(item);
             break;
         case UndoItem::editRemoveLine:
@@ -155,6 +213,7 @@ void KateUndoGroup::redo(KateUndoManager *manager, KTextEditor::ViewPrivate *vie
             break;
         }
     }
+    applyBatch();
 
     if (view != nullptr) {
         if (m_redoSelection.isValid()) {
@@ -186,7 +245,7 @@ static bool mergeUndoItems(UndoItem &base, const UndoItem &u)
 {
     if (base.type == UndoItem::editInsertText && u.type == UndoItem::editWrapLine) {
         // merge insert text full line + wrap line
-        if (base.col == 0 && base.line == u.line && base.col + base.text.length() == u.col && u.newLine) {
+        if (base.col == 0 && base.line == u.line && base.col + base.text.size() == u.col && u.newLine) {
             base.type = UndoItem::editInsertLine;
             base.lineModFlags.setFlag(UndoItem::RedoLine1Modified);
             return true;
@@ -195,15 +254,21 @@ static bool mergeUndoItems(UndoItem &base, const UndoItem &u)
 
     if (base.type == UndoItem::editRemoveText && base.type == u.type) {
         if (base.line == u.line && base.col == (u.col + u.text.size())) {
-            base.text.prepend(u.text);
+            base.text.prepend(u.text.view());
             base.col = u.col;
             return true;
         }
+
+        // deleting forward from the same position
+        if (base.line == u.line && base.col == u.col) {
+            base.text.append(u.text.view());
+            return true;
+        }
     }
 
     if (base.type == UndoItem::editInsertText && base.type == u.type) {
         if (base.line == u.line && (base.col + base.text.size()) == u.col) {
-            base.text += u.text;
+            base.text.append(u.text.view());
             return true;
         }
     }
@@ -211,14 +276,24 @@ static bool mergeUndoItems(UndoItem &base, const UndoItem &u)
     return false;
 }
 
+static qint64 itemMemoryUsage(const UndoItem &item)
+{
+    return qint64(sizeof(UndoItem)) + (item.text.isInline() ? 0 : item.text.size() * qint64(sizeof(QChar)));
+}
+
 void KateUndoGroup::addItem(UndoItem u)
 {
     // try to merge, do that only for equal types, inside mergeWith we do hard casts
-    if (!m_items.empty() && mergeUndoItems(m_items.back(), u)) {
-        return;
+    if (!m_items.empty()) {
+        const qint64 before = itemMemoryUsage(m_items.back());
+        if (mergeUndoItems(m_items.back(), u)) {
+            m_itemsMemoryUsage += itemMemoryUsage(m_items.back()) - before;
+            return;
+        }
     }
 
     // default: just add new item unchanged
+    m_itemsMemoryUsage += itemMemoryUsage(u);
     m_items.push_back(std::move(u));
 }
 
@@ -229,11 +304,14 @@ bool KateUndoGroup::merge(KateUndoGroup *newGroup, bool complex)
     }
 
     if (newGroup->isOnlyType(singleType()) || complex) {
-        // Take all of its items first -> last
-        for (auto &item : newGroup->m_items) {
-            addItem(item);
+        // Take all of its items first -> last, unless they each continue one of ours
+        if (!mergeItemwise(newGroup)) {
+            for (auto &item : newGroup->m_items) {
+                addItem(std::move(item));
+            }
         }
         newGroup->m_items.clear();
+        newGroup->m_itemsMemoryUsage = 0;
 
         if (newGroup->m_safePoint) {
             safePoint();
@@ -250,37 +328,195 @@ bool KateUndoGroup::merge(KateUndoGroup *newGroup, bool complex)
     return false;
 }
 
+bool KateUndoGroup::mergeItemwise(KateUndoGroup *newGroup)
+{
+    const size_t count = newGroup->m_items.size();
+    if (count < 2 || count > m_items.size()) {
+        return false;
+    }
+
+    // merging moves each new item in front of our later items, this is only fine for text changes
+    // inside of distinct lines, they are in descending order as done by DocumentPrivate::replaceTextInLines()
+    const size_t offset = m_items.size() - count;
+    std::vector<UndoItem> merged;
+    merged.reserve(count);
+    qint64 memoryUsage = m_itemsMemoryUsage;
+    for (size_t i = 0; i < count; ++i) {
+        const UndoItem &u = newGroup->m_items[i];
+        if ((u.type != UndoItem::editInsertText && u.type != UndoItem::editRemoveText) || (i > 0 && u.line >= newGroup->m_items[i - 1].line)) {
+            return false;
+        }
+
+        UndoItem item = m_items[offset + i];
+        if (item.type != u.type || !mergeUndoItems(item, u)) {
+            return false;
+        }
+        memoryUsage += itemMemoryUsage(item) - itemMemoryUsage(m_items[offset + i]);
+        merged.push_back(std::move(item));
+    }
+
+    std::move(merged.begin(), merged.end(), m_items.begin() + offset);
+    m_itemsMemoryUsage = memoryUsage;
+    return true;
+}
+
 void KateUndoGroup::safePoint(bool safePoint)
 {
     m_safePoint = safePoint;
 }
 
-void KateUndoGroup::flagSavedAsModified()
+qint64 KateUndoGroup::memoryUsage() const
 {
-    for (UndoItem &item : m_items) {
-        if (item.lineModFlags.testFlag(UndoItem::UndoLine1Saved)) {
-            item.lineModFlags.setFlag(UndoItem::UndoLine1Saved, false);
-            item.lineModFlags.setFlag(UndoItem::UndoLine1Modified, true);
-        }
+    const qint64 cursors = m_undoSecondaryCursors.size() + m_redoSecondaryCursors.size();
+    return m_itemsMemoryUsage + cursors * qint64(sizeof(KTextEditor::ViewPrivate::PlainSecondaryCursor));
+}
 
-        if (item.lineModFlags.testFlag(UndoItem::UndoLine2Saved)) {
-            item.lineModFlags.setFlag(UndoItem::UndoLine2Saved, false);
-            item.lineModFlags.setFlag(UndoItem::UndoLine2Modified, true);
-        }
+static void writeCursors(QDataStream &stream, const QList<KTextEditor::ViewPrivate::PlainSecondaryCursor> &cursors)
+{
+    stream << quint32(cursors.size());
+    for (const auto &c : cursors) {
+        stream << qint32(c.pos.line()) << qint32(c.pos.column()) << qint32(c.range.start().line()) << qint32(c.range.start().column())
+               << qint32(c.range.end().line()) << qint32(c.range.end().column());
+    }
+}
 
-        if (item.lineModFlags.testFlag(UndoItem::RedoLine1Saved)) {
-            item.lineModFlags.setFlag(UndoItem::RedoLine1Saved, false);
-            item.lineModFlags.setFlag(UndoItem::RedoLine1Modified, true);
-        }
+static QList<KTextEditor::ViewPrivate::PlainSecondaryCursor> readCursors(QDataStream &stream)
+{
+    quint32 count = 0;
+    stream >> count;
+    QList<KTextEditor::ViewPrivate::PlainSecondaryCursor> cursors;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        qint32 line, column, startLine, startColumn, endLine, endColumn;
+        stream >> line >> column >> startLine >> startColumn >> endLine >> endColumn;
+        cursors.push_back({KTextEditor::Cursor(line, column), KTextEditor::Range(startLine, startColumn, endLine, endColumn)});
+    }
+    return cursors;
+}
 
-        if (item.lineModFlags.testFlag(UndoItem::RedoLine2Saved)) {
-            item.lineModFlags.setFlag(UndoItem::RedoLine2Saved, false);
-            item.lineModFlags.setFlag(UndoItem::RedoLine2Modified, true);
-        }
+bool KateUndoGroup::spill(KateUndoStore &store)
+{
+    if (isSpilled() || m_items.empty()) {
+        return false;
+    }
+
+    // the modification flags stay in memory, they are not written
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint32(m_items.size());
+    for (const auto &item : m_items) {
+        stream << qint8(item.type) << qint32(item.line) << qint32(item.col) << item.text.toString() << item.autowrapped << item.newLine << item.removeLine
+               << qint32(item.len);
+    }
+    writeCursors(stream, m_undoSecondaryCursors);
+    writeCursors(stream, m_redoSecondaryCursors);
+
+    const KateUndoStore::Record record = store.write(data);
+    if (!record.isValid()) {
+        return false;
+    }
+
+    m_record = record;
+    m_spilledItems.reserve(m_items.size());
+    for (const auto &item : m_items) {
+        m_spilledItems.push_back({item.line, item.type, item.lineModFlags});
+    }
+    m_itemsMemoryUsage = qint64(m_spilledItems.size() * sizeof(SpilledItem));
+    std::vector<UndoItem>().swap(m_items);
+    m_undoSecondaryCursors.clear();
+    m_undoSecondaryCursors.squeeze();
+    m_redoSecondaryCursors.clear();
+    m_redoSecondaryCursors.squeeze();
+    return true;
+}
+
+bool KateUndoGroup::load(KateUndoStore &store)
+{
+    if (!isSpilled()) {
+        return true;
+    }
+
+    const QByteArray data = store.read(m_record);
+    store.release(m_record);
+    m_record = KateUndoStore::Record();
+
+    QDataStream stream(data);
+    quint32 count = 0;
+    stream >> count;
+    m_items.reserve(count);
+    m_itemsMemoryUsage = 0;
+    for (quint32 i = 0; i < count && i < m_spilledItems.size() && stream.status() == QDataStream::Ok; ++i) {
+        UndoItem item;
+        qint8 type;
+        qint32 line, col, len;
+        QString text;
+        stream >> type >> line >> col >> text >> item.autowrapped >> item.newLine >> item.removeLine >> len;
+        item.text = text;
+        item.type = UndoItem::UndoType(type);
+        item.line = line;
+        item.col = col;
+        item.len = len;
+        item.lineModFlags = m_spilledItems[i].lineModFlags;
+        m_itemsMemoryUsage += itemMemoryUsage(item);
+        m_items.push_back(std::move(item));
+    }
+    m_undoSecondaryCursors = readCursors(stream);
+    m_redoSecondaryCursors = readCursors(stream);
+
+    // better lose this step than to undo only parts of it
+    const bool ok = stream.status() == QDataStream::Ok && m_items.size() == m_spilledItems.size();
+    if (!ok) {
+        qCWarning(LOG_KTE) << "lost undo step, can't read it back from the undo store";
+        m_items.clear();
+        m_itemsMemoryUsage = 0;
+    }
+    std::vector<SpilledItem>().swap(m_spilledItems);
+    return ok;
+}
+
+void KateUndoGroup::release(KateUndoStore &store)
+{
+    store.release(m_record);
+    m_record = KateUndoStore::Record();
+    std::vector<SpilledItem>().swap(m_spilledItems);
+    m_itemsMemoryUsage = 0;
+}
+
+template<typename Item>
+static void flagItemSavedAsModified(Item &item)
+{
+    if (item.lineModFlags.testFlag(UndoItem::UndoLine1Saved)) {
+        item.lineModFlags.setFlag(UndoItem::UndoLine1Saved, false);
+        item.lineModFlags.setFlag(UndoItem::UndoLine1Modified, true);
+    }
+
+    if (item.lineModFlags.testFlag(UndoItem::UndoLine2Saved)) {
+        item.lineModFlags.setFlag(UndoItem::UndoLine2Saved, false);
+        item.lineModFlags.setFlag(UndoItem::UndoLine2Modified, true);
+    }
+
+    if (item.lineModFlags.testFlag(UndoItem::RedoLine1Saved)) {
+        item.lineModFlags.setFlag(UndoItem::RedoLine1Saved, false);
+        item.lineModFlags.setFlag(UndoItem::RedoLine1Modified, true);
+    }
+
+    if (item.lineModFlags.testFlag(UndoItem::RedoLine2Saved)) {
+        item.lineModFlags.setFlag(UndoItem::RedoLine2Saved, false);
+        item.lineModFlags.setFlag(UndoItem::RedoLine2Modified, true);
     }
 }
 
-static void updateUndoSavedOnDiskFlag(UndoItem &item, QBitArray &lines)
+void KateUndoGroup::flagSavedAsModified()
+{
+    for (UndoItem &item : m_items) {
+        flagItemSavedAsModified(item);
+    }
+    for (SpilledItem &item : m_spilledItems) {
+        flagItemSavedAsModified(item);
+    }
+}
+
+template<typename Item>
+static void updateUndoSavedOnDiskFlag(Item &item, QBitArray &lines)
 {
     const int line = item.line;
     if (line >= lines.size()) {
@@ -337,9 +573,13 @@ void KateUndoGroup::markUndoAsSaved(QBitArray &lines)
     for (auto rit = m_items.rbegin(); rit != m_items.rend(); ++rit) {
         updateUndoSavedOnDiskFlag(*rit, lines);
     }
+    for (auto rit = m_spilledItems.rbegin(); rit != m_spilledItems.rend(); ++rit) {
+        updateUndoSavedOnDiskFlag(*rit, lines);
+    }
 }
 
-static void updateRedoSavedOnDiskFlag(UndoItem &item, QBitArray &lines)
+template<typename Item>
+static void updateRedoSavedOnDiskFlag(Item &item, QBitArray &lines)
 {
     const int line = item.line;
     if (line >= lines.size()) {
@@ -392,6 +632,9 @@ void KateUndoGroup::markRedoAsSaved(QBitArray &lines)
     for (auto rit = m_items.rbegin(); rit != m_items.rend(); ++rit) {
         updateRedoSavedOnDiskFlag(*rit, lines);
     }
+    for (auto rit = m_spilledItems.rbegin(); rit != m_spilledItems.rend(); ++rit) {
+        updateRedoSavedOnDiskFlag(*rit, lines);
+    }
 }
 
 UndoItem::UndoType KateUndoGroup::singleType() const
@@ -15,19 +15,183 @@
 #include <QList>
 
 #include <QBitArray>
+#include <QStringView>
+#include <kateundostore.h>
 #include <kateview.h>
 #include <ktexteditor/range.h>
 
+#include <algorithm>
+
 class KateUndoManager;
 namespace KTextEditor
 {
 class DocumentPrivate;
 }
 
+/**
+ * Text of an undo item.
+ *
+ * Short texts, like most typed or deleted ones, are kept inline without allocation. Longer ones
+ * are kept in an implicitly shared QString, e.g. removed lines share the data of the line.
+ */
+class UndoText
+{
+public:
+    static constexpr qsizetype InlineCapacity = sizeof(QString) / sizeof(char16_t);
+
+    UndoText() noexcept
+    {
+    }
+
+    explicit UndoText(const QString &text)
+    {
+        if (text.size() <= InlineCapacity) {
+            setInline(text);
+        } else {
+            new (&m_string) QString(text);
+            m_inlineSize = -1;
+        }
+    }
+
+    UndoText(const UndoText &other)
+    {
+        if (other.isInline()) {
+            setInline(other.view());
+        } else {
+            new (&m_string) QString(other.m_string);
+            m_inlineSize = -1;
+        }
+    }
+
+    UndoText(UndoText &&other) noexcept
+    {
+        if (other.isInline()) {
+            setInline(other.view());
+        } else {
+            new (&m_string) QString(std::move(other.m_string));
+            m_inlineSize = -1;
+        }
+    }
+
+    UndoText &operator=(const UndoText &other)
+    {
+        if (this != &other) {
+            UndoText copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    UndoText &operator=(UndoText &&other) noexcept
+    {
+        if (this != &other) {
+            clear();
+            if (other.isInline()) {
+                setInline(other.view());
+            } else {
+                new (&m_string) QString(std::move(other.m_string));
+                m_inlineSize = -1;
+            }
+        }
+        return *this;
+    }
+
+    UndoText &operator=(const QString &text)
+    {
+        return *this = UndoText(text);
+    }
+
+    ~UndoText()
+    {
+        clear();
+    }
+
+    bool isInline() const
+    {
+        return m_inlineSize >= 0;
+    }
+
+    qsizetype size() const
+    {
+        return isInline() ? m_inlineSize : m_string.size();
+    }
+
+    QStringView view() const
+    {
+        return isInline() ? QStringView(m_inline, m_inlineSize) : QStringView(m_string);
+    }
+
+    QString toString() const
+    {
+        return isInline() ? view().toString() : m_string;
+    }
+
+    void append(QStringView text)
+    {
+        if (!isInline()) {
+            m_string.append(text);
+        } else if (m_inlineSize + text.size() <= InlineCapacity) {
+            std::copy_n(text.utf16(), text.size(), m_inline + m_inlineSize);
+            m_inlineSize += text.size();
+        } else {
+            QString joined = view().toString();
+            joined.append(text);
+            *this = UndoText(joined);
+        }
+    }
+
+    void prepend(QStringView text)
+    {
+        if (!isInline()) {
+            m_string.prepend(text);
+        } else if (m_inlineSize + text.size() <= InlineCapacity) {
+            std::copy_backward(m_inline, m_inline + m_inlineSize, m_inline + m_inlineSize + text.size());
+            std::copy_n(text.utf16(), text.size(), m_inline);
+            m_inlineSize += text.size();
+        } else {
+            QString joined = view().toString();
+            joined.prepend(text);
+            *this = UndoText(joined);
+        }
+    }
+
+private:
+    void setInline(QStringView text)
+    {
+        std::copy_n(text.utf16(), text.size(), m_inline);
+        m_inlineSize = qint8(text.size());
+    }
+
+    void clear()
+    {
+        if (!isInline()) {
+            m_string.~QString();
+        }
+        m_inlineSize = 0;
+    }
+
+    union {
+        char16_t m_inline[InlineCapacity];
+        QString m_string;
+    };
+
+    // size of the inline text, -1 if m_string is used
+    qint8 m_inlineSize = 0;
+};
+
 class UndoItem
 {
 public:
-    enum UndoType { editInsertText, editRemoveText, editWrapLine, editUnWrapLine, editInsertLine, editRemoveLine, editMarkLineAutoWrapped, editInvalid };
+    enum UndoType : quint8 {
+        editInsertText,
+        editRemoveText,
+        editWrapLine,
+        editUnWrapLine,
+        editInsertLine,
+        editRemoveLine,
+        editMarkLineAutoWrapped,
+        editInvalid
+    };
 
     enum ModificationFlag {
         UndoLine1Modified = 1,
@@ -41,15 +205,16 @@ public:
     };
     Q_DECLARE_FLAGS(ModificationFlags, ModificationFlag)
 
-    UndoType type = editInvalid;
+    // ordered by size, keep the item small, there is one per edit
+    UndoText text;
     ModificationFlags lineModFlags;
     int line = 0;
     int col = 0;
-    QString text;
+    int len = 0;
+    UndoType type = editInvalid;
     bool autowrapped = false;
     bool newLine = false;
     bool removeLine = false;
-    int len = 0;
 };
 
 /**
@@ -105,9 +270,48 @@ public:
      */
     bool isEmpty() const
     {
-        return m_items.empty();
+        return m_items.empty() && m_spilledItems.empty();
+    }
+
+    /**
+     * Estimated heap memory used by this group.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * Are the items of this group in the undo store?
+     */
+    bool isSpilled() const
+    {
+        return m_record.isValid();
+    }
+
+    /**
+     * Size of this group in the undo store.
+     */
+    qint64 spilledSize() const
+    {
+        return m_record.size;
     }
 
+    /**
+     * Move the items and cursors of this group into the store, only what is needed to track
+     * the modified lines stays in memory. The group can't be undone or merged until loaded.
+     * @return success, the group stays in memory if the store can't be written
+     */
+    bool spill(KateUndoStore &store);
+
+    /**
+     * Load a spilled group back from the store.
+     * @return success, on failure the group is empty and must neither be undone nor redone
+     */
+    bool load(KateUndoStore &store);
+
+    /**
+     * Drop the record of a spilled group from the store, the group is cleared.
+     */
+    void release(KateUndoStore &store);
+
     /**
      * Change all LineSaved flags to LineModified of the line modification system.
      */
@@ -151,6 +355,14 @@ private:
      */
     bool isOnlyType(UndoItem::UndoType type) const;
 
+    /**
+     * Merge the items of a group edited with multiple cursors item by item into our last ones,
+     * e.g. each cursor typed one more character.
+     * @param newGroup group to merge into this one
+     * @return success, nothing is merged if one of the items doesn't continue its counterpart
+     */
+    bool mergeItemwise(KateUndoGroup *newGroup);
+
 public:
     /**
      * add an undo item
@@ -164,6 +376,26 @@ private:
      */
     std::vector<UndoItem> m_items;
 
+    /**
+     * What stays in memory of an item in the undo store, the line modification flags change on save.
+     */
+    struct SpilledItem {
+        int line;
+        UndoItem::UndoType type;
+        UndoItem::ModificationFlags lineModFlags;
+    };
+
+    /**
+     * items of a spilled group, m_items is empty then
+     */
+    std::vector<SpilledItem> m_spilledItems;
+    KateUndoStore::Record m_record;
+
+    /**
+     * estimated heap memory of m_items or m_spilledItems
+     */
+    qint64 m_itemsMemoryUsage = 0;
+
     /**
      * prohibit merging with the next group
      */
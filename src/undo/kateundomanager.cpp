@@ -6,14 +6,20 @@
 
 #include "kateundomanager.h"
 
+#include <ktexteditor/message.h>
 #include <ktexteditor/view.h>
 
+#include "kateconfig.h"
 #include "katedocument.h"
 #include "katepartdebug.h"
 #include "kateview.h"
 
+#include <KLocalizedString>
+
 #include <QBitArray>
 
+#include <algorithm>
+
 KateUndoManager::KateUndoManager(KTextEditor::DocumentPrivate *doc)
     : QObject(doc)
     , m_document(doc)
@@ -28,6 +34,9 @@ KateUndoManager::KateUndoManager(KTextEditor::DocumentPrivate *doc)
         savedUndoItems = std::move(undoItems);
         savedRedoItems = std::move(redoItems);
         docChecksumBeforeReload = m_document->checksum();
+        m_memoryUsage = 0;
+        m_firstUnspilledUndo = 0;
+        m_firstUnspilledRedo = 0;
     });
 
     // After reload restore it only if checksum of the doc is same
@@ -35,11 +44,17 @@ KateUndoManager::KateUndoManager(KTextEditor::DocumentPrivate *doc)
         if (doc && !doc->checksum().isEmpty() && !docChecksumBeforeReload.isEmpty() && doc->checksum() == docChecksumBeforeReload) {
             undoItems = std::move(savedUndoItems);
             redoItems = std::move(savedRedoItems);
+            m_memoryUsage = 0;
+            for (const auto *groups : {&undoItems, &redoItems}) {
+                for (const KateUndoGroup &group : *groups) {
+                    m_memoryUsage += group.memoryUsage();
+                }
+            }
             Q_EMIT undoChanged();
         }
         docChecksumBeforeReload.clear();
-        savedUndoItems.clear();
-        savedRedoItems.clear();
+        clearGroups(savedUndoItems);
+        clearGroups(savedRedoItems);
     });
 }
 
@@ -93,13 +108,27 @@ void KateUndoManager::editEnd()
 
     bool changedUndo = false;
 
+    if (!m_editCurrentUndo->isEmpty() && !undoItems.empty()) {
+        // after an undo the last group might have been spilled
+        if (!loadLastGroup(undoItems, m_firstUnspilledUndo)) {
+            // the older groups don't match the text without the lost one
+            clearUndo();
+            notifyUndoHistoryLost();
+        }
+    }
+
+    const qint64 lastMemoryUsage = undoItems.empty() ? 0 : undoItems.back().memoryUsage();
     if (m_editCurrentUndo->isEmpty()) {
         m_editCurrentUndo.reset();
     } else if (!undoItems.empty() && undoItems.back().merge(&*m_editCurrentUndo, m_undoComplexMerge)) {
         m_editCurrentUndo.reset();
+        m_memoryUsage += undoItems.back().memoryUsage() - lastMemoryUsage;
+        limitMemoryUsage();
     } else {
+        m_memoryUsage += m_editCurrentUndo->memoryUsage();
         undoItems.push_back(std::move(*m_editCurrentUndo));
         changedUndo = true;
+        limitMemoryUsage();
     }
 
     m_editCurrentUndo.reset();
@@ -349,7 +378,10 @@ void KateUndoManager::addUndoItem(UndoItem undo)
     m_editCurrentUndo->addItem(std::move(undo));
 
     // Clear redo buffer
-    redoItems.clear();
+    if (!redoItems.empty()) {
+        m_memoryUsage -= clearGroups(redoItems);
+        m_firstUnspilledRedo = 0;
+    }
 }
 
 void KateUndoManager::setActive(bool enabled)
@@ -379,10 +411,21 @@ void KateUndoManager::undo()
     if (!undoItems.empty()) {
         Q_EMIT undoStart(document());
 
+        if (!loadLastGroup(undoItems, m_firstUnspilledUndo)) {
+            // never apply the older groups to text they don't match
+            clearUndo();
+            updateModified();
+            notifyUndoHistoryLost();
+            Q_EMIT undoEnd(document());
+            return;
+        }
+
         undoItems.back().undo(this, activeView());
         redoItems.push_back(std::move(undoItems.back()));
         undoItems.pop_back();
+        m_firstUnspilledUndo = std::min(m_firstUnspilledUndo, undoItems.size());
         updateModified();
+        limitMemoryUsage();
 
         Q_EMIT undoEnd(document());
     }
@@ -395,15 +438,35 @@ void KateUndoManager::redo()
     if (!redoItems.empty()) {
         Q_EMIT redoStart(document());
 
+        if (!loadLastGroup(redoItems, m_firstUnspilledRedo)) {
+            // never apply the newer groups to text they don't match
+            clearRedo();
+            updateModified();
+            notifyUndoHistoryLost();
+            Q_EMIT redoEnd(document());
+            return;
+        }
+
         redoItems.back().redo(this, activeView());
         undoItems.push_back(std::move(redoItems.back()));
         redoItems.pop_back();
+        m_firstUnspilledRedo = std::min(m_firstUnspilledRedo, redoItems.size());
         updateModified();
+        limitMemoryUsage();
 
         Q_EMIT redoEnd(document());
     }
 }
 
+void KateUndoManager::notifyUndoHistoryLost()
+{
+    auto *message = new KTextEditor::Message(i18n("Part of the undo history could not be read back from its temporary file and was discarded."),
+                                             KTextEditor::Message::Warning);
+    message->setPosition(KTextEditor::Message::TopInView);
+    message->setAutoHide(5000);
+    m_document->postMessage(message);
+}
+
 void KateUndoManager::updateModified()
 {
     /*
@@ -485,7 +548,8 @@ void KateUndoManager::updateModified()
 
 void KateUndoManager::clearUndo()
 {
-    undoItems.clear();
+    m_memoryUsage -= clearGroups(undoItems);
+    m_firstUnspilledUndo = 0;
 
     lastUndoGroupWhenSaved = nullptr;
     docWasSavedWhenUndoWasEmpty = false;
@@ -495,7 +559,8 @@ void KateUndoManager::clearUndo()
 
 void KateUndoManager::clearRedo()
 {
-    redoItems.clear();
+    m_memoryUsage -= clearGroups(redoItems);
+    m_firstUnspilledRedo = 0;
 
     lastRedoGroupWhenSaved = nullptr;
     docWasSavedWhenRedoWasEmpty = false;
@@ -563,9 +628,90 @@ KTextEditor::Cursor KateUndoManager::lastRedoCursor() const
 
 void KateUndoManager::updateConfig()
 {
+    m_memoryLimit = qint64(m_document->config()->undoMemoryLimit()) * 1024 * 1024;
+    limitMemoryUsage();
+
     Q_EMIT undoChanged();
 }
 
+KateUndoManager::MemoryReport KateUndoManager::memoryReport() const
+{
+    MemoryReport report;
+    for (const auto *groups : {&undoItems, &redoItems}) {
+        for (const KateUndoGroup &group : *groups) {
+            ++report.groups;
+            report.memoryUsage += group.memoryUsage();
+            if (group.isSpilled()) {
+                ++report.spilledGroups;
+                report.spilledBytes += group.spilledSize();
+            }
+        }
+    }
+    report.fileSize = m_store.fileSize();
+    return report;
+}
+
+void KateUndoManager::limitMemoryUsage()
+{
+    if (m_memoryLimit < 0) {
+        m_memoryLimit = qint64(m_document->config()->undoMemoryLimit()) * 1024 * 1024;
+    }
+    if (m_memoryLimit == 0 || m_memoryUsage <= m_memoryLimit) {
+        return;
+    }
+
+    // spill what is needed last, the groups are kept in the order they were done,
+    // the ones in front were looked at by an earlier call already
+    bool spilled = false;
+    for (auto [groups, first] : {std::pair{&undoItems, &m_firstUnspilledUndo}, std::pair{&redoItems, &m_firstUnspilledRedo}}) {
+        for (size_t &i = *first; i + 1 < groups->size() && m_memoryUsage > m_memoryLimit; ++i) {
+            KateUndoGroup &group = (*groups)[i];
+            const qint64 before = group.memoryUsage();
+            if (group.spill(m_store)) {
+                m_memoryUsage -= before - group.memoryUsage();
+                spilled = true;
+            }
+        }
+    }
+    if (!spilled || !LOG_KTE().isDebugEnabled()) {
+        return;
+    }
+
+    const MemoryReport report = memoryReport();
+    qCDebug(LOG_KTE) << "undo history of" << m_document->url() << "uses" << report.memoryUsage << "bytes," << report.spilledGroups << "of"
+                     << report.groups << "groups spilled with" << report.spilledBytes << "bytes, undo store" << report.fileSize << "bytes";
+}
+
+qint64 KateUndoManager::clearGroups(std::vector<KateUndoGroup> &groups)
+{
+    // release the newest first, the store shrinks from its end
+    qint64 memoryUsage = 0;
+    for (auto it = groups.rbegin(); it != groups.rend(); ++it) {
+        memoryUsage += it->memoryUsage();
+        if (it->isSpilled()) {
+            it->release(m_store);
+        }
+    }
+    groups.clear();
+    return memoryUsage;
+}
+
+bool KateUndoManager::loadLastGroup(std::vector<KateUndoGroup> &groups, size_t &firstUnspilled)
+{
+    KateUndoGroup &group = groups.back();
+    if (!group.isSpilled()) {
+        return true;
+    }
+
+    const qint64 before = group.memoryUsage();
+    const bool ok = group.load(m_store);
+    m_memoryUsage += group.memoryUsage() - before;
+
+    // it may be spilled again later on
+    firstUnspilled = std::min(firstUnspilled, groups.size() - 1);
+    return ok;
+}
+
 void KateUndoManager::setAllowComplexMerge(bool allow)
 {
     m_undoComplexMerge = allow;
@@ -110,6 +110,31 @@ public:
      */
     KTextEditor::Cursor lastRedoCursor() const;
 
+    /**
+     * Memory used by the undo and redo history.
+     */
+    struct MemoryReport {
+        int groups = 0;
+        // groups moved to the undo store
+        int spilledGroups = 0;
+        // estimated heap memory of all groups
+        qint64 memoryUsage = 0;
+        // compressed size of the spilled groups
+        qint64 spilledBytes = 0;
+        // size of the temporary file of the undo store
+        qint64 fileSize = 0;
+    };
+
+    KTEXTEDITOR_EXPORT MemoryReport memoryReport() const;
+
+    /**
+     * Estimated heap memory of the undo and redo history, kept up to date with each change.
+     */
+    qint64 memoryUsage() const
+    {
+        return m_memoryUsage;
+    }
+
 public Q_SLOTS:
     /**
      * Undo the latest undo group.
@@ -206,6 +231,34 @@ private:
     KTEXTEDITOR_NO_EXPORT
     KTextEditor::ViewPrivate *activeView();
 
+    /**
+     * Move the oldest undo and the farthest redo groups to the undo store until the history
+     * fits into the configured memory limit again. The next undo and redo group stay in memory.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void limitMemoryUsage();
+
+    /**
+     * Clear the groups, releasing their records in the undo store.
+     * @return estimated heap memory the groups used
+     */
+    KTEXTEDITOR_NO_EXPORT
+    qint64 clearGroups(std::vector<KateUndoGroup> &groups);
+
+    /**
+     * Load the last group back from the undo store, if spilled.
+     * @param firstUnspilled first group of @p groups limitMemoryUsage() looks at
+     * @return success, see KateUndoGroup::load()
+     */
+    KTEXTEDITOR_NO_EXPORT
+    bool loadLastGroup(std::vector<KateUndoGroup> &groups, size_t &firstUnspilled);
+
+    /**
+     * Tell the user that groups were dropped as they couldn't be read back from the undo store.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void notifyUndoHistoryLost();
+
 private:
     KTextEditor::DocumentPrivate *m_document = nullptr;
     bool m_undoComplexMerge = false;
@@ -224,6 +277,16 @@ private:
     std::vector<KateUndoGroup> savedUndoItems;
     std::vector<KateUndoGroup> savedRedoItems;
     QByteArray docChecksumBeforeReload;
+
+    // groups moved out of memory
+    KateUndoStore m_store;
+    // in bytes, 0 for no limit, -1 if not read from the config yet
+    qint64 m_memoryLimit = -1;
+    // estimated heap memory of undoItems and redoItems
+    qint64 m_memoryUsage = 0;
+    // the groups in front of these are spilled already, or failed to
+    size_t m_firstUnspilledUndo = 0;
+    size_t m_firstUnspilledRedo = 0;
 };
 
 #endif
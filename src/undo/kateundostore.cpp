@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kateundostore.h"
+#include "katepartdebug.h"
+
+#include <QDir>
+
+#include <iterator>
+
+KateUndoStore::KateUndoStore() = default;
+
+KateUndoStore::~KateUndoStore() = default;
+
+KateUndoStore::Record KateUndoStore::write(const QByteArray &data)
+{
+    if (!m_file) {
+        m_file = std::make_unique<QTemporaryFile>(QDir::tempPath() + QStringLiteral("/kate-undo-XXXXXX"));
+        if (!m_file->open()) {
+            qCWarning(LOG_KTE) << "can't open temporary file for the undo history" << m_file->errorString();
+            m_file.reset();
+            return {};
+        }
+    }
+
+    // undo items are mostly text, favor speed, this is done while typing
+    const QByteArray compressed = qCompress(data, 1);
+    if (!m_file->seek(m_end) || m_file->write(compressed) != compressed.size()) {
+        qCWarning(LOG_KTE) << "can't write undo history to temporary file" << m_file->errorString();
+        m_file->resize(m_end);
+        return {};
+    }
+
+    Record record{m_end, compressed.size()};
+    m_end += record.size;
+    m_usedBytes += record.size;
+    return record;
+}
+
+QByteArray KateUndoStore::read(const Record &record)
+{
+    if (!m_file || !record.isValid() || !m_file->seek(record.offset)) {
+        return {};
+    }
+
+    const QByteArray compressed = m_file->read(record.size);
+    if (compressed.size() != record.size) {
+        qCWarning(LOG_KTE) << "can't read undo history from temporary file" << m_file->errorString();
+        return {};
+    }
+    return qUncompress(compressed);
+}
+
+void KateUndoStore::release(const Record &record)
+{
+    if (!m_file || !record.isValid()) {
+        return;
+    }
+
+    m_usedBytes -= record.size;
+    if (record.offset + record.size != m_end) {
+        m_released.emplace(record.offset, record.size);
+        return;
+    }
+
+    // cut the file at the last record still in use
+    m_end = record.offset;
+    while (!m_released.empty() && m_released.rbegin()->first + m_released.rbegin()->second == m_end) {
+        m_end = m_released.rbegin()->first;
+        m_released.erase(std::prev(m_released.end()));
+    }
+    m_file->resize(m_end);
+}
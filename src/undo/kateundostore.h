@@ -0,0 +1,89 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATEUNDOSTORE_H
+#define KATEUNDOSTORE_H
+
+#include <QByteArray>
+#include <QTemporaryFile>
+
+#include <map>
+#include <memory>
+
+/**
+ * Temporary file holding the undo groups KateUndoManager moved out of memory.
+ *
+ * Each group is written compressed as one record and read back once it is needed again.
+ * Records are appended, the file is cut at the last record still in use. As the groups read
+ * back are most of the time the last ones written, this frees the space of most records.
+ */
+class KateUndoStore
+{
+public:
+    /**
+     * Location of one record in the file.
+     */
+    struct Record {
+        qint64 offset = -1;
+        qint64 size = 0;
+
+        bool isValid() const
+        {
+            return offset >= 0;
+        }
+    };
+
+    KateUndoStore();
+    ~KateUndoStore();
+
+    KateUndoStore(const KateUndoStore &) = delete;
+    KateUndoStore &operator=(const KateUndoStore &) = delete;
+
+    /**
+     * Compress and write the data as new record.
+     * @return the record, invalid if the temporary file can't be written
+     */
+    Record write(const QByteArray &data);
+
+    /**
+     * Read the data of a record back, the record stays valid until released.
+     * @return the uncompressed data, empty on errors
+     */
+    QByteArray read(const Record &record);
+
+    /**
+     * The record is no longer needed, its space is free again.
+     */
+    void release(const Record &record);
+
+    /**
+     * Bytes of all records not released yet.
+     */
+    qint64 usedBytes() const
+    {
+        return m_usedBytes;
+    }
+
+    /**
+     * Size of the temporary file, including released records not at its end.
+     */
+    qint64 fileSize() const
+    {
+        return m_end;
+    }
+
+private:
+    std::unique_ptr<QTemporaryFile> m_file;
+
+    // end of the last record not released yet
+    qint64 m_end = 0;
+    qint64 m_usedBytes = 0;
+
+    // released records in front of m_end, offset -> size
+    std::map<qint64, qint64> m_released;
+};
+
+#endif
@@ -361,6 +361,21 @@ KateDocumentConfig::KateDocumentConfig()
     // Shall we do auto reloading for stuff e.g. in Git?
     addConfigEntry(ConfigEntry(AutoReloadIfStateIsInVersionControl, "Auto Reload If State Is In Version Control", QString(), true));
 
+    // search index for large documents
+    addConfigEntry(ConfigEntry(SearchIndexLineThreshold, "Search Index Line Threshold", QString(), 100000, [](const QVariant &value) {
+        return value.toInt() >= 0;
+    }));
+
+    // undo history kept in memory, in MiB
+    addConfigEntry(ConfigEntry(UndoMemoryLimit, "Undo Memory Limit", QString(), 256, [](const QVariant &value) {
+        return value.toInt() >= 0;
+    }));
+
+    // very long lines are edited in chunks
+    addConfigEntry(ConfigEntry(ChunkedLineLength, "Chunked Line Length", QString(), 65536, [](const QVariant &value) {
+        return value.toInt() >= 0;
+    }));
+
     // finalize the entries, e.g. hashs them
     finalizeConfigEntries();
 
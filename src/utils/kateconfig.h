@@ -540,7 +540,22 @@ public:
         /**
          * Should we auto-reload if the old state is in version control?
          */
-        AutoReloadIfStateIsInVersionControl
+        AutoReloadIfStateIsInVersionControl,
+
+        /**
+         * Minimal number of lines for documents to get a search index, 0 disables the index
+         */
+        SearchIndexLineThreshold,
+
+        /**
+         * Memory for the undo history in MiB, older steps are moved to a temporary file, 0 for no limit
+         */
+        UndoMemoryLimit,
+
+        /**
+         * Minimal length of lines kept in chunks while they are edited, 0 to never chunk lines
+         */
+        ChunkedLineLength
     };
 
 public:
@@ -903,6 +918,36 @@ public:
         setValue(LineLengthLimit, limit);
     }
 
+    int searchIndexLineThreshold() const
+    {
+        return value(SearchIndexLineThreshold).toInt();
+    }
+
+    void setSearchIndexLineThreshold(int lines)
+    {
+        setValue(SearchIndexLineThreshold, lines);
+    }
+
+    int undoMemoryLimit() const
+    {
+        return value(UndoMemoryLimit).toInt();
+    }
+
+    void setUndoMemoryLimit(int mebibytes)
+    {
+        setValue(UndoMemoryLimit, mebibytes);
+    }
+
+    int chunkedLineLength() const
+    {
+        return value(ChunkedLineLength).toInt();
+    }
+
+    void setChunkedLineLength(int length)
+    {
+        setValue(ChunkedLineLength, length);
+    }
+
     void setCamelCursor(bool on)
     {
         setValue(CamelCursor, on);
@@ -0,0 +1,175 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "kateminimaptiles.h"
+#include "katepartdebug.h"
+
+#include <QElapsedTimer>
+#include <QPainter>
+
+#include <algorithm>
+
+KateMiniMapTiles::KateMiniMapTiles(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+KateMiniMapTiles::~KateMiniMapTiles()
+{
+    // the worker posts its results to us, it must be done before we are gone
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void KateMiniMapTiles::setGeometry(const Geometry &geometry, int rows)
+{
+    if (!(geometry == m_geometry)) {
+        m_geometry = geometry;
+        ++m_generation;
+        m_dirty.clear();
+        m_images.clear();
+    }
+
+    const int tiles = (std::max(0, rows) + RowsPerTile - 1) / RowsPerTile;
+    m_dirty.resize(tiles, true);
+    m_images.resize(tiles);
+    m_needsCompose = m_needsCompose || rows != m_rows;
+    m_rows = rows;
+}
+
+void KateMiniMapTiles::invalidateAll()
+{
+    std::fill(m_dirty.begin(), m_dirty.end(), true);
+}
+
+void KateMiniMapTiles::invalidateLines(int firstLine, int lastLine)
+{
+    if (m_dirty.empty()) {
+        return;
+    }
+
+    const int first = std::clamp(firstLine / linesPerTile(), 0, tileCount() - 1);
+    const int last = lastLine < 0 ? tileCount() - 1 : std::clamp(lastLine / linesPerTile(), first, tileCount() - 1);
+    std::fill(m_dirty.begin() + first, m_dirty.begin() + last + 1, true);
+}
+
+QList<int> KateMiniMapTiles::dirtyTiles() const
+{
+    QList<int> tiles;
+    for (size_t i = 0; i < m_dirty.size(); ++i) {
+        if (m_dirty[i]) {
+            tiles.push_back(int(i));
+        }
+    }
+    return tiles;
+}
+
+/**
+ * Rasterize one tile, runs on the worker thread.
+ */
+static QImage renderTile(int width, const KateMiniMapTiles::Content &content)
+{
+    QImage image(std::max(1, width), KateMiniMapTiles::RowsPerTile, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    const QColor selectionColor = QColor::fromRgba(content.selectionColor);
+    for (const auto &line : content.lines) {
+        if (line.selectionStart != -1) {
+            painter.fillRect(line.selectionStart, line.row, line.selectionEnd - line.selectionStart + 1, 1, selectionColor);
+        }
+        for (const auto &run : line.runs) {
+            painter.fillRect(run.x, line.row, run.length, 1, QColor::fromRgba(run.color));
+        }
+    }
+    for (const auto &marker : content.markers) {
+        painter.fillRect(2, marker.row, 3, 1, QColor::fromRgba(marker.color));
+    }
+    painter.end();
+    return image;
+}
+
+void KateMiniMapTiles::render(int tile, Content content)
+{
+    if (tile < 0 || tile >= tileCount()) {
+        return;
+    }
+
+    m_dirty[tile] = false;
+    ++m_pending;
+
+    const quint64 generation = m_generation;
+    const int width = m_geometry.width;
+    m_pool.start([this, tile, generation, width, content = std::move(content)]() {
+        QElapsedTimer timer;
+        timer.start();
+        const QImage image = renderTile(width, content);
+        const qint64 renderNs = timer.nsecsElapsed();
+        QMetaObject::invokeMethod(
+            this,
+            [this, tile, generation, image, renderNs]() {
+                tileRendered(tile, generation, image, renderNs);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void KateMiniMapTiles::finishUpdate(qint64 prepareNs)
+{
+    m_prepareNs = prepareNs;
+    if (m_pending == 0 && m_needsCompose) {
+        compose();
+    }
+}
+
+void KateMiniMapTiles::tileRendered(int tile, quint64 generation, const QImage &image, qint64 renderNs)
+{
+    --m_pending;
+    m_renderNs += renderNs;
+
+    // drop tiles drawn with an outdated sampling
+    if (generation == m_generation && tile < m_images.size()) {
+        m_images[tile] = image;
+        ++m_statistics.tilesRendered;
+        m_needsCompose = true;
+    }
+
+    if (m_pending == 0 && m_needsCompose) {
+        compose();
+    }
+}
+
+void KateMiniMapTiles::compose()
+{
+    // like the rows, the tiles are drawn unscaled into the pixmap
+    const qreal ratio = m_geometry.devicePixelRatio;
+    QPixmap pixmap(std::max(1, m_geometry.width) * ratio, std::max(1, m_rows) * ratio);
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter(&pixmap);
+    for (int i = 0; i < m_images.size(); ++i) {
+        if (!m_images[i].isNull()) {
+            painter.drawImage(0, i * RowsPerTile, m_images[i]);
+        }
+    }
+    painter.end();
+    pixmap.setDevicePixelRatio(ratio);
+    m_pixmap = pixmap;
+    m_needsCompose = false;
+
+    ++m_statistics.updates;
+    m_statistics.lastPrepareNs = m_prepareNs;
+    m_statistics.lastRenderNs = m_renderNs;
+    qCDebug(LOG_KTE) << "minimap update: prepare" << m_prepareNs / 1000 << "us, render" << m_renderNs / 1000 << "us," << m_statistics.tilesRendered
+                     << "tiles rendered in total";
+    m_prepareNs = 0;
+    m_renderNs = 0;
+
+    Q_EMIT updated();
+}
+
+#include "moc_kateminimaptiles.cpp"
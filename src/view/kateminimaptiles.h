@@ -0,0 +1,184 @@
+/*
+    SPDX-FileCopyrightText: 2026 KDE Developers
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATEMINIMAPTILES_H
+#define KATEMINIMAPTILES_H
+
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QPixmap>
+#include <QThreadPool>
+
+#include <vector>
+
+/**
+ * Minimap of KateScrollBar, kept in tiles of a fixed number of pixel rows.
+ *
+ * Each tile covers a range of lines and is only drawn again once one of its lines changed.
+ * The scroll bar collects what to draw for the lines of a tile on the GUI thread, as the
+ * document can't be accessed elsewhere, the tile image is then rasterized on a worker thread.
+ * Once all tiles of an update arrived, the pixmap is put together and updated() is emitted,
+ * until then the old pixmap stays in place.
+ */
+class KateMiniMapTiles : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Pixel rows per tile.
+     */
+    static constexpr int RowsPerTile = 64;
+
+    /**
+     * Sampling of the document, tiles drawn with another one are useless.
+     */
+    struct Geometry {
+        // every n-th line is drawn, n lines share one row
+        int lineIncrement = 1;
+        int charIncrement = 1;
+        int width = 0;
+        qreal devicePixelRatio = 1.0;
+
+        bool operator==(const Geometry &other) const = default;
+    };
+
+    /**
+     * Pixels of one color in a row.
+     */
+    struct Run {
+        int x;
+        int length;
+        QRgb color;
+    };
+
+    /**
+     * What to draw for one line, rows are relative to the tile.
+     */
+    struct Line {
+        int row = 0;
+        // selected pixels, inclusive, -1 if none
+        int selectionStart = -1;
+        int selectionEnd = -1;
+        QList<Run> runs;
+    };
+
+    /**
+     * Modified or saved line marker.
+     */
+    struct Marker {
+        int row;
+        QRgb color;
+    };
+
+    struct Content {
+        QList<Line> lines;
+        QList<Marker> markers;
+        QRgb selectionColor = 0;
+    };
+
+    struct Statistics {
+        quint64 updates = 0;
+        quint64 tilesRendered = 0;
+        // time to collect the content of the tiles of the last update on the GUI thread
+        qint64 lastPrepareNs = 0;
+        // time to rasterize the tiles of the last update on the worker thread
+        qint64 lastRenderNs = 0;
+    };
+
+    explicit KateMiniMapTiles(QObject *parent = nullptr);
+    ~KateMiniMapTiles() override;
+
+    /**
+     * Set the sampling and the height of the map in rows, a new sampling makes all tiles dirty.
+     */
+    void setGeometry(const Geometry &geometry, int rows);
+
+    const Geometry &geometry() const
+    {
+        return m_geometry;
+    }
+
+    int tileCount() const
+    {
+        return int(m_dirty.size());
+    }
+
+    /**
+     * Lines covered by one tile.
+     */
+    int linesPerTile() const
+    {
+        return RowsPerTile * m_geometry.charIncrement * m_geometry.lineIncrement;
+    }
+
+    void invalidateAll();
+
+    /**
+     * Make the tiles covering the given visible lines dirty.
+     * @param lastLine last line, -1 for the end of the document, e.g. if lines moved
+     */
+    void invalidateLines(int firstLine, int lastLine);
+
+    /**
+     * Tiles to draw again, in order.
+     */
+    QList<int> dirtyTiles() const;
+
+    /**
+     * Rasterize the tile on the worker thread, it is clean afterwards.
+     */
+    void render(int tile, Content content);
+
+    /**
+     * All tiles of this update were handed over with render().
+     * @param prepareNs time it took to collect their content
+     */
+    void finishUpdate(qint64 prepareNs);
+
+    const QPixmap &pixmap() const
+    {
+        return m_pixmap;
+    }
+
+    const Statistics &statistics() const
+    {
+        return m_statistics;
+    }
+
+Q_SIGNALS:
+    /**
+     * The pixmap was put together again.
+     */
+    void updated();
+
+private:
+    void tileRendered(int tile, quint64 generation, const QImage &image, qint64 renderNs);
+    void compose();
+
+    Geometry m_geometry;
+    int m_rows = 0;
+
+    // bumped if the sampling changed, tiles rendered before are dropped
+    quint64 m_generation = 0;
+
+    std::vector<bool> m_dirty;
+    QList<QImage> m_images;
+    QPixmap m_pixmap;
+
+    // tiles handed to the worker and not back yet
+    int m_pending = 0;
+    bool m_needsCompose = false;
+    qint64 m_prepareNs = 0;
+    qint64 m_renderNs = 0;
+    Statistics m_statistics;
+
+    // one worker, tiles arrive in order
+    QThreadPool m_pool;
+};
+
+#endif
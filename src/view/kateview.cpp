@@ -76,10 +76,12 @@
 #include <QLayout>
 #include <QMimeData>
 #include <QPainter>
-#include <QRegularExpression>
+#include <QStringMatcher>
 #include <QTextToSpeech>
 #include <QToolTip>
 
+#include <algorithm>
+
 // #define VIEW_RANGE_DEBUG
 
 // END includes
@@ -92,6 +94,12 @@ bool hasCommentInFirstLine(KTextEditor::DocumentPrivate *doc)
     return doc->isComment(0, line.firstChar());
 }
 
+// characters that make up a word for the selection highlights
+bool isHighlightWordChar(QChar c)
+{
+    return c.isLetterOrNumber() || c.isMark() || c.category() == QChar::Punctuation_Connector;
+}
+
 }
 
 void KTextEditor::ViewPrivate::blockFix(KTextEditor::Range &range)
@@ -124,6 +132,7 @@ KTextEditor::ViewPrivate::ViewPrivate(KTextEditor::DocumentPrivate *doc, QWidget
     , m_updatingDocumentConfig(false)
     , m_selection(m_doc->buffer(), KTextEditor::Range::invalid(), Kate::TextRange::ExpandLeft, Kate::TextRange::AllowEmpty)
     , blockSelect(false)
+    , m_searchHighlights(m_doc->buffer())
     , m_bottomViewBar(nullptr)
     , m_gotoBar(nullptr)
     , m_dictionaryBar(nullptr)
@@ -2805,32 +2814,44 @@ bool KTextEditor::ViewPrivate::lineIsSelection(int line)
 
 void KTextEditor::ViewPrivate::tagSelection(KTextEditor::Range oldSelection)
 {
+    // a block selection is part of the line layouts, a normal one is only painted on top of them,
+    // except with a custom line height, then the layouts drop the backgrounds below the selection
+    const auto tag = [this](KTextEditor::Cursor start, KTextEditor::Cursor end) {
+        if (blockSelection() || renderer()->hasCustomLineHeight()) {
+            tagLines(start, end, true);
+        } else {
+            m_viewInternal->damageLines(start, end);
+        }
+    };
+
     if (selection()) {
         if (oldSelection.start().line() == -1) {
             // We have to tag the whole lot if
             // 1) we have a selection, and:
             //  a) it's new; or
-            tagLines(m_selection, true);
+            tag(m_selection.start(), m_selection.end());
 
         } else if (blockSelection()
                    && (oldSelection.start().column() != m_selection.start().column() || oldSelection.end().column() != m_selection.end().column())) {
             //  b) we're in block selection mode and the columns have changed
-            tagLines(m_selection, true);
-            tagLines(oldSelection, true);
+            tag(m_selection.start(), m_selection.end());
+            tag(oldSelection.start(), oldSelection.end());
 
         } else {
             if (oldSelection.start() != m_selection.start()) {
-                tagLines(KTextEditor::LineRange(oldSelection.start().line(), m_selection.start().line()), true);
+                tag(KTextEditor::Cursor(qMin(oldSelection.start().line(), m_selection.start().line()), 0),
+                    KTextEditor::Cursor(qMax(oldSelection.start().line(), m_selection.start().line()), -1));
             }
 
             if (oldSelection.end() != m_selection.end()) {
-                tagLines(KTextEditor::LineRange(oldSelection.end().line(), m_selection.end().line()), true);
+                tag(KTextEditor::Cursor(qMin(oldSelection.end().line(), m_selection.end().line()), 0),
+                    KTextEditor::Cursor(qMax(oldSelection.end().line(), m_selection.end().line()), -1));
             }
         }
 
     } else {
         // No more selection, clean up
-        tagLines(oldSelection, true);
+        tag(oldSelection.start(), oldSelection.end());
     }
 }
 
@@ -4726,6 +4747,7 @@ void KTextEditor::ViewPrivate::slotDelayedUpdateOfView()
     // update view, if valid line range, else only feedback update wanted anyway
     if (m_lineToUpdateRange.isValid()) {
         tagLines(m_lineToUpdateRange, true);
+        m_viewInternal->m_lineScroll->invalidateMiniMapLines(m_lineToUpdateRange.start(), m_lineToUpdateRange.end());
         updateView(true);
     }
 
@@ -4914,6 +4936,12 @@ void KTextEditor::ViewPrivate::selectionChangedForHighlights()
 
     // trigger creation of ranges for current view range
     m_currentTextForHighlights = text;
+
+    // only add word boundary if we can find the text then
+    // fixes $lala hl
+    m_highlightsNeedLeadingBoundary = !text.isEmpty() && isHighlightWordChar(text.front());
+    m_highlightsNeedTrailingBoundary = !text.isEmpty() && isHighlightWordChar(text.back());
+
     createHighlights();
 }
 
@@ -4924,50 +4952,69 @@ void KTextEditor::ViewPrivate::createHighlights()
         return;
     }
 
-    // clear existing highlighting ranges, otherwise we stack over and over the same ones eventually
-    m_rangesForHighlights.clear();
+    const KTextEditor::Range visible = visibleRange();
+    const int startLine = qMax(0, visible.start().line());
+    const int endLine = qMin(visible.end().line(), doc()->lastLine());
 
-    KTextEditor::Attribute::Ptr attr(new KTextEditor::Attribute());
-    attr->setBackground(Qt::yellow);
+    // forget lines that scrolled out of view, their ranges are no longer needed
+    for (auto it = m_rangesForHighlights.begin(); it != m_rangesForHighlights.end();) {
+        if (it->first < startLine || it->first > endLine) {
+            it = m_rangesForHighlights.erase(it);
+        } else {
+            ++it;
+        }
+    }
 
-    // set correct highlight color from Kate's color schema
-    QColor fgColor = defaultStyleAttribute(KSyntaxHighlighting::Theme::TextStyle::Normal)->foreground().color();
-    QColor bgColor = rendererConfig()->searchHighlightColor();
-    attr->setForeground(fgColor);
-    attr->setBackground(bgColor);
+    KTextEditor::Attribute::Ptr attr;
+    const QStringMatcher matcher(m_currentTextForHighlights);
+    const qsizetype needleLength = m_currentTextForHighlights.size();
+    const KTextEditor::Range selection = selectionRange();
 
-    KTextEditor::Cursor start(visibleRange().start());
-    KTextEditor::Range searchRange;
+    for (int line = startLine; line <= endLine; ++line) {
+        const QString text = doc()->plainKateTextLine(line).text();
 
-    // only add word boundary if we can find the text then
-    // fixes $lala hl
-    QString pattern = QRegularExpression::escape(m_currentTextForHighlights);
-    if (m_currentTextForHighlights.contains(QRegularExpression(QLatin1String("\\b") + pattern, QRegularExpression::UseUnicodePropertiesOption))) {
-        pattern.prepend(QLatin1String("\\b"));
-    }
+        // line unchanged since we did look at it the last time? keep the ranges
+        // the text alone is not enough: lines move on wrap and unwrap and can share their text
+        // with a copy of them, the ranges moved along must still be on this line
+        auto &cached = m_rangesForHighlights[line];
+        if (!text.isEmpty() && cached.text.isSharedWith(text)
+            && std::all_of(cached.ranges.begin(), cached.ranges.end(), [line](const auto &range) {
+                   return range->start().line() == line && range->end().line() == line;
+               })) {
+            continue;
+        }
+        cached.text = text;
+        cached.ranges.clear();
+
+        for (qsizetype pos = matcher.indexIn(text); pos != -1; pos = matcher.indexIn(text, pos)) {
+            const qsizetype end = pos + needleLength;
+            if ((m_highlightsNeedLeadingBoundary && pos > 0 && isHighlightWordChar(text.at(pos - 1)))
+                || (m_highlightsNeedTrailingBoundary && end < text.size() && isHighlightWordChar(text.at(end)))) {
+                ++pos;
+                continue;
+            }
 
-    if (m_currentTextForHighlights.contains(QRegularExpression(pattern + QLatin1String("\\b"), QRegularExpression::UseUnicodePropertiesOption))) {
-        pattern += QLatin1String("\\b");
-    }
+            const KTextEditor::Range match(line, int(pos), line, int(end));
+            pos = end;
+            if (match == selection) {
+                continue;
+            }
 
-    QList<KTextEditor::Range> matches;
-    do {
-        searchRange.setRange(start, visibleRange().end());
-
-        matches = doc()->searchText(searchRange, pattern, KTextEditor::Regex);
-
-        if (matches.first().isValid()) {
-            if (matches.first() != selectionRange()) {
-                std::unique_ptr<KTextEditor::MovingRange> mr(doc()->newMovingRange(matches.first()));
-                mr->setZDepth(-90000.0); // Set the z-depth to slightly worse than the selection
-                mr->setAttribute(attr);
-                mr->setView(this);
-                mr->setAttributeOnlyForViews(true);
-                m_rangesForHighlights.push_back(std::move(mr));
+            if (!attr) {
+                // set correct highlight color from Kate's color schema
+                attr = KTextEditor::Attribute::Ptr(new KTextEditor::Attribute());
+                attr->setForeground(defaultStyleAttribute(KSyntaxHighlighting::Theme::TextStyle::Normal)->foreground().color());
+                attr->setBackground(rendererConfig()->searchHighlightColor());
             }
-            start = matches.first().end();
+
+            std::unique_ptr<KTextEditor::MovingRange> mr(doc()->newMovingRange(match));
+            mr->setZDepth(-90000.0); // Set the z-depth to slightly worse than the selection
+            mr->setAttribute(attr);
+            mr->setView(this);
+            mr->setAttributeOnlyForViews(true);
+            cached.ranges.push_back(std::move(mr));
         }
-    } while (matches.first().isValid());
+    }
 }
 
 KateAbstractInputMode *KTextEditor::ViewPrivate::currentInputMode() const
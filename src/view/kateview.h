@@ -19,8 +19,10 @@
 #include <QTimer>
 
 #include <array>
+#include <unordered_map>
 
 #include "katetextfolding.h"
+#include "katetexthighlightstore.h"
 #include "katetextrange.h"
 
 namespace KTextEditor
@@ -939,6 +941,19 @@ private:
     // do we select normal or blockwise ?
     bool blockSelect;
 
+    // results of find/replace all, too many for moving ranges
+    Kate::TextHighlightStore m_searchHighlights;
+
+public:
+    /**
+     * Highlights of all results of the last find or replace all in this view.
+     * @return search highlights
+     */
+    Kate::TextHighlightStore &searchHighlights()
+    {
+        return m_searchHighlights;
+    }
+
     // templates
 public:
     bool insertTemplateInternal(const KTextEditor::Cursor insertPosition, const QString &templateString, const QString &script = QString());
@@ -1030,7 +1045,23 @@ private:
 
     QString m_currentTextForHighlights;
 
-    std::vector<std::unique_ptr<KTextEditor::MovingRange>> m_rangesForHighlights;
+    /**
+     * Only match m_currentTextForHighlights at word boundaries at its start/end?
+     * Decided once per text in selectionChangedForHighlights().
+     */
+    bool m_highlightsNeedLeadingBoundary = false;
+    bool m_highlightsNeedTrailingBoundary = false;
+
+    /**
+     * Highlight ranges of one visible line, with the line text they were computed for.
+     * As long as the buffer still shares that text with us and the ranges are still on
+     * that line, the line is unchanged and its ranges are reused when the visible range changes.
+     */
+    struct HighlightsOfLine {
+        QString text;
+        std::vector<std::unique_ptr<KTextEditor::MovingRange>> ranges;
+    };
+    std::unordered_map<int, HighlightsOfLine> m_rangesForHighlights;
 
 public:
     /**
@@ -46,6 +46,7 @@
 #include <QActionGroup>
 #include <QBoxLayout>
 #include <QCursor>
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QKeyEvent>
 #include <QLinearGradient>
@@ -172,6 +173,59 @@ KateScrollBar::KateScrollBar(Qt::Orientation orientation, KateViewInternal *pare
     connect(this, &KateScrollBar::valueChanged, this, &KateScrollBar::sliderMaybeMoved);
     connect(m_doc, &KTextEditor::DocumentPrivate::marksChanged, this, &KateScrollBar::marksChanged);
 
+    // track which lines of the minimap need to be drawn again
+    connect(&m_miniMapTiles, &KateMiniMapTiles::updated, this, [this]() {
+        m_pixmap = m_miniMapTiles.pixmap();
+        update();
+    });
+    connect(m_doc, &KTextEditor::DocumentPrivate::textInsertedRange, this, [this](KTextEditor::Document *, KTextEditor::Range range) {
+        invalidateMiniMapLines(range.start().line(), range.onSingleLine() ? range.end().line() : -1);
+    });
+    connect(m_doc, &KTextEditor::DocumentPrivate::textRemoved, this, [this](KTextEditor::Document *, KTextEditor::Range range) {
+        invalidateMiniMapLines(range.start().line(), range.onSingleLine() ? range.end().line() : -1);
+    });
+    connect(m_doc, &KTextEditor::Document::lineWrapped, this, [this](KTextEditor::Document *, KTextEditor::Cursor position) {
+        invalidateMiniMapLines(position.line(), -1);
+    });
+    connect(m_doc, &KTextEditor::Document::lineUnwrapped, this, [this](KTextEditor::Document *, int line) {
+        invalidateMiniMapLines(std::max(0, line - 1), -1);
+    });
+    connect(m_doc, &KTextEditor::Document::documentSavedOrUploaded, this, [this]() {
+        // the saved line markers changed
+        m_miniMapTiles.invalidateAll();
+    });
+    connect(&m_doc->buffer(), &KateBuffer::tagLines, this, [this](KTextEditor::LineRange lineRange) {
+        // highlighting changed
+        invalidateMiniMapLines(lineRange.start(), lineRange.end());
+    });
+    connect(&m_doc->buffer(), &KateBuffer::highlightingAdvanced, this, [this](KTextEditor::LineRange lineRange) {
+        // recolor lines drawn without highlighting before, highlighting in idle time
+        // advances often, don't postpone the update until it is done
+        if (m_showMiniMap) {
+            invalidateMiniMapLines(lineRange.start(), lineRange.end());
+            if (!m_updateTimer.isActive()) {
+                m_updateTimer.start();
+            }
+        }
+    });
+    connect(m_doc, &KTextEditor::Document::highlightingModeChanged, this, [this]() {
+        m_miniMapTiles.invalidateAll();
+        m_updateTimer.start();
+    });
+    connect(m_view, &KTextEditor::ViewPrivate::selectionChanged, this, [this]() {
+        const KTextEditor::Range selection = m_view->selectionRange();
+        if (m_miniMapSelection.isValid() && !m_miniMapSelection.isEmpty()) {
+            invalidateMiniMapLines(m_miniMapSelection.start().line(), m_miniMapSelection.end().line());
+        }
+        if (selection.isValid() && !selection.isEmpty()) {
+            invalidateMiniMapLines(selection.start().line(), selection.end().line());
+        }
+        m_miniMapSelection = selection;
+    });
+    connect(&m_view->textFolding(), &Kate::TextFolding::foldingRangesChanged, this, [this]() {
+        m_miniMapTiles.invalidateAll();
+    });
+
     m_updateTimer.setInterval(300);
     m_updateTimer.setSingleShot(true);
 
@@ -208,6 +262,7 @@ void KateScrollBar::setShowMiniMap(bool b)
         connect(m_view, &KTextEditor::ViewPrivate::delayedUpdateOfView, &m_updateTimer, timerSlot, Qt::UniqueConnection);
         connect(&m_updateTimer, &QTimer::timeout, this, &KateScrollBar::updatePixmap, Qt::UniqueConnection);
         connect(&(m_view->textFolding()), &Kate::TextFolding::foldingRangesChanged, &m_updateTimer, timerSlot, Qt::UniqueConnection);
+        m_miniMapTiles.invalidateAll();
     } else if (!b) {
         disconnect(&m_updateTimer);
     }
@@ -270,7 +325,10 @@ void KateScrollBar::mousePressEvent(QMouseEvent *e)
     if (m_showMiniMap) {
         if (!m_sliderRect.contains(e->pos()) && m_leftMouseDown && e->pos().y() > m_mapGroveRect.top() && e->pos().y() < m_mapGroveRect.bottom()) {
             // if we show the minimap left-click jumps directly to the selected position
-            int newVal = (e->pos().y() - m_mapGroveRect.top()) / (double)m_mapGroveRect.height() * (double)(maximum() + pageStep()) - pageStep() / 2;
+            // the minimap shows lines, the scroll bar might count view lines
+            const int mapLines = m_viewInternal->scrollBarValueToLine(maximum() + pageStep());
+            const int line = (e->pos().y() - m_mapGroveRect.top()) / (double)m_mapGroveRect.height() * (double)mapLines;
+            int newVal = m_viewInternal->lineToScrollBarValue(line) - pageStep() / 2;
             newVal = qBound(0, newVal, maximum());
             setSliderPosition(newVal);
         }
@@ -426,7 +484,7 @@ void KateScrollBar::showTextPreview()
         }
 
         const qreal posInPercent = static_cast<double>(cursorPos.y() - grooveRect.top()) / grooveRect.height();
-        const qreal startLine = posInPercent * m_view->textFolding().visibleLines();
+        const qreal startLine = m_viewInternal->scrollBarValueToLine(posInPercent * m_viewInternal->lineToScrollBarValue(m_view->textFolding().visibleLines()));
 
         m_textPreview->resize(m_view->width() / 2, m_view->height() / 5);
         const int xGlobal = mapToGlobal(QPoint(0, 0)).x();
@@ -519,11 +577,20 @@ void KateScrollBar::getCharColorRanges(const QList<Kate::TextLine::Attribute> &a
     }
 }
 
-void KateScrollBar::updatePixmap()
+void KateScrollBar::invalidateMiniMapLines(int firstLine, int lastLine)
 {
-    // QElapsedTimer time;
-    // time.start();
+    if (!m_showMiniMap || firstLine < 0) {
+        return;
+    }
 
+    const Kate::TextFolding &folding = m_view->textFolding();
+    const int first = folding.lineToVisibleLine(firstLine);
+    const int last = lastLine < 0 ? -1 : folding.lineToVisibleLine(lastLine);
+    m_miniMapTiles.invalidateLines(first, last);
+}
+
+void KateScrollBar::updatePixmap()
+{
     if (!m_showMiniMap) {
         // make sure no time is wasted if the option is disabled
         return;
@@ -536,6 +603,9 @@ void KateScrollBar::updatePixmap()
         return;
     }
 
+    QElapsedTimer timer;
+    timer.start();
+
     // For performance reason, only every n-th line will be drawn if the widget is
     // sufficiently small compared to the amount of lines in the document.
     int docLineCount = m_view->textFolding().visibleLines();
@@ -564,6 +634,14 @@ void KateScrollBar::updatePixmap()
     // qCDebug(LOG_KTE) << "l" << lineIncrement << "c" << charIncrement << "d";
     // qCDebug(LOG_KTE) << "pixmap" << pixmapLineCount << pixmapLineWidth << "docLines" << m_view->textFolding().visibleLines() << "height" << m_grooveHeight;
 
+    // only tiles with changed lines are drawn again, all of them if the sampling changed
+    m_miniMapTiles.setGeometry({lineIncrement, charIncrement, pixmapLineWidth, m_view->devicePixelRatioF()}, pixmapLineCount);
+    const QList<int> dirtyTiles = m_miniMapTiles.dirtyTiles();
+    if (dirtyTiles.isEmpty()) {
+        m_miniMapTiles.finishUpdate(timer.nsecsElapsed());
+        return;
+    }
+
     const QBrush backgroundColor = m_view->defaultStyleAttribute(KSyntaxHighlighting::Theme::TextStyle::Normal)->background();
     const QBrush defaultTextColor = m_view->defaultStyleAttribute(KSyntaxHighlighting::Theme::TextStyle::Normal)->foreground();
     const QBrush selectionBgColor = m_view->rendererConfig()->selectionColor();
@@ -574,78 +652,72 @@ void KateScrollBar::updatePixmap()
     modifiedLineColor.setHsv(modifiedLineColor.hue(), 255, 255 - backgroundColor.color().value() / 3);
     savedLineColor.setHsv(savedLineColor.hue(), 100, 255 - backgroundColor.color().value() / 3);
 
-    const QBrush modifiedLineBrush = modifiedLineColor;
-    const QBrush savedLineBrush = savedLineColor;
-
-    // increase dimensions by ratio
-    m_pixmap = QPixmap(pixmapLineWidth * m_view->devicePixelRatioF(), pixmapLineCount * m_view->devicePixelRatioF());
-    m_pixmap.fill(QColor("transparent"));
-
     // The text currently selected in the document, to be drawn later.
     const KTextEditor::Range selection = m_view->selectionRange();
     const bool hasSelection = !selection.isEmpty();
+    m_miniMapSelection = selection;
     // reusable buffer for color->range
     QList<KateScrollBar::ColumnRangeWithColor> colorRangesForLine;
-    const QPen defaultTextPen = QPen(defaultTextColor, 1);
+    const QRgb defaultTextRgb = defaultTextColor.color().rgba();
     // resusable buffer for line ranges;
     QList<Kate::TextRange *> decorations;
 
-    QPainter painter;
-    if (painter.begin(&m_pixmap)) {
-        // init pen once, afterwards, only change it if color changes to avoid a lot of allocation for setPen
-        painter.setPen(QPen(selectionBgColor, 1));
+    // Never force highlighting, lines not highlighted yet are drawn in a neutral color and
+    // recolored once highlighted in idle time, see KateBuffer::highlightingAdvanced
+    const int highlightedLines = m_doc->buffer().highlightedLines();
+    m_doc->buffer().highlightInIdleTime();
+    const QRgb unhighlightedRgb = KColorUtils::mix(backgroundColor.color(), defaultTextColor.color(), 0.5).rgba();
+    const QList<Kate::TextLine::Attribute> noAttributes;
 
-        // Do not force updates of the highlighting if the document is very large
-        const bool simpleMode = m_doc->lines() > 7500;
+    // pen cache to avoid a lot of allocations from pen creation
+    QVarLengthArray<std::pair<QRgb, QPen>, 20> penCache;
 
-        int pixelY = 0;
-        int drawnLines = 0;
+    const int linesPerTile = m_miniMapTiles.linesPerTile();
+    for (const int tile : dirtyTiles) {
+        KateMiniMapTiles::Content content;
+        content.selectionColor = selectionBgColor.color().rgba();
 
-        // pen cache to avoid a lot of allocations from pen creation
-        QVarLengthArray<std::pair<QRgb, QPen>, 20> penCache;
+        const int firstLine = tile * linesPerTile;
+        const int endLine = std::min(docLineCount, firstLine + linesPerTile);
+        const int firstRow = tile * KateMiniMapTiles::RowsPerTile;
 
-        // Iterate over all visible lines, drawing them.
-        for (int virtualLine = 0; virtualLine < docLineCount; virtualLine += lineIncrement) {
+        // Iterate over all visible lines of the tile, collecting what to draw.
+        for (int virtualLine = firstLine; virtualLine < endLine; virtualLine += lineIncrement) {
             int realLineNumber = m_view->textFolding().visibleLineToLine(virtualLine);
             const Kate::TextLine kateline = m_doc->plainKateTextLine(realLineNumber);
             const QString lineText = kateline.text();
 
-            if (!simpleMode) {
-                m_doc->buffer().ensureHighlighted(realLineNumber);
-            }
-
-            // get normal highlighting stuff
-            const auto &attributes = kateline.attributesList();
+            // get normal highlighting stuff, if up to date
+            const bool highlighted = realLineNumber < highlightedLines;
+            const auto &attributes = highlighted ? kateline.attributesList() : noAttributes;
 
             // get moving ranges with attribs (semantic highlighting and co.)
             m_view->doc()->buffer().rangesForLine(realLineNumber, m_view, true, decorations);
 
-            // Draw selection if it is on an empty line
+            KateMiniMapTiles::Line line;
+            line.row = (virtualLine / lineIncrement) / charIncrement - firstRow;
 
             int pixelX = s_pixelMargin; // use this to control the offset of the text from the left
 
             if (hasSelection) {
+                // Draw selection if it is on an empty line
                 if (selection.contains(KTextEditor::Cursor(realLineNumber, 0)) && lineText.size() == 0) {
-                    if (selectionBgColor != painter.pen().brush()) {
-                        painter.setPen(QPen(selectionBgColor, 1));
-                    }
-                    painter.drawLine(s_pixelMargin, pixelY, s_pixelMargin + s_lineWidth - 1, pixelY);
+                    line.selectionStart = s_pixelMargin;
+                    line.selectionEnd = s_pixelMargin + s_lineWidth - 1;
                 }
-                // Iterate over the line to draw the background
-                int selStartX = -1;
-                int selEndX = -1;
+                // Iterate over the line to find the background
                 for (int x = 0; (x < lineText.size() && x < s_lineWidth); x += charIncrement) {
                     if (pixelX >= s_lineWidth + s_pixelMargin) {
                         break;
                     }
                     // Query the selection and draw it behind the character
                     if (selection.contains(KTextEditor::Cursor(realLineNumber, x))) {
-                        if (selStartX == -1) {
-                            selStartX = pixelX;
+                        if (line.selectionStart == -1) {
+                            line.selectionStart = pixelX;
                         }
-                        selEndX = pixelX;
+                        line.selectionEnd = pixelX;
                         if (lineText.size() - 1 == x) {
-                            selEndX = s_lineWidth + s_pixelMargin - 1;
+                            line.selectionEnd = s_lineWidth + s_pixelMargin - 1;
                         }
                     }
 
@@ -655,13 +727,6 @@ void KateScrollBar::updatePixmap()
                         pixelX++;
                     }
                 }
-
-                if (selStartX != -1) {
-                    if (selectionBgColor != painter.pen().brush()) {
-                        painter.setPen(QPen(selectionBgColor, 1));
-                    }
-                    painter.drawLine(selStartX, pixelY, selEndX, pixelY);
-                }
             }
 
             // Iterate over all the characters in the current line
@@ -672,71 +737,57 @@ void KateScrollBar::updatePixmap()
                     break;
                 }
 
-                // draw the pixels
+                // collect the pixels
                 if (lineText[x] == QLatin1Char(' ')) {
                     pixelX++;
                 } else if (lineText[x] == QLatin1Char('\t')) {
                     pixelX += qMax(4 / charIncrement, 1); // FIXME: tab width...
                 } else {
-                    const QPen *pen = nullptr;
+                    // get the column range and color in which this 'x' lies
+                    QRgb color = highlighted ? defaultTextRgb : unhighlightedRgb;
                     int rangeEnd = x + 1;
                     for (const auto &cr : colorRangesForLine) {
                         if (cr.startColumn <= x && x <= cr.endColumn) {
                             rangeEnd = cr.endColumn;
                             if (cr.penIndex != -1) {
-                                pen = &penCache[cr.penIndex].second;
+                                color = penCache[cr.penIndex].first;
                             }
                         }
                     }
 
-                    if (!pen) {
-                        pen = &defaultTextPen;
-                    }
-                    // get the column range and color in which this 'x' lies
-                    painter.setPen(*pen);
-
-                    // Actually draw the pixels with the color queried from the renderer.
-                    QVarLengthArray<QPoint, 100> points;
+                    // the pixels of the range are drawn with the color queried from the renderer
+                    const int runStart = pixelX;
                     for (; x < rangeEnd; x += charIncrement) {
                         if (pixelX >= s_lineWidth + s_pixelMargin) {
                             break;
                         }
-                        points.append({pixelX++, pixelY});
+                        pixelX++;
                     }
-                    painter.drawPoints(points.data(), points.size());
+                    line.runs.push_back({runStart, pixelX - runStart, color});
                 }
             }
-            drawnLines++;
-            if (((drawnLines) % charIncrement) == 0) {
-                pixelY++;
-            }
+            content.lines.push_back(std::move(line));
         }
-        // qCDebug(LOG_KTE) << drawnLines;
-        // Draw line modification marker map.
+
+        // Collect line modification markers.
         // Disable this if the document is really huge,
         // since it requires querying every line.
         if (m_doc->lines() < 50000) {
-            for (int lineno = 0; lineno < docLineCount; lineno++) {
+            for (int lineno = firstLine; lineno < endLine; lineno++) {
                 int realLineNo = m_view->textFolding().visibleLineToLine(lineno);
                 const auto line = m_doc->plainKateTextLine(realLineNo);
-                const QBrush &col = line.markedAsModified() ? modifiedLineBrush : savedLineBrush;
                 if (line.markedAsModified() || line.markedAsSavedOnDisk()) {
-                    int pos = (lineno * pixmapLineCount) / pixmapLinesUnscaled;
-                    painter.fillRect(2, pos, 3, 1, col);
+                    const QColor &col = line.markedAsModified() ? modifiedLineColor : savedLineColor;
+                    content.markers.push_back({(lineno / lineIncrement) / charIncrement - firstRow, col.rgba()});
                 }
             }
         }
 
-        // end painting
-        painter.end();
+        m_miniMapTiles.render(tile, std::move(content));
     }
 
-    // set right ratio
-    m_pixmap.setDevicePixelRatio(m_view->devicePixelRatioF());
-
-    // qCDebug(LOG_KTE) << time.elapsed();
-    // Redraw the scrollbar widget with the updated pixmap.
-    update();
+    // the pixmap is updated once the worker is done with the tiles
+    m_miniMapTiles.finishUpdate(timer.nsecsElapsed());
 }
 
 void KateScrollBar::miniMapPaintEvent(QPaintEvent *e)
@@ -781,9 +832,12 @@ void KateScrollBar::miniMapPaintEvent(QPaintEvent *e)
     m_mapGroveRect = docRect;
 
     // calculate the visible area
-    int max = qMax(maximum() + 1, 1);
-    int visibleStart = value() * docHeight / (max + pageStep()) + docRect.top() + 0.5;
-    int visibleEnd = (value() + pageStep()) * docHeight / (max + pageStep()) + docRect.top();
+    // the minimap shows lines, the scroll bar might count view lines
+    const int max = qMax(m_viewInternal->scrollBarValueToLine(maximum()) + 1, 1);
+    const int startLine = m_viewInternal->scrollBarValueToLine(value());
+    const int page = qMax(m_viewInternal->scrollBarValueToLine(value() + pageStep()) - startLine, 1);
+    int visibleStart = startLine * docHeight / (max + page) + docRect.top() + 0.5;
+    int visibleEnd = (startLine + page) * docHeight / (max + page) + docRect.top();
     QRect visibleRect = docRect;
     visibleRect.moveTop(visibleStart);
     visibleRect.setHeight(visibleEnd - visibleStart);
@@ -1021,7 +1075,7 @@ void KateScrollBar::recomputeMarksPositions()
     }
 
     // get total visible (=without folded) lines in the document
-    int visibleLines = m_view->textFolding().visibleLines() - 1;
+    int visibleLines = m_viewInternal->lineToScrollBarValue(m_view->textFolding().visibleLines()) - 1;
     if (m_view->config()->scrollPastEnd()) {
         visibleLines += m_viewInternal->linesDisplayed() - 1;
         visibleLines -= m_view->config()->autoCenterLines();
@@ -1032,7 +1086,7 @@ void KateScrollBar::recomputeMarksPositions()
     const QHash<int, KTextEditor::Mark *> &marks = m_doc->marks();
     for (QHash<int, KTextEditor::Mark *>::const_iterator i = marks.constBegin(); i != marks.constEnd(); ++i) {
         KTextEditor::Mark *mark = i.value();
-        const int line = m_view->textFolding().lineToVisibleLine(mark->line);
+        const int line = m_viewInternal->lineToScrollBarValue(m_view->textFolding().lineToVisibleLine(mark->line));
         const double ratio = static_cast<double>(line) / visibleLines;
         m_lines.insert(top + (int)(h * ratio), KateRendererConfig::global()->lineMarkerColor((KTextEditor::Document::MarkTypes)mark->type));
     }
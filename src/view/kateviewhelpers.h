@@ -23,9 +23,11 @@
 #include <QScrollBar>
 #include <QTimer>
 
+#include "kateminimaptiles.h"
 #include "katetextline.h"
 #include <ktexteditor/cursor.h>
 #include <ktexteditor/message.h>
+#include <ktexteditor/range.h>
 
 namespace KTextEditor
 {
@@ -149,11 +151,26 @@ public:
         update();
     }
 
+    /**
+     * Draw the whole minimap again, e.g. after the colors changed.
+     */
     inline void queuePixmapUpdate()
     {
+        m_miniMapTiles.invalidateAll();
         m_updateTimer.start();
     }
 
+    /**
+     * Draw the given real lines of the minimap again with the next update.
+     * @param lastLine last line to draw, -1 for all lines behind the first one
+     */
+    void invalidateMiniMapLines(int firstLine, int lastLine);
+
+    const KateMiniMapTiles &miniMapTiles() const
+    {
+        return m_miniMapTiles;
+    }
+
 Q_SIGNALS:
     void sliderMMBMoved(int value);
 
@@ -218,6 +235,9 @@ private:
     int m_miniMapWidth;
 
     QPixmap m_pixmap;
+    KateMiniMapTiles m_miniMapTiles;
+    // selection drawn into the minimap
+    KTextEditor::Range m_miniMapSelection;
     int m_grooveHeight;
     QRect m_stdGroveRect;
     QRect m_mapGroveRect;
@@ -54,6 +54,8 @@
 #include <QStyle>
 #include <QToolTip>
 
+#include <limits>
+
 static const bool debugPainting = false;
 
 class ZoomEventFilter
@@ -190,10 +192,9 @@ KateViewInternal::KateViewInternal(KTextEditor::ViewPrivate *view)
     // Hijack the line scroller's controls, so we can scroll nicely for word-wrap
     connect(m_lineScroll, &KateScrollBar::actionTriggered, this, &KateViewInternal::scrollAction);
 
-    auto viewScrollLinesSlot = qOverload<int>(&KateViewInternal::scrollLines);
-    connect(m_lineScroll, &KateScrollBar::sliderMoved, this, viewScrollLinesSlot);
-    connect(m_lineScroll, &KateScrollBar::sliderMMBMoved, this, viewScrollLinesSlot);
-    connect(m_lineScroll, &KateScrollBar::valueChanged, this, viewScrollLinesSlot);
+    connect(m_lineScroll, &KateScrollBar::sliderMoved, this, &KateViewInternal::scrollToScrollBarValue);
+    connect(m_lineScroll, &KateScrollBar::sliderMMBMoved, this, &KateViewInternal::scrollToScrollBarValue);
+    connect(m_lineScroll, &KateScrollBar::valueChanged, this, &KateViewInternal::scrollToScrollBarValue);
 
     //
     // scrollbar for columns
@@ -241,6 +242,13 @@ KateViewInternal::KateViewInternal(KTextEditor::ViewPrivate *view)
 
     cache()->setWrap(m_view->dynWordWrap());
 
+    // lines counted in idle time change the scroll geometry under dynamic word wrap
+    connect(cache(), &KateLayoutCache::viewLineCountsChanged, this, [this]() {
+        if (view()->dynWordWrap()) {
+            updateLineScrollBar(false);
+        }
+    });
+
     //
     // iconborder ;)
     //
@@ -399,6 +407,12 @@ void KateViewInternal::scrollLines(int line)
     scrollPos(newPos);
 }
 
+void KateViewInternal::scrollToScrollBarValue(int value)
+{
+    KTextEditor::Cursor newPos = scrollBarValueToStartPos(value);
+    scrollPos(newPos);
+}
+
 // This can scroll less than one true line
 void KateViewInternal::scrollViewLines(int offset)
 {
@@ -406,10 +420,52 @@ void KateViewInternal::scrollViewLines(int offset)
     scrollPos(c);
 
     bool blocked = m_lineScroll->blockSignals(true);
-    m_lineScroll->setValue(startLine());
+    m_lineScroll->setValue(scrollBarValue(startPos()));
     m_lineScroll->blockSignals(blocked);
 }
 
+int KateViewInternal::scrollBarValue(const KTextEditor::Cursor virtualCursor)
+{
+    if (!view()->dynWordWrap()) {
+        return virtualCursor.line();
+    }
+
+    // the view line of the cursor inside of its line, the line is laid out anyway when scrolled to
+    const KTextEditor::Cursor realCursor(view()->textFolding().visibleLineToLine(virtualCursor.line()), virtualCursor.column());
+    const qint64 value = cache()->viewLinesBefore(virtualCursor.line()) + cache()->viewLine(realCursor);
+    return int(std::min<qint64>(value, std::numeric_limits<int>::max()));
+}
+
+KTextEditor::Cursor KateViewInternal::scrollBarValueToStartPos(int value)
+{
+    if (!view()->dynWordWrap()) {
+        return KTextEditor::Cursor(value, 0);
+    }
+
+    // the count of the line might have been an estimate, stay inside of it
+    const auto [virtualLine, viewLine] = cache()->lineForViewLine(value);
+    const int realLine = view()->textFolding().visibleLineToLine(virtualLine);
+    const KateTextLayout layout = cache()->textLayout(realLine, std::min(viewLine, cache()->lastViewLine(realLine)));
+    return KTextEditor::Cursor(virtualLine, layout.isValid() ? layout.startCol() : 0);
+}
+
+int KateViewInternal::lineToScrollBarValue(int virtualLine)
+{
+    // lines behind the document, e.g. for scroll past end, count one view line each
+    const int lines = view()->textFolding().visibleLines();
+    const qint64 value = cache()->viewLinesBefore(std::min(virtualLine, lines)) + std::max(0, virtualLine - lines);
+    return int(std::min<qint64>(value, std::numeric_limits<int>::max()));
+}
+
+int KateViewInternal::scrollBarValueToLine(int value)
+{
+    const qint64 total = cache()->totalViewLines();
+    if (value >= total) {
+        return view()->textFolding().visibleLines() + int(value - total);
+    }
+    return cache()->lineForViewLine(value).first;
+}
+
 void KateViewInternal::scrollAction(int action)
 {
     switch (action) {
@@ -589,6 +645,22 @@ void KateViewInternal::scrollColumns(int x)
     m_columnScroll->blockSignals(blocked);
 }
 
+int KateViewInternal::updateLineScrollBar(bool changed)
+{
+    // under dynamic word wrap the scroll bar counts view lines, the thumb then moves evenly
+    // through wrapped lines and its size matches the share of the document that is visible
+    const KTextEditor::Cursor maxStart = maxStartPos(changed);
+    const int maxLineScrollRange = scrollBarValue(maxStart);
+
+    const bool blocked = m_lineScroll->blockSignals(true);
+    m_lineScroll->setRange(0, maxLineScrollRange);
+    m_lineScroll->setValue(scrollBarValue(startPos()));
+    m_lineScroll->setSingleStep(1);
+    m_lineScroll->setPageStep(qMax(0, height()) / renderer()->lineHeight());
+    m_lineScroll->blockSignals(blocked);
+    return maxLineScrollRange;
+}
+
 // If changed is true, the lines that have been set dirty have been updated.
 void KateViewInternal::updateView(bool changed, int viewLinesScrolled)
 {
@@ -621,16 +693,7 @@ void KateViewInternal::updateView(bool changed, int viewLinesScrolled)
     cache()->updateViewCache(startPos(), newSize, viewLinesScrolled);
     m_visibleLineCount = newSize;
 
-    KTextEditor::Cursor maxStart = maxStartPos(changed);
-    int maxLineScrollRange = maxStart.line();
-    if (view()->dynWordWrap() && maxStart.column() != 0) {
-        maxLineScrollRange++;
-    }
-    m_lineScroll->setRange(0, maxLineScrollRange);
-
-    m_lineScroll->setValue(startLine());
-    m_lineScroll->setSingleStep(1);
-    m_lineScroll->setPageStep(qMax(0, height()) / renderer()->lineHeight());
+    const int maxLineScrollRange = updateLineScrollBar(changed);
     m_lineScroll->blockSignals(blocked);
 
     KateViewConfig::ScrollbarMode show_scrollbars = static_cast<KateViewConfig::ScrollbarMode>(view()->config()->showScrollbars());
@@ -838,11 +901,11 @@ QPoint KateViewInternal::cursorToCoordinate(const KTextEditor::Cursor cursor, bo
     // only set x value if we have a valid layout (bug #171027)
     if (layout.isValid()) {
         if (!layout.isRightToLeft() || (layout.isRightToLeft() && view()->dynWordWrap())) {
-            x = (int)layout.lineLayout().cursorToX(cursor.column());
+            x = (int)layout.cursorToX(cursor.column());
         } else /* rtl + dynWordWrap == false */ {
             // if text is rtl and dynamic wrap is false, the x offsets are in the opposite
             // direction i.e., [0] == biggest offset, [1] = next
-            x = (int)layout.lineLayout().cursorToX(textLength - cursor.column());
+            x = (int)layout.cursorToX(textLength - cursor.column());
         }
     }
     //  else
@@ -1065,7 +1128,7 @@ public:
                     }
 
                 } else {
-                    m_cursor.setColumn(thisLine->layout()->nextCursorPosition(column()));
+                    m_cursor.setColumn(thisLine->nextCursorPosition(column()));
                 }
             }
         } else {
@@ -1075,7 +1138,7 @@ public:
                 } else if (column() == 0) {
                     break;
                 } else {
-                    m_cursor.setColumn(thisLine->layout()->previousCursorPosition(column()));
+                    m_cursor.setColumn(thisLine->previousCursorPosition(column()));
                 }
             }
         }
@@ -1137,7 +1200,7 @@ public:
                     continue;
                 }
 
-                m_cursor.setColumn(thisLine->layout()->nextCursorPosition(column()));
+                m_cursor.setColumn(thisLine->nextCursorPosition(column()));
             }
 
         } else {
@@ -1167,7 +1230,7 @@ public:
                 if (column() > thisLine->length()) {
                     m_cursor.setColumn(column() - 1);
                 } else {
-                    m_cursor.setColumn(thisLine->layout()->previousCursorPosition(column()));
+                    m_cursor.setColumn(thisLine->previousCursorPosition(column()));
                 }
             }
         }
@@ -2976,6 +3039,28 @@ bool KateViewInternal::tagLines(KTextEditor::Cursor start, KTextEditor::Cursor e
     return ret;
 }
 
+bool KateViewInternal::damageLines(KTextEditor::Cursor start, KTextEditor::Cursor end)
+{
+    start = toVirtualCursor(start);
+    end = toVirtualCursor(end);
+    if (end.line() < startLine() || start.line() > startLine() + cache()->viewCacheLineCount()) {
+        return false;
+    }
+
+    cache()->updateViewCache(startPos());
+
+    bool ret = false;
+    for (int z = 0; z < cache()->viewCacheLineCount(); z++) {
+        KateTextLayout &line = cache()->viewLine(z);
+        if ((line.virtualLine() > start.line() || (line.virtualLine() == start.line() && line.endCol() >= start.column() && start.column() != -1))
+            && (line.virtualLine() < end.line() || (line.virtualLine() == end.line() && (line.startCol() <= end.column() || end.column() == -1)))) {
+            line.setDirty();
+            ret = true;
+        }
+    }
+    return ret;
+}
+
 bool KateViewInternal::tagRange(KTextEditor::Range range, bool realCursors)
 {
     return tagLines(range.start(), range.end(), realCursors);
@@ -2990,6 +3075,45 @@ void KateViewInternal::tagAll()
     m_leftBorder->update();
 }
 
+QRect KateViewInternal::caretRect(const KTextEditor::Cursor realCursor)
+{
+    const int viewLine = cache()->displayViewLine(toVirtualCursor(realCursor), true);
+    if (viewLine < 0 || viewLine >= cache()->viewCacheLineCount()) {
+        return QRect();
+    }
+
+    const int h = renderer()->lineHeight();
+    const QRect viewLineRect(0, viewLine * h, width(), h);
+
+    // inline notes move the caret, right to left text paints it on the other side, repaint the whole view line for them
+    const KateTextLayout &line = cache()->viewLine(viewLine);
+    if (!line.isValid() || line.isRightToLeft() || !view()->inlineNotes(realCursor.line()).isEmpty()) {
+        return viewLineRect;
+    }
+
+    // from the cursor up to the next character, block carets are as wide as the character, at least a space
+    const int x = renderer()->cursorToX(line, realCursor, !view()->wrapCursor()) - startX();
+    const int nextX = renderer()->cursorToX(line, KTextEditor::Cursor(realCursor.line(), realCursor.column() + 1), true) - startX();
+    const int left = std::min(x, nextX) - 2;
+    const int right = std::max(x + int(renderer()->spaceWidth()), nextX) + 2;
+    return QRect(left, viewLine * h, right - left, h).intersected(viewLineRect);
+}
+
+void KateViewInternal::updateCarets()
+{
+    // the caret is painted on top of the layout, no need to lay out the lines again like tagLine does
+    update(caretRect(m_cursor));
+
+    const int s = view()->firstDisplayedLine();
+    const int e = view()->lastDisplayedLine();
+    for (const auto &c : view()->m_secondaryCursors) {
+        const auto p = c.cursor();
+        if (p.line() >= s && p.line() <= e) {
+            update(caretRect(p));
+        }
+    }
+}
+
 void KateViewInternal::paintCursor()
 {
     if (tagLine(m_displayCursor)) {
@@ -3904,15 +4028,16 @@ void KateViewInternal::paintEvent(QPaintEvent *e)
         qCDebug(LOG_KTE) << "GOT PAINT EVENT: Region" << e->region();
     }
 
+    // only the damaged parts are painted, Qt's backing store keeps the rest of the last frame
+    const QRegion &region = e->region();
     const QRect &unionRect = e->rect();
 
-    int xStart = startX() + unionRect.x();
-    int xEnd = xStart + unionRect.width();
-    uint h = renderer()->lineHeight();
-    uint startz = (unionRect.y() / h);
-    uint endz = startz + 1 + (unionRect.height() / h);
-    uint lineRangesSize = cache()->viewCacheLineCount();
+    const int h = renderer()->lineHeight();
+    const int startz = (unionRect.y() / h);
+    const int endz = startz + 1 + (unionRect.height() / h);
+    const int lineRangesSize = cache()->viewCacheLineCount();
     const KTextEditor::Cursor pos = m_cursor;
+    int linesPainted = 0;
 
     QPainter paint(this);
 
@@ -3929,60 +4054,71 @@ void KateViewInternal::paintEvent(QPaintEvent *e)
 
     // paint line by line
     // this includes parts that span areas without real lines
-    // translate to first line to paint
-    paint.translate(unionRect.x(), startz * h);
-    for (uint z = startz; z <= endz; z++) {
+    const KateLineLayout *lastPaintedLayout = nullptr;
+    for (int z = startz; z <= endz; z++) {
+        // view lines without damage stay as they are
+        const QRect viewLineRect(0, z * h, width(), h);
+        if (!region.intersects(viewLineRect)) {
+            continue;
+        }
+
         // paint regions without lines mapped to
         if ((z >= lineRangesSize) || (cache()->viewLine(z).line() == -1)) {
             if (!(z >= lineRangesSize)) {
                 cache()->viewLine(z).setDirty(false);
             }
-            paint.fillRect(0, 0, unionRect.width(), h, m_view->rendererConfig()->backgroundColor());
+            paint.fillRect(region.intersected(viewLineRect).boundingRect(), m_view->rendererConfig()->backgroundColor());
+            continue;
         }
 
         // paint text lines
-        else {
-            // If viewLine() returns non-zero, then a document line was split
-            // in several visual lines, and we're trying to paint visual line
-            // that is not the first.  In that case, this line was already
-            // painted previously, since KateRenderer::paintTextLine paints
-            // all visual lines.
-            //
-            // Except if we're at the start of the region that needs to
-            // be painted -- when no previous calls to paintTextLine were made.
-            KateTextLayout &thisLine = cache()->viewLine(z);
-            if (!thisLine.viewLine() || z == startz) {
-                // paint our line
-                // set clipping region to only paint the relevant parts
-                paint.save();
-                const int thisLineTop = h * thisLine.viewLine();
-                paint.translate(QPoint(0, -thisLineTop));
-
-                // compute rect for line, fill the stuff
-                // important: as we allow some ARGB colors for other stuff, it is REALLY important to fill the full range once!
-                const QRectF lineRect(0, 0, unionRect.width(), h * thisLine.kateLineLayout()->viewLineCount());
-                paint.fillRect(lineRect, m_view->rendererConfig()->backgroundColor());
-
-                // THIS IS ULTRA EVIL AND ADDS STRANGE RENDERING ARTIFACTS WITH SCALING!!!!
-                // SEE BUG https://bugreports.qt.io/browse/QTBUG-66036
-                // => using a QRectF solves the cut of 1 pixel, the same call with QRect does create artifacts!
-                paint.setClipRect(lineRect);
-
-                // QTextLayout::draw does not take into account QPainter's viewport, so it will try to render
-                // lines outside visible bounds. This causes a significant slowdown when a very long line
-                // dynamically broken into multiple lines. To avoid this, an explicit text clip rect is set.
-                const QRect textClipRect{xStart, thisLineTop, xEnd - xStart, height()};
-
-                renderer()->paintTextLine(paint, thisLine.kateLineLayout(), xStart, xEnd, textClipRect.toRectF(), &pos);
-                paint.restore();
-
-                // line painted, reset and state + mark line as non-dirty
-                thisLine.setDirty(false);
-            }
+        // KateRenderer::paintTextLine paints all visual lines of a document line split into several
+        // ones at once, the damage of all of them is repainted with the first damaged one.
+        KateTextLayout &thisLine = cache()->viewLine(z);
+        KateLineLayout *lineLayout = thisLine.kateLineLayout();
+        thisLine.setDirty(false);
+        if (lineLayout == lastPaintedLayout) {
+            continue;
         }
+        lastPaintedLayout = lineLayout;
+
+        // damaged part of all visual lines of this line
+        const int layoutTop = h * (z - thisLine.viewLine());
+        const QRect layoutRect(0, layoutTop, width(), h * lineLayout->viewLineCount());
+        const QRect damage = region.intersected(layoutRect).boundingRect();
+        const int xStart = startX() + damage.x();
+        const int xEnd = xStart + damage.width();
+
+        // paint our line
+        // set clipping region to only paint the relevant parts
+        paint.save();
+        paint.translate(damage.x(), layoutTop);
+
+        // compute rect for line, fill the stuff
+        // important: as we allow some ARGB colors for other stuff, it is REALLY important to fill the full range once!
+        const QRectF lineRect(0, 0, damage.width(), layoutRect.height());
+        paint.fillRect(lineRect, m_view->rendererConfig()->backgroundColor());
 
-        // translate to next line
-        paint.translate(0, h);
+        // THIS IS ULTRA EVIL AND ADDS STRANGE RENDERING ARTIFACTS WITH SCALING!!!!
+        // SEE BUG https://bugreports.qt.io/browse/QTBUG-66036
+        // => using a QRectF solves the cut of 1 pixel, the same call with QRect does create artifacts!
+        paint.setClipRect(lineRect);
+
+        // QTextLayout::draw does not take into account QPainter's viewport, so it will try to render
+        // lines outside visible bounds. This causes a significant slowdown when a very long line
+        // dynamically broken into multiple lines. To avoid this, an explicit text clip rect is set.
+        const QRect textClipRect{xStart, damage.y() - layoutTop, xEnd - xStart, damage.height()};
+
+        renderer()->paintTextLine(paint, lineLayout, xStart, xEnd, textClipRect.toRectF(), &pos);
+        paint.restore();
+        ++linesPainted;
+    }
+
+    m_paintStatistics.frames++;
+    m_paintStatistics.linesPainted += linesPainted;
+    m_paintStatistics.lastFrameLinesPainted = linesPainted;
+    if (debugPainting) {
+        qCDebug(LOG_KTE) << "Painted" << linesPainted << "lines";
     }
 
     paint.restore();
@@ -4084,7 +4220,7 @@ void KateViewInternal::cursorTimeout()
 {
     if (!debugPainting && m_currentInputMode->blinkCaret()) {
         renderer()->setDrawCaret(!renderer()->drawCaret());
-        paintCursor();
+        updateCarets();
     }
 }
 
@@ -4360,6 +4496,7 @@ void KateViewInternal::clear()
     view()->clearSecondaryCursors();
     cache()->clear();
     updateView(true);
+    m_lineScroll->invalidateMiniMapLines(0, -1);
     m_lineScroll->updatePixmap();
 }
 
@@ -4435,8 +4572,8 @@ void KateViewInternal::scrollPrepareEvent(QScrollPrepareEvent *event)
 
 void KateViewInternal::scrollEvent(QScrollEvent *event)
 {
-    // FIXME Add horizontal scrolling, overscroll, scroll between lines, and word wrap awareness
-    KTextEditor::Cursor newPos((int)event->contentPos().y() / renderer()->lineHeight(), 0);
+    // FIXME Add horizontal scrolling, overscroll, scroll between lines
+    KTextEditor::Cursor newPos = scrollBarValueToStartPos((int)event->contentPos().y() / renderer()->lineHeight());
     scrollPos(newPos);
     event->accept();
 }
@@ -111,6 +111,12 @@ public:
 
     bool tagRange(KTextEditor::Range range, bool realCursors);
 
+    /**
+     * Mark the view lines between the real cursors for repaint, without laying them out again like tagLines.
+     * Enough for everything painted on top of the layouts, e.g. the selection.
+     */
+    bool damageLines(KTextEditor::Cursor start, KTextEditor::Cursor end);
+
     void tagAll();
 
     void updateDirty();
@@ -123,6 +129,17 @@ private Q_SLOTS:
     void updateView(bool changed = false, int viewLinesScrolled = 0);
 
 private:
+    /**
+     * Scroll bar value of a virtual cursor and the start position for a value.
+     */
+    int scrollBarValue(const KTextEditor::Cursor virtualCursor);
+    KTextEditor::Cursor scrollBarValueToStartPos(int value);
+
+    /**
+     * Update range and value of the line scroll bar, returns its maximum.
+     */
+    int updateLineScrollBar(bool changed);
+
     void makeVisible(const KTextEditor::Cursor c, int endCol, bool force = false, bool center = false, bool calledExternally = false);
 
 public:
@@ -145,6 +162,13 @@ public:
 
     KateTextLayout yToKateTextLayout(int y) const;
 
+    /**
+     * Values of the line scroll bar are visible lines, under dynamic word wrap view lines,
+     * see KateLayoutCache::viewLinesBefore.
+     */
+    int lineToScrollBarValue(int virtualLine);
+    int scrollBarValueToLine(int value);
+
     void dynWrapChanged();
 
 public Q_SLOTS:
@@ -154,8 +178,14 @@ public Q_SLOTS:
 
     void paintCursor();
 
+    /**
+     * Repaint just the carets, e.g. when they blink.
+     */
+    void updateCarets();
+
 private Q_SLOTS:
-    void scrollLines(int line); // connected to the sliderMoved of the m_lineScroll
+    void scrollLines(int line);
+    void scrollToScrollBarValue(int value); // connected to the sliderMoved of the m_lineScroll
     void scrollViewLines(int offset);
     void scrollAction(int action);
     void scrollNextPage();
@@ -239,6 +269,31 @@ public:
         return m_leftBorder;
     }
 
+    /**
+     * Counters of the paint events, to see how much of the view a change repaints.
+     */
+    struct PaintStatistics {
+        quint64 frames = 0;
+        quint64 linesPainted = 0;
+        int lastFrameLinesPainted = 0;
+    };
+
+    const PaintStatistics &paintStatistics() const
+    {
+        return m_paintStatistics;
+    }
+
+    void resetPaintStatistics()
+    {
+        m_paintStatistics = PaintStatistics();
+    }
+
+private:
+    // area the caret at the real cursor is painted in, empty if not visible
+    QRect caretRect(const KTextEditor::Cursor realCursor);
+
+    PaintStatistics m_paintStatistics;
+
     // EVENT HANDLING STUFF - IMPORTANT
 private:
     void fixDropEvent(QDropEvent *event);
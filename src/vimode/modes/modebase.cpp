@@ -955,7 +955,7 @@ Range ModeBase::goVisualLineUpDown(int lines)
         const Kate::TextLine startLine = doc()->plainKateTextLine(c.line());
         // Adjust for the fact that if the portion of the line before wrapping is indented,
         // the continuations are also "invisibly" (i.e. without any spaces in the text itself) indented.
-        const bool isWrappedContinuation = (cache->textLayout(startRealLine, startVisualLine).lineLayout().lineNumber() != 0);
+        const bool isWrappedContinuation = (cache->textLayout(startRealLine, startVisualLine).viewLine() != 0);
         const int numInvisibleIndentChars = [&] {
             if (isWrappedContinuation) {
                 auto l = doc()->plainKateTextLine(startRealLine);
@@ -977,7 +977,7 @@ Range ModeBase::goVisualLineUpDown(int lines)
     const Kate::TextLine endLine = doc()->plainKateTextLine(r.endLine);
     // Adjust for the fact that if the portion of the line before wrapping is indented,
     // the continuations are also "invisibly" (i.e. without any spaces in the text itself) indented.
-    const bool isWrappedContinuation = (cache->textLayout(finishRealLine, finishVisualLine).lineLayout().lineNumber() != 0);
+    const bool isWrappedContinuation = (cache->textLayout(finishRealLine, finishVisualLine).viewLine() != 0);
     const int numInvisibleIndentChars = [&] {
         if (isWrappedContinuation) {
             auto l = doc()->plainKateTextLine(finishRealLine);